@@ -38,13 +38,15 @@ public class BaseFPS : ModuleRules
 				"AudioModulation",
 				"AudioMixer",
 				"AudioMixerCore",
-				"ModularGameplayActors"
+				"ModularGameplayActors",
+				"NetCore"
 			}
 		);
 		
 		PrivateDependencyModuleNames.AddRange(
 			new string[] {
-				"ReplicationGraph"
+				"ReplicationGraph",
+				"PhysicsCore"
 			}
 		);
 
@@ -10,6 +10,9 @@
 
 BASEFPS_API DECLARE_LOG_CATEGORY_EXTERN(LogBaseFPS, Log, All);
 
+/** stat group for game-side systems (view with "stat BaseFPS") */
+DECLARE_STATS_GROUP(TEXT("BaseFPS"), STATGROUP_BaseFPS, STATCAT_Advanced);
+
 /**
  * Front-end labels used by the BaseGameUIPolicy (see Blueprint)
  */
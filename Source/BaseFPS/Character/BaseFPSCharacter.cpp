@@ -4,16 +4,41 @@
 
 #include "BaseFPS.h"
 #include "BaseFPSCharacterMovement.h"
+#include "CharacterSignificanceSubsystem.h"
+#include "Components/InteractableSubsystem.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "EnhancedInputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Input/Reply.h"
+#include "Misc/AutomationTest.h"
 #include "Net/UnrealNetwork.h"
+#include "Online/CosmeticFireRelevancySubsystem.h"
+#include "Online/LagCompensationSubsystem.h"
+#include "Pickups/PickupInstance.h"
+#include "Pickups/PickupRenderSubsystem.h"
+#include "System/ActorPoolSubsystem.h"
 #include "Weapons/Weapon.h"
 #include "Weapons/WeaponAttachment.h"
 
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_NetMovement_LocationQuantizeLevel = 0;
+static FAutoConsoleVariableRef CVarBaseFPSNetMovementLocationQuantizeLevel(TEXT("BaseFPS.NetMovement.LocationQuantizeLevel"), CVar_BaseFPS_NetMovement_LocationQuantizeLevel, TEXT("Replicated character location precision: 0 = 1cm, 1 = 0.1cm, 2 = 0.01cm"), ECVF_Default );
+
+float CVar_BaseFPS_NetMovement_SlowSpeed = 100.f;
+static FAutoConsoleVariableRef CVarBaseFPSNetMovementSlowSpeed(TEXT("BaseFPS.NetMovement.SlowSpeed"), CVar_BaseFPS_NetMovement_SlowSpeed, TEXT("Replicated velocities below this speed are sent with 0.1cm/s precision"), ECVF_Default );
+
+float CVar_BaseFPS_NetMovement_FastSpeed = 2000.f;
+static FAutoConsoleVariableRef CVarBaseFPSNetMovementFastSpeed(TEXT("BaseFPS.NetMovement.FastSpeed"), CVar_BaseFPS_NetMovement_FastSpeed, TEXT("Replicated velocities at or above this speed are sent with 4cm/s precision (1cm/s otherwise)"), ECVF_Default );
+
+float CVar_BaseFPS_Inventory_StowDelay = 2.f;
+static FAutoConsoleVariableRef CVarBaseFPSInventoryStowDelay(TEXT("BaseFPS.Inventory.StowDelay"), CVar_BaseFPS_Inventory_StowDelay, TEXT("Seconds a holstered item keeps its actor before it's stowed as plain inventory data (class and ammo) and the actor goes back to the pool. Negative keeps holstered items as actors"), ECVF_Default );
+
+ABaseFPSCharacter::FOnCharacterCombatEventSignature ABaseFPSCharacter::GlobalOnCharacterCombatEvent;
+ABaseFPSCharacter::FOnCharacterInventoryChangedSignature ABaseFPSCharacter::GlobalOnCharacterInventoryChanged;
+
 ABaseFPSCharacter::ABaseFPSCharacter(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer.SetDefaultSubobjectClass<UBaseFPSCharacterMovement>(ACharacter::CharacterMovementComponentName))
 {
@@ -48,12 +73,12 @@ ABaseFPSCharacter::ABaseFPSCharacter(const FObjectInitializer& ObjectInitializer
 	
 	// Inventory
 	InventorySize = 2;
-	bInventoryUpdatedThisFrame = false;
 
 	EquippedWeapon = nullptr;
 	EquippedWeaponAttachment = nullptr;
 	EquippedWeaponClass = nullptr;
 	LastEquippedInventorySlot = INDEX_NONE;
+	PendingSlot = INDEX_NONE;
 	
 	CurrentAnimPose = EAnimPose::Unarmed;
 	ViewPitchInterpRate = 14.f;
@@ -75,15 +100,41 @@ void ABaseFPSCharacter::BeginPlay()
 	if (HasAuthority())
 	{
 		Health = HealthMax;
+
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterCharacter(this);
+		}
+	}
+	else if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+		{
+			Significance->RegisterCharacter(this);
+		}
 	}
 }
 
+void ABaseFPSCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		Significance->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void ABaseFPSCharacter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
 	// initialize inventory
-	Inventory.Init(nullptr, InventorySize);
+	Inventory.Init(this, InventorySize);
 }
 
 #if WITH_EDITOR
@@ -137,10 +188,13 @@ void ABaseFPSCharacter::Tick(float DeltaSeconds)
 	}
 	
 	/* -------------- inventory updates -------------- */
-	if (bInventoryUpdatedThisFrame && GetLocalRole() != ROLE_SimulatedProxy)
+	if (!DirtyInventorySlots.IsEmpty() && GetLocalRole() != ROLE_SimulatedProxy)
 	{
-		OnInventoryUpdated.Broadcast();
-		bInventoryUpdatedThisFrame = false;
+		for (const int32 Slot : DirtyInventorySlots)
+		{
+			OnInventorySlotUpdated.Broadcast(Slot);
+		}
+		DirtyInventorySlots.Reset();
 	}
 }
 
@@ -163,7 +217,7 @@ void ABaseFPSCharacter::Destroyed()
 
 	if (EquippedWeaponAttachment)
 	{
-		EquippedWeaponAttachment->Destroy();
+		UActorPoolSubsystem::ReleaseActor(EquippedWeaponAttachment);
 		EquippedWeaponAttachment = nullptr;
 	}
 	DestroyAllInventory();
@@ -186,9 +240,11 @@ void ABaseFPSCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Ou
 	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, Inventory, COND_OwnerOnly);
 	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, EquippedWeaponClass, COND_SkipOwner);
 
-	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashFireMode, COND_SkipOwner);
-	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashCounter, COND_SkipOwner);
-	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashLocation, COND_SkipOwner);
+	// live connections get firing info through UCosmeticFireRelevancySubsystem, replays record the properties
+	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashFireMode, COND_ReplayOnly);
+	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashCounter, COND_ReplayOnly);
+	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, FlashLocation, COND_ReplayOnly);
+
 	DOREPLIFETIME_CONDITION(ABaseFPSCharacter, bReloading, COND_SkipOwner);
 }
 
@@ -270,6 +326,332 @@ void ABaseFPSCharacter::OnRep_ReplicatedCharMovement()
 	}
 }
 
+/* -------------- Movement serialization -------------- */
+
+/**
+ * FRepCharMovement layout:
+ *   2 bits		location quantization level (BaseFPS.NetMovement.LocationQuantizeLevel), then the packed location
+ *   1 bit		zero velocity flag, velocity is skipped entirely when set
+ *   2 bits		velocity quantization level (picked by speed), then the packed velocity
+ *   16 bits	view yaw
+ *   8 bits		view pitch
+ *   4 bits		acceleration direction
+ */
+namespace RepCharMovement
+{
+	enum ELocationQuantizeLevel : uint8
+	{
+		Location_Whole = 0,			// 1cm
+		Location_OneDecimal = 1,	// 0.1cm
+		Location_TwoDecimals = 2,	// 0.01cm
+	};
+
+	enum EVelocityQuantizeLevel : uint8
+	{
+		Velocity_Fine = 0,			// 0.1cm/s, slow movement where small errors are visible
+		Velocity_Whole = 1,			// 1cm/s
+		Velocity_Coarse = 2,		// CoarseVelocityStep cm/s, fast movement where the relative error stays small
+	};
+
+	/** the velocity step used by {@code Velocity_Coarse} */
+	constexpr double CoarseVelocityStep = 4.0;
+
+	uint8 GetVelocityQuantizeLevel(const FVector& Velocity)
+	{
+		const double SpeedSq = Velocity.SizeSquared();
+		if (SpeedSq < FMath::Square(CVar_BaseFPS_NetMovement_SlowSpeed))
+		{
+			return Velocity_Fine;
+		}
+		return SpeedSq < FMath::Square(CVar_BaseFPS_NetMovement_FastSpeed) ? Velocity_Whole : Velocity_Coarse;
+	}
+}
+
+bool FRepCharMovement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	using namespace RepCharMovement;
+
+	bOutSuccess = true;
+
+	/* -------------- Location -------------- */
+	uint8 LocationLevel = Ar.IsSaving() ? (uint8)FMath::Clamp(CVar_BaseFPS_NetMovement_LocationQuantizeLevel, 0, 2) : 0;
+	Ar.SerializeBits(&LocationLevel, 2);
+	switch (LocationLevel)
+	{
+		case Location_Whole:		bOutSuccess &= SerializePackedVector<1, 20>(Location, Ar); break;
+		case Location_OneDecimal:	bOutSuccess &= SerializePackedVector<10, 24>(Location, Ar); break;
+		case Location_TwoDecimals:	bOutSuccess &= SerializePackedVector<100, 30>(Location, Ar); break;
+		default:					Ar.SetError(); bOutSuccess = false; return false;
+	}
+
+	/* -------------- Velocity -------------- */
+	uint8 bZeroVelocity = Ar.IsSaving() ? LinearVelocity.IsZero() : 0;
+	Ar.SerializeBits(&bZeroVelocity, 1);
+	if (bZeroVelocity)
+	{
+		LinearVelocity = FVector::ZeroVector;
+	}
+	else
+	{
+		uint8 VelocityLevel = Ar.IsSaving() ? GetVelocityQuantizeLevel(LinearVelocity) : 0;
+		Ar.SerializeBits(&VelocityLevel, 2);
+		switch (VelocityLevel)
+		{
+			case Velocity_Fine:		bOutSuccess &= SerializePackedVector<10, 18>(LinearVelocity, Ar); break;
+			case Velocity_Whole:	bOutSuccess &= SerializePackedVector<1, 17>(LinearVelocity, Ar); break;
+			case Velocity_Coarse:
+			{
+				FVector ScaledVelocity = LinearVelocity / CoarseVelocityStep;
+				bOutSuccess &= SerializePackedVector<1, 16>(ScaledVelocity, Ar);
+				if (Ar.IsLoading())
+				{
+					LinearVelocity = ScaledVelocity * CoarseVelocityStep;
+				}
+				break;
+			}
+			default:				Ar.SetError(); bOutSuccess = false; return false;
+		}
+	}
+
+	/* -------------- View & acceleration -------------- */
+	Ar.SerializeBits(&ViewYaw, 16);
+	Ar.SerializeBits(&ViewPitch, 8);
+	Ar.SerializeBits(&AccelDir, 4);
+
+	return true;
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRepCharMovementRoundTripTest, "BaseFPS.NetMovement.RoundTrip", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * Round-trips movement states through FRepCharMovement::NetSerialize at every location quantization level: random
+ * states, a character standing still and saturated states (every field at its max, far from the origin, fast),
+ * checking the error stays within each quantization step and reporting bits per update
+ */
+bool FRepCharMovementRoundTripTest::RunTest(const FString& Parameters)
+{
+	using namespace RepCharMovement;
+
+	// a packed component is rounded to the nearest step, so a vector is off by at most half a step's diagonal
+	auto GetMaxError = [](double Step) { return 0.5 * Step * UE_SQRT_3 + UE_KINDA_SMALL_NUMBER; };
+	const double LocationSteps[] = { 1.0, 0.1, 0.01 };
+	const double VelocitySteps[] = { 0.1, 1.0, CoarseVelocityStep };
+
+	auto RoundTrip = [](FRepCharMovement In, FRepCharMovement& Out, int64& OutNumBits)
+	{
+		bool bSuccess = true;
+		FNetBitWriter Writer(nullptr, 256);
+		In.NetSerialize(Writer, nullptr, bSuccess);
+		OutNumBits = Writer.GetNumBits();
+
+		FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+		Out.NetSerialize(Reader, nullptr, bSuccess);
+		return bSuccess && !Reader.IsError() && Reader.GetBitsLeft() == 0;
+	};
+
+	auto CheckRoundTrip = [&](const FRepCharMovement& In, int32 LocationLevel, const TCHAR* Context, int64& OutNumBits)
+	{
+		FRepCharMovement Out;
+		if (!TestTrue(FString::Printf(TEXT("%s: serializes"), Context), RoundTrip(In, Out, OutNumBits)))
+		{
+			return false;
+		}
+
+		const double VelocityMaxError = GetMaxError(VelocitySteps[GetVelocityQuantizeLevel(In.LinearVelocity)]);
+		bool bPassed = TestTrue(FString::Printf(TEXT("%s: location within %.4fcm"), Context, GetMaxError(LocationSteps[LocationLevel])), FVector::Dist(In.Location, Out.Location) <= GetMaxError(LocationSteps[LocationLevel]));
+		bPassed &= TestEqual(FString::Printf(TEXT("%s: zero velocity"), Context), Out.LinearVelocity.IsZero(), In.LinearVelocity.IsZero());
+		bPassed &= TestTrue(FString::Printf(TEXT("%s: velocity within %.4fcm/s"), Context, VelocityMaxError), FVector::Dist(In.LinearVelocity, Out.LinearVelocity) <= VelocityMaxError);
+		bPassed &= TestEqual(FString::Printf(TEXT("%s: view yaw"), Context), (int32)Out.ViewYaw, (int32)In.ViewYaw);
+		bPassed &= TestEqual(FString::Printf(TEXT("%s: view pitch"), Context), (int32)Out.ViewPitch, (int32)In.ViewPitch);
+		bPassed &= TestEqual(FString::Printf(TEXT("%s: accel dir"), Context), (int32)Out.AccelDir, (int32)In.AccelDir);
+		return bPassed;
+	};
+
+	const TGuardValue<int32> LocationLevelGuard(CVar_BaseFPS_NetMovement_LocationQuantizeLevel, 0);
+	for (int32 LocationLevel = Location_Whole; LocationLevel <= Location_TwoDecimals; LocationLevel++)
+	{
+		CVar_BaseFPS_NetMovement_LocationQuantizeLevel = LocationLevel;
+
+		/* -------------- Random states -------------- */
+		constexpr int32 NumStates = 2000;
+		FRandomStream Stream(0x8A5E);
+		int64 TotalBits = 0;
+		int64 MaxBits = 0;
+		for (int32 i = 0; i < NumStates; i++)
+		{
+			FRepCharMovement In;
+			In.Location = FVector(Stream.FRandRange(-200000.f, 200000.f), Stream.FRandRange(-200000.f, 200000.f), Stream.FRandRange(-20000.f, 20000.f));
+			if (Stream.FRand() > 0.2f) // ~20% of updates are characters standing still
+			{
+				In.LinearVelocity = Stream.GetUnitVector() * Stream.FRandRange(1.f, 3000.f);
+			}
+			In.ViewYaw = (uint16)Stream.RandRange(0, MAX_uint16);
+			In.ViewPitch = (uint8)Stream.RandRange(0, MAX_uint8);
+			In.AccelDir = (uint8)Stream.RandRange(0, 15);
+
+			int64 NumBits = 0;
+			if (!CheckRoundTrip(In, LocationLevel, *FString::Printf(TEXT("Level %d, state %d"), LocationLevel, i), NumBits))
+			{
+				return false; // one failing state is enough to go on
+			}
+			TotalBits += NumBits;
+			MaxBits = FMath::Max(MaxBits, NumBits);
+		}
+		AddInfo(FString::Printf(TEXT("Location level %d: avg %.1f bits/update, max %lld bits"), LocationLevel, (double)TotalBits / NumStates, MaxBits));
+
+		/* -------------- Zero velocity -------------- */
+		FRepCharMovement Standing;
+		Standing.Location = FVector(1234.5678, -8765.4321, 100.25);
+		int64 StandingBits = 0;
+		CheckRoundTrip(Standing, LocationLevel, *FString::Printf(TEXT("Level %d, zero velocity"), LocationLevel), StandingBits);
+
+		FRepCharMovement Moving = Standing;
+		Moving.LinearVelocity = FVector(0.f, 0.f, -1.f);
+		int64 MovingBits = 0;
+		CheckRoundTrip(Moving, LocationLevel, *FString::Printf(TEXT("Level %d, slow velocity"), LocationLevel), MovingBits);
+		TestTrue(FString::Printf(TEXT("Level %d: zero velocity skips the velocity (%lld vs %lld bits)"), LocationLevel, StandingBits, MovingBits), StandingBits < MovingBits);
+
+		/* -------------- Saturated states -------------- */
+		const double Speeds[] = { CVar_BaseFPS_NetMovement_SlowSpeed, CVar_BaseFPS_NetMovement_FastSpeed, 100000.0 };
+		for (const double Speed : Speeds)
+		{
+			for (const double Sign : { 1.0, -1.0 })
+			{
+				FRepCharMovement Saturated;
+				Saturated.Location = FVector(500000.0, -500000.0, 50000.0) * Sign;
+				Saturated.LinearVelocity = FVector(1.0, -1.0, 1.0).GetSafeNormal() * Speed * Sign;
+				Saturated.ViewYaw = MAX_uint16;
+				Saturated.ViewPitch = MAX_uint8;
+				Saturated.AccelDir = 15;
+
+				int64 NumBits = 0;
+				CheckRoundTrip(Saturated, LocationLevel, *FString::Printf(TEXT("Level %d, saturated at %.0fcm/s"), LocationLevel, Speed * Sign), NumBits);
+			}
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+/* -------------- FastShared replication -------------- */
+
+bool FSharedRepCharMovement::FillForCharacter(ABaseFPSCharacter* Character)
+{
+	UCharacterMovementComponent* CharacterMovement = Character->GetCharacterMovement();
+	if (!Character->GetRootComponent() || !CharacterMovement)
+	{
+		return false;
+	}
+
+	// relative (based) movement needs the replicated base, which only the property path sends
+	if (Character->GetBasedMovement().HasRelativeLocation())
+	{
+		return false;
+	}
+
+	Character->GatherCharMovement();
+	RepMovement = Character->ReplicatedCharMovement;
+	RepMovementMode = CharacterMovement->PackNetworkMovementMode();
+	bProxyIsJumpForceApplied = Character->bProxyIsJumpForceApplied || (Character->JumpForceTimeRemaining > 0.0f);
+	bIsCrouched = Character->bIsCrouched;
+
+	// same rule as PreReplication(), the timestamp is only needed for linear smoothing
+	if ((CharacterMovement->NetworkSmoothingMode == ENetworkSmoothingMode::Linear) || CharacterMovement->bNetworkAlwaysReplicateTransformUpdateTimestamp)
+	{
+		RepTimeStamp = CharacterMovement->GetServerLastTransformUpdateTimeStamp();
+	}
+	else
+	{
+		RepTimeStamp = 0.f;
+	}
+
+	return true;
+}
+
+bool FSharedRepCharMovement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+	RepMovement.NetSerialize(Ar, Map, bOutSuccess);
+	Ar << RepMovementMode;
+
+	uint8 bJumpForce = bProxyIsJumpForceApplied;
+	uint8 bCrouched = bIsCrouched;
+	Ar.SerializeBits(&bJumpForce, 1);
+	Ar.SerializeBits(&bCrouched, 1);
+	bProxyIsJumpForceApplied = !!bJumpForce;
+	bIsCrouched = !!bCrouched;
+
+	// timestamp is only sent when it's in use
+	uint8 bHasTimeStamp = (RepTimeStamp != 0.f);
+	Ar.SerializeBits(&bHasTimeStamp, 1);
+	if (bHasTimeStamp)
+	{
+		Ar << RepTimeStamp;
+	}
+	else
+	{
+		RepTimeStamp = 0.f;
+	}
+
+	return true;
+}
+
+bool ABaseFPSCharacter::UpdateSharedReplication()
+{
+	if (GetLocalRole() != ROLE_Authority)
+	{
+		return false;
+	}
+
+	FSharedRepCharMovement SharedMovement;
+	if (!SharedMovement.FillForCharacter(this))
+	{
+		return false;
+	}
+
+	// Skipping the call when nothing changed makes the rep graph reuse last frame's bunch: connections that
+	// already received it get nothing, connections that just became relevant still get it
+	if (SharedMovement != LastSharedReplication)
+	{
+		LastSharedReplication = SharedMovement;
+		ReplicatedMovementMode = SharedMovement.RepMovementMode;
+		FastSharedReplication(SharedMovement);
+	}
+	return true;
+}
+
+void ABaseFPSCharacter::FastSharedReplication_Implementation(const FSharedRepCharMovement& SharedRepMovement)
+{
+	if (GetWorld()->IsPlayingReplay() || GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	ReplicatedServerLastTransformUpdateTimeStamp = SharedRepMovement.RepTimeStamp;
+
+	if (ReplicatedMovementMode != SharedRepMovement.RepMovementMode)
+	{
+		ReplicatedMovementMode = SharedRepMovement.RepMovementMode;
+		GetCharacterMovement()->bNetworkMovementModeChanged = true;
+		GetCharacterMovement()->bNetworkUpdateReceived = true;
+	}
+
+	ReplicatedCharMovement = SharedRepMovement.RepMovement;
+	OnRep_ReplicatedCharMovement();
+
+	bProxyIsJumpForceApplied = SharedRepMovement.bProxyIsJumpForceApplied;
+
+	if (bIsCrouched != SharedRepMovement.bIsCrouched)
+	{
+		bIsCrouched = SharedRepMovement.bIsCrouched;
+		OnRep_IsCrouched();
+	}
+}
+
 /************************************************************************/
 /* Movement                                                             */
 /************************************************************************/
@@ -386,23 +768,40 @@ void ABaseFPSCharacter::FiringInfoUpdated()
 	// 	AnimInstance->StopAllMontages(0.2f);
 	// }
 
+	const bool bFiring = FlashCounter != 0 || !FlashLocation.IsZero();
 	if (IsLocallyControlled() && EquippedWeapon)
 	{
-		const uint8 EffectFireMode = EquippedWeapon->GetCurrentFireMode();
-		EquippedWeapon->SpawnTrailEffect(EffectFireMode, FlashLocation);
-		EquippedWeapon->SpawnImpactEffects(EffectFireMode, FlashLocation);
+		if (bFiring)
+		{
+			const uint8 EffectFireMode = EquippedWeapon->GetCurrentFireMode();
+			EquippedWeapon->SpawnTrailEffect(EffectFireMode, FlashLocation);
+			EquippedWeapon->SpawnImpactEffects(EffectFireMode, FlashLocation, FlashImpact);
+		}
 	}
 	else if (EquippedWeaponAttachment)
 	{
-		if (FlashCounter != 0 || !FlashLocation.IsZero())
+		if (bFiring)
 		{
+			LastFiringEffectsTime = GetWorld()->GetTimeSeconds();
 			EquippedWeaponAttachment->PlayFiringEffects(FlashFireMode);
 			EquippedWeaponAttachment->SpawnTrailEffect(FlashFireMode, FlashLocation);
-			EquippedWeaponAttachment->SpawnImpactEffects(FlashFireMode, FlashLocation);
+			EquippedWeaponAttachment->SpawnImpactEffects(FlashFireMode, FlashLocation, FlashImpact);
+		}
+		else
+		{
+			EquippedWeaponAttachment->StopFiringEffects(FlashFireMode);
 		}
 	}
 }
 
+void ABaseFPSCharacter::FiringInfoReplicated()
+{
+	if (!IsLocallyControlled())
+	{
+		FiringInfoUpdated();
+	}
+}
+
 void ABaseFPSCharacter::IncrementFlashCounter(uint8 InFireMode)
 {
 	FlashCounter++;
@@ -411,14 +810,17 @@ void ABaseFPSCharacter::IncrementFlashCounter(uint8 InFireMode)
 		FlashCounter++; // in case of wrap scenario
 	}
 	FlashFireMode = InFireMode;
+	FlashImpact = FImpactEffectInfo();
 
 	// TODO (aleforte) pack firemode into flash counter to handle alternating prim/alt fire (see UT)
 	FiringInfoUpdated();
+	RelayFiringInfo(FVector::ZeroVector, FlashImpact);
+	NotifyCombatEvent();
 }
 
-void ABaseFPSCharacter::SetFlashLocation(const FVector& InFlashLoc, uint8 InFireMode)
+void ABaseFPSCharacter::SetFlashLocation(const FVector& InFlashLoc, uint8 InFireMode, const FImpactEffectInfo& InImpact)
 {
-	// ensure new flash loc is not the same as previous, otherwise it will not replicate to clients
+	// ensure new flash loc is not the same as previous, otherwise it will not replicate to replays
 	FlashLocation = ((FlashLocation - InFlashLoc).SizeSquared() > 0.5f) ?
 		InFlashLoc : (InFlashLoc + FVector(0.f, 0.f, 1.0f));
 
@@ -428,7 +830,10 @@ void ABaseFPSCharacter::SetFlashLocation(const FVector& InFlashLoc, uint8 InFire
 		FlashLocation.Z += 0.6f;
 	}
 	FlashFireMode = InFireMode;
+	FlashImpact = InImpact;
 	FiringInfoUpdated();
+	RelayFiringInfo(FlashLocation, FlashImpact);
+	NotifyCombatEvent();
 }
 
 const FVector_NetQuantize& ABaseFPSCharacter::GetFlashLocation() const
@@ -436,19 +841,67 @@ const FVector_NetQuantize& ABaseFPSCharacter::GetFlashLocation() const
 	return FlashLocation;
 }
 
+void ABaseFPSCharacter::PlayRelayedFiringInfo(uint8 InFireMode, const FVector& InFlashLoc, const FImpactEffectInfo& InImpact, uint8 ShotCount)
+{
+	if (IsLocallyControlled())
+	{
+		return;
+	}
+
+	if (ShotCount == 0)
+	{
+		ClearFiringInfo();
+		return;
+	}
+
+	// no flash location means the shot's hit location isn't important, e.g. projectile fire
+	if (InFlashLoc.IsZero())
+	{
+		FlashCounter += ShotCount;
+		if (FlashCounter == 0)
+		{
+			FlashCounter++;
+		}
+	}
+	FlashLocation = InFlashLoc;
+	FlashFireMode = InFireMode;
+	FlashImpact = InImpact;
+	FiringInfoUpdated();
+}
+
+void ABaseFPSCharacter::RelayFiringInfo(const FVector& InFlashLoc, const FImpactEffectInfo& InImpact)
+{
+	if (HasAuthority())
+	{
+		if (UCosmeticFireRelevancySubsystem* Relay = GetWorld()->GetSubsystem<UCosmeticFireRelevancySubsystem>())
+		{
+			Relay->AddFireEvent(this, FlashFireMode, InFlashLoc, InImpact);
+		}
+	}
+}
+
+void ABaseFPSCharacter::NotifyCombatEvent()
+{
+	if (HasAuthority())
+	{
+		GlobalOnCharacterCombatEvent.Broadcast(this);
+	}
+}
+
 void ABaseFPSCharacter::ClearFiringInfo()
 {
 	// set flash vars to their "not firing" values
 	FlashCounter = 0;
 	FlashLocation = FVector::ZeroVector;
+	FlashImpact = FImpactEffectInfo();
 	FiringInfoUpdated();
-}
 
-void ABaseFPSCharacter::FiringInfoReplicated()
-{
-	if (!IsLocallyControlled())
+	if (HasAuthority())
 	{
-		FiringInfoUpdated();
+		if (UCosmeticFireRelevancySubsystem* Relay = GetWorld()->GetSubsystem<UCosmeticFireRelevancySubsystem>())
+		{
+			Relay->AddStopFiringEvent(this, FlashFireMode);
+		}
 	}
 }
 
@@ -515,67 +968,50 @@ bool ABaseFPSCharacter::IsDead() const
 
 void ABaseFPSCharacter::PerformInteractableCheck()
 {
-	if (Controller)
+	UInteractableSubsystem* Interactables = GetWorld()->GetSubsystem<UInteractableSubsystem>();
+	if (Controller && Interactables)
 	{
 		InteractionData.LastInteractionCheckTime = GetWorld()->GetTimeSeconds();
 
 		FVector OutViewLocation;
 		FRotator OutViewRotation;
 		Controller->GetPlayerViewPoint(OutViewLocation, OutViewRotation);
+		const FVector ViewDirection = OutViewRotation.Vector();
 
-		const FVector TraceStart = OutViewLocation;
-		const FVector TraceDirection = OutViewRotation.Vector();
-		const FVector TraceEnd = OutViewLocation + (TraceDirection * InteractableCheckDistance);
-		
-		FCollisionQueryParams TraceParams;
-		TraceParams.AddIgnoredActor(this);
+		// candidates come sorted by how close they are to our view direction
+		TArray<FInteractableCandidate> Candidates;
+		Interactables->QueryView(OutViewLocation, ViewDirection, InteractableCheckDistance, Candidates);
 
-		TArray<FHitResult> OutHits;
-		GetWorld()->LineTraceMultiByChannel(OutHits, TraceStart, TraceEnd, COLLISION_INTERACTABLE, TraceParams);
-		if (OutHits.Num() > 0 && !OutHits[0].bBlockingHit)
+		UInteractableComponent* CurrentInteractable = IsInteracting() ? InteractionData.InteractableComponentInFocus : nullptr;
+		UInteractableComponent* NewInFocus = nullptr;
+		for (const FInteractableCandidate& Candidate : Candidates)
 		{
-			UInteractableComponent* HitInFocus = nullptr;
-			double DotForHitInFocus = -1.0f;
-			for (FHitResult& Hit : OutHits)
+			UInteractableComponent* Interactable = Candidate.Component;
+			if (FMath::Square(Candidate.Distance) > Interactable->GetInteractableDistanceSquared()) // dist^2 for optimization
 			{
-				if (UInteractableComponent* HitInteractable = Cast<UInteractableComponent>(Hit.GetActor()->GetComponentByClass(UInteractableComponent::StaticClass())))
-				{
-					const float DistanceSquared = (TraceStart - Hit.ImpactPoint).SizeSquared(); // dist^2 for optimization
-					if (DistanceSquared <= HitInteractable->GetInteractableDistanceSquared())
-					{
-						if (IsInteracting() && IsCurrentlyInFocus(HitInteractable))
-						{
-							HitInFocus = HitInteractable;
-							break; // note break here, current interactable takes priority if we're interacting with it
-						}
-						else if (HitInteractable->CanInteract(this))
-						{
-							// using dot product to find which interactable is closest to our viewpoint
-							FVector VectorToHit = Hit.GetActor()->GetActorLocation() - TraceStart;					
-							double DotForHit = FVector::DotProduct(TraceDirection, VectorToHit.GetSafeNormal());
-							if (DotForHit > DotForHitInFocus)
-							{
-								HitInFocus = HitInteractable;
-								DotForHitInFocus = DotForHit;
-							}	
-						}
-					}					
-				} else if (!Hit.bBlockingHit)
-				{
-					UE_LOG(LogBaseFPS, Warning, TEXT("Interactable check found actor without interactable component -- %s (class %s)"), *Hit.GetActor()->GetName(), *Hit.GetActor()->GetClass()->GetFName().ToString());
-				}
+				continue;
 			}
-			
-			if (!IsCurrentlyInFocus(HitInFocus))
+
+			// once we have the best candidate, only keep looking for the one we're interacting with
+			const bool bIsCurrent = (Interactable == CurrentInteractable);
+			if (!bIsCurrent && (NewInFocus || !Interactable->CanInteract(this)))
+			{
+				continue;
+			}
+
+			if (Interactables->IsVisibleFrom(OutViewLocation, ViewDirection, Candidate, this))
 			{
-				FocusChanged(HitInFocus);
+				NewInFocus = Interactable;
+				if (bIsCurrent || CurrentInteractable == nullptr)
+				{
+					break; // note break here, current interactable takes priority if we're interacting with it
+				}
 			}
-			return;
 		}
-		// if we reach here, we've lost focus from all objects... set "in focus" to nullptr
-		if (InteractionData.InteractableComponentInFocus != nullptr)
+
+		if (!IsCurrentlyInFocus(NewInFocus))
 		{
-			FocusChanged(nullptr);
+			FocusChanged(NewInFocus);
 		}
 	}
 }
@@ -683,6 +1119,15 @@ void ABaseFPSCharacter::FocusChanged(UInteractableComponent* NewInteractable)
 	
 	InteractionData.InteractableComponentInFocus = NewInteractable;
 	OnFocusChanged.Broadcast(NewInteractable);
+
+	// a focused pickup is drawn as its own actor rather than an instance
+	if (IsLocallyControlled())
+	{
+		if (UPickupRenderSubsystem* PickupRender = GetWorld()->GetSubsystem<UPickupRenderSubsystem>())
+		{
+			PickupRender->SetFocusedPickup(this, NewInteractable ? Cast<APickupInstance>(NewInteractable->GetOwner()) : nullptr);
+		}
+	}
 }
 
 
@@ -700,9 +1145,13 @@ bool ABaseFPSCharacter::IsCurrentlyInFocus(UInteractableComponent* InteractableC
 /* Inventory                                                            */
 /************************************************************************/
 
-void ABaseFPSCharacter::OnRep_Inventory()
+void ABaseFPSCharacter::InventorySlotChanged(int32 Slot)
+{
+	DirtyInventorySlots.AddUnique(Slot);
+}
+
+void ABaseFPSCharacter::InventoryReplicated()
 {
-	bInventoryUpdatedThisFrame = true;
 	if (LastEquippedInventorySlot > INDEX_NONE)
 	{
 		if (!PendingWeapon)
@@ -712,20 +1161,45 @@ void ABaseFPSCharacter::OnRep_Inventory()
 		}
 		LastEquippedInventorySlot = INDEX_NONE;
 	}
+
+	if (PendingSlot > INDEX_NONE)
+	{
+		AWeapon* NewWeapon = Cast<AWeapon>(Inventory[PendingSlot]);
+		if (NewWeapon && NewWeapon->GetCharacterOwner() == this)
+		{
+			PendingSlot = INDEX_NONE;
+			SetPendingWeapon(NewWeapon);
+			if (!EquippedWeapon)
+			{
+				// the previous weapon is already put down
+				WeaponChanged();
+			}
+		}
+		else if (!Inventory.GetItemClass(PendingSlot))
+		{
+			// the item was taken away before it got here
+			PendingSlot = INDEX_NONE;
+			if (!EquippedWeapon)
+			{
+				WeaponChanged();
+			}
+		}
+	}
 }
 
 bool ABaseFPSCharacter::AddInventory(AInventory* Inv, bool bAutoActivate)
 {
 	if (HasAuthority() && Inv)
 	{
-		const int32 Slot = Inventory.IndexOfByPredicate([](const AInventory* Inv){ return Inv == nullptr; });
+		const int32 Slot = Inventory.FindFreeSlot();
 		if (Slot > INDEX_NONE)
 		{
-			Inventory[Slot] = Inv;
+			Inventory.SetItem(Slot, Inv);
 			Inv->OnAddedToInventory(this);
-			bInventoryUpdatedThisFrame = true;
+			ScheduleStowHolsteredInventory();
+			GlobalOnCharacterInventoryChanged.Broadcast(this);
+			return true;
 		}
-		return true;
 	}
 	return false;
 }
@@ -734,12 +1208,12 @@ bool ABaseFPSCharacter::ReplaceInventory(AInventory* CurrInv, AInventory* NewInv
 {
 	if (HasAuthority() && CurrInv && NewInv)
 	{
-		const int32 Slot = Inventory.Find(CurrInv);
+		const int32 Slot = Inventory.FindSlot(CurrInv);
 		if (Slot > INDEX_NONE)
 		{
-			Inventory[Slot]->OnRemovedFromInventory();
-			Inventory[Slot] = NewInv;
-			Inventory[Slot]->OnAddedToInventory(this);
+			CurrInv->OnRemovedFromInventory();
+			Inventory.SetItem(Slot, NewInv);
+			NewInv->OnAddedToInventory(this);
 
 			if (!IsLocallyControlled() && (IsPendingEquip(CurrInv) || IsEquipped(CurrInv)))
 			{
@@ -761,7 +1235,8 @@ bool ABaseFPSCharacter::ReplaceInventory(AInventory* CurrInv, AInventory* NewInv
 				WeaponChanged();
 			}
 			
-			bInventoryUpdatedThisFrame = true;
+			ScheduleStowHolsteredInventory();
+			GlobalOnCharacterInventoryChanged.Broadcast(this);
 		}
 		return true;
 	}
@@ -772,11 +1247,11 @@ bool ABaseFPSCharacter::RemoveInventory(AInventory* Inv)
 {
 	if (HasAuthority() && Inv)
 	{
-		const int32 Slot = Inventory.Find(Inv);
+		const int32 Slot = Inventory.FindSlot(Inv);
 		if (Slot > INDEX_NONE)
 		{	
-			Inventory[Slot]->OnRemovedFromInventory();
-			Inventory[Slot] = nullptr;
+			Inv->OnRemovedFromInventory();
+			Inventory.SetItem(Slot, nullptr);
 
 			if (!IsLocallyControlled() && (IsPendingEquip(Inv) || IsEquipped(Inv)))
 			{
@@ -794,12 +1269,12 @@ bool ABaseFPSCharacter::RemoveInventory(AInventory* Inv)
 				if (!PendingWeapon)
 				{
 					TInventoryIterator<AWeapon> It(this);
-					SetPendingWeapon(*It);
+					SetPendingWeapon(It ? Cast<AWeapon>(MaterializeInventory(It.Index())) : nullptr);
 				}
 				WeaponChanged();
 			}
 			
-			bInventoryUpdatedThisFrame = true;
+			GlobalOnCharacterInventoryChanged.Broadcast(this);
 			return true;
 		}
 	}
@@ -812,21 +1287,24 @@ void ABaseFPSCharacter::RemoveAllInventory()
 	{
 		for (int32 i = 0; i < InventorySize; i++)
 		{
-			if (Inventory[i] != nullptr)
+			if (Inventory.GetItemClass(i) != nullptr)
 			{
-				Inventory[i]->OnRemovedFromInventory();
-				Inventory[i] = nullptr;
+				if (Inventory[i] != nullptr)
+				{
+					Inventory[i]->OnRemovedFromInventory();
+				}
+				Inventory.SetItem(i, nullptr);
 			}
 		}
+		GlobalOnCharacterInventoryChanged.Broadcast(this);
 	}
-	bInventoryUpdatedThisFrame = true;
 }
 
 bool ABaseFPSCharacter::IsInventoryEmpty() const
 {
 	for (int32 i = 0; i < Inventory.Num(); i++)
 	{
-		if (Inventory[i] != nullptr && Inventory[i]->IsOwnedBy(this))
+		if (Inventory.GetItemClass(i) != nullptr)
 		{
 			return false;
 		}
@@ -836,31 +1314,42 @@ bool ABaseFPSCharacter::IsInventoryEmpty() const
 
 bool ABaseFPSCharacter::IsInventoryFull() const
 {
-	for (int32 i = 0; i < Inventory.Num(); i++)
-	{
-		if (Inventory[i] == nullptr)
-		{
-			return false;
-		}
-	}
-	return true;
+	return Inventory.FindFreeSlot() == INDEX_NONE;
 }
 
 bool ABaseFPSCharacter::IsInInventory(AInventory* TestInv) const
 {
-	return IsValid(TestInv) && Inventory.Contains(TestInv);
+	return IsValid(TestInv) && Inventory.FindSlot(TestInv) > INDEX_NONE;
+}
+
+bool ABaseFPSCharacter::HasInventoryOfType(TSubclassOf<AInventory> InvType) const
+{
+	return Inventory.FindSlotOfType(InvType) > INDEX_NONE;
 }
 
 AInventory* ABaseFPSCharacter::GetInventoryOfType(TSubclassOf<AInventory> InvType) const
 {
-	for (int32 i = 0; i < Inventory.Num(); i++)
+	return Inventory.GetItem(Inventory.FindSlotOfType(InvType));
+}
+
+bool ABaseFPSCharacter::AddReserveAmmo(TSubclassOf<AWeapon> WeaponType, int32 AddAmount)
+{
+	const int32 Slot = Inventory.FindSlotOfType(WeaponType);
+	if (!HasAuthority() || Slot == INDEX_NONE)
 	{
-		if (Inventory[i] && Inventory[i]->IsA(InvType))
-		{
-			return Inventory[i];
-		}
+		return false;
+	}
+
+	if (AWeapon* Weapon = Cast<AWeapon>(Inventory[Slot]))
+	{
+		Weapon->AddAmmoToReserve(AddAmount);
+	}
+	else if (const FInventoryEntry* Entry = Inventory.GetEntry(Slot))
+	{
+		const AWeapon* WeaponDefaults = CastChecked<AWeapon>(Entry->ItemClass.GetDefaultObject());
+		Inventory.SetStowedAmmo(Slot, Entry->AmmoInClip, FMath::Clamp(Entry->ReserveAmmo + AddAmount, 0, WeaponDefaults->GetMaxReserveAmmo()));
 	}
-	return nullptr;
+	return true;
 }
 
 bool ABaseFPSCharacter::CanPickUp(APickupInstance* PickupInstance) const
@@ -878,36 +1367,85 @@ void ABaseFPSCharacter::AddDefaultInventory()
 	}
 }
 
-AInventory* ABaseFPSCharacter::CreateInventory(TSubclassOf<AInventory> NewInvClass)
+int32 ABaseFPSCharacter::CreateInventory(TSubclassOf<AInventory> NewInvClass)
 {
 	if (NewInvClass && HasAuthority())
 	{
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		AWeapon* NewWeapon = GetWorld()->SpawnActor<AWeapon>(NewInvClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
-		const int32 Slot = AddInventory(NewWeapon, false);
-		if (Slot == INDEX_NONE)
+		// stowed until it's equipped, no actor needed yet
+		const int32 Slot = Inventory.FindFreeSlot();
+		if (Slot > INDEX_NONE)
 		{
-			NewWeapon->Destroy();
-			return nullptr;
+			Inventory.SetStowedItem(Slot, NewInvClass);
+			GlobalOnCharacterInventoryChanged.Broadcast(this);
 		}
-		return NewWeapon;
+		return Slot;
 	}
-	return nullptr;
+	return INDEX_NONE;
 }
 
 void ABaseFPSCharacter::DestroyAllInventory()
 {
+	GetWorldTimerManager().ClearTimer(StowHolsteredInventoryTimerHandle);
 	for (int32 i = 0; i < Inventory.Num(); i++)
 	{
 		if (Inventory[i])
 		{
-			Inventory[i]->Destroy();
-			Inventory[i] = nullptr;
+			UActorPoolSubsystem::ReleaseActor(Inventory[i]);
 		}
+		Inventory.SetItem(i, nullptr);
 	}
 	EquippedWeapon = nullptr;
 	PendingWeapon = nullptr;
+	PendingSlot = INDEX_NONE;
+}
+
+AInventory* ABaseFPSCharacter::MaterializeInventory(int32 Slot)
+{
+	AInventory* Item = Inventory.GetItem(Slot);
+	const TSubclassOf<AInventory> ItemClass = Inventory.GetItemClass(Slot);
+	if (Item || ItemClass == nullptr || !HasAuthority())
+	{
+		return Item;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	Item = UActorPoolSubsystem::AcquireActor<AInventory>(GetWorld(), ItemClass, FTransform::Identity, SpawnParams);
+	if (Item)
+	{
+		Inventory.MaterializeItem(Slot, Item);
+		Item->OnAddedToInventory(this);
+		GlobalOnCharacterInventoryChanged.Broadcast(this);
+	}
+	return Item;
+}
+
+void ABaseFPSCharacter::ScheduleStowHolsteredInventory()
+{
+	if (HasAuthority() && CVar_BaseFPS_Inventory_StowDelay >= 0.f)
+	{
+		GetWorldTimerManager().SetTimer(StowHolsteredInventoryTimerHandle, this, &ThisClass::StowHolsteredInventory, FMath::Max(CVar_BaseFPS_Inventory_StowDelay, 0.01f));
+	}
+}
+
+void ABaseFPSCharacter::StowHolsteredInventory()
+{
+	bool bStowedAny = false;
+	for (int32 i = 0; i < Inventory.Num(); i++)
+	{
+		AInventory* Item = Inventory[i];
+		if (Item && !IsEquipped(Item) && !IsPendingEquip(Item))
+		{
+			Inventory.StowItem(i);
+			UActorPoolSubsystem::ReleaseActor(Item);
+			bStowedAny = true;
+		}
+	}
+
+	if (bStowedAny)
+	{
+		GlobalOnCharacterInventoryChanged.Broadcast(this);
+	}
 }
 
 /************************************************************************/
@@ -917,36 +1455,36 @@ void ABaseFPSCharacter::DestroyAllInventory()
 void ABaseFPSCharacter::NextWeapon()
 {
 	UE_LOG(LogTemp, Warning, TEXT("Next Weapon called!"));
-	SwitchWeapon(GetNextWeaponFromSequence(false));
+	SwitchToSlot(GetNextWeaponSlotFromSequence(false));
 }
 
 void ABaseFPSCharacter::PrevWeapon()
 {
 	UE_LOG(LogTemp, Warning, TEXT("Prev Weapon called!"));
-	SwitchWeapon(GetNextWeaponFromSequence(true));
+	SwitchToSlot(GetNextWeaponSlotFromSequence(true));
 }
 
-AWeapon* ABaseFPSCharacter::GetNextWeaponFromSequence(bool bPrev)
+int32 ABaseFPSCharacter::GetNextWeaponSlotFromSequence(bool bPrev)
 {
-	const AWeapon* CurrWeapon = PendingWeapon ? PendingWeapon : EquippedWeapon;
+	const int32 CurrSlot = PendingSlot > INDEX_NONE ? PendingSlot : Inventory.FindSlot(PendingWeapon ? PendingWeapon : EquippedWeapon);
 	
 	bool bFoundCurrWeapon = false;
-	AWeapon* WrapChoice = nullptr; // wrap around scenario
-	AWeapon* BestChoice = nullptr;
+	int32 WrapChoice = INDEX_NONE; // wrap around scenario
+	int32 BestChoice = INDEX_NONE;
 
 	for (TInventoryIterator<AWeapon> It(this, !bPrev); It; It.Next()) // note, we're iterating in inverse direction
 	{
-		if (CurrWeapon == *It)
+		if (CurrSlot == It.Index())
 		{
 			bFoundCurrWeapon = true;
 		}
 		if (!bFoundCurrWeapon)
 		{
-			BestChoice = *It;
+			BestChoice = It.Index();
 		}
-		WrapChoice = *It;
+		WrapChoice = It.Index();
 	}
-	return BestChoice ? BestChoice : WrapChoice;
+	return BestChoice > INDEX_NONE ? BestChoice : WrapChoice;
 }
 
 void ABaseFPSCharacter::SetPendingWeapon(AWeapon* NewWeapon)
@@ -1007,7 +1545,7 @@ void ABaseFPSCharacter::UpdateWeaponAttachment()
 	const TSubclassOf<AWeaponAttachment> AttachmentClass = EquippedWeaponClass ? EquippedWeaponClass.GetDefaultObject()->GetWeaponAttachmentType() : nullptr;
 	if (EquippedWeaponAttachment && (AttachmentClass == nullptr || !EquippedWeaponAttachment->IsA(AttachmentClass)))
 	{
-		EquippedWeaponAttachment->Destroy();
+		UActorPoolSubsystem::ReleaseActor(EquippedWeaponAttachment);
 		EquippedWeaponAttachment = nullptr;
 		if (GetLocalRole() == ROLE_SimulatedProxy)
 		{
@@ -1019,7 +1557,7 @@ void ABaseFPSCharacter::UpdateWeaponAttachment()
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Instigator = this;
 		SpawnParams.Owner = this;
-		EquippedWeaponAttachment = GetWorld()->SpawnActor<AWeaponAttachment>(AttachmentClass, SpawnParams);
+		EquippedWeaponAttachment = UActorPoolSubsystem::AcquireActor<AWeaponAttachment>(GetWorld(), AttachmentClass, FTransform::Identity, SpawnParams);
 		EquippedWeaponAttachment->AttachToOwnerEquipped();
 		
 		if (GetLocalRole() == ROLE_SimulatedProxy)
@@ -1064,6 +1602,24 @@ void ABaseFPSCharacter::SwitchWeapon(AWeapon* NewWeapon)
 	}
 }
 
+void ABaseFPSCharacter::SwitchToSlot(int32 Slot)
+{
+	if (!Inventory.IsValidSlot(Slot) || Inventory.GetItemClass(Slot) == nullptr || IsDead())
+	{
+		return;
+	}
+
+	if (HasAuthority())
+	{
+		ClientSwitchToSlot(static_cast<uint8>(Slot));
+	}
+	else if (IsLocallyControlled())
+	{
+		ServerSwitchToSlot(static_cast<uint8>(Slot));
+		LocalSwitchToSlot(Slot);
+	}
+}
+
 
 void ABaseFPSCharacter::SwitchToStartingWeapon()
 {
@@ -1076,20 +1632,24 @@ void ABaseFPSCharacter::SwitchToStartingWeapon()
 	{
 		// for now, just switch to first weapon found...
 		TInventoryIterator<AWeapon> It(this);
-		SwitchWeapon(*It);	
+		SwitchToSlot(It.Index());
 	}
 }
 
 void ABaseFPSCharacter::LocalSwitchWeapon(AWeapon* NewWeapon)
 {
-	if (IsDead() || (NewWeapon && !Inventory.Contains(NewWeapon)))
+	if (IsDead() || (NewWeapon && !IsInInventory(NewWeapon)))
 	{
 		return;
 	}
 
+	// an explicit switch replaces one still waiting on its weapon to replicate
+	const bool bWasPendingSlot = PendingSlot > INDEX_NONE;
+	PendingSlot = INDEX_NONE;
+
 	// [borrowed from UT] ensures clients don't try to switch to non-fully replicated weapons or
 	// weapons that have been removed (e.g. sent by client before they received the inventory update)
-	if (NewWeapon && (NewWeapon->GetCharacterOwner() != this || (HasAuthority() && !Inventory.Contains(NewWeapon))))
+	if (NewWeapon && (NewWeapon->GetCharacterOwner() != this || (HasAuthority() && !IsInInventory(NewWeapon))))
 	{
 		UE_LOG(LogTemp, Error, TEXT("MISSING OWNER!!! (bServer=%d)"), HasAuthority());
 		ClientSwitchWeapon(EquippedWeapon);
@@ -1115,14 +1675,14 @@ void ABaseFPSCharacter::LocalSwitchWeapon(AWeapon* NewWeapon)
 				SetPendingWeapon(NewWeapon);
 			}
 		}
-		else if (PendingWeapon)
+		else if (PendingWeapon || bWasPendingSlot)
 		{
 			// switching back to current weapon
 			SetPendingWeapon(nullptr);
 			EquippedWeapon->BringUp();
 		}
 	}
-	else if (PendingWeapon && EquippedWeapon->IsUnequipping())
+	else if ((PendingWeapon || bWasPendingSlot) && EquippedWeapon->IsUnequipping())
 	{
 		// stop switch in progress
 		SetPendingWeapon(nullptr);
@@ -1130,6 +1690,57 @@ void ABaseFPSCharacter::LocalSwitchWeapon(AWeapon* NewWeapon)
 	}
 }
 
+void ABaseFPSCharacter::LocalSwitchToSlot(int32 Slot)
+{
+	if (IsDead() || !Inventory.IsValidSlot(Slot))
+	{
+		return;
+	}
+
+	if (HasAuthority())
+	{
+		if (AWeapon* NewWeapon = Cast<AWeapon>(MaterializeInventory(Slot)))
+		{
+			LocalSwitchWeapon(NewWeapon);
+		}
+		return;
+	}
+
+	AWeapon* NewWeapon = Cast<AWeapon>(Inventory[Slot]);
+	if (NewWeapon && NewWeapon->GetCharacterOwner() == this)
+	{
+		LocalSwitchWeapon(NewWeapon);
+	}
+	else if (Inventory.GetItemClass(Slot) && Inventory.GetItemClass(Slot)->IsChildOf(AWeapon::StaticClass()))
+	{
+		// stowed, the server materializes it while the current weapon is put down (see InventoryReplicated)
+		if (!EquippedWeapon || EquippedWeapon->IsUnequipping() || EquippedWeapon->PutDown())
+		{
+			SetPendingWeapon(nullptr);
+			PendingSlot = Slot;
+		}
+	}
+}
+
+void ABaseFPSCharacter::ServerSwitchToSlot_Implementation(uint8 Slot)
+{
+	LocalSwitchToSlot(Slot);
+}
+
+bool ABaseFPSCharacter::ServerSwitchToSlot_Validate(uint8 Slot)
+{
+	return Inventory.IsValidSlot(Slot);
+}
+
+void ABaseFPSCharacter::ClientSwitchToSlot_Implementation(uint8 Slot)
+{
+	if (!HasAuthority() && IsLocallyControlled())
+	{
+		ServerSwitchToSlot(Slot);
+	}
+	LocalSwitchToSlot(Slot);
+}
+
 void ABaseFPSCharacter::ServerSwitchWeapon_Implementation(AWeapon* NewWeapon)
 {
 	if (NewWeapon)
@@ -1183,11 +1794,21 @@ void ABaseFPSCharacter::WeaponChanged(float OverflowTime)
 		}
 		EquippedWeapon = PendingWeapon;
 		SetPendingWeapon(nullptr);
+		ScheduleStowHolsteredInventory();
 		EquippedWeaponClass = EquippedWeapon->GetClass();
 		UpdateWeaponAttachment();
 		EquippedWeapon->BringUp(OverflowTime);
 		OnEquippedNewWeapon.Broadcast();
 	}
+	else if (PendingSlot > INDEX_NONE)
+	{
+		// [client] the weapon being switched to hasn't replicated yet, hands stay empty until it does
+		if (EquippedWeapon)
+		{
+			EquippedWeapon->DetachMeshFromPawn();
+			EquippedWeapon = nullptr;
+		}
+	}
 	else if (EquippedWeapon) // bring back up current weapon
 	{
 		EquippedWeapon->BringUp();
@@ -1235,8 +1856,10 @@ void ABaseFPSCharacter::ClientWeaponLost_Implementation(AInventory* LostInv)
 
 			if (!PendingWeapon)
 			{
+				// the server materializes the next weapon, it may not have replicated yet
 				TInventoryIterator<AWeapon> It(this);
-				SetPendingWeapon(*It);	
+				SetPendingWeapon(*It);
+				PendingSlot = (It && !PendingWeapon) ? It.Index() : INDEX_NONE;
 			}
 			WeaponChanged();
 		}
@@ -1279,7 +1902,7 @@ void ABaseFPSCharacter::ClientWeaponReplaced_Implementation(AInventory* Replaced
 			{
 				// if we're here, then new inv was not present on client yet, setting flag to switch to OnRep/RepNotify.
 				// (not sure if/when this could happen, but keeping just in case...)
-				LastEquippedInventorySlot = Inventory.Find(EquippedWeapon);
+				LastEquippedInventorySlot = Inventory.FindSlot(EquippedWeapon);
 			}
 		}
 	}
@@ -1383,11 +2006,22 @@ AWeapon* ABaseFPSCharacter::GetEquippedWeapon() const
 	return EquippedWeapon;
 }
 
-TArray<AInventory*>& ABaseFPSCharacter::GetInventory()
+const FInventoryList& ABaseFPSCharacter::GetInventory() const
 {
 	return Inventory;
 }
 
+TArray<AInventory*> ABaseFPSCharacter::K2_GetInventory() const
+{
+	TArray<AInventory*> Items;
+	Items.Reserve(Inventory.Num());
+	for (int32 i = 0; i < Inventory.Num(); i++)
+	{
+		Items.Add(Inventory[i]);
+	}
+	return Items;
+}
+
 AWeapon* ABaseFPSCharacter::GetPendingWeapon() const
 {
 	return PendingWeapon;
@@ -7,6 +7,8 @@
 #include "InputActionValue.h"
 #include "Components/InteractableComponent.h"
 #include "Inventory/Inventory.h"
+#include "Inventory/InventoryList.h"
+#include "Weapons/ImpactEffectInfo.h"
 #include "BaseFPSCharacter.generated.h"
 
 class AWeaponAttachment;
@@ -72,7 +74,7 @@ struct FRepCharMovement
 	UPROPERTY()		uint16 ViewYaw;
 	UPROPERTY()		uint8 ViewPitch;
 	 
-	/* Compressed acceleration direction (lowest 2 bits are forward/back, next 2 bits are left/right (-1, 0, 1) */
+	/* Compressed acceleration direction (lowest 2 bits are forward/back, next 2 bits are left/right (-1, 0, 1), only the lowest 4 bits are replicated */
 	UPROPERTY()
 	uint8 AccelDir;
 
@@ -84,22 +86,11 @@ struct FRepCharMovement
 		, AccelDir(ForceInit)
 	{}
 
-	/* Should be disabled since WithNetSerializer is commented out, meaning we're sending sending deltas instead */ 
-	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
-	{
-		bOutSuccess = true;
-		bool bOutSuccessLocal = true;
-
-		LinearVelocity.NetSerialize(Ar, Map, bOutSuccessLocal);
-		bOutSuccess &= bOutSuccessLocal;
-		Location.NetSerialize(Ar, Map, bOutSuccessLocal);
-		bOutSuccess &= bOutSuccessLocal;
-		Ar.SerializeBits(&ViewYaw, 16);
-		Ar.SerializeBits(&ViewPitch, 8);
-		Ar.SerializeBits(&AccelDir, 8);
-
-		return true;
-	}
+	/**
+	 * Bit-packed serialization, see BaseFPSCharacter.cpp for the layout.
+	 * Location precision is set by BaseFPS.NetMovement.LocationQuantizeLevel, velocity precision scales with speed.
+	 */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
 
 	bool operator==(const FRepCharMovement& Other) const
 	{
@@ -126,7 +117,59 @@ struct TStructOpsTypeTraits<FRepCharMovement> : public TStructOpsTypeTraitsBase2
 {
 	enum
 	{
-		// WithNetSerializer = true
+		WithNetSerializer = true
+	};
+};
+
+/**
+ * Character movement sent through the replication graph's FastShared path. The struct is filled and serialized
+ * once per frame on the server, and the resulting bunch is reused for every connection the character is relevant to.
+ */
+USTRUCT()
+struct FSharedRepCharMovement
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)	FRepCharMovement RepMovement;
+
+	/** server's last transform update timestamp, zero if unused (see {@code ReplicatedServerLastTransformUpdateTimeStamp}) */
+	UPROPERTY(Transient)	float RepTimeStamp = 0.f;
+
+	/** packed network movement mode (see {@code ReplicatedMovementMode}) */
+	UPROPERTY(Transient)	uint8 RepMovementMode = 0;
+
+	UPROPERTY(Transient)	bool bProxyIsJumpForceApplied = false;
+	UPROPERTY(Transient)	bool bIsCrouched = false;
+
+	/**
+	 * Gathers the character's current movement state
+	 * @return false if the character cannot currently use the shared path */
+	bool FillForCharacter(ABaseFPSCharacter* Character);
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FSharedRepCharMovement& Other) const
+	{
+		return RepMovement == Other.RepMovement
+			&& RepTimeStamp == Other.RepTimeStamp
+			&& RepMovementMode == Other.RepMovementMode
+			&& bProxyIsJumpForceApplied == Other.bProxyIsJumpForceApplied
+			&& bIsCrouched == Other.bIsCrouched;
+	}
+
+	bool operator!=(const FSharedRepCharMovement& Other) const
+	{
+		return !(*this == Other);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FSharedRepCharMovement> : public TStructOpsTypeTraitsBase2<FSharedRepCharMovement>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithNetSharedSerialization = true
 	};
 };
 
@@ -141,6 +184,7 @@ public:
 protected:
 	//~Begin AActor interface
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void PostInitializeComponents() override;
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
@@ -159,8 +203,9 @@ public:
 	/* Delegates                                                            */
 	/************************************************************************/
 public:
-	DECLARE_MULTICAST_DELEGATE(FOnInventoryUpdatedSignature);
-	FOnInventoryUpdatedSignature OnInventoryUpdated;
+	/** broadcast once per frame for every inventory slot that changed (item added, removed, materialized or stowed) */
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnInventorySlotUpdatedSignature, int32 /* Slot */);
+	FOnInventorySlotUpdatedSignature OnInventorySlotUpdated;
 	
 	DECLARE_MULTICAST_DELEGATE(FOnEquippedNewWeaponSignature);
 	FOnEquippedNewWeaponSignature OnEquippedNewWeapon;
@@ -173,6 +218,19 @@ public:
 	
 	DECLARE_MULTICAST_DELEGATE_TwoParams(FOnInteractionEventSignature, UInteractableComponent* /* Interactable */, EInteractionEventType /* EventType */)
 	FOnInteractionEventSignature OnInteractionEvent;
+
+	/* -------------- Global events (used by the replication graph) -------------- */
+
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterCombatEventSignature, ABaseFPSCharacter* /* Character */);
+	/** [server] broadcast whenever any character fires or is hit by a shot */
+	static FOnCharacterCombatEventSignature GlobalOnCharacterCombatEvent;
+
+	/** [server] flags this character as involved in combat (fired or got shot at) */
+	void NotifyCombatEvent();
+
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnCharacterInventoryChangedSignature, ABaseFPSCharacter* /* Character */);
+	/** [server] broadcast whenever an item is added to, replaced in or removed from any character's inventory, or its actor is materialized or stowed */
+	static FOnCharacterInventoryChangedSignature GlobalOnCharacterInventoryChanged;
 	
 	/************************************************************************/
 	/* Networking                                                           */
@@ -189,7 +247,25 @@ protected:
 	
 	UFUNCTION()
 	void OnRep_ReplicatedCharMovement();
-	
+
+	/* -------------- FastShared replication (see UBaseFPSReplicationGraph) -------------- */
+public:
+	/**
+	 * [server] called by the replication graph when the character replicates through the FastShared path
+	 * @return false if the shared path can't be used this frame, the character then replicates through its properties */
+	bool UpdateSharedReplication();
+
+protected:
+	/** [client] shared movement update, serialized once and sent to every connection the character is relevant to */
+	UFUNCTION(NetMulticast, unreliable)
+	void FastSharedReplication(const FSharedRepCharMovement& SharedRepMovement);
+
+private:
+	/** the last shared movement sent, used to skip sending unchanged state */
+	FSharedRepCharMovement LastSharedReplication;
+
+	friend struct FSharedRepCharMovement;
+
 	/************************************************************************/
 	/* Movement                                                             */
 	/************************************************************************/
@@ -220,6 +296,7 @@ public:
 
 	/* -------------- Burst/Flash counters (non-local character firing effects) -------------- */
 protected:
+	// only replicated to replays (demo net driver), live clients get shots through UCosmeticFireRelevancySubsystem's fire event batches
 	UPROPERTY(Transient, Replicated)
 	uint8 FlashFireMode;
 	
@@ -229,21 +306,39 @@ protected:
 	UPROPERTY(Transient, ReplicatedUsing=FiringInfoReplicated)
 	FVector_NetQuantize FlashLocation;
 
+	/** what FlashLocation hit, if known */
+	FImpactEffectInfo FlashImpact;
+
+	/** [local] world time firing effects were last played for this non-local character */
+	float LastFiringEffectsTime = -BIG_NUMBER;
+
 public:
 	/** used when hit location is not important, e.g. projectile fire */
 	void IncrementFlashCounter(uint8 InFireMode);
 
 	/** used when hit location is important, e.g. hitscan fire */
-	void SetFlashLocation(const FVector& InFlashLoc, uint8 InFireMode);
+	void SetFlashLocation(const FVector& InFlashLoc, uint8 InFireMode, const FImpactEffectInfo& InImpact = FImpactEffectInfo());
 	const FVector_NetQuantize& GetFlashLocation() const;
+
+	/** [server] stops firing effects, relayed to the clients that were sent this character's shots */
+	void ClearFiringInfo();
+
+	/**
+	 * [client] plays firing effects relayed by UCosmeticFireRelevancySubsystem, a zero flash location means IncrementFlashCounter()
+	 * and a ShotCount of 0 means ClearFiringInfo() */
+	void PlayRelayedFiringInfo(uint8 InFireMode, const FVector& InFlashLoc, const FImpactEffectInfo& InImpact, uint8 ShotCount = 1);
+
+	/** used by UCharacterSignificanceSubsystem to keep shooting proxies significant */
+	float GetLastFiringEffectsTime() const { return LastFiringEffectsTime; }
 	
 protected:
+	/** [server] hands this shot to UCosmeticFireRelevancySubsystem, which decides what each connection gets to see */
+	void RelayFiringInfo(const FVector& InFlashLoc, const FImpactEffectInfo& InImpact);
+
 	/** [local] controls burst/flash effects for non-local characters, called on both server & clients  */
 	void FiringInfoUpdated();
-	
-	/** stops firing effects */
-	void ClearFiringInfo();
-	
+
+	/** [replay] firing info recorded by the demo net driver */
 	UFUNCTION()
 	void FiringInfoReplicated();
 
@@ -329,22 +424,41 @@ public:
 	/************************************************************************/
 
 protected:
-	/** The array used to store this inventory's items */
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_Inventory)
-	TArray<AInventory*> Inventory;
+	/**
+	 * This character's items by slot, only the occupied slots are replicated. Holstered items are stowed, kept as
+	 * their class and ammo, only the equipped (or pending) weapon has an actor (see BaseFPS.Inventory.StowDelay)
+	 */
+	UPROPERTY(Transient, Replicated)
+	FInventoryList Inventory;
 	
 	/** The number of items this character's inventory can hold */
 	UPROPERTY(EditDefaultsOnly, Category="Inventory", meta=(ClampMin=0, ClampMax=20))
 	int32 InventorySize;
 
 protected:
-	UFUNCTION()
-	void OnRep_Inventory();
+	/** called by the inventory list for every slot it adds, changes or empties (locally or through replication) */
+	void InventorySlotChanged(int32 Slot);
+
+	/** [client] called by the inventory list after replicated entries were added or changed, and by items once they know their owner */
+	void InventoryReplicated();
+	friend struct FInventoryList;
+	friend class AInventory;
 	
 private:
-	/** Flag set when this character's inventory updates this frame */
-	UPROPERTY(Transient)
-	uint8 bInventoryUpdatedThisFrame:1;
+	/** slots changed this frame, broadcast through OnInventorySlotUpdated on the next tick */
+	TArray<int32> DirtyInventorySlots;
+
+	FTimerHandle StowHolsteredInventoryTimerHandle;
+
+	/** [server] (re)starts the countdown to StowHolsteredInventory() */
+	void ScheduleStowHolsteredInventory();
+
+	/** [server] stows every materialized item that isn't equipped or pending, their actors go back to the pool */
+	void StowHolsteredInventory();
+
+public:
+	/** [server] the slot's item actor, acquired (and given the item's stowed state) if the item is stowed */
+	AInventory* MaterializeInventory(int32 Slot);
 
 public:
 	/** [server]
@@ -370,7 +484,14 @@ public:
 	
 	/** returns true if item is in inventory list */
 	bool IsInInventory(AInventory* TestInv) const;
+	bool HasInventoryOfType(TSubclassOf<AInventory> InvType) const;
+
+	/** the materialized item of InvType, null if there's none or it's stowed */
 	AInventory* GetInventoryOfType(TSubclassOf<AInventory> InvType) const;
+
+	/** [server] adds reserve ammo to the weapon of WeaponType, whether it's materialized or stowed
+	 * @return true if the character has a weapon of the type */
+	bool AddReserveAmmo(TSubclassOf<AWeapon> WeaponType, int32 AddAmount);
 	
 	bool CanPickUp(APickupInstance* PickupInstance) const;
 
@@ -383,8 +504,9 @@ public:
 	/** [server] adds default inventory for character, called on Restart() by Pawn/GameMode */
 	void AddDefaultInventory();
 
-	/** [server] used to create an inventory item to give to character */
-	AInventory* CreateInventory(TSubclassOf<AInventory> NewInvClass);
+	/** [server] gives the character a new (stowed) item of the class
+	 * @return the item's slot, INDEX_NONE if the inventory is full */
+	int32 CreateInventory(TSubclassOf<AInventory> NewInvClass);
 
 	/** destroys all items in character's inventory */
 	void DestroyAllInventory();
@@ -411,9 +533,9 @@ public:
 	/**
 	 * Picks the next weapon to equip in the player's inventory
 	 * @param bPrev find the previous weapon in sequence if true
-	 * @return the next weapon to equip
+	 * @return the slot of the next weapon to equip, INDEX_NONE if there's none
 	 */
-	AWeapon* GetNextWeaponFromSequence(bool bPrev);
+	int32 GetNextWeaponSlotFromSequence(bool bPrev);
 	
 	/** Sets the pending weapon for this character */
 	void SetPendingWeapon(AWeapon* NewWeapon);
@@ -452,6 +574,9 @@ protected:
 public:
 	/** [server + local] switches weapon */
 	void SwitchWeapon(AWeapon* NewWeapon);
+
+	/** [server + local] switches to the weapon in the slot, whether its actor is materialized yet or not */
+	void SwitchToSlot(int32 Slot);
 	
 	/** [server + local] Switches to starting weapon */
 	void SwitchToStartingWeapon();
@@ -459,12 +584,22 @@ public:
 private:
 	/** [server + local] handles actual weapon switch logic */
 	void LocalSwitchWeapon(AWeapon* NewWeapon);
+
+	/**
+	 * [server + local] switches to the slot's weapon, materializing it on the server. A client that doesn't have the
+	 * weapon's actor yet puts the equipped weapon down meanwhile and switches once it replicates (see PendingSlot)
+	 */
+	void LocalSwitchToSlot(int32 Slot);
 	
 protected:
 	/** [server] request to server switch to new weapon */
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerSwitchWeapon(AWeapon* NewWeapon);
 
+	/** [server] request to server switch to the slot's weapon, which the client may only know as a stowed item */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSwitchToSlot(uint8 Slot);
+
 	/** [server] weapon check after switching to prevent mismatch between server/client */
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerVerifyEquippedWeapon(AWeapon* NewWeapon);
@@ -472,6 +607,10 @@ protected:
 	/** [local] request to client switch to new weapon and send RPC to server to follow their lead */
 	UFUNCTION(Client, Reliable)
 	void ClientSwitchWeapon(AWeapon* NewWeapon);
+
+	/** [local] request to client switch to the slot's weapon and send RPC to server to follow their lead */
+	UFUNCTION(Client, Reliable)
+	void ClientSwitchToSlot(uint8 Slot);
 	
 public:
 	/** [server + local]
@@ -483,6 +622,9 @@ public:
 protected:
 	/** [client] flag set when the equipped weapon is replaced but new weapon is not fully replicated */
 	int32 LastEquippedInventorySlot;
+
+	/** [client] the slot being switched to while the server materializes its weapon, INDEX_NONE if none */
+	int32 PendingSlot;
 public:
 	/** [client] request to client to verify their current weapon with server, initiated when mismatch detected */
 	UFUNCTION(Client, Reliable)
@@ -578,8 +720,11 @@ public:
 	UFUNCTION(BlueprintPure, Category="Character")
 	AWeapon* GetEquippedWeapon() const;
 	
-	UFUNCTION(BlueprintPure, Category="Character")
-	TArray<AInventory*>& GetInventory();
+	const FInventoryList& GetInventory() const;
+
+	/** the item actor in each inventory slot, null for empty slots and stowed items (see GetInventory for their classes) */
+	UFUNCTION(BlueprintPure, Category="Character", meta=(DisplayName="Get Inventory"))
+	TArray<AInventory*> K2_GetInventory() const;
 
 	/* -------------- Weapons -------------- */
 
@@ -593,7 +738,8 @@ public:
  * TInventoryIterator
  ********************************************************************************************
  *[Adapted from UTAlpha]
- * Iterator used to access an inventory array, useful because it protects against invalid actors (e.g. not fully initialized/replicated locally)
+ * Iterator over the occupied inventory slots holding items of a type, stowed or not. Dereferencing gives the item's
+ * actor, which is null while the item is stowed or its actor isn't fully initialized/replicated locally
  * @param InvType the inventory type, e.g. weapon, armor, powerups, etc.
  */
 
@@ -601,29 +747,34 @@ template <typename InvType = AInventory> class BASEFPS_API TInventoryIterator
 {
 private:
 	ABaseFPSCharacter* Owner;
-	TArray<AInventory*>& Inventory;
+	const FInventoryList& Inventory;
 	bool bReverse;
 	int32 CurrIdx;
 
 	inline bool IsValidForIteration(int32 Index)
 	{
-		return Inventory[Index] != nullptr
-			&& Inventory[Index]->GetOwner() != nullptr
-			&& Inventory[Index]->GetOwner() == Owner
-			&& Inventory[Index]->IsA(InvType::StaticClass());
+		const TSubclassOf<AInventory> ItemClass = Inventory.GetItemClass(Index);
+		return ItemClass && ItemClass->IsChildOf(InvType::StaticClass());
+	}
+
+	inline InvType* GetItem()
+	{
+		AInventory* Item = Inventory.IsValidSlot(CurrIdx) ? Inventory.GetItem(CurrIdx) : nullptr;
+		if (Item == nullptr || Item->GetOwner() == nullptr || Item->GetOwner() != Owner || !Item->IsA(InvType::StaticClass()))
+		{
+			return nullptr;
+		}
+		return static_cast<InvType*>(Item);
 	}
 
 public:
 	TInventoryIterator(ABaseFPSCharacter* InventoryOwner, bool bRev = false)
 		: Owner(InventoryOwner), Inventory(InventoryOwner->GetInventory()), bReverse(bRev)
 	{
-		if (InventoryOwner)
+		CurrIdx = bReverse ? (Inventory.Num()-1) : 0;
+		if (Inventory.IsValidSlot(CurrIdx) && !IsValidForIteration(CurrIdx))
 		{
-			CurrIdx = bReverse ? (Inventory.Num()-1) : 0;
-			if (!IsValidForIteration(CurrIdx))
-			{
-				Next();
-			}
+			Next();
 		}
 	}
 
@@ -639,12 +790,12 @@ public:
 			{
 				CurrIdx++;
 			}
-		} while(Inventory.IsValidIndex(CurrIdx) && !IsValidForIteration(CurrIdx));
+		} while(Inventory.IsValidSlot(CurrIdx) && !IsValidForIteration(CurrIdx));
 	}
 	
 	FORCEINLINE bool IsValid()
 	{
-		return Inventory.IsValidIndex(CurrIdx) && IsValidForIteration(CurrIdx);
+		return Inventory.IsValidSlot(CurrIdx) && IsValidForIteration(CurrIdx);
 	}
 	
 	FORCEINLINE operator bool()
@@ -654,20 +805,17 @@ public:
 	
 	FORCEINLINE InvType* operator*()
 	{
-		if (!Inventory.IsValidIndex(CurrIdx) || Inventory[CurrIdx] == nullptr || !Inventory[CurrIdx]->IsA(InvType::StaticClass()))
-		{
-			return nullptr;
-		}
-		return static_cast<InvType*>(Inventory[CurrIdx]);
+		return GetItem();
 	}
 	
 	FORCEINLINE InvType* operator->()
 	{
-		if (!Inventory.IsValidIndex(CurrIdx) || Inventory[CurrIdx] == nullptr || !Inventory[CurrIdx]->IsA(InvType::StaticClass()))
-		{
-			return nullptr;
-		}
-		return static_cast<InvType*>(Inventory[CurrIdx]);
+		return GetItem();
+	}
+
+	FORCEINLINE TSubclassOf<AInventory> GetItemClass() const
+	{
+		return Inventory.GetItemClass(CurrIdx);
 	}
 
 	FORCEINLINE int32 Index() const
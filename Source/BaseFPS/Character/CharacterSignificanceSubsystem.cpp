@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/CharacterSignificanceSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Character/BaseFPSCharacter.h"
+#include "DrawDebugHelpers.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance: Evaluate"), STAT_BaseFPS_SignificanceEvaluate, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_Significance_Enable = 1;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceEnable(TEXT("BaseFPS.Significance.Enable"), CVar_BaseFPS_Significance_Enable, TEXT("Throttles simulated proxy characters by significance, 0 restores every proxy to full rate"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_EvaluateInterval = 0.2f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceEvaluateInterval(TEXT("BaseFPS.Significance.EvaluateInterval"), CVar_BaseFPS_Significance_EvaluateInterval, TEXT("Seconds between significance evaluations"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_HighDist = 2500.f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceHighDist(TEXT("BaseFPS.Significance.HighDist"), CVar_BaseFPS_Significance_HighDist, TEXT("Proxies within this distance of a local viewer are updated at full rate, rendered or not"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_MediumDist = 8000.f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceMediumDist(TEXT("BaseFPS.Significance.MediumDist"), CVar_BaseFPS_Significance_MediumDist, TEXT("Rendered proxies within this distance are Medium, further away Low"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_CombatTime = 3.f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceCombatTime(TEXT("BaseFPS.Significance.CombatTime"), CVar_BaseFPS_Significance_CombatTime, TEXT("Proxies that fired within this many seconds are bumped up one bucket"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_MediumTickInterval = 1.f / 30.f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceMediumTickInterval(TEXT("BaseFPS.Significance.MediumTickInterval"), CVar_BaseFPS_Significance_MediumTickInterval, TEXT("Seconds between actor and movement ticks of Medium proxies (rendered, beyond HighDist), animation skips 1 frame in 2"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_LowTickInterval = 0.1f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceLowTickInterval(TEXT("BaseFPS.Significance.LowTickInterval"), CVar_BaseFPS_Significance_LowTickInterval, TEXT("Seconds between actor and movement ticks of Low proxies (rendered, beyond MediumDist), animation skips 3 frames in 4"), ECVF_Default );
+
+float CVar_BaseFPS_Significance_HiddenTickInterval = 0.25f;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceHiddenTickInterval(TEXT("BaseFPS.Significance.HiddenTickInterval"), CVar_BaseFPS_Significance_HiddenTickInterval, TEXT("Seconds between actor and movement ticks of Hidden proxies (not rendered, beyond HighDist), animation skips 7 frames in 8"), ECVF_Default );
+
+int32 CVar_BaseFPS_Significance_DrawDebug = 0;
+static FAutoConsoleVariableRef CVarBaseFPSSignificanceDrawDebug(TEXT("BaseFPS.Significance.DrawDebug"), CVar_BaseFPS_Significance_DrawDebug, TEXT("Draws each proxy's significance bucket above its head"), ECVF_Default );
+
+// ----------------------------------------------------------------------------------------------------------
+
+namespace CharacterSignificance
+{
+	/** animation frames skipped between updates (URO), per bucket */
+	static constexpr int32 FrameSkips[] = { 0, 1, 3, 7 };
+
+	static const TCHAR* Names[] = { TEXT("High"), TEXT("Medium"), TEXT("Low"), TEXT("Hidden") };
+	static const FColor Colors[] = { FColor::Green, FColor::Yellow, FColor::Orange, FColor::Red };
+
+	static float GetTickInterval(ECharacterSignificance Significance)
+	{
+		switch (Significance)
+		{
+		case ECharacterSignificance::Medium:	return CVar_BaseFPS_Significance_MediumTickInterval;
+		case ECharacterSignificance::Low:		return CVar_BaseFPS_Significance_LowTickInterval;
+		case ECharacterSignificance::Hidden:	return CVar_BaseFPS_Significance_HiddenTickInterval;
+		default:								return 0.f;
+		}
+	}
+}
+
+bool UCharacterSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UCharacterSignificanceSubsystem::Deinitialize()
+{
+	TrackedCharacters.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UCharacterSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UCharacterSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (TrackedCharacters.Num() > 0 && Now >= NextEvaluateTime)
+	{
+		NextEvaluateTime = Now + CVar_BaseFPS_Significance_EvaluateInterval;
+		EvaluateSignificance();
+	}
+
+	if (CVar_BaseFPS_Significance_DrawDebug > 0)
+	{
+		DrawDebug();
+	}
+}
+
+TStatId UCharacterSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+bool UCharacterSignificanceSubsystem::IsEnabled()
+{
+	return CVar_BaseFPS_Significance_Enable > 0;
+}
+
+void UCharacterSignificanceSubsystem::RegisterCharacter(ABaseFPSCharacter* Character)
+{
+	if (Character && !TrackedCharacters.ContainsByPredicate([Character](const FTrackedCharacter& Tracked) { return Tracked.Character == Character; }))
+	{
+		TrackedCharacters.AddDefaulted_GetRef().Character = Character;
+	}
+}
+
+void UCharacterSignificanceSubsystem::UnregisterCharacter(ABaseFPSCharacter* Character)
+{
+	const int32 Index = TrackedCharacters.IndexOfByPredicate([Character](const FTrackedCharacter& Tracked) { return Tracked.Character == Character; });
+	if (Index > INDEX_NONE)
+	{
+		if (TrackedCharacters[Index].Significance != ECharacterSignificance::High)
+		{
+			ApplySignificance(Character, ECharacterSignificance::High);
+		}
+		TrackedCharacters.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+ECharacterSignificance UCharacterSignificanceSubsystem::GetSignificance(const ABaseFPSCharacter* Character) const
+{
+	const FTrackedCharacter* Tracked = TrackedCharacters.FindByPredicate([Character](const FTrackedCharacter& Tracked) { return Tracked.Character == Character; });
+	return Tracked ? Tracked->Significance : ECharacterSignificance::High;
+}
+
+void UCharacterSignificanceSubsystem::EvaluateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_SignificanceEvaluate);
+
+	// every local viewer counts (split screen), a proxy is as significant as it is to the closest one
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (PC && PC->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	for (int32 Index = TrackedCharacters.Num() - 1; Index >= 0; --Index)
+	{
+		FTrackedCharacter& Tracked = TrackedCharacters[Index];
+		ABaseFPSCharacter* Character = Tracked.Character.Get();
+		if (Character == nullptr)
+		{
+			TrackedCharacters.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		const ECharacterSignificance Significance = (IsEnabled() && ViewLocations.Num() > 0) ? ScoreCharacter(Character, ViewLocations) : ECharacterSignificance::High;
+		if (Significance != Tracked.Significance)
+		{
+			Tracked.Significance = Significance;
+			ApplySignificance(Character, Significance);
+		}
+		else if (Significance != ECharacterSignificance::High && Character->GetMesh()->AnimUpdateRateParams && !Character->GetMesh()->AnimUpdateRateParams->bShouldUseLodMap)
+		{
+			// the mesh's update rate params only exist once it ticked with URO on, catch up on the frame skip
+			ApplySignificance(Character, Significance);
+		}
+	}
+}
+
+ECharacterSignificance UCharacterSignificanceSubsystem::ScoreCharacter(const ABaseFPSCharacter* Character, const TArray<FVector>& ViewLocations) const
+{
+	if (Character->GetLocalRole() != ROLE_SimulatedProxy)
+	{
+		return ECharacterSignificance::High;
+	}
+
+	float MinDistSq = MAX_flt;
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		MinDistSq = FMath::Min<float>(MinDistSq, FVector::DistSquared(ViewLocation, Character->GetActorLocation()));
+	}
+
+	if (MinDistSq < FMath::Square(CVar_BaseFPS_Significance_HighDist))
+	{
+		return ECharacterSignificance::High;
+	}
+
+	ECharacterSignificance Significance = MinDistSq < FMath::Square(CVar_BaseFPS_Significance_MediumDist) ? ECharacterSignificance::Medium : ECharacterSignificance::Low;
+	if (!Character->GetMesh()->WasRecentlyRendered(0.2f))
+	{
+		Significance = ECharacterSignificance::Hidden;
+	}
+
+	// shooting proxies get a bucket more, they're likely to be looked at (or shooting at us) any moment
+	if (GetWorld()->TimeSince(Character->GetLastFiringEffectsTime()) < CVar_BaseFPS_Significance_CombatTime)
+	{
+		Significance = static_cast<ECharacterSignificance>(static_cast<uint8>(Significance) - 1);
+	}
+	return Significance;
+}
+
+void UCharacterSignificanceSubsystem::ApplySignificance(ABaseFPSCharacter* Character, ECharacterSignificance Significance)
+{
+	const ABaseFPSCharacter* DefaultCharacter = Character->GetClass()->GetDefaultObject<ABaseFPSCharacter>();
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	if (Significance == ECharacterSignificance::High)
+	{
+		Character->SetActorTickInterval(DefaultCharacter->GetActorTickInterval());
+		Movement->SetComponentTickInterval(DefaultCharacter->GetCharacterMovement()->GetComponentTickInterval());
+		Movement->NetworkSmoothingMode = DefaultCharacter->GetCharacterMovement()->NetworkSmoothingMode;
+		Mesh->bEnableUpdateRateOptimizations = DefaultCharacter->GetMesh()->bEnableUpdateRateOptimizations;
+		if (Mesh->AnimUpdateRateParams)
+		{
+			Mesh->AnimUpdateRateParams->bShouldUseLodMap = false;
+		}
+		return;
+	}
+
+	// view pitch interpolation and movement smoothing run on the actor and movement ticks
+	const float TickInterval = CharacterSignificance::GetTickInterval(Significance);
+	Character->SetActorTickInterval(TickInterval);
+	Movement->SetComponentTickInterval(TickInterval);
+	Movement->NetworkSmoothingMode = (Significance == ECharacterSignificance::Medium) ? ENetworkSmoothingMode::Linear : ENetworkSmoothingMode::Disabled;
+
+	Mesh->bEnableUpdateRateOptimizations = true;
+	if (FAnimUpdateRateParameters* UpdateRateParams = Mesh->AnimUpdateRateParams)
+	{
+		// every LOD gets the bucket's frame skip, the bucket decides the rate rather than the screen size
+		const int32 FrameSkip = CharacterSignificance::FrameSkips[static_cast<uint8>(Significance)];
+		UpdateRateParams->bShouldUseLodMap = true;
+		UpdateRateParams->LODToFrameSkipMap.Reset();
+		for (int32 LODIndex = 0; LODIndex < FMath::Max(Mesh->GetNumLODs(), 1); LODIndex++)
+		{
+			UpdateRateParams->LODToFrameSkipMap.Add(LODIndex, FrameSkip);
+		}
+		UpdateRateParams->BaseNonRenderedUpdateRate = FrameSkip + 1;
+	}
+}
+
+void UCharacterSignificanceSubsystem::DrawDebug() const
+{
+	for (const FTrackedCharacter& Tracked : TrackedCharacters)
+	{
+		if (const ABaseFPSCharacter* Character = Tracked.Character.Get())
+		{
+			const uint8 Bucket = static_cast<uint8>(Tracked.Significance);
+			const FVector Location = Character->GetActorLocation() + FVector(0.f, 0.f, Character->GetSimpleCollisionHalfHeight() + 30.f);
+			DrawDebugString(GetWorld(), Location, CharacterSignificance::Names[Bucket], nullptr, CharacterSignificance::Colors[Bucket], 0.f, true);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterSignificanceSubsystem.generated.h"
+
+class ABaseFPSCharacter;
+
+/** How much detail a simulated proxy is updated with, most significant first */
+UENUM()
+enum class ECharacterSignificance : uint8
+{
+	/** close by, full rate */
+	High,
+	Medium,
+	Low,
+	/** not rendered and not close by */
+	Hidden,
+	MAX UMETA(Hidden)
+};
+
+/**
+ * [client] Scores simulated proxy characters by distance to the local viewers, whether they were rendered and whether
+ * they fired recently, and sorts them into {@code ECharacterSignificance} buckets. Each bucket throttles the
+ * character's tick (view pitch interpolation), its movement component's tick and network smoothing, and the 3P
+ * mesh's animation update rate (URO). The High bucket restores the class defaults.
+ *
+ * Buckets are re-evaluated every EvaluateInterval, not every frame. See BaseFPS.Significance.*
+ */
+UCLASS()
+class BASEFPS_API UCharacterSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	static bool IsEnabled();
+
+	/** [client] starts throttling the character while it's a simulated proxy */
+	void RegisterCharacter(ABaseFPSCharacter* Character);
+
+	/** [client] stops throttling the character, restoring its defaults */
+	void UnregisterCharacter(ABaseFPSCharacter* Character);
+
+	ECharacterSignificance GetSignificance(const ABaseFPSCharacter* Character) const;
+
+private:
+	struct FTrackedCharacter
+	{
+		TWeakObjectPtr<ABaseFPSCharacter> Character;
+		ECharacterSignificance Significance = ECharacterSignificance::High;
+	};
+	TArray<FTrackedCharacter> TrackedCharacters;
+
+	float NextEvaluateTime = 0.f;
+
+	/** sorts every tracked proxy into its bucket and applies the bucket's settings when it changed */
+	void EvaluateSignificance();
+
+	ECharacterSignificance ScoreCharacter(const ABaseFPSCharacter* Character, const TArray<FVector>& ViewLocations) const;
+
+	static void ApplySignificance(ABaseFPSCharacter* Character, ECharacterSignificance Significance);
+
+	void DrawDebug() const;
+};
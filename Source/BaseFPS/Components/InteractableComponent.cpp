@@ -5,6 +5,7 @@
 
 #include "BaseFPS.h"
 #include "Character/BaseFPSCharacter.h"
+#include "Components/InteractableSubsystem.h"
 
 // Sets default values for this component's properties
 UInteractableComponent::UInteractableComponent(const FObjectInitializer& ObjectInitializer)
@@ -31,7 +32,37 @@ void UInteractableComponent::BeginPlay()
 
 	// caching value for optimization
 	InteractableDistanceSquared = FMath::Square(InteractableDistance);
-	
+
+	if (UInteractableSubsystem* Interactables = GetWorld()->GetSubsystem<UInteractableSubsystem>())
+	{
+		Interactables->RegisterInteractable(this);
+		if (USceneComponent* Root = GetOwner()->GetRootComponent())
+		{
+			Root->TransformUpdated.AddUObject(this, &UInteractableComponent::OnOwnerMoved);
+		}
+	}
+}
+
+void UInteractableComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UInteractableSubsystem* Interactables = GetWorld()->GetSubsystem<UInteractableSubsystem>())
+	{
+		Interactables->UnregisterInteractable(this);
+	}
+	if (USceneComponent* Root = GetOwner()->GetRootComponent())
+	{
+		Root->TransformUpdated.RemoveAll(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UInteractableComponent::OnOwnerMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (UInteractableSubsystem* Interactables = GetWorld()->GetSubsystem<UInteractableSubsystem>())
+	{
+		Interactables->UpdateInteractable(this);
+	}
 }
 
 void UInteractableComponent::BeginInteract(ABaseFPSCharacter* Character)
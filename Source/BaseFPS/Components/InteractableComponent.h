@@ -96,6 +96,10 @@ public:
 	
 	protected:
 	void BeginPlay() override;
+	void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** keeps our entry in UInteractableSubsystem's index up to date */
+	void OnOwnerMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
 	
 public:
 	/** called on the client when the player's interaction check begins/ends focus on this item */
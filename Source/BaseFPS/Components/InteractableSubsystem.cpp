@@ -0,0 +1,401 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/InteractableSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Components/InteractableComponent.h"
+#include "EngineUtils.h"
+#include "Pickups/PickupInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Interactables: Query View"), STAT_BaseFPS_InteractablesQueryView, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+float CVar_BaseFPS_Interactables_CellSize = 1000.f;
+static FAutoConsoleVariableRef CVarBaseFPSInteractablesCellSize(TEXT("BaseFPS.Interactables.CellSize"), CVar_BaseFPS_Interactables_CellSize, TEXT("Size of the interactable grid's cells, applies to worlds started afterwards"), ECVF_Default );
+
+float CVar_BaseFPS_Interactables_ConeHalfAngle = 3.f;
+static FAutoConsoleVariableRef CVarBaseFPSInteractablesConeHalfAngle(TEXT("BaseFPS.Interactables.ConeHalfAngle"), CVar_BaseFPS_Interactables_ConeHalfAngle, TEXT("Degrees off the view direction an interactable can be focused at, on top of its focus radius"), ECVF_Default );
+
+/* -------------- FAutoConsoleCommandWithWorldAndArgs -------------- */
+
+namespace InteractableBenchmark
+{
+	/** the focus check as it was before the index: multi trace, then look up the component on every hit */
+	static UInteractableComponent* LegacyQuery(UWorld* World, const FVector& ViewLocation, const FVector& ViewDirection, float MaxDistance)
+	{
+		TArray<FHitResult> OutHits;
+		World->LineTraceMultiByChannel(OutHits, ViewLocation, ViewLocation + ViewDirection * MaxDistance, COLLISION_INTERACTABLE, FCollisionQueryParams());
+
+		UInteractableComponent* HitInFocus = nullptr;
+		double DotForHitInFocus = -1.0;
+		if (OutHits.Num() > 0 && !OutHits[0].bBlockingHit)
+		{
+			for (const FHitResult& Hit : OutHits)
+			{
+				UInteractableComponent* HitInteractable = Hit.GetActor() ? Cast<UInteractableComponent>(Hit.GetActor()->GetComponentByClass(UInteractableComponent::StaticClass())) : nullptr;
+				if (HitInteractable && (ViewLocation - Hit.ImpactPoint).SizeSquared() <= HitInteractable->GetInteractableDistanceSquared())
+				{
+					const double DotForHit = FVector::DotProduct(ViewDirection, (Hit.GetActor()->GetActorLocation() - ViewLocation).GetSafeNormal());
+					if (DotForHit > DotForHitInFocus)
+					{
+						HitInFocus = HitInteractable;
+						DotForHitInFocus = DotForHit;
+					}
+				}
+			}
+		}
+		return HitInFocus;
+	}
+
+	static UInteractableComponent* IndexedQuery(const UInteractableSubsystem* Interactables, TArray<FInteractableCandidate>& Candidates, const FVector& ViewLocation, const FVector& ViewDirection, float MaxDistance)
+	{
+		Interactables->QueryView(ViewLocation, ViewDirection, MaxDistance, Candidates);
+		for (const FInteractableCandidate& Candidate : Candidates)
+		{
+			if (FMath::Square(Candidate.Distance) <= Candidate.Component->GetInteractableDistanceSquared()
+				&& Interactables->IsVisibleFrom(ViewLocation, ViewDirection, Candidate, nullptr))
+			{
+				return Candidate.Component;
+			}
+		}
+		return nullptr;
+	}
+}
+
+FAutoConsoleCommandWithWorldAndArgs InteractablesBenchmarkCmd(TEXT("BaseFPS.Interactables.Benchmark"), TEXT("Spawns pickups around the world origin and times the focus check with the multi trace against the interactable index. Usage: BaseFPS.Interactables.Benchmark [Interactables=500] [Queries=10000] [Radius=5000] [Distance=400] [PickupClass=/Game/...]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const FString Cmd = FString::Join(Args, TEXT(" "));
+		int32 NumInteractables = 500;
+		int32 NumQueries = 10000;
+		float Radius = 5000.f;
+		float MaxDistance = 400.f;
+		FString PickupClassPath;
+		FParse::Value(*Cmd, TEXT("Interactables="), NumInteractables);
+		FParse::Value(*Cmd, TEXT("Queries="), NumQueries);
+		FParse::Value(*Cmd, TEXT("Radius="), Radius);
+		FParse::Value(*Cmd, TEXT("Distance="), MaxDistance);
+		FParse::Value(*Cmd, TEXT("PickupClass="), PickupClassPath);
+		NumQueries = FMath::Max(NumQueries, 1);
+
+		UInteractableSubsystem* Interactables = World ? World->GetSubsystem<UInteractableSubsystem>() : nullptr;
+		if (Interactables == nullptr)
+		{
+			UE_LOG(LogBaseFPS, Warning, TEXT("Interactables benchmark: needs a game world"));
+			return;
+		}
+
+		UClass* PickupClass = PickupClassPath.IsEmpty() ? nullptr : LoadClass<APickupInstance>(nullptr, *PickupClassPath);
+		for (TActorIterator<APickupInstance> It(World); It && PickupClass == nullptr; ++It)
+		{
+			PickupClass = It->GetClass();
+		}
+		if (PickupClass == nullptr)
+		{
+			UE_LOG(LogBaseFPS, Warning, TEXT("Interactables benchmark: no pickup class found (use PickupClass=)"));
+			return;
+		}
+
+		// pickups spread over a disc, queries from eye height looking mostly at a pickup so both paths find something
+		FRandomStream Stream(0x1A7E);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		TArray<AActor*> Pickups;
+		for (int32 i = 0; i < NumInteractables; i++)
+		{
+			const FVector2D Offset = FMath::RandPointInCircle(Radius);
+			const FVector Location(Offset.X, Offset.Y, 50.f);
+			if (AActor* Pickup = World->SpawnActor<AActor>(PickupClass, Location, FRotator::ZeroRotator, SpawnParams))
+			{
+				Pickups.Add(Pickup);
+			}
+		}
+		if (Pickups.Num() == 0)
+		{
+			UE_LOG(LogBaseFPS, Warning, TEXT("Interactables benchmark: failed to spawn %s"), *PickupClass->GetName());
+			return;
+		}
+
+		TArray<TPair<FVector, FVector>> Views;
+		Views.Reserve(NumQueries);
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			const FVector Target = Pickups[Stream.RandRange(0, Pickups.Num() - 1)]->GetActorLocation();
+			const FVector ViewLocation = Target + FVector(Stream.FRandRange(-300.f, 300.f), Stream.FRandRange(-300.f, 300.f), 110.f);
+			const FVector ToTarget = (Target - ViewLocation).GetSafeNormal();
+			const FVector ViewDirection = Stream.FRand() < 0.7f ? ToTarget : Stream.VRandCone(ToTarget, FMath::DegreesToRadians(30.f));
+			Views.Emplace(ViewLocation, ViewDirection);
+		}
+
+		int32 NumLegacyFound = 0;
+		TArray<UInteractableComponent*> LegacyResults;
+		LegacyResults.Reserve(NumQueries);
+		const double LegacyStart = FPlatformTime::Seconds();
+		for (const TPair<FVector, FVector>& View : Views)
+		{
+			LegacyResults.Add(InteractableBenchmark::LegacyQuery(World, View.Key, View.Value, MaxDistance));
+		}
+		const double LegacyMs = (FPlatformTime::Seconds() - LegacyStart) * 1000.0;
+
+		int32 NumIndexedFound = 0;
+		int32 NumMismatches = 0;
+		TArray<FInteractableCandidate> Candidates;
+		TArray<UInteractableComponent*> IndexedResults;
+		IndexedResults.Reserve(NumQueries);
+		const double IndexedStart = FPlatformTime::Seconds();
+		for (const TPair<FVector, FVector>& View : Views)
+		{
+			IndexedResults.Add(InteractableBenchmark::IndexedQuery(Interactables, Candidates, View.Key, View.Value, MaxDistance));
+		}
+		const double IndexedMs = (FPlatformTime::Seconds() - IndexedStart) * 1000.0;
+
+		for (int32 i = 0; i < NumQueries; i++)
+		{
+			NumLegacyFound += LegacyResults[i] ? 1 : 0;
+			NumIndexedFound += IndexedResults[i] ? 1 : 0;
+			NumMismatches += (LegacyResults[i] && LegacyResults[i] != IndexedResults[i]) ? 1 : 0;
+		}
+
+		UE_LOG(LogBaseFPS, Display, TEXT("Interactables benchmark (%d pickups, %d queries, %.0fcm): multi trace %.2fus/query (%d found), index %.2fus/query (%d found), %d traced focus changed"),
+			Pickups.Num(), NumQueries, MaxDistance, LegacyMs * 1000.0 / NumQueries, NumLegacyFound, IndexedMs * 1000.0 / NumQueries, NumIndexedFound, NumMismatches);
+
+		for (AActor* Pickup : Pickups)
+		{
+			Pickup->Destroy();
+		}
+	})
+);
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool UInteractableSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UInteractableSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	CellSize = FMath::Max(CVar_BaseFPS_Interactables_CellSize, 100.f);
+}
+
+void UInteractableSubsystem::Deinitialize()
+{
+	Cells.Empty();
+	ComponentCells.Empty();
+	MaxFocusRadius = 0.f;
+	bMaxFocusRadiusDirty = false;
+
+	Super::Deinitialize();
+}
+
+bool UInteractableSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UInteractableSubsystem::RegisterInteractable(UInteractableComponent* Component)
+{
+	if (Component && !ComponentCells.Contains(Component))
+	{
+		FVector Location;
+		float FocusRadius;
+		GetComponentBounds(Component, Location, FocusRadius);
+
+		const FIntVector Cell = GetCell(Location);
+		ComponentCells.Add(Component, Cell);
+		AddToCell(Cell, Component, Location, FocusRadius);
+	}
+}
+
+void UInteractableSubsystem::UnregisterInteractable(UInteractableComponent* Component)
+{
+	FIntVector Cell;
+	if (ComponentCells.RemoveAndCopyValue(Component, Cell))
+	{
+		RemoveFromCell(Cell, Component);
+	}
+}
+
+void UInteractableSubsystem::UpdateInteractable(UInteractableComponent* Component)
+{
+	FIntVector* CellPtr = ComponentCells.Find(Component);
+	if (CellPtr == nullptr)
+	{
+		return;
+	}
+
+	FVector Location;
+	float FocusRadius;
+	GetComponentBounds(Component, Location, FocusRadius);
+
+	const FIntVector NewCell = GetCell(Location);
+	if (NewCell != *CellPtr)
+	{
+		RemoveFromCell(*CellPtr, Component);
+		AddToCell(NewCell, Component, Location, FocusRadius);
+		*CellPtr = NewCell;
+	}
+	else if (FInteractableCell* Cell = Cells.Find(NewCell))
+	{
+		const int32 Index = Cell->Components.IndexOfByKey(Component);
+		if (Index != INDEX_NONE)
+		{
+			bMaxFocusRadiusDirty |= FocusRadius < Cell->FocusRadii[Index] && Cell->FocusRadii[Index] >= MaxFocusRadius;
+			Cell->Locations[Index] = Location;
+			Cell->FocusRadii[Index] = FocusRadius;
+			MaxFocusRadius = FMath::Max(MaxFocusRadius, FocusRadius);
+		}
+	}
+}
+
+void UInteractableSubsystem::QueryView(const FVector& ViewLocation, const FVector& ViewDirection, float MaxDistance, TArray<FInteractableCandidate>& OutCandidates) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_InteractablesQueryView);
+
+	OutCandidates.Reset();
+
+	const float ConeHalfAngle = FMath::DegreesToRadians(FMath::Clamp(CVar_BaseFPS_Interactables_ConeHalfAngle, 0.f, 89.f));
+	const float CosHalfAngle = FMath::Cos(ConeHalfAngle);
+
+	// the cells around the view segment, widened by how far off the ray an interactable can still be focused
+	const FVector ViewEnd = ViewLocation + ViewDirection * MaxDistance;
+	const FVector Slack(GetMaxFocusRadius() + MaxDistance * FMath::Sin(ConeHalfAngle));
+	const FIntVector MinCell = GetCell(ViewLocation.ComponentMin(ViewEnd) - Slack);
+	const FIntVector MaxCell = GetCell(ViewLocation.ComponentMax(ViewEnd) + Slack);
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+			{
+				const FInteractableCell* Cell = Cells.Find(FIntVector(X, Y, Z));
+				if (Cell == nullptr)
+				{
+					continue;
+				}
+
+				for (int32 Index = 0; Index < Cell->Components.Num(); Index++)
+				{
+					const FVector ToTarget = Cell->Locations[Index] - ViewLocation;
+					const float FocusRadius = Cell->FocusRadii[Index];
+					const float Along = ToTarget | ViewDirection;
+					const float DistSq = ToTarget.SizeSquared();
+					const float Distance = FMath::Max(FMath::Sqrt(DistSq) - FocusRadius, 0.f);
+					if (Along <= 0.f || Distance > MaxDistance)
+					{
+						continue;
+					}
+
+					// on the view ray (what the trace used to hit), or inside the cone
+					const float ViewDot = Along / FMath::Max(FMath::Sqrt(DistSq), KINDA_SMALL_NUMBER);
+					const bool bOnRay = (DistSq - FMath::Square(Along)) <= FMath::Square(FocusRadius);
+					if (!bOnRay && ViewDot < CosHalfAngle)
+					{
+						continue;
+					}
+
+					UInteractableComponent* Component = Cell->Components[Index];
+					const AActor* Owner = Component ? Component->GetOwner() : nullptr;
+					if (Owner == nullptr || Owner->IsHidden() || !Component->IsActive())
+					{
+						continue; // e.g. waiting in the actor pool
+					}
+
+					FInteractableCandidate& Candidate = OutCandidates.AddDefaulted_GetRef();
+					Candidate.Component = Component;
+					Candidate.Location = Cell->Locations[Index];
+					Candidate.Distance = Distance;
+					Candidate.ViewDot = ViewDot;
+				}
+			}
+		}
+	}
+
+	OutCandidates.Sort([](const FInteractableCandidate& A, const FInteractableCandidate& B) { return A.ViewDot > B.ViewDot; });
+}
+
+bool UInteractableSubsystem::IsVisibleFrom(const FVector& ViewLocation, const FVector& ViewDirection, const FInteractableCandidate& Candidate, const AActor* Viewer) const
+{
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(InteractableVisibility), false, Viewer);
+	TraceParams.AddIgnoredActor(Candidate.Component->GetOwner());
+
+	// same as the old focus trace, stopped where the interactable starts
+	const FVector TraceDirection = (Candidate.Location - ViewLocation).GetSafeNormal(KINDA_SMALL_NUMBER, ViewDirection);
+	const FVector TraceEnd = ViewLocation + TraceDirection * Candidate.Distance;
+	return !GetWorld()->LineTraceTestByChannel(ViewLocation, TraceEnd, COLLISION_INTERACTABLE, TraceParams);
+}
+
+FIntVector UInteractableSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void UInteractableSubsystem::AddToCell(const FIntVector& Cell, UInteractableComponent* Component, const FVector& Location, float FocusRadius)
+{
+	FInteractableCell& CellData = Cells.FindOrAdd(Cell);
+	CellData.Components.Add(Component);
+	CellData.Locations.Add(Location);
+	CellData.FocusRadii.Add(FocusRadius);
+
+	MaxFocusRadius = FMath::Max(MaxFocusRadius, FocusRadius);
+}
+
+void UInteractableSubsystem::RemoveFromCell(const FIntVector& Cell, UInteractableComponent* Component)
+{
+	if (FInteractableCell* CellData = Cells.Find(Cell))
+	{
+		const int32 Index = CellData->Components.IndexOfByKey(Component);
+		if (Index != INDEX_NONE)
+		{
+			bMaxFocusRadiusDirty |= CellData->FocusRadii[Index] >= MaxFocusRadius;
+			CellData->Components.RemoveAtSwap(Index, 1, false);
+			CellData->Locations.RemoveAtSwap(Index, 1, false);
+			CellData->FocusRadii.RemoveAtSwap(Index, 1, false);
+		}
+		if (CellData->Components.Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+float UInteractableSubsystem::GetMaxFocusRadius() const
+{
+	// recomputed lazily, so unregistering many interactables at once (e.g. a level unloading) scans the cells only once
+	if (bMaxFocusRadiusDirty)
+	{
+		MaxFocusRadius = 0.f;
+		for (const TPair<FIntVector, FInteractableCell>& Cell : Cells)
+		{
+			for (float FocusRadius : Cell.Value.FocusRadii)
+			{
+				MaxFocusRadius = FMath::Max(MaxFocusRadius, FocusRadius);
+			}
+		}
+		bMaxFocusRadiusDirty = false;
+	}
+	return MaxFocusRadius;
+}
+
+void UInteractableSubsystem::GetComponentBounds(const UInteractableComponent* Component, FVector& OutLocation, float& OutFocusRadius)
+{
+	const AActor* Owner = Component->GetOwner();
+	const USceneComponent* Root = Owner ? Owner->GetRootComponent() : nullptr;
+	OutLocation = Root ? Root->GetComponentLocation() : FVector::ZeroVector;
+	OutFocusRadius = Root ? Root->Bounds.SphereRadius : 0.f;
+}
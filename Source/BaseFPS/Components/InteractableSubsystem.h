@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InteractableSubsystem.generated.h"
+
+class UInteractableComponent;
+
+/** The interactables in a single grid cell, locations and radii are kept next to the components for queries */
+USTRUCT()
+struct FInteractableCell
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UInteractableComponent>> Components;
+
+	TArray<FVector> Locations;
+
+	/** how far off the view ray the interactable can be and still be focused (its owner's bounds) */
+	TArray<float> FocusRadii;
+};
+
+/** An interactable found by {@code UInteractableSubsystem::QueryView} */
+struct FInteractableCandidate
+{
+	UInteractableComponent* Component = nullptr;
+	FVector Location = FVector::ZeroVector;
+
+	/** distance from the view location to the interactable's focus radius */
+	float Distance = 0.f;
+
+	/** cosine between the view direction and the direction to the interactable */
+	float ViewDot = -1.f;
+};
+
+/**
+ * Per-world spatial index of every {@code UInteractableComponent}, a uniform hash grid keyed by cell. Components add
+ * themselves on BeginPlay and keep their entry up to date when their owner moves, so finding what a player looks at
+ * is a cone query over the few cells around them, plus a single occlusion trace for the best candidate, instead of
+ * a multi trace against the Interactable channel. See BaseFPS.Interactables.*
+ */
+UCLASS()
+class BASEFPS_API UInteractableSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	void RegisterInteractable(UInteractableComponent* Component);
+	void UnregisterInteractable(UInteractableComponent* Component);
+
+	/** moves the component's entry to its owner's current location */
+	void UpdateInteractable(UInteractableComponent* Component);
+
+	/**
+	 * Finds every interactable within MaxDistance the view ray passes close to (within the interactable's focus
+	 * radius or the BaseFPS.Interactables.ConeHalfAngle cone), sorted by how close they are to the view direction.
+	 * Occlusion isn't tested, see IsVisibleFrom().
+	 */
+	void QueryView(const FVector& ViewLocation, const FVector& ViewDirection, float MaxDistance, TArray<FInteractableCandidate>& OutCandidates) const;
+
+	/** true if nothing blocks the Interactable channel between the view location and the candidate */
+	bool IsVisibleFrom(const FVector& ViewLocation, const FVector& ViewDirection, const FInteractableCandidate& Candidate, const AActor* Viewer) const;
+
+	int32 GetNumInteractables() const { return ComponentCells.Num(); }
+
+private:
+	UPROPERTY(Transient)
+	TMap<FIntVector, FInteractableCell> Cells;
+
+	/** the cell each registered component is in */
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UInteractableComponent>, FIntVector> ComponentCells;
+
+	/** cell size at the time the world started, see BaseFPS.Interactables.CellSize */
+	float CellSize = 1000.f;
+
+	/** largest focus radius of any registered interactable, widens the cells a query looks at (see GetMaxFocusRadius()) */
+	mutable float MaxFocusRadius = 0.f;
+
+	/** the interactable with the largest focus radius shrank or left, MaxFocusRadius is recomputed on the next query */
+	mutable bool bMaxFocusRadiusDirty = false;
+
+	float GetMaxFocusRadius() const;
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	void AddToCell(const FIntVector& Cell, UInteractableComponent* Component, const FVector& Location, float FocusRadius);
+	void RemoveFromCell(const FIntVector& Cell, UInteractableComponent* Component);
+
+	static void GetComponentBounds(const UInteractableComponent* Component, FVector& OutLocation, float& OutFocusRadius);
+};
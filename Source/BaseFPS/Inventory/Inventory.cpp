@@ -50,6 +50,14 @@ void AInventory::OnRep_Owner()
 	}
 }
 
+void AInventory::OnReleasedToPool()
+{
+	// no ClientOnRemovedFromInventory(), the client's copy is destroyed along with the channel
+	SetInstigator(nullptr);
+	SetOwner(nullptr);
+	CharacterOwner = nullptr;
+}
+
 ABaseFPSCharacter* AInventory::GetCharacterOwner() const
 {
 	return CharacterOwner;
@@ -89,6 +97,11 @@ void AInventory::OnAddedToInventory(ABaseFPSCharacter* NewOwner)
 	{
 		ClientOnAddedToInventory(NewOwner);			
 	}
+	else if (NewOwner)
+	{
+		// the character may be waiting on this item to switch to it
+		NewOwner->InventoryReplicated();
+	}
 }
 
 void AInventory::OnRemovedFromInventory()
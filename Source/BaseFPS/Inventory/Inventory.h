@@ -4,15 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "System/PoolableActor.h"
 #include "Inventory.generated.h"
 
 class ABaseFPSCharacter;
+struct FInventoryEntry;
 
 /**
  * Represents an Inventory item/actor stored in a player's inventory
  */
 UCLASS(Abstract)
-class BASEFPS_API AInventory : public AActor
+class BASEFPS_API AInventory : public AActor, public IPoolableActor
 {
 	GENERATED_BODY()
 	
@@ -27,6 +29,11 @@ protected:
 	virtual void OnRep_Owner() override;
 	//~ End AActor interface
 
+public:
+	//~ Begin IPoolableActor interface
+	virtual void OnReleasedToPool() override;
+	//~ End IPoolableActor interface
+
 protected:
 	/** Pointer to the @code Owner cast to a Character */
 	UPROPERTY(Transient)
@@ -61,4 +68,17 @@ public:
 
 	/** [server] item was removed from pawn's inventory */
 	virtual void OnRemovedFromInventory();
+
+	/************************************************************************/
+	/* Stowed State                                                         */
+	/************************************************************************/
+
+	/** [server] called on the class default object, the state a new item starts with while it's stowed */
+	virtual void InitStowedState(FInventoryEntry& Entry) const {}
+
+	/** [server] writes what the item carries into its inventory entry, before its actor is given back */
+	virtual void StowState(FInventoryEntry& Entry) const {}
+
+	/** [server] takes over the state its inventory entry carried while the item was stowed */
+	virtual void RestoreStowedState(const FInventoryEntry& Entry) {}
 };
@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Inventory/InventoryList.h"
+
+#include "Character/BaseFPSCharacter.h"
+#include "Inventory/Inventory.h"
+#include "Weapons/Weapon.h"
+
+int32 FInventoryEntry::GetTotalAmmo() const
+{
+	if (const AWeapon* Weapon = Cast<AWeapon>(Item))
+	{
+		return Weapon->GetCurrentTotalAmmo();
+	}
+	return AmmoInClip + ReserveAmmo;
+}
+
+void FInventoryList::Init(ABaseFPSCharacter* InOwner, int32 InNumSlots)
+{
+	Owner = InOwner;
+	NumSlots = FMath::Clamp(InNumSlots, 0, MAX_uint8 + 1);
+	Entries.Reset();
+	SlotsByClass.Reset();
+	MarkArrayDirty();
+}
+
+const FInventoryEntry* FInventoryList::GetEntry(int32 Slot) const
+{
+	return Entries.FindByPredicate([Slot](const FInventoryEntry& Entry) { return Entry.Slot == Slot; });
+}
+
+TSubclassOf<AInventory> FInventoryList::GetItemClass(int32 Slot) const
+{
+	const FInventoryEntry* Entry = GetEntry(Slot);
+	return Entry ? Entry->ItemClass : nullptr;
+}
+
+AInventory* FInventoryList::GetItem(int32 Slot) const
+{
+	const FInventoryEntry* Entry = GetEntry(Slot);
+	return Entry ? Entry->Item.Get() : nullptr;
+}
+
+int32 FInventoryList::FindSlot(const AInventory* Item) const
+{
+	const FInventoryEntry* Entry = Item ? Entries.FindByPredicate([Item](const FInventoryEntry& Entry) { return Entry.Item == Item; }) : nullptr;
+	return Entry ? Entry->Slot : INDEX_NONE;
+}
+
+int32 FInventoryList::FindFreeSlot() const
+{
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		if (GetEntry(Slot) == nullptr)
+		{
+			return Slot;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 FInventoryList::FindSlotOfType(TSubclassOf<AInventory> InvType) const
+{
+	if (InvType == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* Slot = SlotsByClass.Find(InvType.Get()))
+	{
+		return *Slot;
+	}
+
+	int32 BestSlot = INDEX_NONE;
+	for (const FInventoryEntry& Entry : Entries)
+	{
+		if (Entry.ItemClass && Entry.ItemClass->IsChildOf(InvType) && (BestSlot == INDEX_NONE || Entry.Slot < BestSlot))
+		{
+			BestSlot = Entry.Slot;
+		}
+	}
+	return BestSlot;
+}
+
+void FInventoryList::SetItem(int32 Slot, AInventory* Item)
+{
+	if (!IsValidSlot(Slot))
+	{
+		return;
+	}
+
+	const int32 EntryIndex = Entries.IndexOfByPredicate([Slot](const FInventoryEntry& Entry) { return Entry.Slot == Slot; });
+	if (Item == nullptr)
+	{
+		if (EntryIndex != INDEX_NONE)
+		{
+			Entries.RemoveAtSwap(EntryIndex, 1, false);
+			MarkArrayDirty();
+		}
+	}
+	else
+	{
+		FInventoryEntry& Entry = EntryIndex != INDEX_NONE ? Entries[EntryIndex] : Entries.AddDefaulted_GetRef();
+		Entry.Slot = Slot;
+		Entry.ItemClass = Item->GetClass();
+		Entry.Item = Item;
+		MarkItemDirty(Entry);
+	}
+
+	RebuildSlotsByClass();
+	NotifySlotChanged(Slot);
+}
+
+void FInventoryList::SetStowedItem(int32 Slot, TSubclassOf<AInventory> ItemClass)
+{
+	if (!IsValidSlot(Slot) || ItemClass == nullptr)
+	{
+		return;
+	}
+
+	FInventoryEntry* Entry = FindEntry(Slot);
+	if (Entry == nullptr)
+	{
+		Entry = &Entries.AddDefaulted_GetRef();
+		Entry->Slot = Slot;
+	}
+	Entry->ItemClass = ItemClass;
+	Entry->Item = nullptr;
+	ItemClass.GetDefaultObject()->InitStowedState(*Entry);
+	MarkItemDirty(*Entry);
+
+	RebuildSlotsByClass();
+	NotifySlotChanged(Slot);
+}
+
+void FInventoryList::MaterializeItem(int32 Slot, AInventory* Item)
+{
+	FInventoryEntry* Entry = FindEntry(Slot);
+	if (Entry && Entry->Item == nullptr && Item && Item->IsA(Entry->ItemClass))
+	{
+		Item->RestoreStowedState(*Entry);
+		Entry->Item = Item;
+		MarkItemDirty(*Entry);
+		NotifySlotChanged(Slot);
+	}
+}
+
+AInventory* FInventoryList::StowItem(int32 Slot)
+{
+	FInventoryEntry* Entry = FindEntry(Slot);
+	AInventory* Item = Entry ? Entry->Item.Get() : nullptr;
+	if (Item)
+	{
+		Item->StowState(*Entry);
+		Entry->Item = nullptr;
+		MarkItemDirty(*Entry);
+		NotifySlotChanged(Slot);
+	}
+	return Item;
+}
+
+void FInventoryList::SetStowedAmmo(int32 Slot, int32 AmmoInClip, int32 ReserveAmmo)
+{
+	FInventoryEntry* Entry = FindEntry(Slot);
+	if (Entry && Entry->Item == nullptr)
+	{
+		Entry->AmmoInClip = AmmoInClip;
+		Entry->ReserveAmmo = ReserveAmmo;
+		MarkItemDirty(*Entry);
+		NotifySlotChanged(Slot);
+	}
+}
+
+void FInventoryList::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	for (const int32 Index : RemovedIndices)
+	{
+		NotifySlotChanged(Entries[Index].Slot);
+	}
+	RebuildSlotsByClass(RemovedIndices);
+}
+
+void FInventoryList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	for (const int32 Index : AddedIndices)
+	{
+		NotifySlotChanged(Entries[Index].Slot);
+	}
+	RebuildSlotsByClass();
+
+	if (Owner)
+	{
+		Owner->InventoryReplicated();
+	}
+}
+
+void FInventoryList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	// also called once an item's actor replicates after its entry did
+	for (const int32 Index : ChangedIndices)
+	{
+		NotifySlotChanged(Entries[Index].Slot);
+	}
+	RebuildSlotsByClass();
+
+	if (Owner)
+	{
+		Owner->InventoryReplicated();
+	}
+}
+
+FInventoryEntry* FInventoryList::FindEntry(int32 Slot)
+{
+	return Entries.FindByPredicate([Slot](const FInventoryEntry& Entry) { return Entry.Slot == Slot; });
+}
+
+void FInventoryList::NotifySlotChanged(int32 Slot) const
+{
+	if (Owner)
+	{
+		Owner->InventorySlotChanged(Slot);
+	}
+}
+
+void FInventoryList::RebuildSlotsByClass(const TArrayView<int32> RemovedIndices)
+{
+	// a handful of entries per character, rebuilt on every change so lookups stay O(1)
+	SlotsByClass.Reset();
+	for (int32 Index = 0; Index < Entries.Num(); Index++)
+	{
+		const FInventoryEntry& Entry = Entries[Index];
+		if (Entry.ItemClass && !RemovedIndices.Contains(Index))
+		{
+			int32& Slot = SlotsByClass.FindOrAdd(Entry.ItemClass.Get(), Entry.Slot);
+			Slot = FMath::Min(Slot, static_cast<int32>(Entry.Slot));
+		}
+	}
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "InventoryList.generated.h"
+
+class AInventory;
+class ABaseFPSCharacter;
+struct FInventoryList;
+
+/**
+ * A single occupied inventory slot. The entry is the item: its class and state are all a holstered item is, an actor
+ * is only materialized for it while it's equipped or being switched to (see {@code ABaseFPSCharacter::MaterializeInventory})
+ */
+USTRUCT()
+struct BASEFPS_API FInventoryEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint8 Slot = 0;
+
+	UPROPERTY()
+	TSubclassOf<AInventory> ItemClass;
+
+	/** the item's actor while it's materialized, null while the item is stowed */
+	UPROPERTY()
+	TObjectPtr<AInventory> Item = nullptr;
+
+	/** a stowed weapon's ammo, the actor's own ammo is current while it's materialized */
+	UPROPERTY()
+	int32 AmmoInClip = 0;
+
+	UPROPERTY()
+	int32 ReserveAmmo = 0;
+
+	/** the item's current ammo, from its actor if it's materialized */
+	int32 GetTotalAmmo() const;
+};
+
+/**
+ * A character's inventory, only the occupied slots are replicated (as a fast array, so adding, replacing or removing
+ * an item sends just that entry). Items can be looked up by slot and by type without touching their actors.
+ * Every slot that changes, on the server or through replication, is reported to the owner so listeners (the HUD)
+ * only update that slot.
+ */
+USTRUCT()
+struct BASEFPS_API FInventoryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	void Init(ABaseFPSCharacter* InOwner, int32 InNumSlots);
+
+	int32 Num() const { return NumSlots; }
+	bool IsValidSlot(int32 Slot) const { return Slot >= 0 && Slot < NumSlots; }
+
+	/** the slot's entry, null if the slot is empty */
+	const FInventoryEntry* GetEntry(int32 Slot) const;
+
+	/** the class of the item in the slot, null if the slot is empty */
+	TSubclassOf<AInventory> GetItemClass(int32 Slot) const;
+
+	/** the item's actor in the slot, null if the slot is empty, the item is stowed (or its actor hasn't replicated yet) */
+	AInventory* GetItem(int32 Slot) const;
+	AInventory* operator[](int32 Slot) const { return GetItem(Slot); }
+
+	int32 FindSlot(const AInventory* Item) const;
+	int32 FindFreeSlot() const;
+
+	/** first slot holding an item of InvType (or a subclass), O(1) for an exact class match */
+	int32 FindSlotOfType(TSubclassOf<AInventory> InvType) const;
+
+	/** [server] puts the (materialized) item in the slot, or empties the slot if Item is null */
+	void SetItem(int32 Slot, AInventory* Item);
+
+	/** [server] puts a stowed item of ItemClass in the slot, with the state a new item of its class starts with */
+	void SetStowedItem(int32 Slot, TSubclassOf<AInventory> ItemClass);
+
+	/** [server] gives the slot's stowed item the actor, which takes over the stowed state */
+	void MaterializeItem(int32 Slot, AInventory* Item);
+
+	/** [server] writes the state of the slot's item back into its entry and detaches its actor, which is returned */
+	AInventory* StowItem(int32 Slot);
+
+	/** [server] sets the ammo of the slot's stowed item */
+	void SetStowedAmmo(int32 Slot, int32 AmmoInClip, int32 ReserveAmmo);
+
+	//~ Begin FFastArraySerializer contract
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+	//~ End FFastArraySerializer contract
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryEntry, FInventoryList>(Entries, DeltaParms, *this);
+	}
+
+private:
+	/** the occupied slots, a handful per character, so slot lookups walk them rather than keep a cache to go stale */
+	UPROPERTY()
+	TArray<FInventoryEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	TObjectPtr<ABaseFPSCharacter> Owner = nullptr;
+
+	UPROPERTY(NotReplicated)
+	int32 NumSlots = 0;
+
+	/** slot of the first item of each class */
+	TMap<const UClass*, int32> SlotsByClass;
+
+	FInventoryEntry* FindEntry(int32 Slot);
+	void NotifySlotChanged(int32 Slot) const;
+
+	/** @param RemovedIndices entries that are about to be removed, and left out */
+	void RebuildSlotsByClass(const TArrayView<int32> RemovedIndices = TArrayView<int32>());
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryList> : public TStructOpsTypeTraitsBase2<FInventoryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -12,10 +12,22 @@
 #include "GameplayDebuggerCategoryReplicator.h"
 #endif
 
+#include "BaseFPS.h"
 #include "Character/BaseFPSCharacter.h"
+#include "Engine/LevelBounds.h"
 #include "Engine/LevelScriptActor.h"
 #include "GameFramework/PlayerState.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectHash.h"
 #include "Inventory/Inventory.h"
+#include "Online/BaseFPSReplicationGraphBenchmark.h"
+#include "Pickups/Pickup.h"
 #include "Pickups/PickupInstance.h"
 #include "Player/BaseFPSPlayerController.h"
 #include "Settings/LevelEditorViewportSettings.h"
@@ -23,31 +35,162 @@
 
 DEFINE_LOG_CATEGORY(LogBaseFPSReplicationGraph);
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rep Graph: Distance LOD Reduced Actors"), STAT_BaseFPS_RepGraphDistanceLODReducedActors, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rep Graph: Occluded Actors"), STAT_BaseFPS_RepGraphOccludedActors, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rep Graph: Occlusion Traces"), STAT_BaseFPS_RepGraphOcclusionTraces, STATGROUP_BaseFPS);
+DECLARE_CYCLE_STAT(TEXT("Rep Graph: Occlusion Checks"), STAT_BaseFPS_RepGraphOcclusionChecks, STATGROUP_BaseFPS);
+DECLARE_CYCLE_STAT(TEXT("Rep Graph: Always Relevant Gather"), STAT_BaseFPS_RepGraphAlwaysRelevantGather, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rep Graph: Always Relevant Rebuilds"), STAT_BaseFPS_RepGraphAlwaysRelevantRebuilds, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rep Graph: PlayerStates Per Frame"), STAT_BaseFPS_RepGraphPlayerStatesPerFrame, STATGROUP_BaseFPS);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Rep Graph: PlayerState Refresh Period (ms)"), STAT_BaseFPS_RepGraphPlayerStateRefreshPeriod, STATGROUP_BaseFPS);
+
 /* -------------- CVars -------------- */
 
 float CVar_BaseFPSRepGraph_DestructionInfoMaxDist = 30000.f;
 static FAutoConsoleVariableRef CVarBaseFPSRepGraphDestructMaxDist(TEXT("BaseFPSRepGraph.DestructInfo.MaxDist"), CVar_BaseFPSRepGraph_DestructionInfoMaxDist, TEXT("Max distance (not squared) to rep destruct infos at"), ECVF_Default );
 
 int32 CVar_BaseFPSRepGraph_DisplayClientLevelStreaming = 0;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphDisplayClientLevelStreaming(TEXT("BaseFPSRepGraph.DisplayClientLevelStreaming"), CVar_BaseFPSRepGraph_DisplayClientLevelStreaming, TEXT(""), ECVF_Default );
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDisplayClientLevelStreaming(TEXT("BaseFPSRepGraph.DisplayClientLevelStreaming"), CVar_BaseFPSRepGraph_DisplayClientLevelStreaming, TEXT("1 = log client level streaming visibility changes and the always relevant streaming level lists they update"), ECVF_Default );
 
 float CVar_BaseFPSRepGraph_CellSize = 10000.f;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphCellSize(TEXT("BaseFPSRepGraph.CellSize"), CVar_BaseFPSRepGraph_CellSize, TEXT(""), ECVF_Default );
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphCellSize(TEXT("BaseFPSRepGraph.CellSize"), CVar_BaseFPSRepGraph_CellSize, TEXT("Spatial grid cell size (cm) when the grid isn't fitted to the world (Grid.AutoBounds 0 or no level bounds). Read on graph init"), ECVF_Default );
 
 // Essentially "Min X" for replication. This is just an initial value. The system will reset itself if actors appears outside of this.
 float CVar_BaseFPSRepGraph_SpatialBiasX = -150000.f;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphSpatialBiasX(TEXT("BaseFPSRepGraph.SpatialBiasX"),CVar_BaseFPSRepGraph_SpatialBiasX, TEXT(""), ECVF_Default );
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphSpatialBiasX(TEXT("BaseFPSRepGraph.SpatialBiasX"),CVar_BaseFPSRepGraph_SpatialBiasX, TEXT("Min X (cm) of the spatial grid when it isn't fitted to the world, actors outside of it rebuild the grid. Read on graph init"), ECVF_Default );
 
 // Essentially "Min Y" for replication. This is just an initial value. The system will reset itself if actors appears outside of this.
 float CVar_BaseFPSRepGraph_SpatialBiasY = -200000.f;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphSpatialBiasY(TEXT("BaseFPSRepGraph.SpatialBiasY"),CVar_BaseFPSRepGraph_SpatialBiasY, TEXT(""), ECVF_Default );
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphSpatialBiasY(TEXT("BaseFPSRepGraph.SpatialBiasY"),CVar_BaseFPSRepGraph_SpatialBiasY, TEXT("Min Y (cm) of the spatial grid when it isn't fitted to the world, actors outside of it rebuild the grid. Read on graph init"), ECVF_Default );
 
 // How many buckets to spread dynamic, spatialized actors across, High number = more buckets = smaller effective replication frequency. This happens before individual actors do their own NetUpdateFrequency check.
 int32 CVar_BaseFPSRepGraph_DynamicActorFrequencyBuckets = 3;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphActorFrequencyBuckets(TEXT("BaseFPSRepGraph.DynamicActorFrequencyBuckets"), CVar_BaseFPSRepGraph_DynamicActorFrequencyBuckets, TEXT(""), ECVF_Default );
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphActorFrequencyBuckets(TEXT("BaseFPSRepGraph.DynamicActorFrequencyBuckets"), CVar_BaseFPSRepGraph_DynamicActorFrequencyBuckets, TEXT("Buckets dynamic spatialized actors are spread across, each replicated on every Nth frame before the actor's own NetUpdateFrequency check. Read on graph init"), ECVF_Default );
+
+// Off by default: a grid fitted to the world (Grid.AutoBounds) clamps stray actors to its edge cells and never rebuilds, the
+// fallback grid from CellSize/SpatialBias rebuilds itself when an actor shows up outside of it.
+int32 CVar_BaseFPSRepGraph_DisableSpatialRebuilds = 0;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDisableSpatialRebuilds(TEXT("BaseFPSRepGraph.DisableSpatialRebuilds"), CVar_BaseFPSRepGraph_DisableSpatialRebuilds, TEXT("1 = never rebuild the spatial grids when an actor is outside of them (they are clamped to the edge cells instead). Read on graph init"), ECVF_Default );
+
+// Fit the grid's bias, bounds and cell size to the world's level bounds when it's loaded. CellSize and SpatialBias are only used as a fallback.
+int32 CVar_BaseFPSRepGraph_Grid_AutoBounds = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridAutoBounds(TEXT("BaseFPSRepGraph.Grid.AutoBounds"), CVar_BaseFPSRepGraph_Grid_AutoBounds, TEXT("Derive the spatial grid from the world bounds on load"), ECVF_Default );
+
+// Room left around the level bounds for actors that leave the level geometry (e.g. falling or flying).
+float CVar_BaseFPSRepGraph_Grid_BoundsMargin = 5000.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridBoundsMargin(TEXT("BaseFPSRepGraph.Grid.BoundsMargin"), CVar_BaseFPSRepGraph_Grid_BoundsMargin, TEXT("Room (cm) left around the level bounds when fitting the spatial grid, for actors that leave the level geometry"), ECVF_Default );
+
+// The automatic cell size splits the longest side of the world into this many cells, clamped to [MinCellSize, MaxCellSize].
+int32 CVar_BaseFPSRepGraph_Grid_TargetCellsPerAxis = 32;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridTargetCellsPerAxis(TEXT("BaseFPSRepGraph.Grid.TargetCellsPerAxis"), CVar_BaseFPSRepGraph_Grid_TargetCellsPerAxis, TEXT("Cells the fitted grid splits the longest side of the world into, the cell size is clamped to [MinCellSize, MaxCellSize]"), ECVF_Default );
+
+float CVar_BaseFPSRepGraph_Grid_MinCellSize = 5000.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridMinCellSize(TEXT("BaseFPSRepGraph.Grid.MinCellSize"), CVar_BaseFPSRepGraph_Grid_MinCellSize, TEXT("Smallest cell size (cm) of the fitted spatial grid"), ECVF_Default );
+
+float CVar_BaseFPSRepGraph_Grid_MaxCellSize = 20000.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridMaxCellSize(TEXT("BaseFPSRepGraph.Grid.MaxCellSize"), CVar_BaseFPSRepGraph_Grid_MaxCellSize, TEXT("Largest cell size (cm) of the fitted spatial grid"), ECVF_Default );
+
+// Static actors (placed or spawned by pickup spawners) a coarse cell needs at load to be split into fine cells. 0 disables the fine grid.
+int32 CVar_BaseFPSRepGraph_Grid_DenseCellActors = 64;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridDenseCellActors(TEXT("BaseFPSRepGraph.Grid.DenseCellActors"), CVar_BaseFPSRepGraph_Grid_DenseCellActors, TEXT("Static actors a coarse cell needs at load to be split into fine cells, 0 disables the fine grid"), ECVF_Default );
+
+// Fine cells per coarse cell side in dense areas.
+int32 CVar_BaseFPSRepGraph_Grid_FineCellDivisions = 4;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphGridFineCellDivisions(TEXT("BaseFPSRepGraph.Grid.FineCellDivisions"), CVar_BaseFPSRepGraph_Grid_FineCellDivisions, TEXT("Fine cells per coarse cell side in dense areas, only static actors are placed in them"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_EnableFastSharedPath = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphEnableFastSharedPath(TEXT("BaseFPSRepGraph.EnableFastSharedPath"), CVar_BaseFPSRepGraph_EnableFastSharedPath, TEXT("Replicate character movement through the FastShared path (serialized once, shared by all connections). Read on graph init"), ECVF_Default );
+
+// Bandwidth budget per connection for the FastShared path, in KBytes/sec.
+float CVar_BaseFPSRepGraph_TargetKBytesSecFastSharedPath = 10.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphTargetKBytesSecFastSharedPath(TEXT("BaseFPSRepGraph.TargetKBytesSecFastSharedPath"), CVar_BaseFPSRepGraph_TargetKBytesSecFastSharedPath, TEXT("Bandwidth budget per connection (KBytes/sec) for character movement sent through the FastShared path"), ECVF_Default );
+
+// Percentage of an actor's cull distance within which it can use the FastShared path.
+float CVar_BaseFPSRepGraph_FastSharedPathCullDistPct = 0.80f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphFastSharedPathCullDistPct(TEXT("BaseFPSRepGraph.FastSharedPathCullDistPct"), CVar_BaseFPSRepGraph_FastSharedPathCullDistPct, TEXT("Fraction (0-1) of an actor's cull distance within which it is sent through the FastShared path, further away it is left to the regular path"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_DistanceLOD_Enable = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODEnable(TEXT("BaseFPSRepGraph.DistanceLOD.Enable"), CVar_BaseFPSRepGraph_DistanceLOD_Enable, TEXT("Lower the replication rate of dynamic actors by distance from the viewer"), ECVF_Default );
+
+// Actors closer than this replicate at their full rate.
+float CVar_BaseFPSRepGraph_DistanceLOD_NearDist = 2500.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODNearDist(TEXT("BaseFPSRepGraph.DistanceLOD.NearDist"), CVar_BaseFPSRepGraph_DistanceLOD_NearDist, TEXT("Distance (cm) from the viewer within which dynamic actors replicate at their full rate"), ECVF_Default );
+
+// Actors between NearDist and this replicate every MidPeriod frames, anything further every FarPeriod frames.
+float CVar_BaseFPSRepGraph_DistanceLOD_MidDist = 7500.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODMidDist(TEXT("BaseFPSRepGraph.DistanceLOD.MidDist"), CVar_BaseFPSRepGraph_DistanceLOD_MidDist, TEXT("Distance (cm) from the viewer within which dynamic actors replicate every MidPeriod frames, further away every FarPeriod frames"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_DistanceLOD_MidPeriod = 2;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODMidPeriod(TEXT("BaseFPSRepGraph.DistanceLOD.MidPeriod"), CVar_BaseFPSRepGraph_DistanceLOD_MidPeriod, TEXT("Replication period (in frames) for actors in the mid distance band"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_DistanceLOD_FarPeriod = 5;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODFarPeriod(TEXT("BaseFPSRepGraph.DistanceLOD.FarPeriod"), CVar_BaseFPSRepGraph_DistanceLOD_FarPeriod, TEXT("Replication period (in frames) for actors in the far distance band"), ECVF_Default );
+
+// Half angle (degrees) of the viewer's view cone, actors inside it replicate at their full rate regardless of distance.
+float CVar_BaseFPSRepGraph_DistanceLOD_ViewConeHalfAngle = 12.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODViewConeHalfAngle(TEXT("BaseFPSRepGraph.DistanceLOD.ViewConeHalfAngle"), CVar_BaseFPSRepGraph_DistanceLOD_ViewConeHalfAngle, TEXT("Half angle (degrees) of the viewer's view cone, actors inside it replicate at their full rate at any distance"), ECVF_Default );
+
+// Characters that fired or were hit within this many seconds replicate at their full rate.
+float CVar_BaseFPSRepGraph_DistanceLOD_CombatTimeout = 2.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODCombatTimeout(TEXT("BaseFPSRepGraph.DistanceLOD.CombatTimeout"), CVar_BaseFPSRepGraph_DistanceLOD_CombatTimeout, TEXT("Seconds after firing or being hit during which a character replicates at its full rate at any distance"), ECVF_Default );
+
+// How often (in frames) each connection re-evaluates its LOD bands. Connections are staggered across frames.
+int32 CVar_BaseFPSRepGraph_DistanceLOD_UpdateInterval = 2;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphDistanceLODUpdateInterval(TEXT("BaseFPSRepGraph.DistanceLOD.UpdateInterval"), CVar_BaseFPSRepGraph_DistanceLOD_UpdateInterval, TEXT("Frames between re-evaluations of a connection's LOD bands, connections are staggered across frames"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_Occlusion_Enable = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionEnable(TEXT("BaseFPSRepGraph.Occlusion.Enable"), CVar_BaseFPSRepGraph_Occlusion_Enable, TEXT("Drop pawns hidden behind world geometry to a heartbeat replication rate"), ECVF_Default );
+
+// Replication period (in frames) for occluded pawns.
+int32 CVar_BaseFPSRepGraph_Occlusion_HeartbeatPeriod = 15;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionHeartbeatPeriod(TEXT("BaseFPSRepGraph.Occlusion.HeartbeatPeriod"), CVar_BaseFPSRepGraph_Occlusion_HeartbeatPeriod, TEXT("Replication period (in frames) for pawns hidden from the viewer by world geometry"), ECVF_Default );
+
+// Visibility traces allowed per replication frame, shared by all connections (on top of their MinTracesPerConnection). Pairs that can't be checked in time are treated as visible.
+int32 CVar_BaseFPSRepGraph_Occlusion_MaxTracesPerFrame = 256;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionMaxTracesPerFrame(TEXT("BaseFPSRepGraph.Occlusion.MaxTracesPerFrame"), CVar_BaseFPSRepGraph_Occlusion_MaxTracesPerFrame, TEXT("Visibility traces per replication frame shared by all connections, on top of MinTracesPerConnection. Unchecked pairs count as visible"), ECVF_Default );
+
+// Traces a connection may always do, even once the frame's budget is spent, so large servers still make progress on every connection.
+int32 CVar_BaseFPSRepGraph_Occlusion_MinTracesPerConnection = 5;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionMinTracesPerConnection(TEXT("BaseFPSRepGraph.Occlusion.MinTracesPerConnection"), CVar_BaseFPSRepGraph_Occlusion_MinTracesPerConnection, TEXT("Visibility traces each connection may do per frame even once MaxTracesPerFrame is spent"), ECVF_Default );
+
+// How long (seconds) an occluded result is trusted before it is checked again.
+float CVar_BaseFPSRepGraph_Occlusion_OccludedRecheckTime = 0.1f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionOccludedRecheckTime(TEXT("BaseFPSRepGraph.Occlusion.OccludedRecheckTime"), CVar_BaseFPSRepGraph_Occlusion_OccludedRecheckTime, TEXT("Seconds an occluded result is trusted before the pair is traced again"), ECVF_Default );
+
+// How long (seconds) a visible result is trusted before it is checked again.
+float CVar_BaseFPSRepGraph_Occlusion_VisibleRecheckTime = 0.25f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionVisibleRecheckTime(TEXT("BaseFPSRepGraph.Occlusion.VisibleRecheckTime"), CVar_BaseFPSRepGraph_Occlusion_VisibleRecheckTime, TEXT("Seconds a visible result is trusted before the pair is traced again"), ECVF_Default );
+
+// Extra time (seconds) added to the recheck time when sizing the movement margin, covers the heartbeat and latency.
+float CVar_BaseFPSRepGraph_Occlusion_Lookahead = 0.15f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionLookahead(TEXT("BaseFPSRepGraph.Occlusion.Lookahead"), CVar_BaseFPSRepGraph_Occlusion_Lookahead, TEXT("Seconds added to the recheck time when sizing the movement margin around the traced points, covers the heartbeat and latency"), ECVF_Default );
+
+// Upper bound for the movement margin around occlusion sample points.
+float CVar_BaseFPSRepGraph_Occlusion_MaxMargin = 400.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphOcclusionMaxMargin(TEXT("BaseFPSRepGraph.Occlusion.MaxMargin"), CVar_BaseFPSRepGraph_Occlusion_MaxMargin, TEXT("Upper bound (cm) of the movement margin around the traced points, larger margins count more pawns as visible"), ECVF_Default );
+
+// Bytes per second each connection may spend on other players' PlayerStates.
+float CVar_BaseFPSRepGraph_PlayerStateLimiter_TargetBytesPerSec = 3000.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphPlayerStateLimiterTargetBytesPerSec(TEXT("BaseFPSRepGraph.PlayerStateLimiter.TargetBytesPerSec"), CVar_BaseFPSRepGraph_PlayerStateLimiter_TargetBytesPerSec, TEXT("Bytes per second each connection may spend on other players' PlayerStates, sets how many are replicated per frame"), ECVF_Default );
+
+// Estimated size of one PlayerState update, used to turn the byte budget into PlayerStates per frame.
+float CVar_BaseFPSRepGraph_PlayerStateLimiter_BytesPerPlayerState = 40.f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphPlayerStateLimiterBytesPerPlayerState(TEXT("BaseFPSRepGraph.PlayerStateLimiter.BytesPerPlayerState"), CVar_BaseFPSRepGraph_PlayerStateLimiter_BytesPerPlayerState, TEXT("Estimated bytes of one PlayerState update, turns TargetBytesPerSec into PlayerStates per frame"), ECVF_Default );
+
+int32 CVar_BaseFPSRepGraph_PlayerStateLimiter_MinPerFrame = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphPlayerStateLimiterMinPerFrame(TEXT("BaseFPSRepGraph.PlayerStateLimiter.MinPerFrame"), CVar_BaseFPSRepGraph_PlayerStateLimiter_MinPerFrame, TEXT("PlayerStates replicated per frame at the least, however small the budget"), ECVF_Default );
+
+// How much of the budget is given up when every connection is saturated (scaled by the fraction of saturated connections).
+float CVar_BaseFPSRepGraph_PlayerStateLimiter_SaturationBackoff = 0.75f;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphPlayerStateLimiterSaturationBackoff(TEXT("BaseFPSRepGraph.PlayerStateLimiter.SaturationBackoff"), CVar_BaseFPSRepGraph_PlayerStateLimiter_SaturationBackoff, TEXT("Fraction (0-1) of the budget given up when every connection is saturated, scaled by the fraction of saturated connections"), ECVF_Default );
 
-int32 CVar_BaseFPSRepGraph_DisableSpatialRebuilds = 1;
-static FAutoConsoleVariableRef CVarBaseFPSRepGraphDisableSpatialRebuilds(TEXT("BaseFPSRepGraph.DisableSpatialRebuilds"), CVar_BaseFPSRepGraph_DisableSpatialRebuilds, TEXT(""), ECVF_Default );
+// Keep each connection's always relevant list between frames and only rebuild it when its viewers, pawns or inventory change. 0 rebuilds every frame (compare with stat BaseFPS).
+int32 CVar_BaseFPSRepGraph_AlwaysRelevant_CacheGather = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphAlwaysRelevantCacheGather(TEXT("BaseFPSRepGraph.AlwaysRelevant.CacheGather"), CVar_BaseFPSRepGraph_AlwaysRelevant_CacheGather, TEXT("1 = keep each connection's always relevant list between frames and only rebuild it when its viewers, pawns or inventory change. 0 = rebuild every frame"), ECVF_Default );
+
+// Reuse class routing results between graph inits (and, in cooked builds, between runs via Saved/ReplicationGraph). Always off in the editor.
+int32 CVar_BaseFPSRepGraph_ClassRoutingCache = 1;
+static FAutoConsoleVariableRef CVarBaseFPSRepGraphClassRoutingCache(TEXT("BaseFPSRepGraph.ClassRoutingCache"), CVar_BaseFPSRepGraph_ClassRoutingCache, TEXT("Cache the class routing table built in InitGlobalActorClassSettings for the process, and on disk per build in cooked builds. 0 = classify every class on each init"), ECVF_Default );
 
 /* -------------- FAutoConsoleCommandWithWorldAndArgs -------------- */
 
@@ -61,6 +204,16 @@ FAutoConsoleCommandWithWorldAndArgs ShooterPrintRepNodePoliciesCmd(TEXT("BaseFPS
 	})
 );
 
+FAutoConsoleCommandWithWorldAndArgs BaseFPSGridHistogramCmd(TEXT("BaseFPSRepGraph.GridHistogram"), TEXT("Logs how many actors the spatial grid cells hold"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		for (TObjectIterator<UBaseFPSReplicationGraph> It; It; ++It)
+		{
+			It->LogGridHistogram();
+		}
+	})
+);
+
 FAutoConsoleCommandWithWorldAndArgs ChangeFrequencyBucketsCmd(TEXT("BaseFPSRepGraph.FrequencyBuckets"), TEXT("Resets frequency bucket count."), FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray< FString >& Args, UWorld* World)
 {
 	int32 Buckets = 1;
@@ -85,13 +238,247 @@ UBaseFPSReplicationGraph::UBaseFPSReplicationGraph()
 
 /* -------------- Helper functions -------------- */
 
+/**
+ * Routing and class settings of every replicated actor class, as worked out by InitGlobalActorClassSettings. This is a
+ * runtime cache, not a table generated at cook time: the first graph init of a process still classifies every loaded
+ * actor class it doesn't have an entry for. Entries are kept for the lifetime of the process and saved to disk in
+ * cooked builds, where the next run of the same build only has to classify classes it hasn't seen before.
+ *
+ * The table is keyed on the build version and changelist (see MakeKey), so a new build starts from scratch. Locally
+ * built engines report changelist 0, which is why entries are also checked against a hash of the class defaults they
+ * were worked out from, so a changed class (blueprint-only changes included) is classified again on its own.
+ */
+namespace RepGraphClassCache
+{
+	/** bump when the classification rules in InitGlobalActorClassSettings change */
+	constexpr int32 Version = 3;
+	constexpr uint8 NoMapping = 0xFF;
+
+	/** hash of the class defaults the classification reads, the class' own and its super's */
+	static uint32 HashClassSettings(const UClass* Class)
+	{
+		uint32 Hash = 0;
+		for (const UClass* HashedClass : { Class, Class->GetSuperClass() })
+		{
+			const AActor* CDO = HashedClass ? Cast<AActor>(HashedClass->GetDefaultObject()) : nullptr;
+			if (CDO == nullptr)
+			{
+				continue;
+			}
+
+			const uint32 Flags = (CDO->GetIsReplicated() ? 1 : 0) | (CDO->bAlwaysRelevant ? 2 : 0) | (CDO->bOnlyRelevantToOwner ? 4 : 0) | (CDO->bNetUseOwnerRelevancy ? 8 : 0);
+			Hash = HashCombine(Hash, Flags);
+			Hash = HashCombine(Hash, GetTypeHash(CDO->NetUpdateFrequency));
+			Hash = HashCombine(Hash, GetTypeHash(CDO->NetCullDistanceSquared));
+		}
+		return Hash;
+	}
+
+	struct FEntry
+	{
+		FString ClassPath;
+
+		/** HashClassSettings of the class when the entry was worked out */
+		uint32 SettingsHash = 0;
+
+		/** the class the entry was last looked up for, not saved */
+		FObjectKey ClassKey;
+
+		bool bReplicated = false;
+
+		/** EClassRepNodeMapping to add for this class, NoMapping if it inherits its parent's */
+		uint8 Mapping = NoMapping;
+		bool bNonSpatializedChild = false;
+
+		/** FClassReplicationInfo settings, filled lazily since they depend on the final routing */
+		bool bHasClassInfo = false;
+		bool bSpatialized = false;
+		float CullDistanceSquared = 0.f;
+		uint32 ReplicationPeriodFrame = 1;
+
+		void SetClassInfo(bool bInSpatialized, const FClassReplicationInfo& Info)
+		{
+			bHasClassInfo = true;
+			bSpatialized = bInSpatialized;
+			CullDistanceSquared = Info.GetCullDistanceSquared();
+			ReplicationPeriodFrame = Info.ReplicationPeriodFrame;
+		}
+
+		void GetClassInfo(FClassReplicationInfo& OutInfo) const
+		{
+			if (bSpatialized)
+			{
+				OutInfo.SetCullDistanceSquared(CullDistanceSquared);
+			}
+			OutInfo.ReplicationPeriodFrame = ReplicationPeriodFrame;
+		}
+
+		friend FArchive& operator<<(FArchive& Ar, FEntry& Entry)
+		{
+			Ar << Entry.ClassPath << Entry.SettingsHash << Entry.bReplicated << Entry.Mapping << Entry.bNonSpatializedChild;
+			Ar << Entry.bHasClassInfo << Entry.bSpatialized << Entry.CullDistanceSquared << Entry.ReplicationPeriodFrame;
+			return Ar;
+		}
+	};
+
+	static bool IsEnabled()
+	{
+		// blueprints can be recompiled between PIE sessions
+		return CVar_BaseFPSRepGraph_ClassRoutingCache > 0 && !GIsEditor;
+	}
+
+	static bool UseDiskCache()
+	{
+		// uncooked builds can have their assets changed without a new build version
+		return IsEnabled() && FPlatformProperties::RequiresCookedData();
+	}
+
+	static FString GetFilename()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("ReplicationGraph") / TEXT("ClassRoutingCache.bin");
+	}
+
+	static FString MakeKey(float ServerMaxTickRate)
+	{
+		// build version and changelist identify the build, changes to the class defaults within one are caught per entry (see HashClassSettings)
+		return FString::Printf(TEXT("%d|%s|%u|%u|%.2f"), Version, FApp::GetBuildVersion(), FEngineVersion::Current().GetChangelist(), FEngineVersion::CompatibleWith().GetChangelist(), ServerMaxTickRate);
+	}
+
+	struct FTable
+	{
+		FString Key;
+		TArray<FEntry> Entries;
+		TMap<FString, int32> PathToEntry;
+		TMap<FObjectKey, int32> ClassToEntry;
+		bool bDirty = false;
+
+		/**
+		 * the class' entry, reset if the class defaults changed since it was worked out
+		 * @param bOutNeedsClassify true if the entry is new or was reset, and has to be classified */
+		int32 FindOrAdd(UClass* Class, bool& bOutNeedsClassify)
+		{
+			const uint32 SettingsHash = HashClassSettings(Class);
+			const FObjectKey ClassKey(Class);
+
+			const int32* KnownIdx = ClassToEntry.Find(ClassKey);
+			int32 Idx = KnownIdx ? *KnownIdx : INDEX_NONE;
+			if (Idx == INDEX_NONE)
+			{
+				// entries loaded from disk, and those of reloaded classes, are only known by path until first looked up
+				const FString ClassPath = Class->GetPathName();
+				const int32* PathIdx = PathToEntry.Find(ClassPath);
+				Idx = PathIdx ? *PathIdx : INDEX_NONE;
+				if (Idx == INDEX_NONE)
+				{
+					Idx = Entries.AddDefaulted();
+					Entries[Idx].ClassPath = ClassPath;
+					Entries[Idx].SettingsHash = SettingsHash;
+					PathToEntry.Add(ClassPath, Idx);
+					bDirty = true;
+					bOutNeedsClassify = true;
+				}
+				else
+				{
+					// a reloaded class takes over the entry of the class it replaces
+					ClassToEntry.Remove(Entries[Idx].ClassKey);
+				}
+				Entries[Idx].ClassKey = ClassKey;
+				ClassToEntry.Add(ClassKey, Idx);
+			}
+
+			if (Entries[Idx].SettingsHash != SettingsHash)
+			{
+				FEntry& Entry = Entries[Idx];
+				FEntry ResetEntry;
+				ResetEntry.ClassPath = MoveTemp(Entry.ClassPath);
+				ResetEntry.SettingsHash = SettingsHash;
+				ResetEntry.ClassKey = ClassKey;
+				Entry = MoveTemp(ResetEntry);
+				bDirty = true;
+				bOutNeedsClassify = true;
+			}
+			return Idx;
+		}
+
+		void Load()
+		{
+			TArray<uint8> Data;
+			if (!FFileHelper::LoadFileToArray(Data, *GetFilename(), FILEREAD_Silent))
+			{
+				return;
+			}
+
+			FMemoryReader Reader(Data);
+			FString FileKey;
+			Reader << FileKey;
+			if (FileKey != Key)
+			{
+				UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Class routing cache is out of date, rebuilding"));
+				return;
+			}
+
+			Reader << Entries;
+			if (Reader.IsError())
+			{
+				UE_LOG(LogBaseFPSReplicationGraph, Warning, TEXT("Failed to read class routing cache %s, rebuilding"), *GetFilename());
+				Entries.Reset();
+				return;
+			}
+
+			for (int32 Idx = 0; Idx < Entries.Num(); Idx++)
+			{
+				PathToEntry.Add(Entries[Idx].ClassPath, Idx);
+			}
+		}
+
+		void SaveIfDirty()
+		{
+			if (!bDirty || !IsEnabled())
+			{
+				return;
+			}
+			bDirty = false;
+
+			if (UseDiskCache())
+			{
+				TArray<uint8> Data;
+				FMemoryWriter Writer(Data);
+				Writer << Key;
+				Writer << Entries;
+				if (!FFileHelper::SaveArrayToFile(Data, *GetFilename()))
+				{
+					UE_LOG(LogBaseFPSReplicationGraph, Warning, TEXT("Failed to write class routing cache %s"), *GetFilename());
+				}
+			}
+		}
+	};
+
+	/** the process-wide table for the given tick rate, a fresh (unsaved) one if caching is disabled */
+	static FTable& GetTable(float ServerMaxTickRate)
+	{
+		static FTable Table;
+
+		const FString Key = MakeKey(ServerMaxTickRate);
+		if (!IsEnabled() || Table.Key != Key)
+		{
+			Table = FTable();
+			Table.Key = Key;
+			if (UseDiskCache())
+			{
+				Table.Load();
+			}
+		}
+		return Table;
+	}
+}
+
 void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize, float ServerMaxTickRate)
 {
 	AActor* CDO = Class->GetDefaultObject<AActor>();
 	if (bSpatialize)
 	{
 		Info.SetCullDistanceSquared(CDO->NetCullDistanceSquared);
-		UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Setting cull distance for %s to %f (%f)"), *Class->GetName(), Info.GetCullDistanceSquared(), Info.GetCullDistance());
+		UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Setting cull distance for %s to %f (%f)"), *Class->GetName(), Info.GetCullDistanceSquared(), Info.GetCullDistance());
 	}
 
 	Info.ReplicationPeriodFrame = FMath::Max<uint32>( (uint32)FMath::RoundToFloat(ServerMaxTickRate / CDO->NetUpdateFrequency), 1);
@@ -102,7 +489,7 @@ void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool b
 		NativeClass = NativeClass->GetSuperClass();
 	}
 
-	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Setting replication period for %s (%s) to %d frames (%.2f)"), *Class->GetName(), *NativeClass->GetName(), Info.ReplicationPeriodFrame, CDO->NetUpdateFrequency);
+	UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Setting replication period for %s (%s) to %d frames (%.2f)"), *Class->GetName(), *NativeClass->GetName(), Info.ReplicationPeriodFrame, CDO->NetUpdateFrequency);
 }
 
 void UBaseFPSReplicationGraph::ResetGameWorldState()
@@ -110,6 +497,10 @@ void UBaseFPSReplicationGraph::ResetGameWorldState()
 	Super::ResetGameWorldState();
 
 	AlwaysRelevantStreamingLevelActors.Empty();
+	DistanceLODActors.Reset();
+	DistanceLODBuckets = FDistanceLODBuckets();
+	LastCombatTimes.Empty();
+	FineGridActors.Reset();
 
 	for (UNetReplicationGraphConnection* ConnManager : Connections)
 	{
@@ -134,6 +525,122 @@ void UBaseFPSReplicationGraph::ResetGameWorldState()
 	}
 }
 
+void UBaseFPSReplicationGraph::InitializeForWorld(UWorld* World)
+{
+	// the grids have to be set up before Super routes the world's actors into them
+	UpdateGridsForWorld(World);
+
+	Super::InitializeForWorld(World);
+}
+
+void UBaseFPSReplicationGraph::UpdateGridsForWorld(UWorld* World)
+{
+	FineGridActors.Reset();
+	DenseCells.Reset();
+
+	GridNode->CellSize = CVar_BaseFPSRepGraph_CellSize;
+	GridNode->SpatialBias = FVector2D(CVar_BaseFPSRepGraph_SpatialBiasX, CVar_BaseFPSRepGraph_SpatialBiasY);
+	GridNode->GridBounds.Init();
+	FineGridNode->bGatherEnabled = false;
+
+	if (World == nullptr || CVar_BaseFPSRepGraph_Grid_AutoBounds == 0)
+	{
+		return;
+	}
+
+	FBox WorldBounds(ForceInit);
+	for (const ULevel* Level : World->GetLevels())
+	{
+		if (Level)
+		{
+			WorldBounds += ALevelBounds::CalculateLevelBounds(Level);
+		}
+	}
+
+	if (!WorldBounds.IsValid)
+	{
+		UE_LOG(LogBaseFPSReplicationGraph, Warning, TEXT("UpdateGridsForWorld: %s has no level bounds, using BaseFPSRepGraph.CellSize and SpatialBias"), *World->GetName());
+		return;
+	}
+
+	// -----------------------------------------------
+	//	Coarse grid, covering the whole world
+	// -----------------------------------------------
+	const FVector Margin(CVar_BaseFPSRepGraph_Grid_BoundsMargin, CVar_BaseFPSRepGraph_Grid_BoundsMargin, 0.f);
+	const FBox GridBounds(FVector(WorldBounds.Min.X, WorldBounds.Min.Y, -WORLD_MAX) - Margin, FVector(WorldBounds.Max.X, WorldBounds.Max.Y, WORLD_MAX) + Margin);
+	const FVector GridSize = GridBounds.GetSize();
+
+	const float TargetCellSize = FMath::Max(GridSize.X, GridSize.Y) / FMath::Max(CVar_BaseFPSRepGraph_Grid_TargetCellsPerAxis, 1);
+	const float CellSize = FMath::Clamp(TargetCellSize, CVar_BaseFPSRepGraph_Grid_MinCellSize, FMath::Max(CVar_BaseFPSRepGraph_Grid_MinCellSize, CVar_BaseFPSRepGraph_Grid_MaxCellSize));
+
+	GridNode->CellSize = CellSize;
+	GridNode->SpatialBias = FVector2D(GridBounds.Min.X, GridBounds.Min.Y);
+	GridNode->GridBounds = GridBounds;
+
+	// -----------------------------------------------
+	//	Fine grid, covering the coarse cells crowded with static actors
+	// -----------------------------------------------
+	const int32 FineCellDivisions = FMath::Max(CVar_BaseFPSRepGraph_Grid_FineCellDivisions, 1);
+	if (CVar_BaseFPSRepGraph_Grid_DenseCellActors > 0 && FineCellDivisions > 1)
+	{
+		// pickup spawners don't replicate themselves, but spawn a pickup instance in place once play starts
+		TMap<FIntPoint, int32> StaticActorsPerCell;
+		for (FActorIterator It(World); It; ++It)
+		{
+			AActor* Actor = *It;
+			bool bCountActor = Actor->IsA<APickup>();
+			if (!bCountActor && ULevel::IsNetActor(Actor) && Actor->GetIsReplicated())
+			{
+				const EClassRepNodeMapping Mapping = GetMappingPolicy(Actor->GetClass());
+				bCountActor = Mapping == EClassRepNodeMapping::Spatialize_Static || Mapping == EClassRepNodeMapping::Spatialize_Dormancy;
+			}
+
+			if (bCountActor)
+			{
+				const FVector Location = Actor->GetActorLocation();
+				StaticActorsPerCell.FindOrAdd(FIntPoint(FMath::FloorToInt((Location.X - GridBounds.Min.X) / CellSize), FMath::FloorToInt((Location.Y - GridBounds.Min.Y) / CellSize)))++;
+			}
+		}
+
+		FBox DenseBounds(ForceInit);
+		for (const TPair<FIntPoint, int32>& Cell : StaticActorsPerCell)
+		{
+			if (Cell.Value >= CVar_BaseFPSRepGraph_Grid_DenseCellActors)
+			{
+				DenseCells.Add(Cell.Key);
+				DenseBounds += FVector(GridBounds.Min.X + Cell.Key.X * CellSize, GridBounds.Min.Y + Cell.Key.Y * CellSize, -WORLD_MAX);
+				DenseBounds += FVector(GridBounds.Min.X + (Cell.Key.X + 1) * CellSize, GridBounds.Min.Y + (Cell.Key.Y + 1) * CellSize, WORLD_MAX);
+			}
+		}
+
+		if (DenseCells.Num() > 0)
+		{
+			FineGridNode->CellSize = CellSize / FineCellDivisions;
+			FineGridNode->SpatialBias = FVector2D(DenseBounds.Min.X, DenseBounds.Min.Y);
+			FineGridNode->GridBounds = DenseBounds;
+			FineGridNode->bGatherEnabled = true;
+		}
+	}
+
+	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Grid for %s: bounds %s, cell size %.0f, %d dense cells (fine cell size %.0f)"),
+		*World->GetName(), *GridBounds.ToString(), CellSize, DenseCells.Num(), DenseCells.Num() > 0 ? FineGridNode->CellSize : 0.f);
+}
+
+UReplicationGraphNode_GridSpatialization2D* UBaseFPSReplicationGraph::GetGridNodeForStaticActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (DenseCells.Num() > 0)
+	{
+		const FVector Location = ActorInfo.Actor->GetActorLocation();
+		const FIntPoint Cell(FMath::FloorToInt((Location.X - GridNode->SpatialBias.X) / GridNode->CellSize), FMath::FloorToInt((Location.Y - GridNode->SpatialBias.Y) / GridNode->CellSize));
+		if (DenseCells.Contains(Cell))
+		{
+			FineGridActors.Add(ActorInfo.Actor);
+			return FineGridNode;
+		}
+	}
+	return GridNode;
+}
+
 void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 {
 	Super::InitGlobalActorClassSettings();
@@ -147,54 +654,46 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 	AddInfo(APlayerState::StaticClass(),					EClassRepNodeMapping::NotRouted);				// Special cased via UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter
 	AddInfo(AReplicationGraphDebugActor::StaticClass(),		EClassRepNodeMapping::NotRouted);				// Not needed. Replicated special case inside RepGraph
 	AddInfo(AInfo::StaticClass(),							EClassRepNodeMapping::RelevantAllConnections);	// Not spatialized, relevant to all
-	AddInfo(APickupInstance::StaticClass(),					EClassRepNodeMapping::Spatialize_Static);		// Spatialized and never moves, Routes to GridNode
+	AddInfo(APickupInstance::StaticClass(),					EClassRepNodeMapping::Spatialize_Dormancy);	// Spatialized and dormant until taken, Routes to GridNode
 
 #if WITH_GAMEPLAY_DEBUGGER
 	AddInfo(AGameplayDebuggerCategoryReplicator::StaticClass(),	EClassRepNodeMapping::NotRouted);			// Replicated via UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnectio
 #endif
 
-	TArray<UClass*> AllReplicatedClasses;
+	// --------------------------------------------------------------------
+	// Classify every loaded actor class. The result only depends on the class defaults and the explicit rules above, so
+	// it is cached per process and, in cooked builds, on disk per build (see RepGraphClassCache). Classes the cache
+	// already knows are only looked up, the first init of a process also pays for their path names.
+	// --------------------------------------------------------------------
 
-	for (TObjectIterator<UClass> It; It; ++It)
-	{
-		UClass* Class = *It;
-		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
-		if (!ActorCDO || !ActorCDO->GetIsReplicated())
-		{
-			continue;
-		}
+	const double ClassifyStartTime = FPlatformTime::Seconds();
+	RepGraphClassCache::FTable& ClassCache = RepGraphClassCache::GetTable(NetDriver->NetServerMaxTickRate);
+	int32 NumComputedClasses = 0;
 
-		// Skip SKEL and REINST classes.
-		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
-		{
-			continue;
-		}
+	auto ShouldSpatialize = [](const AActor* CDO)
+	{
+		return CDO->GetIsReplicated() && (!(CDO->bAlwaysRelevant || CDO->bOnlyRelevantToOwner || CDO->bNetUseOwnerRelevancy));
+	};
 
-		// --------------------------------------------------------------------
-		// This is a replicated class. Save this off for the second pass below
-		// --------------------------------------------------------------------
+	auto GetLegacyDebugStr = [](const AActor* CDO)
+	{
+		return FString::Printf(TEXT("%s [%d/%d/%d]"), *CDO->GetClass()->GetName(), CDO->bAlwaysRelevant, CDO->bOnlyRelevantToOwner, CDO->bNetUseOwnerRelevancy);
+	};
 
-		AllReplicatedClasses.Add(Class);
+	auto ClassifyClass = [&](UClass* Class, RepGraphClassCache::FEntry& Entry)
+	{
+		const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+		Entry.bReplicated = ActorCDO->GetIsReplicated();
 
-		// Skip if already in the map (added explicitly)
-		if (ClassRepNodePolicies.Contains(Class, false))
+		// Skip if not replicated, or already in the map (added explicitly)
+		if (!Entry.bReplicated || ClassRepNodePolicies.Contains(Class, false))
 		{
-			continue;
+			return;
 		}
 
-		auto ShouldSpatialize = [](const AActor* CDO)
-		{
-			return CDO->GetIsReplicated() && (!(CDO->bAlwaysRelevant || CDO->bOnlyRelevantToOwner || CDO->bNetUseOwnerRelevancy));
-		};
-
-		auto GetLegacyDebugStr = [](const AActor* CDO)
-		{
-			return FString::Printf(TEXT("%s [%d/%d/%d]"), *CDO->GetClass()->GetName(), CDO->bAlwaysRelevant, CDO->bOnlyRelevantToOwner, CDO->bNetUseOwnerRelevancy);
-		};
-
 		// Only handle this class if it differs from its super. There is no need to put every child class explicitly in the graph class mapping
 		UClass* SuperClass = Class->GetSuperClass();
-		if (AActor* SuperCDO = Cast<AActor>(SuperClass->GetDefaultObject()))
+		if (const AActor* SuperCDO = Cast<AActor>(SuperClass->GetDefaultObject()))
 		{
 			if (   SuperCDO->GetIsReplicated() == ActorCDO->GetIsReplicated()
 				&& SuperCDO->bAlwaysRelevant == ActorCDO->bAlwaysRelevant
@@ -202,23 +701,69 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 				&& SuperCDO->bNetUseOwnerRelevancy == ActorCDO->bNetUseOwnerRelevancy
 				)
 			{
-				continue;
+				return;
 			}
 
 			if (ShouldSpatialize(ActorCDO) == false && ShouldSpatialize(SuperCDO) == true)
 			{
-				UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Adding %s to NonSpatializedChildClasses. (Parent: %s)"), *GetLegacyDebugStr(ActorCDO), *GetLegacyDebugStr(SuperCDO));
-				NonSpatializedChildClasses.Add(Class);
+				UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Adding %s to NonSpatializedChildClasses. (Parent: %s)"), *GetLegacyDebugStr(ActorCDO), *GetLegacyDebugStr(SuperCDO));
+				Entry.bNonSpatializedChild = true;
 			}
 		}
 
 		if (ShouldSpatialize(ActorCDO))
 		{
-			AddInfo(Class, EClassRepNodeMapping::Spatialize_Dynamic);
+			Entry.Mapping = (uint8)EClassRepNodeMapping::Spatialize_Dynamic;
 		}
 		else if (ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner)
 		{
-			AddInfo(Class, EClassRepNodeMapping::RelevantAllConnections);
+			Entry.Mapping = (uint8)EClassRepNodeMapping::RelevantAllConnections;
+		}
+	};
+
+	// replicated classes and their cache entries, saved off for the second pass below
+	TArray<TPair<UClass*, int32>> AllReplicatedClasses;
+
+	// walks the class hierarchy instead of every loaded UClass, which avoids touching non-actor classes at all
+	TArray<UClass*> ActorClasses;
+	ActorClasses.Add(AActor::StaticClass());
+	GetDerivedClasses(AActor::StaticClass(), ActorClasses, true);
+
+	for (UClass* Class : ActorClasses)
+	{
+#if WITH_EDITOR
+		// Skip SKEL and REINST classes (editor only, cooked builds have neither)
+		const FNameBuilder ClassName(Class->GetFName());
+		if (ClassName.ToView().StartsWith(TEXT("SKEL_")) || ClassName.ToView().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+#endif
+
+		bool bNeedsClassify = false;
+		const int32 EntryIdx = ClassCache.FindOrAdd(Class, bNeedsClassify);
+		if (bNeedsClassify)
+		{
+			ClassifyClass(Class, ClassCache.Entries[EntryIdx]);
+			NumComputedClasses++;
+		}
+
+		const RepGraphClassCache::FEntry& Entry = ClassCache.Entries[EntryIdx];
+		if (!Entry.bReplicated)
+		{
+			continue;
+		}
+
+		AllReplicatedClasses.Emplace(Class, EntryIdx);
+
+		if (Entry.bNonSpatializedChild)
+		{
+			NonSpatializedChildClasses.Add(Class);
+		}
+
+		if (Entry.Mapping != RepGraphClassCache::NoMapping)
+		{
+			AddInfo(Class, (EClassRepNodeMapping)Entry.Mapping);
 		}
 	}
 
@@ -226,9 +771,21 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 	// Setup FClassReplicationInfo. This is essentially the per class replication settings. Some we set explicitly, the rest we are setting via looking at the legacy settings on AActor.
 	// -----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
-	TArray<UClass*> ExplicitlySetClasses;
+	TSet<UClass*> ExplicitlySetClasses;
 	auto SetClassInfo = [&](UClass* Class, const FClassReplicationInfo& Info) { GlobalActorReplicationInfoMap.SetClassInfo(Class, Info); ExplicitlySetClasses.Add(Class); };
 
+	auto IsChildOfExplicitlySetClass = [&](UClass* Class)
+	{
+		for (UClass* SuperClass = Class; SuperClass; SuperClass = SuperClass->GetSuperClass())
+		{
+			if (ExplicitlySetClasses.Contains(SuperClass))
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
 	FClassReplicationInfo PawnClassRepInfo;
 	PawnClassRepInfo.DistancePriorityScale = 1.f;
 	PawnClassRepInfo.StarvationPriorityScale = 1.f;
@@ -236,57 +793,67 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 	PawnClassRepInfo.SetCullDistanceSquared(15000.f * 15000.f); // Yuck (??? need to test this...)
 	SetClassInfo( APawn::StaticClass(), PawnClassRepInfo );
 
+	// Characters share their movement bunch between connections. The FastShared path is used on the frames the
+	// regular (property) path doesn't replicate the character, which still sends the full state as a fallback.
+	FClassReplicationInfo CharacterClassRepInfo = PawnClassRepInfo;
+	if (CVar_BaseFPSRepGraph_EnableFastSharedPath > 0)
+	{
+		CharacterClassRepInfo.FastSharedReplicationFunc = [](AActor* Actor)
+		{
+			ABaseFPSCharacter* Character = Cast<ABaseFPSCharacter>(Actor);
+			return Character && Character->UpdateSharedReplication();
+		};
+		CharacterClassRepInfo.FastSharedReplicationFuncName = FName(TEXT("FastSharedReplication"));
+
+		FastSharedPathConstants.MaxBitsPerFrame = (int32)((float)(CVar_BaseFPSRepGraph_TargetKBytesSecFastSharedPath * 1024 * 8) / NetDriver->GetNetServerMaxTickRate());
+		FastSharedPathConstants.DistanceRequirementPct = CVar_BaseFPSRepGraph_FastSharedPathCullDistPct;
+	}
+	SetClassInfo( ABaseFPSCharacter::StaticClass(), CharacterClassRepInfo );
+
+	UReplicationGraphNode_ActorListFrequencyBuckets::DefaultSettings.EnableFastPath = (CVar_BaseFPSRepGraph_EnableFastSharedPath > 0);
+
 	FClassReplicationInfo PlayerStateRepInfo;
 	PlayerStateRepInfo.DistancePriorityScale = 0.f;
 	PlayerStateRepInfo.ActorChannelFrameTimeout = 0;
 	SetClassInfo( APlayerState::StaticClass(), PlayerStateRepInfo );
 
 	UReplicationGraphNode_ActorListFrequencyBuckets::DefaultSettings.ListSize = 12;
+	UReplicationGraphNode_ActorListFrequencyBuckets::DefaultSettings.NumBuckets = FMath::Max(CVar_BaseFPSRepGraph_DynamicActorFrequencyBuckets, 1);
 
 	// Set FClassReplicationInfo based on legacy settings for all replicated classes
-	for (UClass* ReplicatedClass : AllReplicatedClasses)
+	for (const TPair<UClass*, int32>& ReplicatedClassPair : AllReplicatedClasses)
 	{
-		if (ExplicitlySetClasses.FindByPredicate([&](const UClass* SetClass) { return ReplicatedClass->IsChildOf(SetClass); }) != nullptr)
+		UClass* ReplicatedClass = ReplicatedClassPair.Key;
+		if (IsChildOfExplicitlySetClass(ReplicatedClass))
 		{
 			continue;
 		}
 
-		const bool bClassIsSpatialized = IsSpatialized(ClassRepNodePolicies.GetChecked(ReplicatedClass));
+		RepGraphClassCache::FEntry& Entry = ClassCache.Entries[ReplicatedClassPair.Value];
+		if (!Entry.bHasClassInfo)
+		{
+			const bool bClassIsSpatialized = IsSpatialized(ClassRepNodePolicies.GetChecked(ReplicatedClass));
+
+			FClassReplicationInfo ComputedInfo;
+			InitClassReplicationInfo(ComputedInfo, ReplicatedClass, bClassIsSpatialized, NetDriver->NetServerMaxTickRate);
+			Entry.SetClassInfo(bClassIsSpatialized, ComputedInfo);
+			ClassCache.bDirty = true;
+		}
 
 		FClassReplicationInfo ClassInfo;
-		InitClassReplicationInfo(ClassInfo, ReplicatedClass, bClassIsSpatialized, NetDriver->NetServerMaxTickRate);
+		Entry.GetClassInfo(ClassInfo);
 		GlobalActorReplicationInfoMap.SetClassInfo( ReplicatedClass, ClassInfo );
 	}
 
+	ClassCache.SaveIfDirty();
+
+	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Class settings: %d replicated classes (%d newly classified) in %.2fms"), AllReplicatedClasses.Num(), NumComputedClasses, (FPlatformTime::Seconds() - ClassifyStartTime) * 1000.0);
+
 	// Print out what we came up with
-	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT(""));
-	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Class Routing Map: "));
-	UEnum* Enum = StaticEnum<EClassRepNodeMapping>();
-	for (auto ClassMapIt = ClassRepNodePolicies.CreateIterator(); ClassMapIt; ++ClassMapIt)
+	if (UE_LOG_ACTIVE(LogBaseFPSReplicationGraph, Verbose))
 	{
-		UClass* Class = CastChecked<UClass>(ClassMapIt.Key().ResolveObjectPtr());
-		const EClassRepNodeMapping Mapping = ClassMapIt.Value();
-
-		// Only print if different than native class
-		UClass* ParentNativeClass = GetParentNativeClass(Class);
-		const EClassRepNodeMapping* ParentMapping = ClassRepNodePolicies.Get(ParentNativeClass);
-		if (ParentMapping && Class != ParentNativeClass && Mapping == *ParentMapping)
-		{
-			continue;
-		}
-
-		UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("  %s (%s) -> %s"), *Class->GetName(), *GetNameSafe(ParentNativeClass), *Enum->GetNameStringByValue(static_cast<uint32>(Mapping)));
-	}
-
-	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT(""));
-	UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("Class Settings Map: "));
-	FClassReplicationInfo DefaultValues;
-	for (auto ClassRepInfoIt = GlobalActorReplicationInfoMap.CreateClassMapIterator(); ClassRepInfoIt; ++ClassRepInfoIt)
-	{
-		UClass* Class = CastChecked<UClass>(ClassRepInfoIt.Key().ResolveObjectPtr());
-		const FClassReplicationInfo& ClassInfo = ClassRepInfoIt.Value();
-		UE_LOG(LogBaseFPSReplicationGraph, Log, TEXT("  %s (%s) -> %s"), *Class->GetName(), *GetNameSafe(GetParentNativeClass(Class)), *ClassInfo.BuildDebugStringDelta());
-	}
+		LogClassSettings();
+	}
 
 	// Rep destruct infos based on CVar value
 	DestructInfoMaxDistanceSquared = CVar_BaseFPSRepGraph_DestructionInfoMaxDist * CVar_BaseFPSRepGraph_DestructionInfoMaxDist;
@@ -298,6 +865,8 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 	//	So for now, erring on the side of a cleaning dependencies between classes.
 	// -------------------------------------------------------
 	
+	ABaseFPSCharacter::GlobalOnCharacterCombatEvent.AddUObject(this, &UBaseFPSReplicationGraph::OnCharacterCombatEvent);
+	ABaseFPSCharacter::GlobalOnCharacterInventoryChanged.AddUObject(this, &UBaseFPSReplicationGraph::OnCharacterInventoryChanged);
 	// ABaseFPSCharacter::GlobalOnCharacterEquipWeapon.AddUObject(this, &UBaseFPSReplicationGraph::OnCharacterEquipWeapon);
 	// ABaseFPSCharacter::GlobalOnCharacterUnEquipWeapon.AddUObject(this, &UBaseFPSReplicationGraph::OnCharacterUnEquipWeapon);
 
@@ -306,6 +875,38 @@ void UBaseFPSReplicationGraph::InitGlobalActorClassSettings()
 #endif
 }
 
+void UBaseFPSReplicationGraph::LogClassSettings()
+{
+	UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT(""));
+	UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Class Routing Map: "));
+	UEnum* Enum = StaticEnum<EClassRepNodeMapping>();
+	for (auto ClassMapIt = ClassRepNodePolicies.CreateIterator(); ClassMapIt; ++ClassMapIt)
+	{
+		UClass* Class = CastChecked<UClass>(ClassMapIt.Key().ResolveObjectPtr());
+		const EClassRepNodeMapping Mapping = ClassMapIt.Value();
+
+		// Only print if different than native class
+		UClass* ParentNativeClass = GetParentNativeClass(Class);
+		const EClassRepNodeMapping* ParentMapping = ClassRepNodePolicies.Get(ParentNativeClass);
+		if (ParentMapping && Class != ParentNativeClass && Mapping == *ParentMapping)
+		{
+			continue;
+		}
+
+		UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("  %s (%s) -> %s"), *Class->GetName(), *GetNameSafe(ParentNativeClass), *Enum->GetNameStringByValue(static_cast<uint32>(Mapping)));
+	}
+
+	UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT(""));
+	UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Class Settings Map: "));
+	FClassReplicationInfo DefaultValues;
+	for (auto ClassRepInfoIt = GlobalActorReplicationInfoMap.CreateClassMapIterator(); ClassRepInfoIt; ++ClassRepInfoIt)
+	{
+		UClass* Class = CastChecked<UClass>(ClassRepInfoIt.Key().ResolveObjectPtr());
+		const FClassReplicationInfo& ClassInfo = ClassRepInfoIt.Value();
+		UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("  %s (%s) -> %s"), *Class->GetName(), *GetNameSafe(GetParentNativeClass(Class)), *ClassInfo.BuildDebugStringDelta());
+	}
+}
+
 void UBaseFPSReplicationGraph::InitGlobalGraphNodes()
 {
 	Super::InitGlobalGraphNodes();
@@ -320,21 +921,29 @@ void UBaseFPSReplicationGraph::InitGlobalGraphNodes()
 	//	Spatial Actors
 	// -----------------------------------------------
 
-	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	// cell size, bias and bounds are fit to the world in UpdateGridsForWorld
+	GridNode = CreateNewNode<UBaseFPSReplicationGraphNode_GridSpatialization2D>();
 	GridNode->CellSize = CVar_BaseFPSRepGraph_CellSize;
 	GridNode->SpatialBias = FVector2D(CVar_BaseFPSRepGraph_SpatialBiasX, CVar_BaseFPSRepGraph_SpatialBiasY);
 
+	FineGridNode = CreateNewNode<UBaseFPSReplicationGraphNode_GridSpatialization2D>();
+	FineGridNode->bGatherEnabled = false;
+
+	// only opt in: a fitted grid has GridBounds set and clamps instead of rebuilding, and the fine grid only takes actors
+	// inside its own bounds
 	if (CVar_BaseFPSRepGraph_DisableSpatialRebuilds)
 	{
 		GridNode->AddToClassRebuildDenyList(AActor::StaticClass()); // Disable All spatial rebuilding
+		FineGridNode->AddToClassRebuildDenyList(AActor::StaticClass());
 	}
 
 	AddGlobalGraphNode(GridNode);
+	AddGlobalGraphNode(FineGridNode);
 
 	// -----------------------------------------------
 	//	Always Relevant (to everyone) Actors
 	// -----------------------------------------------
-	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AlwaysRelevantNode = CreateNewNode<UBaseFPSReplicationGraphNode_ActorList>();
 	AddGlobalGraphNode(AlwaysRelevantNode);
 
 	// -----------------------------------------------
@@ -355,6 +964,9 @@ void UBaseFPSReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConn
 	ConnectionManager->OnClientVisibleLevelNameRemove.AddUObject(AlwaysRelevantConnectionNode, &UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::OnClientLevelVisibilityRemove);
 
 	AddConnectionGraphNode(AlwaysRelevantConnectionNode, ConnectionManager);
+
+	UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection* DistanceLODNode = CreateNewNode<UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection>();
+	AddConnectionGraphNode(DistanceLODNode, ConnectionManager);
 }
 
 EClassRepNodeMapping UBaseFPSReplicationGraph::GetMappingPolicy(UClass* Class)
@@ -391,19 +1003,20 @@ void UBaseFPSReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedA
 
 		case EClassRepNodeMapping::Spatialize_Static:
 		{
-			GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+			GetGridNodeForStaticActor(ActorInfo)->AddActor_Static(ActorInfo, GlobalInfo);
 			break;
 		}
 
 		case EClassRepNodeMapping::Spatialize_Dynamic:
 		{
 			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			DistanceLODActors.Add(ActorInfo.Actor);
 			break; 
 		}
 
 		case EClassRepNodeMapping::Spatialize_Dormancy:
 		{
-			GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+			GetGridNodeForStaticActor(ActorInfo)->AddActor_Dormancy(ActorInfo, GlobalInfo);
 			break; 
 		}
 	};
@@ -438,24 +1051,100 @@ void UBaseFPSReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicat
 
 		case EClassRepNodeMapping::Spatialize_Static:
 		{
-			GridNode->RemoveActor_Static(ActorInfo);
+			if (FineGridActors.Remove(ActorInfo.Actor) > 0)
+			{
+				FineGridNode->RemoveActor_Static(ActorInfo);
+			}
+			else
+			{
+				GridNode->RemoveActor_Static(ActorInfo);
+			}
 			break;
 		}
 
 		case EClassRepNodeMapping::Spatialize_Dynamic:
 		{
 			GridNode->RemoveActor_Dynamic(ActorInfo);
+			DistanceLODActors.RemoveFast(ActorInfo.Actor);
+			LastCombatTimes.Remove(ActorInfo.Actor);
+
+			for (UNetReplicationGraphConnection* ConnManager : Connections)
+			{
+				for (UReplicationGraphNode* ConnectionNode : ConnManager->GetConnectionGraphNodes())
+				{
+					if (UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection* DistanceLODNode = Cast<UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection>(ConnectionNode))
+					{
+						DistanceLODNode->NotifyActorRemoved(ActorInfo.Actor);
+					}
+				}
+			}
 			break; 
 		}
 
 		case EClassRepNodeMapping::Spatialize_Dormancy:
 		{
-			GridNode->RemoveActor_Dormancy(ActorInfo);
+			if (FineGridActors.Remove(ActorInfo.Actor) > 0)
+			{
+				FineGridNode->RemoveActor_Dormancy(ActorInfo);
+			}
+			else
+			{
+				GridNode->RemoveActor_Dormancy(ActorInfo);
+			}
 			break; 
 		}
 	};
 }
 
+int32 UBaseFPSReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	if (ActiveBenchmark == nullptr)
+	{
+		return Super::ServerReplicateActors(DeltaSeconds);
+	}
+
+	// nodes add their gather times as they run, see FBaseFPSScopedNodeGatherTimer
+	BenchmarkNodeGatherMs.Reset();
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	ActiveBenchmark->RecordReplicateFrame(FPlatformTime::Seconds() - StartTime, BenchmarkNodeGatherMs);
+	return Result;
+}
+
+const UBaseFPSReplicationGraph::FDistanceLODBuckets& UBaseFPSReplicationGraph::GetDistanceLODBuckets(uint32 ReplicationFrameNum)
+{
+	if (DistanceLODBuckets.FrameNum == ReplicationFrameNum && DistanceLODBuckets.Cells.Num() > 0)
+	{
+		return DistanceLODBuckets;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_BaseFPSRepGraph_BuildDistanceLODBuckets);
+
+	// same cells as the grid, keep the cell arrays allocated between frames
+	DistanceLODBuckets.FrameNum = ReplicationFrameNum;
+	DistanceLODBuckets.CellSize = FMath::Max(GridNode->CellSize, 1.f);
+	DistanceLODBuckets.SpatialBias = GridNode->SpatialBias;
+	DistanceLODBuckets.MaxCullDistance = 0.f;
+	for (TPair<FIntPoint, TArray<FActorRepListType>>& Cell : DistanceLODBuckets.Cells)
+	{
+		Cell.Value.Reset();
+	}
+
+	float MaxCullDistSq = 0.f;
+	for (FActorRepListType Actor : DistanceLODActors)
+	{
+		DistanceLODBuckets.Cells.FindOrAdd(DistanceLODBuckets.GetCell(Actor->GetActorLocation())).Add(Actor);
+		MaxCullDistSq = FMath::Max(MaxCullDistSq, GlobalActorReplicationInfoMap.Get(Actor).Settings.GetCullDistanceSquared());
+	}
+	DistanceLODBuckets.MaxCullDistance = FMath::Sqrt(MaxCullDistSq);
+	return DistanceLODBuckets;
+}
+
+void UBaseFPSReplicationGraph::RecordNodeGatherTime(const UReplicationGraphNode* Node, double Seconds)
+{
+	BenchmarkNodeGatherMs.FindOrAdd(Node->GetClass()->GetFName()) += Seconds * 1000.0;
+}
+
 // Since we listen to global (static) events, we need to watch out for cross world broadcasts (PIE)
 #if WITH_EDITOR
 #define CHECK_WORLDS(X) if (X->GetWorld() != GetWorld()) return;
@@ -463,6 +1152,57 @@ void UBaseFPSReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicat
 #define CHECK_WORLDS(X)
 #endif
 
+void UBaseFPSReplicationGraph::OnCharacterCombatEvent(ABaseFPSCharacter* Character)
+{
+	if (Character)
+	{
+		CHECK_WORLDS(Character);
+
+		LastCombatTimes.FindOrAdd(Character) = GetWorld()->GetTimeSeconds();
+	}
+}
+
+void UBaseFPSReplicationGraph::OnCharacterInventoryChanged(ABaseFPSCharacter* Character)
+{
+	if (Character)
+	{
+		CHECK_WORLDS(Character);
+
+		for (UNetReplicationGraphConnection* ConnManager : Connections)
+		{
+			for (UReplicationGraphNode* ConnectionNode : ConnManager->GetConnectionGraphNodes())
+			{
+				if (UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = Cast<UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection>(ConnectionNode))
+				{
+					AlwaysRelevantConnectionNode->NotifyInventoryChanged(Character);
+				}
+			}
+		}
+	}
+}
+
+int32 UBaseFPSReplicationGraph::GetOcclusionTracesRemaining(uint32 ReplicationFrameNum)
+{
+	if (OcclusionBudgetFrameNum != ReplicationFrameNum)
+	{
+		OcclusionBudgetFrameNum = ReplicationFrameNum;
+		OcclusionTracesThisFrame = 0;
+	}
+	return FMath::Max(CVar_BaseFPSRepGraph_Occlusion_MaxTracesPerFrame - OcclusionTracesThisFrame, 0);
+}
+
+void UBaseFPSReplicationGraph::ConsumeOcclusionTraces(uint32 ReplicationFrameNum, int32 NumTraces)
+{
+	GetOcclusionTracesRemaining(ReplicationFrameNum);
+	OcclusionTracesThisFrame += NumTraces;
+}
+
+bool UBaseFPSReplicationGraph::IsInCombat(const AActor* Actor, float WorldTime) const
+{
+	const float* LastCombatTime = LastCombatTimes.Find(Actor);
+	return LastCombatTime && (WorldTime - *LastCombatTime) < CVar_BaseFPSRepGraph_DistanceLOD_CombatTimeout;
+}
+
 void UBaseFPSReplicationGraph::OnCharacterEquipWeapon(ABaseFPSCharacter* Character, AWeapon* NewWeapon)
 {
 	if (Character && NewWeapon)
@@ -521,6 +1261,46 @@ void UBaseFPSReplicationGraph::OnGameplayDebuggerOwnerChange(AGameplayDebuggerCa
 }
 #endif
 
+void UBaseFPSReplicationGraph::LogGridHistogram()
+{
+	auto LogGrid = [](const TCHAR* GridName, const UBaseFPSReplicationGraphNode_GridSpatialization2D* Grid)
+	{
+		TArray<int32> ActorsPerCell;
+		Grid->GetCellOccupancy(ActorsPerCell);
+
+		// buckets: 0, 1, 2-3, 4-7, ...
+		TArray<int32> Buckets;
+		int32 TotalActors = 0;
+		int32 MaxActors = 0;
+		for (const int32 NumActors : ActorsPerCell)
+		{
+			const int32 Bucket = NumActors == 0 ? 0 : (int32)FMath::FloorLog2((uint32)NumActors) + 1;
+			if (Buckets.Num() <= Bucket)
+			{
+				Buckets.SetNumZeroed(Bucket + 1);
+			}
+			Buckets[Bucket]++;
+			TotalActors += NumActors;
+			MaxActors = FMath::Max(MaxActors, NumActors);
+		}
+
+		UE_LOG(LogBaseFPSReplicationGraph, Display, TEXT("%s: cell size %.0f, %d allocated cells, %.1f actors per cell on average, %d max"), GridName, Grid->CellSize, ActorsPerCell.Num(),
+			ActorsPerCell.Num() > 0 ? (float)TotalActors / ActorsPerCell.Num() : 0.f, MaxActors);
+		for (int32 Bucket = 0; Bucket < Buckets.Num(); Bucket++)
+		{
+			const int32 Min = Bucket == 0 ? 0 : 1 << (Bucket - 1);
+			const int32 Max = Bucket == 0 ? 0 : (1 << Bucket) - 1;
+			UE_LOG(LogBaseFPSReplicationGraph, Display, TEXT("  %5d - %-5d : %d"), Min, Max, Buckets[Bucket]);
+		}
+	};
+
+	LogGrid(TEXT("Grid"), GridNode);
+	if (FineGridNode->bGatherEnabled)
+	{
+		LogGrid(TEXT("Fine grid"), FineGridNode);
+	}
+}
+
 void UBaseFPSReplicationGraph::PrintRepNodePolicies()
 {
 	UEnum* Enum = StaticEnum<EClassRepNodeMapping>();
@@ -543,97 +1323,96 @@ void UBaseFPSReplicationGraph::PrintRepNodePolicies()
 	}
 }
 
-/************************************************************************/
-/* Replication Graph Node - Always Relevant - For Connection            */
-/************************************************************************/
-
-void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(
-	const FConnectionGatherActorListParameters& Params)
+/** [benchmark] times the enclosing gather for the running benchmark, a no-op otherwise */
+struct FBaseFPSScopedNodeGatherTimer
 {
-	QUICK_SCOPE_CYCLE_COUNTER( UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection_GatherActorListsForConnection )
+	explicit FBaseFPSScopedNodeGatherTimer(const UReplicationGraphNode* InNode)
+		: Node(InNode)
+		, RepGraph(CastChecked<UBaseFPSReplicationGraph>(InNode->GetOuter()))
+		, StartTime(RepGraph->ActiveBenchmark ? FPlatformTime::Seconds() : 0.0)
+	{}
 
-	UBaseFPSReplicationGraph* RepGraph = CastChecked<UBaseFPSReplicationGraph>(GetOuter());
-
-	ReplicationActorList.Reset();
-
-	auto ResetActorCullDistance = [&](TObjectPtr<AActor> ActorToSet, TObjectPtr<AActor>& LastActor)
+	~FBaseFPSScopedNodeGatherTimer()
 	{
-		if (ActorToSet != LastActor)
+		if (StartTime > 0.0)
 		{
-			LastActor = ActorToSet;
-
-			UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Setting pawn cull distance to 0 (%s)"), *ActorToSet->GetName())
-			FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(ActorToSet);
-			ConnectionActorInfo.SetCullDistanceSquared(0.f);
+			RepGraph->RecordNodeGatherTime(Node, FPlatformTime::Seconds() - StartTime);
 		}
-	};
+	}
 
-	for (const FNetViewer& CurViewer : Params.Viewers)
+private:
+	const UReplicationGraphNode* Node;
+	UBaseFPSReplicationGraph* RepGraph;
+	double StartTime;
+};
+
+/************************************************************************/
+/* Replication Graph Node - Grid Spatialization 2D                      */
+/************************************************************************/
+
+void UBaseFPSReplicationGraphNode_GridSpatialization2D::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	FBaseFPSScopedNodeGatherTimer BenchmarkTimer(this);
+	if (bGatherEnabled)
 	{
-		ReplicationActorList.ConditionalAdd(CurViewer.InViewer);
-		ReplicationActorList.ConditionalAdd(CurViewer.ViewTarget);
+		Super::GatherActorListsForConnection(Params);
+	}
+}
 
-		if (ABaseFPSPlayerController* PC = Cast<ABaseFPSPlayerController>(CurViewer.InViewer))
+void UBaseFPSReplicationGraphNode_GridSpatialization2D::GetCellOccupancy(TArray<int32>& OutActorsPerCell) const
+{
+	TArray<FActorRepListType> CellActors;
+	for (const TArray<UReplicationGraphNode_GridCell*>& GridX : Grid)
+	{
+		for (const UReplicationGraphNode_GridCell* Cell : GridX)
 		{
-			// 50% throttling of PlayerStates.
-			const bool bReplicatePS = (Params.ConnectionManager.ConnectionOrderNum % 2) == (Params.ReplicationFrameNum % 2);
-			if (bReplicatePS)
+			if (Cell)
 			{
-				if (APlayerState* PS = PC->PlayerState)
-				{
-					// Always return the player state to the owning player. Simulated proxy player states are handled by UShooterReplicationGraphNode_PlayerStateFrequencyLimiter
-					if (!bInitializedPlayerState)
-					{
-						bInitializedPlayerState = true;
-						FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(PS);
-						ConnectionActorInfo.ReplicationPeriodFrame = 1;
-					}
-
-					ReplicationActorList.ConditionalAdd(PS);				
-				}
+				CellActors.Reset();
+				Cell->GetAllActorsInNode_Debugging(CellActors);
+				OutActorsPerCell.Add(CellActors.Num());
 			}
+		}
+	}
+}
 
-			FAlwaysRelevantActorInfo* LastData = PastRelevantActors.FindByKey<UNetConnection*>(CurViewer.Connection);
-
-			// We've not seen this actor before, go ahead and add them.
-			if (LastData == nullptr)
-			{
-				FAlwaysRelevantActorInfo NewActorInfo;
-				NewActorInfo.Connection = CurViewer.Connection;
-				LastData = &(PastRelevantActors[PastRelevantActors.Add(NewActorInfo)]);
-			}
+/************************************************************************/
+/* Replication Graph Node - Actor List                                  */
+/************************************************************************/
 
-			check(LastData != nullptr);
+void UBaseFPSReplicationGraphNode_ActorList::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	FBaseFPSScopedNodeGatherTimer BenchmarkTimer(this);
+	Super::GatherActorListsForConnection(Params);
+}
 
-			if (ABaseFPSCharacter* Pawn = Cast<ABaseFPSCharacter>(PC->GetPawn()))
-			{
-				ResetActorCullDistance(Pawn, LastData->LastViewer);
+/************************************************************************/
+/* Replication Graph Node - Always Relevant - For Connection            */
+/************************************************************************/
 
-				if (Pawn != CurViewer.ViewTarget)
-				{
-					ReplicationActorList.ConditionalAdd(Pawn);
-				}
+void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(
+	const FConnectionGatherActorListParameters& Params)
+{
+	QUICK_SCOPE_CYCLE_COUNTER( UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection_GatherActorListsForConnection )
+	FBaseFPSScopedNodeGatherTimer BenchmarkTimer(this);
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_RepGraphAlwaysRelevantGather);
 
-				TArray<AInventory*>& Inv = Pawn->GetInventory();
-				for (int32 i = 0; i < Inv.Num(); i++)
-				{
-					ReplicationActorList.ConditionalAdd(Inv[i]);
-				}
-			}
+	UBaseFPSReplicationGraph* RepGraph = CastChecked<UBaseFPSReplicationGraph>(GetOuter());
 
-			if (ABaseFPSCharacter* ViewTargetPawn = Cast<ABaseFPSCharacter>(CurViewer.ViewTarget))
-			{
-				ResetActorCullDistance(ViewTargetPawn, LastData->LastViewTarget);
-			}
-		}
+	if (CVar_BaseFPSRepGraph_AlwaysRelevant_CacheGather == 0 || NeedsRebuild(Params.Viewers))
+	{
+		RebuildActorList(Params);
 	}
 
-	PastRelevantActors.RemoveAll([&](FAlwaysRelevantActorInfo& RelActorInfo){
-		return RelActorInfo.Connection = nullptr;
-	});
-
 	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
 
+	// 50% throttling of PlayerStates.
+	const bool bReplicatePS = (Params.ConnectionManager.ConnectionOrderNum % 2) == (Params.ReplicationFrameNum % 2);
+	if (bReplicatePS && PlayerStateList.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(PlayerStateList);
+	}
+
 	// Always relevant streaming level actors;
 	FPerConnectionActorInfoMap& ConnectionActorInfoMap = Params.ConnectionManager.ActorInfoMap;
 
@@ -683,12 +1462,139 @@ void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorLists
 		}
 	}
 
+}
+
+bool UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::NeedsRebuild(const FNetViewerArray& Viewers) const
+{
+	if (bActorListDirty || Viewers.Num() != CachedViewers.Num())
+	{
+		return true;
+	}
+
 #if WITH_GAMEPLAY_DEBUGGER
+	if (CachedGameplayDebugger.IsStale() || GameplayDebugger != CachedGameplayDebugger.Get())
+	{
+		return true;
+	}
+#endif
+
+	for (int32 Idx = 0; Idx < Viewers.Num(); Idx++)
+	{
+		const FNetViewer& CurViewer = Viewers[Idx];
+		const FCachedViewer& Cached = CachedViewers[Idx];
+		if (Cached.IsStale() || CurViewer.InViewer != Cached.InViewer.Get() || CurViewer.ViewTarget != Cached.ViewTarget.Get())
+		{
+			return true;
+		}
+
+		const APlayerController* Controller = Cached.Controller.Get();
+		if (Controller && (Controller->GetPawn() != Cached.Pawn.Get() || Controller->PlayerState != Cached.PlayerState.Get()))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::RebuildActorList(const FConnectionGatherActorListParameters& Params)
+{
+	INC_DWORD_STAT(STAT_BaseFPS_RepGraphAlwaysRelevantRebuilds);
+
+	auto ResetActorCullDistance = [&](AActor* ActorToSet, const AActor* LastActor)
+	{
+		if (ActorToSet != LastActor)
+		{
+			UE_LOG(LogBaseFPSReplicationGraph, Verbose, TEXT("Setting pawn cull distance to 0 (%s)"), *ActorToSet->GetName())
+			FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(ActorToSet);
+			ConnectionActorInfo.SetCullDistanceSquared(0.f);
+		}
+	};
+
+	// what the list was built from last time, to only touch the connection actor info of actors that changed
+	const TArray<FCachedViewer, TInlineAllocator<2>> PreviousViewers = MoveTemp(CachedViewers);
+	CachedViewers.Reset();
+
+	ReplicationActorList.Reset();
+	PlayerStateList.Reset();
+
+	for (int32 Idx = 0; Idx < Params.Viewers.Num(); Idx++)
+	{
+		const FNetViewer& CurViewer = Params.Viewers[Idx];
+		const FCachedViewer* Previous = PreviousViewers.IsValidIndex(Idx) ? &PreviousViewers[Idx] : nullptr;
+
+		FCachedViewer& Cached = CachedViewers.AddDefaulted_GetRef();
+		Cached.InViewer = CurViewer.InViewer;
+		Cached.ViewTarget = CurViewer.ViewTarget;
+
+		ReplicationActorList.ConditionalAdd(CurViewer.InViewer);
+		ReplicationActorList.ConditionalAdd(CurViewer.ViewTarget);
+
+		if (ABaseFPSPlayerController* PC = Cast<ABaseFPSPlayerController>(CurViewer.InViewer))
+		{
+			Cached.Controller = PC;
+			Cached.Pawn = PC->GetPawn();
+			Cached.PlayerState = PC->PlayerState;
+
+			if (APlayerState* PS = PC->PlayerState)
+			{
+				// Always return the player state to the owning player. Simulated proxy player states are handled by UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter
+				if (!Previous || Previous->PlayerState.Get() != PS)
+				{
+					FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(PS);
+					ConnectionActorInfo.ReplicationPeriodFrame = 1;
+				}
+
+				PlayerStateList.ConditionalAdd(PS);
+			}
+
+			if (ABaseFPSCharacter* Pawn = Cast<ABaseFPSCharacter>(PC->GetPawn()))
+			{
+				ResetActorCullDistance(Pawn, Previous ? Previous->Pawn.Get() : nullptr);
+
+				if (Pawn != CurViewer.ViewTarget)
+				{
+					ReplicationActorList.ConditionalAdd(Pawn);
+				}
+
+				// only materialized items have actors, stowed ones replicate as part of the pawn's inventory list
+				const FInventoryList& Inv = Pawn->GetInventory();
+				for (int32 i = 0; i < Inv.Num(); i++)
+				{
+					if (AInventory* Item = Inv[i])
+					{
+						ReplicationActorList.ConditionalAdd(Item);
+					}
+				}
+			}
+
+			if (ABaseFPSCharacter* ViewTargetPawn = Cast<ABaseFPSCharacter>(CurViewer.ViewTarget))
+			{
+				ResetActorCullDistance(ViewTargetPawn, Previous ? Previous->ViewTarget.Get() : nullptr);
+			}
+		}
+	}
+
+#if WITH_GAMEPLAY_DEBUGGER
+	CachedGameplayDebugger = GameplayDebugger;
 	if (GameplayDebugger)
 	{
 		ReplicationActorList.ConditionalAdd(GameplayDebugger);
 	}
 #endif
+
+	bActorListDirty = false;
+}
+
+void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::NotifyInventoryChanged(const ABaseFPSCharacter* Character)
+{
+	for (const FCachedViewer& Cached : CachedViewers)
+	{
+		if (Cached.Pawn.Get() == Character)
+		{
+			bActorListDirty = true;
+			return;
+		}
+	}
 }
 
 void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::LogNode(FReplicationGraphDebugInfo& DebugInfo,
@@ -697,6 +1603,7 @@ void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::LogNode(FReplica
 	DebugInfo.Log(NodeName);
 	DebugInfo.PushIndent();
 	LogActorRepList(DebugInfo, NodeName,ReplicationActorList);
+	LogActorRepList(DebugInfo, TEXT("PlayerStates"), PlayerStateList);
 	for (const FName& LevelName : AlwaysRelevantStreamingLevelsNeedingReplication)
 	{
 		UBaseFPSReplicationGraph* RepGraph = CastChecked<UBaseFPSReplicationGraph>(GetOuter());
@@ -724,6 +1631,231 @@ void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::OnClientLevelVis
 void UBaseFPSReplicationGraphNode_AlwaysRelevant_ForConnection::ResetGameWorldState()
 {
 	AlwaysRelevantStreamingLevelsNeedingReplication.Empty();
+	CachedViewers.Reset();
+	bActorListDirty = true;
+}
+
+/************************************************************************/
+/* Replication Graph Node - Distance LOD - For Connection               */
+/************************************************************************/
+
+void UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection::GatherActorListsForConnection(
+	const FConnectionGatherActorListParameters& Params)
+{
+	FBaseFPSScopedNodeGatherTimer BenchmarkTimer(this);
+
+	// bands only need to follow the viewers roughly, stagger the connections across frames
+	const uint32 UpdateInterval = (uint32)FMath::Max(CVar_BaseFPSRepGraph_DistanceLOD_UpdateInterval, 1);
+	if ((Params.ReplicationFrameNum + (uint32)Params.ConnectionManager.ConnectionOrderNum) % UpdateInterval != 0)
+	{
+		INC_DWORD_STAT_BY(STAT_BaseFPS_RepGraphDistanceLODReducedActors, NumReducedActors);
+		INC_DWORD_STAT_BY(STAT_BaseFPS_RepGraphOccludedActors, NumOccludedActors);
+		return;
+	}
+
+	QUICK_SCOPE_CYCLE_COUNTER( UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection_GatherActorListsForConnection )
+
+	UBaseFPSReplicationGraph* RepGraph = CastChecked<UBaseFPSReplicationGraph>(GetOuter());
+	FPerConnectionActorInfoMap& ConnectionActorInfoMap = Params.ConnectionManager.ActorInfoMap;
+
+	// only the actors in cells within cull distance of a viewer can replicate to this connection, the rest keep
+	// whatever period they last had and are re-evaluated once they come back into range
+	const UBaseFPSReplicationGraph::FDistanceLODBuckets& Buckets = RepGraph->GetDistanceLODBuckets(Params.ReplicationFrameNum);
+	const FVector Range(Buckets.MaxCullDistance, Buckets.MaxCullDistance, 0.f);
+	TArray<FIntRect, TInlineAllocator<2>> ViewerCellRects;
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		ViewerCellRects.Emplace(Buckets.GetCell(Viewer.ViewLocation - Range), Buckets.GetCell(Viewer.ViewLocation + Range));
+	}
+
+	// only occupied cells are visited, however large the range is
+	LODCandidates.Reset();
+	for (const TPair<FIntPoint, TArray<FActorRepListType>>& Cell : Buckets.Cells)
+	{
+		for (const FIntRect& CellRect : ViewerCellRects)
+		{
+			if (Cell.Key.X >= CellRect.Min.X && Cell.Key.X <= CellRect.Max.X && Cell.Key.Y >= CellRect.Min.Y && Cell.Key.Y <= CellRect.Max.Y)
+			{
+				LODCandidates.Append(Cell.Value);
+				break;
+			}
+		}
+	}
+	const TArray<FActorRepListType>& LODActors = LODCandidates;
+
+	// the viewers' own pawns are never reduced. The view target is usually the pawn, but not while spectating or using a camera actor
+	TArray<const AActor*, TInlineAllocator<4>> ViewerPawns;
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		ViewerPawns.AddUnique(Viewer.ViewTarget);
+		if (const APlayerController* ViewerController = Cast<APlayerController>(Viewer.InViewer))
+		{
+			ViewerPawns.AddUnique(ViewerController->GetPawn());
+		}
+	}
+
+	const bool bDistanceLODEnabled = CVar_BaseFPSRepGraph_DistanceLOD_Enable > 0;
+	const bool bOcclusionEnabled = CVar_BaseFPSRepGraph_Occlusion_Enable > 0;
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	const float NearDistSq = FMath::Square(CVar_BaseFPSRepGraph_DistanceLOD_NearDist);
+	const float MidDistSq = FMath::Square(CVar_BaseFPSRepGraph_DistanceLOD_MidDist);
+	const float ViewConeCos = FMath::Cos(FMath::DegreesToRadians(CVar_BaseFPSRepGraph_DistanceLOD_ViewConeHalfAngle));
+	const uint32 MidPeriod = (uint32)FMath::Max(CVar_BaseFPSRepGraph_DistanceLOD_MidPeriod, 1);
+	const uint32 FarPeriod = (uint32)FMath::Max(CVar_BaseFPSRepGraph_DistanceLOD_FarPeriod, 1);
+	const uint32 HeartbeatPeriod = (uint32)FMath::Max(CVar_BaseFPSRepGraph_Occlusion_HeartbeatPeriod, 1);
+
+	// this connection's share of the frame's trace budget, connections are spread over UpdateInterval frames. The
+	// minimum holds even when the budget is spent by the connections gathered before this one
+	const int32 NumConnectionsPerFrame = FMath::Max<int32>(RepGraph->Connections.Num() / (int32)UpdateInterval, 1);
+	const int32 ConnectionTraceShare = CVar_BaseFPSRepGraph_Occlusion_MaxTracesPerFrame / NumConnectionsPerFrame;
+	const int32 TraceBudget = FMath::Max(FMath::Min(ConnectionTraceShare, RepGraph->GetOcclusionTracesRemaining(Params.ReplicationFrameNum)), CVar_BaseFPSRepGraph_Occlusion_MinTracesPerConnection);
+	int32 NumTraces = 0;
+
+	// occlusion checks are done round robin, starting where the budget ran out last time
+	const int32 NumActors = LODActors.Num();
+	OcclusionCursor = (NumActors > 0) ? (OcclusionCursor % NumActors) : 0;
+	int32 NextOcclusionCursor = OcclusionCursor;
+	bool bBudgetExhausted = false;
+
+	NumReducedActors = 0;
+	NumOccludedActors = 0;
+	for (int32 i = 0; i < NumActors; i++)
+	{
+		const int32 ActorIdx = (OcclusionCursor + i) % NumActors;
+		FActorRepListType Actor = LODActors[ActorIdx];
+		const FGlobalActorReplicationInfo& GlobalInfo = GraphGlobals->GlobalActorReplicationInfoMap->Get(Actor);
+
+		uint32 LODPeriod = 1;
+		if (!RepGraph->IsInCombat(Actor, WorldTime) && !ViewerPawns.Contains(Actor))
+		{
+			const FVector ActorLocation = Actor->GetActorLocation();
+			float ClosestDistSq = MAX_flt;
+			bool bInViewCone = false;
+
+			for (const FNetViewer& Viewer : Params.Viewers)
+			{
+				const FVector ToActor = ActorLocation - Viewer.ViewLocation;
+				const float DistSq = ToActor.SizeSquared();
+				ClosestDistSq = FMath::Min(ClosestDistSq, DistSq);
+				bInViewCone |= (DistSq >= NearDistSq && (ToActor | Viewer.ViewDir) > ViewConeCos * FMath::Sqrt(DistSq));
+			}
+
+			if (bDistanceLODEnabled && !bInViewCone && ClosestDistSq >= NearDistSq)
+			{
+				LODPeriod = (ClosestDistSq < MidDistSq) ? MidPeriod : FarPeriod;
+			}
+
+			// out of cull distance pawns aren't replicated anyway, don't spend traces on them
+			const APawn* Pawn = Cast<APawn>(Actor);
+			if (bOcclusionEnabled && Pawn && ClosestDistSq < GlobalInfo.Settings.GetCullDistanceSquared())
+			{
+				FOcclusionState& State = OcclusionStates.FindOrAdd(Actor);
+				if (WorldTime >= State.ExpireTime)
+				{
+					if (TraceBudget - NumTraces > 0)
+					{
+						State.bOccluded = IsOccludedFromViewers(Pawn, Params.Viewers, NumTraces);
+						State.ExpireTime = WorldTime + (State.bOccluded ? CVar_BaseFPSRepGraph_Occlusion_OccludedRecheckTime : CVar_BaseFPSRepGraph_Occlusion_VisibleRecheckTime);
+					}
+					else
+					{
+						// out of budget: a stale result is treated as visible until it can be checked again
+						State.bOccluded = false;
+						if (!bBudgetExhausted)
+						{
+							bBudgetExhausted = true;
+							NextOcclusionCursor = ActorIdx;
+						}
+					}
+				}
+
+				if (State.bOccluded)
+				{
+					LODPeriod = FMath::Max(LODPeriod, HeartbeatPeriod);
+					NumOccludedActors++;
+				}
+			}
+		
+		}
+
+		// never replicate faster than the class allows (see InitClassReplicationInfo)
+		FConnectionReplicationActorInfo& ConnectionActorInfo = ConnectionActorInfoMap.FindOrAdd(Actor);
+		const uint32 ReplicationPeriodFrame = FMath::Max<uint32>(GlobalInfo.Settings.ReplicationPeriodFrame, LODPeriod);
+		if (ReplicationPeriodFrame < ConnectionActorInfo.ReplicationPeriodFrame)
+		{
+			// e.g. an occluded pawn stepping into view: replicate it now rather than at the end of its heartbeat period
+			ConnectionActorInfo.NextReplicationFrameNum = FMath::Min(ConnectionActorInfo.NextReplicationFrameNum, Params.ReplicationFrameNum);
+		}
+		ConnectionActorInfo.ReplicationPeriodFrame = ReplicationPeriodFrame;
+		ConnectionActorInfo.FastPath_ReplicationPeriodFrame = LODPeriod;
+
+		NumReducedActors += (LODPeriod > 1) ? 1 : 0;
+	}
+
+	OcclusionCursor = NextOcclusionCursor;
+	RepGraph->ConsumeOcclusionTraces(Params.ReplicationFrameNum, NumTraces);
+
+	INC_DWORD_STAT_BY(STAT_BaseFPS_RepGraphDistanceLODReducedActors, NumReducedActors);
+	INC_DWORD_STAT_BY(STAT_BaseFPS_RepGraphOccludedActors, NumOccludedActors);
+	INC_DWORD_STAT_BY(STAT_BaseFPS_RepGraphOcclusionTraces, NumTraces);
+}
+
+bool UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection::IsOccludedFromViewers(const APawn* Pawn, const FNetViewerArray& Viewers, int32& InOutNumTraces) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_RepGraphOcclusionChecks);
+
+	float Radius, HalfHeight;
+	Pawn->GetSimpleCollisionCylinder(Radius, HalfHeight);
+	const FVector PawnLocation = Pawn->GetActorLocation();
+	const FVector HeadLocation = PawnLocation + FVector(0.f, 0.f, HalfHeight);
+
+	// the result is trusted until the next recheck, so sample points are pushed out by how far both sides can move until then
+	const float Lookahead = CVar_BaseFPSRepGraph_Occlusion_OccludedRecheckTime + CVar_BaseFPSRepGraph_Occlusion_Lookahead;
+	const float PawnSpeed = Pawn->GetVelocity().Size();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(RepGraphOcclusion), false, Pawn);
+	for (const FNetViewer& Viewer : Viewers)
+	{
+		const float ViewerSpeed = Viewer.ViewTarget ? Viewer.ViewTarget->GetVelocity().Size() : 0.f;
+		const float Margin = FMath::Min(Radius + (PawnSpeed + ViewerSpeed) * Lookahead, CVar_BaseFPSRepGraph_Occlusion_MaxMargin);
+		const FVector Side = FVector::CrossProduct(PawnLocation - Viewer.ViewLocation, FVector::UpVector).GetSafeNormal() * Margin;
+
+		// ordered by how likely they are to be visible, any visible point ends the check
+		const FVector SamplePoints[] =
+		{
+			HeadLocation,
+			PawnLocation,
+			PawnLocation + Side,
+			PawnLocation - Side,
+			HeadLocation + FVector(0.f, 0.f, Margin)
+		};
+
+		for (const FVector& SamplePoint : SamplePoints)
+		{
+			InOutNumTraces++;
+			if (!GetWorld()->LineTraceTestByChannel(Viewer.ViewLocation, SamplePoint, ECC_Visibility, QueryParams, WorldResponseParams))
+			{
+				return false;
+			}
+		}
+	}
+
+	return Viewers.Num() > 0;
+}
+
+void UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection::NotifyActorRemoved(const AActor* Actor)
+{
+	OcclusionStates.Remove(Actor);
+}
+
+void UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection::LogNode(FReplicationGraphDebugInfo& DebugInfo,
+	const FString& NodeName) const
+{
+	DebugInfo.Log(NodeName);
+	DebugInfo.PushIndent();
+	DebugInfo.Log(FString::Printf(TEXT("Reduced rate actors: %d"), NumReducedActors));
+	DebugInfo.Log(FString::Printf(TEXT("Occluded actors: %d"), NumOccludedActors));
+	DebugInfo.PopIndent();
 }
 
 /************************************************************************/
@@ -737,8 +1869,12 @@ UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::UBaseFPSReplicationGra
 
 void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
 {
-	const int32 ListIdx = Params.ReplicationFrameNum % ReplicationActorLists.Num();
-	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorLists[ListIdx]);
+	FBaseFPSScopedNodeGatherTimer BenchmarkTimer(this);
+
+	if (ReplicationActorList.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+	}
 
 	if (ForceNetUpdateReplicationActorList.Num() > 0)
 	{
@@ -750,29 +1886,137 @@ void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::PrepareForReplica
 {
 	QUICK_SCOPE_CYCLE_COUNTER( UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter_GlobalPrepareForReplication );
 
-	ReplicationActorLists.Reset();
-	ForceNetUpdateReplicationActorList.Reset();
+	UBaseFPSReplicationGraph* RepGraph = CastChecked<UBaseFPSReplicationGraph>(GetOuter());
+	const uint32 FrameNum = RepGraph->GetReplicationGraphFrame();
 
-	ReplicationActorLists.AddDefaulted();
-	FActorRepListRefView* CurrentList = &ReplicationActorLists[0];
+	ReplicationActorList.Reset();
+	ForceNetUpdateReplicationActorList.Reset();
 
 	// We rebuild our lists of player states each frame. This is not as efficient as it could be but its the simplest way
 	// to handle players disconnecting and keeping the lists compact. If the lists were persistent we would need to defrag them as players left.
+	TArray<APlayerState*, TInlineAllocator<64>> PlayerStates;
 	for (TActorIterator<APlayerState> It(GetWorld()); It; ++It)
 	{
 		APlayerState* PS = *It;
-		if (IsActorValidForReplicationGather(PS) == false)
+		if (IsActorValidForReplicationGather(PS))
 		{
-			continue;
+			PlayerStates.Add(PS);
 		}
+	}
+
+	const int32 NumPlayerStates = PlayerStates.Num();
+	if (NumPlayerStates == 0)
+	{
+		Snapshots.Reset();
+		LastPrepareFrame = FrameNum;
+		return;
+	}
+
+	// -----------------------------------------------
+	//	Size this frame's slice from the byte budget
+	// -----------------------------------------------
+	UpdateSaturation(RepGraph);
+
+	const float DeltaSeconds = GetWorld()->GetDeltaSeconds();
+	const float BudgetScale = 1.f - SmoothedSaturation * FMath::Clamp(CVar_BaseFPSRepGraph_PlayerStateLimiter_SaturationBackoff, 0.f, 1.f);
+	const float BudgetBytes = CVar_BaseFPSRepGraph_PlayerStateLimiter_TargetBytesPerSec * BudgetScale * DeltaSeconds;
+	SliceCarry += BudgetBytes / FMath::Max(CVar_BaseFPSRepGraph_PlayerStateLimiter_BytesPerPlayerState, 1.f);
+
+	const int32 NumSlots = FMath::Clamp(FMath::FloorToInt(SliceCarry), FMath::Max(CVar_BaseFPSRepGraph_PlayerStateLimiter_MinPerFrame, 1), NumPlayerStates);
+	SliceCarry = FMath::Clamp(SliceCarry - NumSlots, 0.f, 1.f);
+
+	// -----------------------------------------------
+	//	ForceNetUpdate and changed PlayerStates first
+	// -----------------------------------------------
+	FGlobalActorReplicationInfoMap* GlobalActorReplicationInfoMap = GraphGlobals.IsValid() ? GraphGlobals->GlobalActorReplicationInfoMap : nullptr;
+	for (APlayerState* PS : PlayerStates)
+	{
+		FPlayerStateSnapshot& Snapshot = Snapshots.FindOrAdd(PS);
+		Snapshot.LastSeenFrame = FrameNum;
 
-		if (CurrentList->Num() >= TargetActorsPerFrame)
+		const FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap ? GlobalActorReplicationInfoMap->Find(PS) : nullptr;
+		if (GlobalInfo && GlobalInfo->ForceNetUpdateFrame > LastPrepareFrame)
 		{
-			ReplicationActorLists.AddDefaulted();
-			CurrentList = &ReplicationActorLists.Last();
+			ForceNetUpdateReplicationActorList.Add(PS);
+			Snapshot.Update(PS, FrameNum);
+		}
+		else if (ReplicationActorList.Num() < NumSlots && Snapshot.HasChanged(PS))
+		{
+			ReplicationActorList.Add(PS);
+			Snapshot.Update(PS, FrameNum);
 		}
-		CurrentList->Add(PS);
 	}
+
+	// -----------------------------------------------
+	//	Fill the remaining slots round robin
+	// -----------------------------------------------
+	RoundRobinCursor = RoundRobinCursor % NumPlayerStates;
+	for (int32 Visited = 0; Visited < NumPlayerStates && ReplicationActorList.Num() < NumSlots; Visited++)
+	{
+		APlayerState* PS = PlayerStates[RoundRobinCursor];
+		RoundRobinCursor = (RoundRobinCursor + 1) % NumPlayerStates;
+
+		FPlayerStateSnapshot& Snapshot = Snapshots.FindChecked(PS);
+		if (Snapshot.LastGatheredFrame != FrameNum)
+		{
+			ReplicationActorList.Add(PS);
+			Snapshot.Update(PS, FrameNum);
+		}
+	}
+
+	// forget PlayerStates that went away
+	if (Snapshots.Num() > NumPlayerStates)
+	{
+		for (auto It = Snapshots.CreateIterator(); It; ++It)
+		{
+			if (It.Value().LastSeenFrame != FrameNum)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	LastNumSlots = NumSlots;
+	LastRefreshPeriod = (float)NumPlayerStates / NumSlots * DeltaSeconds;
+	LastPrepareFrame = FrameNum;
+
+	SET_DWORD_STAT(STAT_BaseFPS_RepGraphPlayerStatesPerFrame, ReplicationActorList.Num() + ForceNetUpdateReplicationActorList.Num());
+	SET_FLOAT_STAT(STAT_BaseFPS_RepGraphPlayerStateRefreshPeriod, LastRefreshPeriod * 1000.f);
+}
+
+void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::UpdateSaturation(UBaseFPSReplicationGraph* RepGraph)
+{
+	if (RepGraph->Connections.Num() == 0)
+	{
+		SmoothedSaturation = 0.f;
+		return;
+	}
+
+	// measured after the previous replication frame
+	int32 NumSaturated = 0;
+	for (UNetReplicationGraphConnection* ConnManager : RepGraph->Connections)
+	{
+		if (ConnManager->NetConnection && !ConnManager->NetConnection->IsNetReady(false))
+		{
+			NumSaturated++;
+		}
+	}
+
+	const float Saturation = (float)NumSaturated / RepGraph->Connections.Num();
+	SmoothedSaturation = FMath::Lerp(SmoothedSaturation, Saturation, 0.1f);
+}
+
+bool UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::FPlayerStateSnapshot::HasChanged(const APlayerState* PS) const
+{
+	return Score != PS->GetScore() || CompressedPing != PS->GetCompressedPing() || bIsSpectator != PS->IsSpectator();
+}
+
+void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::FPlayerStateSnapshot::Update(const APlayerState* PS, uint32 FrameNum)
+{
+	Score = PS->GetScore();
+	CompressedPing = PS->GetCompressedPing();
+	bIsSpectator = PS->IsSpectator();
+	LastGatheredFrame = FrameNum;
 }
 
 void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const
@@ -780,11 +2024,9 @@ void UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter::LogNode(FReplicat
 	DebugInfo.Log(NodeName);
 	DebugInfo.PushIndent();
 
-	int32 i=0;
-	for (const FActorRepListRefView& List : ReplicationActorLists)
-	{
-		LogActorRepList(DebugInfo, FString::Printf(TEXT("Bucket[%d]"), i++), List);
-	}
+	DebugInfo.Log(FString::Printf(TEXT("Slots: %d, Refresh period: %.2fs, Saturation: %.2f"), LastNumSlots, LastRefreshPeriod, SmoothedSaturation));
+	LogActorRepList(DebugInfo, TEXT("Current"), ReplicationActorList);
+	LogActorRepList(DebugInfo, TEXT("ForceNetUpdate"), ForceNetUpdateReplicationActorList);
 
 	DebugInfo.PopIndent();
 }
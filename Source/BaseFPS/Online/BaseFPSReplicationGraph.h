@@ -6,10 +6,14 @@
 #include "ReplicationGraph.h"
 #include "BaseFPSReplicationGraph.generated.h"
 
+class APawn;
 class APlayerController;
+class APlayerState;
 class ABaseFPSCharacter;
 class AWeapon;
 class AGameplayDebuggerCategoryReplicator;
+class UBaseFPSReplicationGraphBenchmark;
+class UBaseFPSReplicationGraphNode_GridSpatialization2D;
 
 DECLARE_LOG_CATEGORY_EXTERN( LogBaseFPSReplicationGraph, Display, All);
 
@@ -38,12 +42,14 @@ public:
 	UBaseFPSReplicationGraph();
 
 	virtual void ResetGameWorldState() override;
+	virtual void InitializeForWorld(UWorld* World) override;
 
 	virtual void InitGlobalActorClassSettings() override;
 	virtual void InitGlobalGraphNodes() override;
 	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager) override;
 	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
 	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
 
 	UPROPERTY()
 	TArray<UClass*> SpatializedClasses;
@@ -55,13 +61,55 @@ public:
 	TArray<UClass*> AlwaysRelevantClasses;
 
 	UPROPERTY()
-	UReplicationGraphNode_GridSpatialization2D* GridNode;
+	UBaseFPSReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	/**
+	 * finer grid for static and dormancy actors in dense areas of the map, only gathered when the map has any (see DenseCells).
+	 * Dynamic actors always stay in GridNode, since they would have to move between the grids as they cross a dense area */
+	UPROPERTY()
+	UBaseFPSReplicationGraphNode_GridSpatialization2D* FineGridNode;
 
 	UPROPERTY()
 	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
 	
 	TMap<FName, FActorRepListRefView> AlwaysRelevantStreamingLevelActors;
 
+	/** dynamic spatialized actors whose replication period is scaled by distance, per connection (see UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection) */
+	FActorRepListRefView DistanceLODActors;
+
+	/** DistanceLODActors bucketed by GridNode cell, so each connection only visits the actors within cull distance of its viewers */
+	struct FDistanceLODBuckets
+	{
+		/** the replication frame the buckets were built for */
+		uint32 FrameNum = 0;
+
+		float CellSize = 1.f;
+		FVector2D SpatialBias = FVector2D::ZeroVector;
+
+		/** largest cull distance of any bucketed actor, actors further than this from every viewer aren't replicated anyway */
+		float MaxCullDistance = 0.f;
+
+		TMap<FIntPoint, TArray<FActorRepListType>> Cells;
+
+		FIntPoint GetCell(const FVector& Location) const
+		{
+			return FIntPoint(FMath::FloorToInt((Location.X - SpatialBias.X) / CellSize), FMath::FloorToInt((Location.Y - SpatialBias.Y) / CellSize));
+		}
+	};
+
+	/** the DistanceLODActors buckets for this replication frame, built by the first connection to ask for them */
+	const FDistanceLODBuckets& GetDistanceLODBuckets(uint32 ReplicationFrameNum);
+
+	/** is the actor a character that was recently involved in combat (see BaseFPSRepGraph.DistanceLOD.CombatTimeout) */
+	bool IsInCombat(const AActor* Actor, float WorldTime) const;
+
+	void OnCharacterCombatEvent(ABaseFPSCharacter* Character);
+	void OnCharacterInventoryChanged(ABaseFPSCharacter* Character);
+
+	/** occlusion traces left in the given frame's budget (see BaseFPSRepGraph.Occlusion.MaxTracesPerFrame) */
+	int32 GetOcclusionTracesRemaining(uint32 ReplicationFrameNum);
+	void ConsumeOcclusionTraces(uint32 ReplicationFrameNum, int32 NumTraces);
+
 	void OnCharacterEquipWeapon(ABaseFPSCharacter* Character, AWeapon* NewWeapon);
 	void OnCharacterUnEquipWeapon(ABaseFPSCharacter* Character, AWeapon* OldWeapon);
 	
@@ -70,12 +118,84 @@ public:
 #endif
 
 	void PrintRepNodePolicies();
+
+	/** logs a histogram of actors per cell for both grids */
+	void LogGridHistogram();
+
+	/** dumps the class routing and class settings maps built by InitGlobalActorClassSettings (Verbose) */
+	void LogClassSettings();
+
+	/** the running load benchmark, if any (see BaseFPSRepGraph.Benchmark) */
+	UPROPERTY()
+	TObjectPtr<UBaseFPSReplicationGraphBenchmark> ActiveBenchmark;
+
+	/** [benchmark] adds to the gather time of the node's class in the current ServerReplicateActors call */
+	void RecordNodeGatherTime(const UReplicationGraphNode* Node, double Seconds);
 	
 private:
 	EClassRepNodeMapping GetMappingPolicy(UClass* Class);
 	bool IsSpatialized(EClassRepNodeMapping Mapping) const { return Mapping >= EClassRepNodeMapping::Spatialize_Static; }
 	
 	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	/** [benchmark] gather time in milliseconds by node class in the current ServerReplicateActors call, summed over all connections */
+	TMap<FName, double> BenchmarkNodeGatherMs;
+
+	FDistanceLODBuckets DistanceLODBuckets;
+
+	/** last world time each character fired or was hit */
+	TMap<const AActor*, float> LastCombatTimes;
+
+	/** occlusion traces done in OcclusionBudgetFrameNum, by all connections */
+	uint32 OcclusionBudgetFrameNum = 0;
+	int32 OcclusionTracesThisFrame = 0;
+
+	/** coarse cells (in GridNode coordinates) with enough static actors to route them to FineGridNode instead */
+	TSet<FIntPoint> DenseCells;
+
+	/** static and dormancy actors routed to FineGridNode, so they're removed from the same grid */
+	TSet<FActorRepListType> FineGridActors;
+
+	/** fits both grids to the world's bounds and static actor density, before any actor is routed */
+	void UpdateGridsForWorld(UWorld* World);
+
+	UReplicationGraphNode_GridSpatialization2D* GetGridNodeForStaticActor(const FNewReplicatedActorInfo& ActorInfo);
+};
+
+/************************************************************************/
+/* Replication Graph Node - Grid Spatialization 2D                      */
+/************************************************************************/
+
+/**
+ * The stock 2D grid with the hooks the BaseFPS graph needs: it can be switched off entirely (the fine grid on maps without
+ * dense areas) and can report how many actors each of its cells holds.
+ */
+UCLASS()
+class UBaseFPSReplicationGraphNode_GridSpatialization2D : public UReplicationGraphNode_GridSpatialization2D
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	bool bGatherEnabled = true;
+
+	/** number of actors in each allocated cell */
+	void GetCellOccupancy(TArray<int32>& OutActorsPerCell) const;
+};
+
+/************************************************************************/
+/* Replication Graph Node - Actor List                                  */
+/************************************************************************/
+
+/** The stock actor list, with its gather timed by the load benchmark like the other BaseFPS nodes (see BaseFPSRepGraph.Benchmark) */
+UCLASS()
+class UBaseFPSReplicationGraphNode_ActorList : public UReplicationGraphNode_ActorList
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
 };
 
 /************************************************************************/
@@ -100,6 +220,9 @@ public:
 
 	void ResetGameWorldState();
 
+	/** [server] rebuilds the actor list on the next gather if the character is one of this connection's pawns */
+	void NotifyInventoryChanged(const ABaseFPSCharacter* Character);
+
 #if WITH_GAMEPLAY_DEBUGGER
 	AGameplayDebuggerCategoryReplicator* GameplayDebugger = nullptr;
 #endif
@@ -107,16 +230,99 @@ public:
 private:
 	TArray<FName, TInlineAllocator<64>> AlwaysRelevantStreamingLevelsNeedingReplication;
 
+	/** viewers, view targets, pawns and their inventory. Only rebuilt when one of them changes (see NeedsRebuild) */
 	FActorRepListRefView ReplicationActorList;
 
-	UPROPERTY()
-	AActor* LastPawn = nullptr;
+	/** the connection's own PlayerStates, gathered every other frame */
+	FActorRepListRefView PlayerStateList;
+
+	/** what ReplicationActorList was last built from, per viewer. Weak, so a destroyed actor forces a rebuild instead of comparing equal to whatever reuses its address */
+	struct FCachedViewer
+	{
+		TWeakObjectPtr<AActor> InViewer;
+		TWeakObjectPtr<AActor> ViewTarget;
+		TWeakObjectPtr<APlayerController> Controller;
+		TWeakObjectPtr<APawn> Pawn;
+		TWeakObjectPtr<APlayerState> PlayerState;
+
+		/** one of the actors the list was built from was destroyed since */
+		bool IsStale() const
+		{
+			return InViewer.IsStale() || ViewTarget.IsStale() || Controller.IsStale() || Pawn.IsStale() || PlayerState.IsStale();
+		}
+	};
+	TArray<FCachedViewer, TInlineAllocator<2>> CachedViewers;
 
-	/** List of previously (or currently if nothing changed last tick) focused actor data per connection */
-	UPROPERTY()
-	TArray<FAlwaysRelevantActorInfo> PastRelevantActors;
+#if WITH_GAMEPLAY_DEBUGGER
+	TWeakObjectPtr<AGameplayDebuggerCategoryReplicator> CachedGameplayDebugger;
+#endif
+
+	/** set by events that change the list without changing the viewers (e.g. inventory) */
+	bool bActorListDirty = true;
 
-	bool bInitializedPlayerState = false;
+	bool NeedsRebuild(const FNetViewerArray& Viewers) const;
+	void RebuildActorList(const FConnectionGatherActorListParameters& Params);
+};
+
+/************************************************************************/
+/* Replication Graph Node - Distance LOD - For Connection               */
+/************************************************************************/
+
+/**
+ * Lowers the replication period of dynamic spatialized actors for a connection, in distance bands from its viewers.
+ * Actors in the viewer's view cone and characters recently involved in combat are always kept at full rate.
+ *
+ * Pawns hidden from every viewer behind world geometry drop to a heartbeat rate. Visibility checks are time-sliced
+ * across frames under a shared trace budget, and use sample points pushed out by how far the pawn and viewer can move
+ * before the next check, so pawns come back to full rate before they can become visible.
+ *
+ * This node doesn't gather any actors itself, it only adjusts the per-connection replication info. Only the actors in grid
+ * cells within cull distance of the connection's viewers are visited (see UBaseFPSReplicationGraph::FDistanceLODBuckets).
+ */
+UCLASS()
+class UBaseFPSReplicationGraphNode_DistanceLOD_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& Actor, bool bWarnIfNotFound) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override { }
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	virtual void LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const override;
+
+	/** drops any cached state for an actor leaving the graph */
+	void NotifyActorRemoved(const AActor* Actor);
+
+private:
+	/** number of actors replicating at a reduced rate as of the last update */
+	int32 NumReducedActors = 0;
+
+	/** number of pawns occluded from this connection as of the last update */
+	int32 NumOccludedActors = 0;
+
+	struct FOcclusionState
+	{
+		/** world time the result stops being trusted */
+		float ExpireTime = 0.f;
+		bool bOccluded = false;
+	};
+
+	/** cached visibility of each pawn from this connection's viewers */
+	TMap<const AActor*, FOcclusionState> OcclusionStates;
+
+	/** index into LODCandidates that occlusion checks resume from */
+	int32 OcclusionCursor = 0;
+
+	/** the DistanceLODActors in cells within cull distance of the viewers, reused between gathers */
+	TArray<FActorRepListType> LODCandidates;
+
+	/**
+	 * Traces from each viewer to a few sample points around the pawn
+	 * @return true if every sample point is blocked for every viewer */
+	bool IsOccludedFromViewers(const APawn* Pawn, const FNetViewerArray& Viewers, int32& InOutNumTraces) const;
 };
 
 /************************************************************************/
@@ -126,6 +332,10 @@ private:
 /**
  * This is a specialized node for handling PlayerState replication in a frequency limited fashion. It
  * tracks all player states but only returns a subset of them to the replication driver each frame.
+ *
+ * The subset is sized from a per-connection byte budget, scaled back while connections are saturated (see
+ * BaseFPSRepGraph.PlayerStateLimiter.*). PlayerStates whose score or ping changed since they were last returned go
+ * first, the remaining slots are filled round robin.
  */
 UCLASS()
 class UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter : public UReplicationGraphNode
@@ -141,11 +351,40 @@ class UBaseFPSReplicationGraphNode_PlayerStateFrequencyLimiter : public UReplica
 	virtual void PrepareForReplication() override;
 
 	virtual void LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const override;
-	
-	/** How many actors we want to return to the replication driver per frame, Will not surpress ForceNetUpdate. */
-	int32 TargetActorsPerFrame = 2;
 
 private:
-	TArray<FActorRepListRefView> ReplicationActorLists;
+	/** the PlayerStates returned to every connection this frame. Does not include ForceNetUpdate ones, which are never limited */
+	FActorRepListRefView ReplicationActorList;
 	FActorRepListRefView ForceNetUpdateReplicationActorList;
+
+	/** what a PlayerState looked like the last time it was returned */
+	struct FPlayerStateSnapshot
+	{
+		float Score = 0.f;
+		uint8 CompressedPing = 0;
+		bool bIsSpectator = false;
+		uint32 LastSeenFrame = 0;
+		uint32 LastGatheredFrame = 0;
+
+		bool HasChanged(const APlayerState* PS) const;
+		void Update(const APlayerState* PS, uint32 FrameNum);
+	};
+	TMap<const APlayerState*, FPlayerStateSnapshot> Snapshots;
+
+	/** next PlayerState (in iteration order) to fill a slot that isn't taken by a changed one */
+	int32 RoundRobinCursor = 0;
+
+	/** fractional slots carried over to the next frame, so small budgets still make progress */
+	float SliceCarry = 0.f;
+
+	/** smoothed fraction of connections that were saturated after the last replication frame */
+	float SmoothedSaturation = 0.f;
+
+	/** slots and effective refresh period of the last frame, for LogNode */
+	int32 LastNumSlots = 0;
+	float LastRefreshPeriod = 0.f;
+
+	uint32 LastPrepareFrame = 0;
+
+	void UpdateSaturation(UBaseFPSReplicationGraph* RepGraph);
 };
\ No newline at end of file
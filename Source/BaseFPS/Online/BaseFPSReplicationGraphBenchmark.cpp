@@ -0,0 +1,402 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Online/BaseFPSReplicationGraphBenchmark.h"
+
+#include "Character/BaseFPSCharacter.h"
+#include "Engine/NetConnection.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Online/BaseFPSReplicationGraph.h"
+#include "Pickups/PickupInstance.h"
+
+/* -------------- FAutoConsoleCommandWithWorldAndArgs -------------- */
+
+FAutoConsoleCommandWithWorldAndArgs RepGraphBenchmarkCmd(TEXT("BaseFPSRepGraph.Benchmark"),
+	TEXT("Runs the replication graph load benchmark with simulated connections. Usage: BaseFPSRepGraph.Benchmark [Connections=16] [Characters=32] [Pickups=64] [Frames=600] [Radius=10000] [PickupClass=/Game/...] [Quit=0]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UBaseFPSReplicationGraphBenchmark::FSettings Settings;
+		Settings.ParseArgs(Args);
+		UBaseFPSReplicationGraphBenchmark::Start(World, Settings);
+	})
+);
+
+// ----------------------------------------------------------------------------------------------------------
+
+namespace RepGraphBenchmark
+{
+	/** returns the given percentile (0-1) of the values */
+	double Percentile(TArray<double> Values, double Pct)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+		Values.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Pct * Values.Num()) - 1, 0, Values.Num() - 1);
+		return Values[Index];
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::FSettings::ParseArgs(const TArray<FString>& Args)
+{
+	const FString Cmd = FString::Join(Args, TEXT(" "));
+	FParse::Value(*Cmd, TEXT("Connections="), NumConnections);
+	FParse::Value(*Cmd, TEXT("Characters="), NumCharacters);
+	FParse::Value(*Cmd, TEXT("Pickups="), NumPickups);
+	FParse::Value(*Cmd, TEXT("Frames="), NumFrames);
+	FParse::Value(*Cmd, TEXT("Radius="), Radius);
+	FParse::Value(*Cmd, TEXT("PickupClass="), PickupClassPath);
+	FParse::Bool(*Cmd, TEXT("Quit="), bQuitWhenDone);
+
+	NumConnections = FMath::Max(NumConnections, 1);
+	NumCharacters = FMath::Max(NumCharacters, 0);
+	NumPickups = FMath::Max(NumPickups, 0);
+	NumFrames = FMath::Max(NumFrames, 1);
+}
+
+UBaseFPSReplicationGraphBenchmark* UBaseFPSReplicationGraphBenchmark::Start(UWorld* World, const FSettings& InSettings)
+{
+	// host the benchmark ourselves when run from a standalone game (e.g. -game -nullrhi), the graph is created with the net driver
+	if (World && World->GetNetMode() == NM_Standalone && World->GetAuthGameMode())
+	{
+		FURL ListenURL(World->URL);
+		ListenURL.AddOption(TEXT("Listen"));
+		if (!World->Listen(ListenURL))
+		{
+			UE_LOG(LogBaseFPSReplicationGraph, Error, TEXT("RepGraph benchmark: failed to listen on %s"), *World->GetName());
+			return nullptr;
+		}
+	}
+
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	UBaseFPSReplicationGraph* Graph = NetDriver ? NetDriver->GetReplicationDriver<UBaseFPSReplicationGraph>() : nullptr;
+	if (!Graph || !World->GetAuthGameMode())
+	{
+		UE_LOG(LogBaseFPSReplicationGraph, Error, TEXT("RepGraph benchmark: needs a server world running UBaseFPSReplicationGraph"));
+		return nullptr;
+	}
+
+	if (Graph->ActiveBenchmark)
+	{
+		UE_LOG(LogBaseFPSReplicationGraph, Warning, TEXT("RepGraph benchmark: a benchmark is already running"));
+		return nullptr;
+	}
+
+	UBaseFPSReplicationGraphBenchmark* Benchmark = NewObject<UBaseFPSReplicationGraphBenchmark>(Graph);
+	Benchmark->Settings = InSettings;
+	Benchmark->World = World;
+	Benchmark->RepGraph = Graph;
+
+	Benchmark->SpawnActors();
+	Benchmark->AddConnections();
+
+	Benchmark->Frames.Reserve(InSettings.NumFrames);
+	Benchmark->bRunning = true;
+	Graph->ActiveBenchmark = Benchmark;
+
+	UE_LOG(LogBaseFPSReplicationGraph, Display, TEXT("RepGraph benchmark: started with %d connections, %d characters, %d pickups for %d frames"),
+		Benchmark->Connections.Num(), Benchmark->Characters.Num(), Benchmark->SpawnedActors.Num() - Benchmark->Characters.Num(), InSettings.NumFrames);
+	return Benchmark;
+}
+
+void UBaseFPSReplicationGraphBenchmark::SpawnActors()
+{
+	UWorld* BenchmarkWorld = World.Get();
+	AGameModeBase* GameMode = BenchmarkWorld->GetAuthGameMode();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// characters start spread around their scripted path (see UpdatePaths), each with its default inventory
+	FRandomStream Stream(0x4E7B);
+	for (int32 i = 0; i < Settings.NumCharacters; i++)
+	{
+		const float Phase = Stream.FRandRange(0.f, 2.f * PI);
+		const FVector Location(FMath::Cos(Phase) * Settings.Radius, FMath::Sin(Phase) * Settings.Radius, 200.f);
+		APawn* Pawn = BenchmarkWorld->SpawnActor<APawn>(GameMode->DefaultPawnClass, Location, FRotator::ZeroRotator, SpawnParams);
+		if (!Pawn)
+		{
+			continue;
+		}
+
+		if (ABaseFPSCharacter* Character = Cast<ABaseFPSCharacter>(Pawn))
+		{
+			Character->AddDefaultInventory();
+		}
+
+		SpawnedActors.Add(Pawn);
+		Characters.Add(Pawn);
+		PathPhases.Add(Phase);
+	}
+
+	// pickups are static, scattered on a grid over the benchmark area
+	TArray<UClass*> PickupClasses;
+	if (!Settings.PickupClassPath.IsEmpty())
+	{
+		if (UClass* PickupClass = LoadClass<APickupInstance>(nullptr, *Settings.PickupClassPath))
+		{
+			PickupClasses.Add(PickupClass);
+		}
+	}
+	else
+	{
+		for (TActorIterator<APickupInstance> It(BenchmarkWorld); It; ++It)
+		{
+			PickupClasses.AddUnique(It->GetClass());
+		}
+	}
+
+	if (PickupClasses.Num() == 0 && Settings.NumPickups > 0)
+	{
+		UE_LOG(LogBaseFPSReplicationGraph, Warning, TEXT("RepGraph benchmark: no pickup class found (use PickupClass=), skipping pickups"));
+		return;
+	}
+
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)Settings.NumPickups));
+	const float Spacing = (2.f * Settings.Radius) / FMath::Max(GridSize, 1);
+	for (int32 i = 0; i < Settings.NumPickups; i++)
+	{
+		const FVector Location(-Settings.Radius + (i % GridSize + 0.5f) * Spacing, -Settings.Radius + (i / GridSize + 0.5f) * Spacing, 50.f);
+		if (AActor* Pickup = BenchmarkWorld->SpawnActor<AActor>(PickupClasses[i % PickupClasses.Num()], Location, FRotator::ZeroRotator, SpawnParams))
+		{
+			SpawnedActors.Add(Pickup);
+		}
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::AddConnections()
+{
+	UWorld* BenchmarkWorld = World.Get();
+	UNetDriver* NetDriver = BenchmarkWorld->GetNetDriver();
+	AGameModeBase* GameMode = BenchmarkWorld->GetAuthGameMode();
+
+	for (int32 i = 0; i < Settings.NumConnections; i++)
+	{
+		USimulatedClientNetConnection* Connection = NewObject<USimulatedClientNetConnection>();
+		Connection->InitConnection(NetDriver, USOCK_Open, BenchmarkWorld->URL, 1000000);
+		Connection->InitSendBuffer();
+		Connection->SetClientLoginState(EClientLoginState::Welcomed);
+		NetDriver->AddClientConnection(Connection);
+
+		// each connection views (and owns, if there are enough) one of the synthetic characters
+		APlayerController* PC = BenchmarkWorld->SpawnActor<APlayerController>(GameMode->PlayerControllerClass);
+		PC->SetReplicates(true);
+		PC->NetConnection = Connection;
+		Connection->PlayerController = PC;
+		Connection->OwningActor = PC;
+
+		if (Characters.Num() > 0)
+		{
+			APawn* ViewPawn = Characters[i % Characters.Num()];
+			if (i < Characters.Num())
+			{
+				PC->Possess(ViewPawn);
+			}
+			PC->SetViewTarget(ViewPawn);
+			Connection->ViewTarget = ViewPawn;
+		}
+
+		Connections.Add(Connection);
+		SpawnedActors.Add(PC);
+		LastConnectionBytes.Add(Connection->OutTotalBytes);
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::UpdatePaths(float DeltaTime)
+{
+	// characters run around concentric loops at different speeds, so they keep crossing grid cells and LOD bands
+	ElapsedTime += DeltaTime;
+	for (int32 i = 0; i < Characters.Num(); i++)
+	{
+		if (APawn* Pawn = Characters[i])
+		{
+			const float PathRadius = Settings.Radius * (0.25f + 0.75f * ((i % 4) + 1) / 4.f);
+			const float AngularSpeed = 600.f / PathRadius;
+			const float Angle = PathPhases[i] + ElapsedTime * AngularSpeed * ((i % 2) ? 1.f : -1.f);
+			const FVector NewLocation(FMath::Cos(Angle) * PathRadius, FMath::Sin(Angle) * PathRadius, Pawn->GetActorLocation().Z);
+			Pawn->SetActorLocationAndRotation(NewLocation, FRotator(0.f, FMath::RadiansToDegrees(Angle) + 90.f, 0.f));
+		}
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::Tick(float DeltaTime)
+{
+	UpdatePaths(DeltaTime);
+}
+
+TStatId UBaseFPSReplicationGraphBenchmark::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBaseFPSReplicationGraphBenchmark, STATGROUP_Tickables);
+}
+
+void UBaseFPSReplicationGraphBenchmark::RecordReplicateFrame(double ReplicateSeconds, const TMap<FName, double>& NodeGatherMs)
+{
+	if (!bRunning)
+	{
+		return;
+	}
+
+	if (WarmupFrames > 0)
+	{
+		WarmupFrames--;
+		for (int32 i = 0; i < Connections.Num(); i++)
+		{
+			LastConnectionBytes[i] = Connections[i]->OutTotalBytes;
+		}
+		return;
+	}
+
+	FBaseFPSRepGraphBenchmarkFrame& Frame = Frames.AddDefaulted_GetRef();
+	Frame.ReplicateMs = ReplicateSeconds * 1000.0;
+	Frame.NodeGatherMs = NodeGatherMs;
+
+	Frame.ConnectionBytes.SetNumUninitialized(Connections.Num());
+	for (int32 i = 0; i < Connections.Num(); i++)
+	{
+		const uint64 TotalBytes = Connections[i]->OutTotalBytes;
+		Frame.ConnectionBytes[i] = (uint32)(TotalBytes - LastConnectionBytes[i]);
+		LastConnectionBytes[i] = TotalBytes;
+	}
+
+	if (Frames.Num() >= Settings.NumFrames)
+	{
+		Finish();
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::Finish()
+{
+	bRunning = false;
+	WriteResults();
+	Cleanup();
+
+	if (Settings.bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UBaseFPSReplicationGraphBenchmark::WriteResults() const
+{
+	using namespace RepGraphBenchmark;
+
+	TArray<FName> NodeNames;
+	for (const FBaseFPSRepGraphBenchmarkFrame& Frame : Frames)
+	{
+		for (const TPair<FName, double>& NodeTime : Frame.NodeGatherMs)
+		{
+			NodeNames.AddUnique(NodeTime.Key);
+		}
+	}
+	NodeNames.Sort(FNameLexicalLess());
+
+	/* -------------- Per-frame results -------------- */
+	TArray<double> ReplicateMs;
+	TArray<double> BytesPerConnection;
+	TMap<FName, TArray<double>> NodeGatherMs;
+
+	FString FramesCsv = TEXT("Frame,ReplicateMs,TotalBytes,AvgBytesPerConnection,MaxBytesPerConnection");
+	for (const FName& NodeName : NodeNames)
+	{
+		FramesCsv += FString::Printf(TEXT(",Gather_%s_Ms"), *NodeName.ToString());
+	}
+	FramesCsv += LINE_TERMINATOR;
+
+	for (int32 FrameIdx = 0; FrameIdx < Frames.Num(); FrameIdx++)
+	{
+		const FBaseFPSRepGraphBenchmarkFrame& Frame = Frames[FrameIdx];
+
+		uint64 TotalBytes = 0;
+		uint32 MaxBytes = 0;
+		for (uint32 Bytes : Frame.ConnectionBytes)
+		{
+			TotalBytes += Bytes;
+			MaxBytes = FMath::Max(MaxBytes, Bytes);
+			BytesPerConnection.Add(Bytes);
+		}
+		const double AvgBytes = Frame.ConnectionBytes.Num() > 0 ? (double)TotalBytes / Frame.ConnectionBytes.Num() : 0.0;
+		ReplicateMs.Add(Frame.ReplicateMs);
+
+		FramesCsv += FString::Printf(TEXT("%d,%.4f,%llu,%.1f,%u"), FrameIdx, Frame.ReplicateMs, TotalBytes, AvgBytes, MaxBytes);
+		for (const FName& NodeName : NodeNames)
+		{
+			// nodes that didn't gather this frame (e.g. no connection had a view target) are left empty
+			if (const double* GatherMs = Frame.NodeGatherMs.Find(NodeName))
+			{
+				FramesCsv += FString::Printf(TEXT(",%.4f"), *GatherMs);
+				NodeGatherMs.FindOrAdd(NodeName).Add(*GatherMs);
+			}
+			else
+			{
+				FramesCsv += TEXT(",");
+			}
+		}
+		FramesCsv += LINE_TERMINATOR;
+	}
+
+	/* -------------- Summary -------------- */
+	FString SummaryCsv = FString::Printf(TEXT("# Connections=%d Characters=%d Actors=%d Frames=%d%s"), Connections.Num(), Characters.Num(), SpawnedActors.Num(), Frames.Num(), LINE_TERMINATOR);
+	SummaryCsv += TEXT("Metric,Avg,P50,P90,P99,Max");
+	SummaryCsv += LINE_TERMINATOR;
+
+	auto AddSummaryRow = [&SummaryCsv](const FString& Metric, const TArray<double>& Values)
+	{
+		double Sum = 0.0;
+		for (double Value : Values)
+		{
+			Sum += Value;
+		}
+		const double Avg = Values.Num() > 0 ? Sum / Values.Num() : 0.0;
+		SummaryCsv += FString::Printf(TEXT("%s,%.4f,%.4f,%.4f,%.4f,%.4f%s"), *Metric, Avg, Percentile(Values, 0.5), Percentile(Values, 0.9), Percentile(Values, 0.99), Percentile(Values, 1.0), LINE_TERMINATOR);
+	};
+
+	AddSummaryRow(TEXT("ReplicateMs"), ReplicateMs);
+	AddSummaryRow(TEXT("BytesPerConnection"), BytesPerConnection);
+	for (const FName& NodeName : NodeNames)
+	{
+		AddSummaryRow(FString::Printf(TEXT("Gather_%s_Ms"), *NodeName.ToString()), NodeGatherMs.FindRef(NodeName));
+	}
+
+	const FString OutputDir = FPaths::ProfilingDir() / TEXT("RepGraphBenchmark");
+	const FString BaseName = FString::Printf(TEXT("RepGraphBenchmark-%s"), *FDateTime::Now().ToString());
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+	FFileHelper::SaveStringToFile(FramesCsv, *(OutputDir / BaseName + TEXT("-Frames.csv")));
+	FFileHelper::SaveStringToFile(SummaryCsv, *(OutputDir / BaseName + TEXT("-Summary.csv")));
+
+	UE_LOG(LogBaseFPSReplicationGraph, Display, TEXT("RepGraph benchmark: finished, ReplicateMs p50 %.3f / p99 %.3f, results written to %s"),
+		Percentile(ReplicateMs, 0.5), Percentile(ReplicateMs, 0.99), *FPaths::ConvertRelativePathToFull(OutputDir / BaseName));
+}
+
+void UBaseFPSReplicationGraphBenchmark::Cleanup()
+{
+	if (UBaseFPSReplicationGraph* Graph = RepGraph.Get())
+	{
+		Graph->ActiveBenchmark = nullptr;
+	}
+
+	for (USimulatedClientNetConnection* Connection : Connections)
+	{
+		if (Connection)
+		{
+			Connection->CleanUp();
+		}
+	}
+	Connections.Empty();
+
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (IsValid(Actor))
+		{
+			Actor->Destroy();
+		}
+	}
+	SpawnedActors.Empty();
+	Characters.Empty();
+	PathPhases.Empty();
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "UObject/Object.h"
+#include "BaseFPSReplicationGraphBenchmark.generated.h"
+
+class UBaseFPSReplicationGraph;
+class USimulatedClientNetConnection;
+
+/** The replication graph's timings and bandwidth for a single benchmark frame */
+struct FBaseFPSRepGraphBenchmarkFrame
+{
+	/** time spent in UBaseFPSReplicationGraph::ServerReplicateActors (gather, prioritize, replicate) */
+	double ReplicateMs = 0.0;
+
+	/**
+	 * time spent in each node's GatherActorListsForConnection during ServerReplicateActors (summed over all connections),
+	 * keyed by node class. Every node the graph adds is timed, grid cells as part of their grid */
+	TMap<FName, double> NodeGatherMs;
+
+	/** bytes sent to each simulated connection since the previous frame */
+	TArray<uint32> ConnectionBytes;
+};
+
+/**
+ * Headless load benchmark for {@code UBaseFPSReplicationGraph}. Adds simulated client connections and synthetic
+ * characters (with their default inventory) and pickups to the world, moves the characters along scripted paths and
+ * records the real replication loop for a fixed number of frames. Results are written as CSV to
+ * Saved/Profiling/RepGraphBenchmark.
+ *
+ * A standalone game world is turned into a listen server first, so the benchmark hosts itself, e.g.
+ *		UnrealEditor-Cmd BaseFPS.uproject <Map> -game -nullrhi -nosound -ExecCmds="BaseFPSRepGraph.Benchmark Connections=64 Characters=64 Pickups=128 Frames=1800 Quit=1"
+ * A dedicated server (-server instead of -game) runs it as is.
+ */
+UCLASS(Transient)
+class BASEFPS_API UBaseFPSReplicationGraphBenchmark : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	struct FSettings
+	{
+		int32 NumConnections = 16;
+		int32 NumCharacters = 32;
+		int32 NumPickups = 64;
+
+		/** number of replication frames to record */
+		int32 NumFrames = 600;
+
+		/** radius of the area actors are spread over */
+		float Radius = 10000.f;
+
+		/** optional pickup instance class, otherwise the classes of the level's pickups are used */
+		FString PickupClassPath;
+
+		/** request engine exit once the results are written */
+		bool bQuitWhenDone = false;
+
+		/** parses "Key=Value" console arguments */
+		void ParseArgs(const TArray<FString>& Args);
+	};
+
+	/** starts a benchmark on the world's replication graph (listening first if the world is standalone), returns null if the world can't run one */
+	static UBaseFPSReplicationGraphBenchmark* Start(UWorld* World, const FSettings& InSettings);
+
+	/**
+	 * [rep graph] records one call to ServerReplicateActors
+	 * @param NodeGatherMs the call's gather time in milliseconds by node class */
+	void RecordReplicateFrame(double ReplicateSeconds, const TMap<FName, double>& NodeGatherMs);
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override { return bRunning; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return World.Get(); }
+	//~ End FTickableGameObject interface
+
+private:
+	FSettings Settings;
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<UBaseFPSReplicationGraph> RepGraph;
+
+	UPROPERTY()
+	TArray<USimulatedClientNetConnection*> Connections;
+
+	UPROPERTY()
+	TArray<AActor*> SpawnedActors;
+
+	/** the characters moved along scripted paths, indices match {@code PathPhases} */
+	UPROPERTY()
+	TArray<APawn*> Characters;
+
+	TArray<float> PathPhases;
+
+	/** OutTotalBytes of each connection as of the previous frame */
+	TArray<uint64> LastConnectionBytes;
+
+	TArray<FBaseFPSRepGraphBenchmarkFrame> Frames;
+
+	/** frames left to skip before recording, lets the initial replication burst settle */
+	int32 WarmupFrames = 30;
+
+	float ElapsedTime = 0.f;
+	bool bRunning = false;
+
+	void SpawnActors();
+	void AddConnections();
+	void UpdatePaths(float DeltaTime);
+
+	/** writes the results and tears down everything the benchmark created */
+	void Finish();
+	void WriteResults() const;
+	void Cleanup();
+};
@@ -0,0 +1,457 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Online/CosmeticFireRelevancySubsystem.h"
+
+#include "BaseFPS.h"
+#include "Character/BaseFPSCharacter.h"
+#include "Engine/NetSerialization.h"
+#include "Player/BaseFPSPlayerController.h"
+#include "Weapons/Weapon.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Fire: Full Detail Events"), STAT_BaseFPS_CosmeticFireFullEvents, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Fire: Reduced Rate Events"), STAT_BaseFPS_CosmeticFireReducedEvents, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Fire: Summarized Shots"), STAT_BaseFPS_CosmeticFireSummarizedShots, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Fire: Culled Events"), STAT_BaseFPS_CosmeticFireCulledEvents, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cosmetic Fire: Batches Sent"), STAT_BaseFPS_CosmeticFireBatches, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+float CVar_BaseFPS_CosmeticFire_FullDetailDist = 8000.f;
+static FAutoConsoleVariableRef CVarBaseFPSCosmeticFireFullDetailDist(TEXT("BaseFPS.CosmeticFire.FullDetailDist"), CVar_BaseFPS_CosmeticFire_FullDetailDist, TEXT("Viewers within this distance of the shooter get every shot"), ECVF_Default );
+
+float CVar_BaseFPS_CosmeticFire_ReducedDist = 15000.f;
+static FAutoConsoleVariableRef CVarBaseFPSCosmeticFireReducedDist(TEXT("BaseFPS.CosmeticFire.ReducedDist"), CVar_BaseFPS_CosmeticFire_ReducedDist, TEXT("Viewers within this distance of the shooter get shots at a reduced rate (see ReducedInterval)"), ECVF_Default );
+
+float CVar_BaseFPS_CosmeticFire_ReducedInterval = 0.1f;
+static FAutoConsoleVariableRef CVarBaseFPSCosmeticFireReducedInterval(TEXT("BaseFPS.CosmeticFire.ReducedInterval"), CVar_BaseFPS_CosmeticFire_ReducedInterval, TEXT("Seconds between the shots of a shooter sent to viewers between FullDetailDist and ReducedDist, the shots in between are dropped"), ECVF_Default );
+
+float CVar_BaseFPS_CosmeticFire_AudibleDist = 30000.f;
+static FAutoConsoleVariableRef CVarBaseFPSCosmeticFireAudibleDist(TEXT("BaseFPS.CosmeticFire.AudibleDist"), CVar_BaseFPS_CosmeticFire_AudibleDist, TEXT("Viewers within this distance of the shooter get distant gunfire summaries, viewers further away get nothing. Only used for fire modes without a FireSoundAttenuation or AudibleRange"), ECVF_Default );
+
+float CVar_BaseFPS_CosmeticFire_SummaryInterval = 0.5f;
+static FAutoConsoleVariableRef CVarBaseFPSCosmeticFireSummaryInterval(TEXT("BaseFPS.CosmeticFire.SummaryInterval"), CVar_BaseFPS_CosmeticFire_SummaryInterval, TEXT("Seconds between the distant gunfire summaries sent to a viewer, each sums up the shots beyond ReducedDist since the last one"), ECVF_Default );
+
+/************************************************************************/
+/* FFireEventBatch                                                      */
+/************************************************************************/
+
+bool FFireEventBatch::AddShot(ABaseFPSCharacter* Shooter, uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact)
+{
+	int32 ShooterIndex = Shooters.Find(Shooter);
+
+	// back to back shots without an end point only need counting
+	if (ShooterIndex != INDEX_NONE && EndPoint.IsZero() && Events.Num() > 0)
+	{
+		FBatchedFireEvent& LastEvent = Events.Last();
+		if (LastEvent.ShooterIndex == ShooterIndex && LastEvent.FireMode == FireMode && LastEvent.EndPoint.IsZero() && LastEvent.ShotCount > 0 && LastEvent.ShotCount < MAX_uint8)
+		{
+			LastEvent.ShotCount++;
+			return true;
+		}
+	}
+
+	if (Events.Num() >= MaxEvents || (ShooterIndex == INDEX_NONE && Shooters.Num() >= MaxShooters))
+	{
+		return false;
+	}
+
+	if (ShooterIndex == INDEX_NONE)
+	{
+		ShooterIndex = Shooters.Add(Shooter);
+	}
+
+	ensureMsgf(FireMode < MaxFireModes, TEXT("FFireEventBatch: fire mode %d doesn't fit, raise MaxFireModes"), FireMode);
+
+	FBatchedFireEvent& Event = Events.AddDefaulted_GetRef();
+	Event.ShooterIndex = (uint8)ShooterIndex;
+	Event.FireMode = FireMode;
+	Event.EndPoint = EndPoint;
+	Event.Impact = Impact;
+	return true;
+}
+
+bool FFireEventBatch::AddStopFiring(ABaseFPSCharacter* Shooter, uint8 FireMode)
+{
+	int32 ShooterIndex = Shooters.Find(Shooter);
+	if (Events.Num() >= MaxEvents || (ShooterIndex == INDEX_NONE && Shooters.Num() >= MaxShooters))
+	{
+		return false;
+	}
+
+	if (ShooterIndex == INDEX_NONE)
+	{
+		ShooterIndex = Shooters.Add(Shooter);
+	}
+
+	FBatchedFireEvent& Event = Events.AddDefaulted_GetRef();
+	Event.ShooterIndex = (uint8)ShooterIndex;
+	Event.FireMode = FireMode;
+	Event.ShotCount = 0;
+	return true;
+}
+
+void FFireEventBatch::Reset()
+{
+	Shooters.Reset();
+	Events.Reset();
+}
+
+static void SerializeImpact(FImpactEffectInfo& Impact, FArchive& Ar)
+{
+	uint8 bKnown = Impact.bKnown;
+	uint8 bBlockingHit = Impact.bBlockingHit;
+	Ar.SerializeBits(&bKnown, 1);
+	if (bKnown)
+	{
+		Ar.SerializeBits(&bBlockingHit, 1);
+	}
+
+	if (bKnown && bBlockingHit)
+	{
+		// a byte per component is plenty to orient a decal or particle
+		SerializeFixedVector<1, 8>(Impact.Normal, Ar);
+
+		uint32 SurfaceType = Impact.SurfaceType;
+		Ar.SerializeInt(SurfaceType, SurfaceType_Max);
+
+		uint8 bHitCharacter = Impact.bHitCharacter;
+		Ar.SerializeBits(&bHitCharacter, 1);
+
+		if (Ar.IsLoading())
+		{
+			Impact.Normal = Impact.Normal.GetSafeNormal();
+			Impact.SurfaceType = (EPhysicalSurface)SurfaceType;
+			Impact.bHitCharacter = bHitCharacter;
+		}
+	}
+	else if (Ar.IsLoading())
+	{
+		Impact = FImpactEffectInfo();
+	}
+
+	if (Ar.IsLoading())
+	{
+		Impact.bKnown = bKnown;
+		Impact.bBlockingHit = bKnown && bBlockingHit;
+	}
+}
+
+bool FFireEventBatch::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	if (Map == nullptr)
+	{
+		bOutSuccess = false;
+		return false;
+	}
+
+	bOutSuccess = true;
+
+	uint32 NumShooters = Shooters.Num();
+	Ar.SerializeInt(NumShooters, MaxShooters + 1);
+	if (Ar.IsLoading())
+	{
+		Shooters.SetNum(NumShooters);
+	}
+
+	// shooters the client doesn't know about (not relevant) come out null
+	for (TObjectPtr<ABaseFPSCharacter>& Shooter : Shooters)
+	{
+		UObject* Object = Shooter;
+		bOutSuccess &= Map->SerializeObject(Ar, ABaseFPSCharacter::StaticClass(), Object);
+		if (Ar.IsLoading())
+		{
+			Shooter = Cast<ABaseFPSCharacter>(Object);
+		}
+	}
+
+	uint32 NumEvents = Events.Num();
+	Ar.SerializeInt(NumEvents, MaxEvents + 1);
+	if (Ar.IsLoading())
+	{
+		Events.SetNum(NumEvents);
+	}
+
+	for (FBatchedFireEvent& Event : Events)
+	{
+		uint32 ShooterIndex = Event.ShooterIndex;
+		Ar.SerializeInt(ShooterIndex, FMath::Max<uint32>(NumShooters, 1));
+
+		uint32 FireMode = Event.FireMode;
+		Ar.SerializeInt(FireMode, MaxFireModes);
+
+		uint8 bHasEndPoint = !Event.EndPoint.IsZero();
+		Ar.SerializeBits(&bHasEndPoint, 1);
+		if (bHasEndPoint)
+		{
+			bOutSuccess &= SerializePackedVector<1, 20>(Event.EndPoint, Ar);
+			SerializeImpact(Event.Impact, Ar);
+		}
+
+		// anything but a single shot: several folded shots, or 0 for stop firing
+		uint8 bShotCount = Event.ShotCount != 1;
+		Ar.SerializeBits(&bShotCount, 1);
+		if (bShotCount)
+		{
+			Ar << Event.ShotCount;
+		}
+
+		if (Ar.IsLoading())
+		{
+			Event.ShooterIndex = (uint8)ShooterIndex;
+			Event.FireMode = (uint8)FireMode;
+			if (!bHasEndPoint)
+			{
+				Event.EndPoint = FVector::ZeroVector;
+				Event.Impact = FImpactEffectInfo();
+			}
+			if (!bShotCount)
+			{
+				Event.ShotCount = 1;
+			}
+		}
+	}
+
+	return true;
+}
+
+/************************************************************************/
+/* FDistantGunfire                                                      */
+/************************************************************************/
+
+bool FDistantGunfire::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// metre precision is plenty to place a distant sound, and keeps each component within 16 bits for +-327km
+	FVector Metres = Location / 100.f;
+	bOutSuccess = SerializePackedVector<1, 16>(Metres, Ar);
+	if (Ar.IsLoading())
+	{
+		Location = Metres * 100.f;
+	}
+
+	Ar << NumShots;
+	Ar << FireMode;
+	return true;
+}
+
+/************************************************************************/
+/* UCosmeticFireRelevancySubsystem                                      */
+/************************************************************************/
+
+bool UCosmeticFireRelevancySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UCosmeticFireRelevancySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// after every actor and tickable (e.g. the fire queue) has ticked, before the net driver replicates the frame
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCosmeticFireRelevancySubsystem::OnWorldPostActorTick);
+}
+
+void UCosmeticFireRelevancySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PendingEvents.Empty();
+	ConnectionStates.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UCosmeticFireRelevancySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UCosmeticFireRelevancySubsystem::AddFireEvent(ABaseFPSCharacter* Shooter, uint8 FireMode, const FVector& FlashLocation, const FImpactEffectInfo& Impact)
+{
+	if (Shooter)
+	{
+		FFireEvent& Event = PendingEvents.AddDefaulted_GetRef();
+		Event.Shooter = Shooter;
+		Event.ShooterLocation = Shooter->GetActorLocation();
+		Event.FlashLocation = FlashLocation;
+		Event.Impact = Impact;
+		Event.FireMode = FireMode;
+
+		const AWeapon* Weapon = Shooter->GetEquippedWeapon();
+		const float AudibleRange = Weapon ? Weapon->GetAudibleRange(FireMode) : 0.f;
+		Event.AudibleDistSq = FMath::Square(AudibleRange > 0.f ? AudibleRange : CVar_BaseFPS_CosmeticFire_AudibleDist);
+	}
+}
+
+void UCosmeticFireRelevancySubsystem::AddStopFiringEvent(ABaseFPSCharacter* Shooter, uint8 FireMode)
+{
+	if (Shooter)
+	{
+		FFireEvent& Event = PendingEvents.AddDefaulted_GetRef();
+		Event.Shooter = Shooter;
+		Event.ShooterLocation = Shooter->GetActorLocation();
+		Event.FireMode = FireMode;
+		Event.bStopFiring = true;
+	}
+}
+
+void UCosmeticFireRelevancySubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == GetWorld() && InWorld->GetNetMode() != NM_Client)
+	{
+		RelayPendingEvents();
+	}
+}
+
+void UCosmeticFireRelevancySubsystem::RelayPendingEvents()
+{
+	if (PendingEvents.Num() == 0 && ConnectionStates.Num() == 0)
+	{
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	const float Now = World->GetTimeSeconds();
+	const float FullDetailDistSq = FMath::Square(CVar_BaseFPS_CosmeticFire_FullDetailDist);
+	const float ReducedDistSq = FMath::Square(CVar_BaseFPS_CosmeticFire_ReducedDist);
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		// local controllers (listen server) already played the effects when the shot was fired
+		ABaseFPSPlayerController* PC = Cast<ABaseFPSPlayerController>(It->Get());
+		if (PC == nullptr || PC->IsLocalController() || PC->GetNetConnection() == nullptr)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		FConnectionState& State = ConnectionStates.FindOrAdd(PC);
+		FFireEventBatch& Batch = State.Batch;
+		auto AddToBatch = [PC, &Batch](ABaseFPSCharacter* Shooter, const FFireEvent& Event)
+		{
+			auto AddEvent = [&]()
+			{
+				return Event.bStopFiring ? Batch.AddStopFiring(Shooter, Event.FireMode) : Batch.AddShot(Shooter, Event.FireMode, Event.FlashLocation, Event.Impact);
+			};
+
+			if (!AddEvent())
+			{
+				PC->ClientFireEventBatch(Batch);
+				INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireBatches);
+				Batch.Reset();
+				AddEvent();
+			}
+		};
+
+		for (const FFireEvent& Event : PendingEvents)
+		{
+			// the shooter's own client plays its firing effects locally
+			ABaseFPSCharacter* Shooter = Event.Shooter.Get();
+			if (Shooter == nullptr || Shooter->GetController() == PC)
+			{
+				continue;
+			}
+
+			// only connections that were sent the shooter's shots have effects to stop
+			if (Event.bStopFiring)
+			{
+				if (State.FiringShooters.Remove(Event.Shooter) > 0)
+				{
+					AddToBatch(Shooter, Event);
+				}
+				continue;
+			}
+
+			const float DistSq = FVector::DistSquared(ViewLocation, Event.ShooterLocation);
+			if (DistSq <= FullDetailDistSq)
+			{
+				AddToBatch(Shooter, Event);
+				State.FiringShooters.Add(Event.Shooter);
+				INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireFullEvents);
+			}
+			else if (DistSq <= ReducedDistSq)
+			{
+				float& LastSendTime = State.LastReducedSendTimes.FindOrAdd(Event.Shooter, -BIG_NUMBER);
+				if (Now - LastSendTime >= CVar_BaseFPS_CosmeticFire_ReducedInterval)
+				{
+					LastSendTime = Now;
+					AddToBatch(Shooter, Event);
+					State.FiringShooters.Add(Event.Shooter);
+					INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireReducedEvents);
+				}
+				else
+				{
+					INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireCulledEvents);
+				}
+			}
+			else if (DistSq <= Event.AudibleDistSq)
+			{
+				FDistantGunfire& Gunfire = State.PendingGunfire.FindOrAdd(Event.Shooter);
+				Gunfire.Location = Event.ShooterLocation;
+				Gunfire.FireMode = Event.FireMode;
+				Gunfire.NumShots = (uint8)FMath::Min<int32>(Gunfire.NumShots + 1, MAX_uint8);
+				INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireSummarizedShots);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireCulledEvents);
+			}
+		}
+
+		if (!Batch.IsEmpty())
+		{
+			PC->ClientFireEventBatch(Batch);
+			INC_DWORD_STAT(STAT_BaseFPS_CosmeticFireBatches);
+			Batch.Reset();
+		}
+
+		if (State.PendingGunfire.Num() > 0 && Now >= State.NextSummaryTime)
+		{
+			TArray<FDistantGunfire> Summary;
+			State.PendingGunfire.GenerateValueArray(Summary);
+			PC->ClientDistantGunfire(Summary);
+
+			State.PendingGunfire.Reset();
+			State.NextSummaryTime = Now + CVar_BaseFPS_CosmeticFire_SummaryInterval;
+
+			// good time to forget shooters that went away
+			for (auto ShooterIt = State.LastReducedSendTimes.CreateIterator(); ShooterIt; ++ShooterIt)
+			{
+				if (!ShooterIt.Key().IsValid())
+				{
+					ShooterIt.RemoveCurrent();
+				}
+			}
+			for (auto ShooterIt = State.FiringShooters.CreateIterator(); ShooterIt; ++ShooterIt)
+			{
+				if (!ShooterIt->IsValid())
+				{
+					ShooterIt.RemoveCurrent();
+				}
+			}
+		}
+	}
+
+	PendingEvents.Reset();
+
+	// forget controllers that left
+	for (auto It = ConnectionStates.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
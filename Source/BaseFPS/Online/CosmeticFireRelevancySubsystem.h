@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Weapons/ImpactEffectInfo.h"
+#include "CosmeticFireRelevancySubsystem.generated.h"
+
+class ABaseFPSCharacter;
+class ABaseFPSPlayerController;
+
+/** One or more back to back shots of a shooter in a {@code FFireEventBatch} */
+USTRUCT()
+struct BASEFPS_API FBatchedFireEvent
+{
+	GENERATED_BODY()
+
+	/** index into the batch's Shooters */
+	UPROPERTY()
+	uint8 ShooterIndex = 0;
+
+	UPROPERTY()
+	uint8 FireMode = 0;
+
+	/** where the shot ended, zero when the hit location isn't important (e.g. projectile fire) */
+	UPROPERTY()
+	FVector EndPoint = FVector::ZeroVector;
+
+	/** shots folded into this event, only shots without an end point are folded. 0 means the shooter stopped firing */
+	UPROPERTY()
+	uint8 ShotCount = 1;
+
+	/** what the shot hit, sent with a quantized normal so clients don't trace for it (only with an end point) */
+	FImpactEffectInfo Impact;
+};
+
+/**
+ * Every shot a connection gets to see in a frame, packed into a single unreliable bunch. Shooters are sent once and
+ * referenced by index, end points are quantized like {@code FVector_NetQuantize}.
+ */
+USTRUCT()
+struct BASEFPS_API FFireEventBatch
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxShooters = 64;
+	static constexpr int32 MaxEvents = 255;
+	static constexpr int32 MaxFireModes = 4;
+
+	UPROPERTY()
+	TArray<TObjectPtr<ABaseFPSCharacter>> Shooters;
+
+	UPROPERTY()
+	TArray<FBatchedFireEvent> Events;
+
+	/** adds a shot to the batch, returns false if the batch is full */
+	bool AddShot(ABaseFPSCharacter* Shooter, uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact);
+
+	/** adds the shooter stopping firing to the batch, returns false if the batch is full */
+	bool AddStopFiring(ABaseFPSCharacter* Shooter, uint8 FireMode);
+
+	bool IsEmpty() const { return Events.Num() == 0; }
+	void Reset();
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FFireEventBatch> : public TStructOpsTypeTraitsBase2<FFireEventBatch>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/** Gunfire too far away to be shown, summed up so clients can still play a distant audio cue */
+USTRUCT()
+struct BASEFPS_API FDistantGunfire
+{
+	GENERATED_BODY()
+
+	/** where the shots came from, sent with metre precision */
+	UPROPERTY()
+	FVector Location = FVector::ZeroVector;
+
+	/** shots fired since the previous summary (saturates) */
+	UPROPERTY()
+	uint8 NumShots = 0;
+
+	UPROPERTY()
+	uint8 FireMode = 0;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FDistantGunfire> : public TStructOpsTypeTraitsBase2<FDistantGunfire>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ * [server] Relays characters' cosmetic firing info (muzzle flash, trail and impact) to each connection by how far the
+ * shot is from the connection's viewer. The character's flash properties are only replicated to replays, this is the
+ * only way other clients hear about a shot:
+ *	- within FullDetailDist, every shot
+ *	- within ReducedDist, at most one shot per shooter every ReducedInterval
+ *	- within the shot's audible range, summed into a {@code FDistantGunfire} summary sent every SummaryInterval. The
+ *	  range comes from the fire mode's sound attenuation or AudibleRange (see {@code AWeapon::GetAudibleRange}), AudibleDist
+ *	  if it has neither
+ *	- further away, nothing
+ * A shooter stopping firing is sent to the connections that were sent any of its shots, so they can stop looping effects.
+ *
+ * Shots are collected while actors tick and relayed once per frame, before the net driver replicates it, as one
+ * {@code FFireEventBatch} per connection. See BaseFPS.CosmeticFire.*
+ */
+UCLASS()
+class BASEFPS_API UCosmeticFireRelevancySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	/** [server] queues a shot's firing info to be relayed at the end of the frame */
+	void AddFireEvent(ABaseFPSCharacter* Shooter, uint8 FireMode, const FVector& FlashLocation, const FImpactEffectInfo& Impact);
+
+	/** [server] queues the shooter stopping firing, relayed to the connections that were sent any of its shots since it started */
+	void AddStopFiringEvent(ABaseFPSCharacter* Shooter, uint8 FireMode);
+
+private:
+	struct FFireEvent
+	{
+		TWeakObjectPtr<ABaseFPSCharacter> Shooter;
+		FVector ShooterLocation = FVector::ZeroVector;
+		FVector FlashLocation = FVector::ZeroVector;
+		FImpactEffectInfo Impact;
+		/** squared distance the shot can be heard from */
+		float AudibleDistSq = 0.f;
+		uint8 FireMode = 0;
+		bool bStopFiring = false;
+	};
+
+	/** shots fired this frame */
+	TArray<FFireEvent> PendingEvents;
+
+	struct FConnectionState
+	{
+		/** last time a reduced rate shot was sent, per shooter */
+		TMap<TWeakObjectPtr<ABaseFPSCharacter>, float> LastReducedSendTimes;
+
+		/** shooters whose shots were sent in a batch since they last stopped firing */
+		TSet<TWeakObjectPtr<ABaseFPSCharacter>> FiringShooters;
+
+		/** distant gunfire since the last summary, per shooter */
+		TMap<TWeakObjectPtr<ABaseFPSCharacter>, FDistantGunfire> PendingGunfire;
+
+		float NextSummaryTime = 0.f;
+
+		/** this frame's shots, only kept around to reuse its allocations */
+		FFireEventBatch Batch;
+	};
+	TMap<TWeakObjectPtr<ABaseFPSPlayerController>, FConnectionState> ConnectionStates;
+
+	FDelegateHandle PostActorTickHandle;
+
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void RelayPendingEvents();
+};
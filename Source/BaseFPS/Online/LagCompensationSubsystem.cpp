@@ -0,0 +1,341 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Online/LagCompensationSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Character/BaseFPSCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "DrawDebugHelpers.h"
+#include "GameFramework/PlayerState.h"
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_LagCompensation_Enabled = 1;
+static FAutoConsoleVariableRef CVarBaseFPSLagCompensationEnabled(TEXT("BaseFPS.LagCompensation.Enabled"), CVar_BaseFPS_LagCompensation_Enabled, TEXT("Rewinds character hitboxes to the shooter's fire time when resolving hitscan shots on the server"), ECVF_Default );
+
+float CVar_BaseFPS_LagCompensation_MaxRewindTime = 0.4f;
+static FAutoConsoleVariableRef CVarBaseFPSLagCompensationMaxRewindTime(TEXT("BaseFPS.LagCompensation.MaxRewindTime"), CVar_BaseFPS_LagCompensation_MaxRewindTime, TEXT("Max amount of time (in seconds) a shot can be rewound by"), ECVF_Default );
+
+float CVar_BaseFPS_LagCompensation_InterpDelay = 0.1f;
+static FAutoConsoleVariableRef CVarBaseFPSLagCompensationInterpDelay(TEXT("BaseFPS.LagCompensation.InterpDelay"), CVar_BaseFPS_LagCompensation_InterpDelay, TEXT("How far (in seconds) clients render remote characters behind their latest replicated pose, added to every rewind. Should match the characters' NetworkSimulatedSmoothLocationTime"), ECVF_Default );
+
+int32 CVar_BaseFPS_LagCompensation_DrawDebug = 0;
+static FAutoConsoleVariableRef CVarBaseFPSLagCompensationDrawDebug(TEXT("BaseFPS.LagCompensation.DrawDebug"), CVar_BaseFPS_LagCompensation_DrawDebug, TEXT("Draws the rewound hitboxes tested by each shot"), ECVF_Default );
+
+/* -------------- Helper functions -------------- */
+
+namespace LagCompensation
+{
+	/**
+	 * Finds where a segment first enters a vertical (Z-aligned) capsule
+	 * @param Delta End - Start of the segment
+	 * @return the entry time along the segment [0, 1], or a negative value if the segment misses
+	 */
+	float SegmentCapsuleEntryTime(const FVector& Start, const FVector& Delta, const FVector& Center, float HalfHeight, float Radius)
+	{
+		const float RadiusSquared = Radius * Radius;
+		const float CylinderHalfHeight = FMath::Max(HalfHeight - Radius, 0.f);
+
+		// already inside the capsule
+		const FVector StartToCenter = Start - Center;
+		const FVector ClosestOnAxis = FVector(0.f, 0.f, FMath::Clamp(StartToCenter.Z, -CylinderHalfHeight, CylinderHalfHeight));
+		if ((StartToCenter - ClosestOnAxis).SizeSquared() <= RadiusSquared)
+		{
+			return 0.f;
+		}
+
+		float BestTime = -1.f;
+
+		// cylinder body (only the XY components matter since the capsule is upright)
+		const double A = Delta.X * Delta.X + Delta.Y * Delta.Y;
+		if (A > UE_KINDA_SMALL_NUMBER)
+		{
+			const double B = 2.0 * (StartToCenter.X * Delta.X + StartToCenter.Y * Delta.Y);
+			const double C = StartToCenter.X * StartToCenter.X + StartToCenter.Y * StartToCenter.Y - RadiusSquared;
+			const double Discriminant = B * B - 4.0 * A * C;
+			if (Discriminant >= 0.0)
+			{
+				const double T = (-B - FMath::Sqrt(Discriminant)) / (2.0 * A);
+				const double HitZ = StartToCenter.Z + T * Delta.Z;
+				if (T >= 0.0 && T <= 1.0 && FMath::Abs(HitZ) <= CylinderHalfHeight)
+				{
+					BestTime = T;
+				}
+			}
+		}
+
+		// hemispheres, the first entry into either sphere or the cylinder is the first entry into the capsule
+		const double DeltaSizeSquared = Delta.SizeSquared();
+		if (DeltaSizeSquared > UE_KINDA_SMALL_NUMBER)
+		{
+			for (const float CapOffset : { CylinderHalfHeight, -CylinderHalfHeight })
+			{
+				const FVector StartToCap = StartToCenter - FVector(0.f, 0.f, CapOffset);
+				const double B = StartToCap | Delta;
+				const double C = StartToCap.SizeSquared() - RadiusSquared;
+				const double Discriminant = B * B - DeltaSizeSquared * C;
+				if (Discriminant >= 0.0)
+				{
+					const double T = (-B - FMath::Sqrt(Discriminant)) / DeltaSizeSquared;
+					if (T >= 0.0 && T <= 1.0 && (BestTime < 0.f || T < BestTime))
+					{
+						BestTime = T;
+					}
+				}
+			}
+		}
+		return BestTime;
+	}
+}
+
+/************************************************************************/
+/* FLagCompensationHistory                                              */
+/************************************************************************/
+
+void FLagCompensationHistory::Record(float Timestamp, const FVector& Location, float HalfHeight, float Radius)
+{
+	Head = (Head + 1) % Capacity;
+	Num = FMath::Min(Num + 1, Capacity);
+
+	Timestamps[Head] = Timestamp;
+	Locations[Head] = FVector3f(Location);
+	HalfHeights[Head] = HalfHeight;
+	Radii[Head] = Radius;
+}
+
+bool FLagCompensationHistory::GetPoseAtTime(float Time, FVector& OutLocation, float& OutHalfHeight, float& OutRadius) const
+{
+	if (Num == 0)
+	{
+		return false;
+	}
+
+	// walk backwards from the newest pose until we find the first pose recorded at or before the requested time
+	int32 NewerIdx = Head;
+	int32 OlderIdx = Head;
+	for (int32 i = 0; i < Num; ++i)
+	{
+		OlderIdx = (Head - i + Capacity) % Capacity;
+		if (Timestamps[OlderIdx] <= Time)
+		{
+			break;
+		}
+		NewerIdx = OlderIdx;
+	}
+
+	float Alpha = 0.f;
+	if (NewerIdx != OlderIdx)
+	{
+		const float Span = Timestamps[NewerIdx] - Timestamps[OlderIdx];
+		Alpha = Span > UE_KINDA_SMALL_NUMBER ? FMath::Clamp((Time - Timestamps[OlderIdx]) / Span, 0.f, 1.f) : 0.f;
+	}
+
+	OutLocation = FVector(FMath::Lerp(Locations[OlderIdx], Locations[NewerIdx], Alpha));
+	OutHalfHeight = FMath::Lerp(HalfHeights[OlderIdx], HalfHeights[NewerIdx], Alpha);
+	OutRadius = FMath::Lerp(Radii[OlderIdx], Radii[NewerIdx], Alpha);
+	return true;
+}
+
+/************************************************************************/
+/* ULagCompensationSubsystem                                            */
+/************************************************************************/
+
+bool ULagCompensationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	Characters.Empty();
+	Histories.Empty();
+
+	Super::Deinitialize();
+}
+
+bool ULagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (GetWorld()->GetNetMode() != NM_Client)
+	{
+		RecordPoses();
+	}
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+/************************************************************************/
+/* Pose History                                                         */
+/************************************************************************/
+
+void ULagCompensationSubsystem::RegisterCharacter(ABaseFPSCharacter* Character)
+{
+	if (Character && !Characters.Contains(Character))
+	{
+		Characters.Add(Character);
+		Histories.AddDefaulted();
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(ABaseFPSCharacter* Character)
+{
+	const int32 Index = Characters.IndexOfByKey(Character);
+	if (Index > INDEX_NONE)
+	{
+		Characters.RemoveAtSwap(Index, 1, false);
+		Histories.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+void ULagCompensationSubsystem::RecordPoses()
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_LagCompensation_RecordPoses);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 i = Characters.Num() - 1; i >= 0; --i)
+	{
+		const ABaseFPSCharacter* Character = Characters[i].Get();
+		if (!Character)
+		{
+			Characters.RemoveAtSwap(i, 1, false);
+			Histories.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		Histories[i].Record(Now, Capsule->GetComponentLocation(), Capsule->GetScaledCapsuleHalfHeight(), Capsule->GetScaledCapsuleRadius());
+	}
+}
+
+/************************************************************************/
+/* Rewind                                                               */
+/************************************************************************/
+
+bool ULagCompensationSubsystem::IsEnabled()
+{
+	return CVar_BaseFPS_LagCompensation_Enabled > 0;
+}
+
+float ULagCompensationSubsystem::GetRewindTime(const APawn* Shooter, float ClientShotTime, float ShotTime) const
+{
+	// ExactPing is the round trip time in milliseconds, poses only travel one way
+	const APlayerState* PlayerState = Shooter ? Shooter->GetPlayerState() : nullptr;
+	const float OneWayLatency = PlayerState ? PlayerState->ExactPing * 0.0005f : 0.f;
+
+	const float RewindTime = ClientShotTime - OneWayLatency - CVar_BaseFPS_LagCompensation_InterpDelay;
+	return FMath::Clamp(RewindTime, ShotTime - CVar_BaseFPS_LagCompensation_MaxRewindTime, ShotTime);
+}
+
+bool ULagCompensationSubsystem::RewindTrace(const AActor* Shooter, float RewindTime, const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	QUICK_SCOPE_CYCLE_COUNTER(STAT_LagCompensation_RewindTrace);
+
+	TArray<FLagCompensationHitbox> Hitboxes;
+	GatherHitboxes(Shooter, RewindTime, Hitboxes);
+
+	float HitTime;
+	const int32 HitIdx = TraceHitboxes(Hitboxes, Start, End, HitTime);
+	return HitIdx != INDEX_NONE && MakeHitboxHit(Hitboxes[HitIdx], Start, End, HitTime, OutHit);
+}
+
+void ULagCompensationSubsystem::GatherHitboxes(const AActor* Shooter, float RewindTime, TArray<FLagCompensationHitbox>& OutHitboxes) const
+{
+	check(IsInGameThread());
+
+	for (int32 i = 0; i < Characters.Num(); ++i)
+	{
+		ABaseFPSCharacter* Character = Characters[i].Get();
+		if (!Character || Character == Shooter || Character->IsDead())
+		{
+			continue;
+		}
+
+		FLagCompensationHitbox Hitbox;
+		if (Histories[i].GetPoseAtTime(RewindTime, Hitbox.Location, Hitbox.HalfHeight, Hitbox.Radius))
+		{
+			Hitbox.Character = Character;
+			OutHitboxes.Add(Hitbox);
+
+			if (CVar_BaseFPS_LagCompensation_DrawDebug > 0)
+			{
+				DrawDebugCapsule(GetWorld(), Hitbox.Location, Hitbox.HalfHeight, Hitbox.Radius, FQuat::Identity, FColor::Yellow, false, 2.f);
+			}
+		}
+	}
+}
+
+int32 ULagCompensationSubsystem::TraceHitboxes(TConstArrayView<FLagCompensationHitbox> Hitboxes, const FVector& Start, const FVector& End, float& OutHitTime)
+{
+	const FVector Delta = End - Start;
+
+	int32 BestIdx = INDEX_NONE;
+	OutHitTime = 1.f;
+	for (int32 i = 0; i < Hitboxes.Num(); ++i)
+	{
+		const FLagCompensationHitbox& Hitbox = Hitboxes[i];
+
+		// cheap bounding sphere rejection before the exact capsule test
+		if (FMath::PointDistToSegmentSquared(Hitbox.Location, Start, End) > FMath::Square(Hitbox.HalfHeight + Hitbox.Radius))
+		{
+			continue;
+		}
+
+		const float EntryTime = LagCompensation::SegmentCapsuleEntryTime(Start, Delta, Hitbox.Location, Hitbox.HalfHeight, Hitbox.Radius);
+		if (EntryTime >= 0.f && EntryTime <= OutHitTime)
+		{
+			BestIdx = i;
+			OutHitTime = EntryTime;
+		}
+	}
+	return BestIdx;
+}
+
+bool ULagCompensationSubsystem::MakeHitboxHit(const FLagCompensationHitbox& Hitbox, const FVector& Start, const FVector& End, float HitTime, FHitResult& OutHit) const
+{
+	check(IsInGameThread());
+
+	ABaseFPSCharacter* HitCharacter = Hitbox.Character.Get();
+	if (!HitCharacter)
+	{
+		return false;
+	}
+
+	const FVector Delta = End - Start;
+	const FVector HitLocation = Start + Delta * HitTime;
+	const float CylinderHalfHeight = FMath::Max(Hitbox.HalfHeight - Hitbox.Radius, 0.f);
+	const FVector ClosestOnAxis = Hitbox.Location + FVector(0.f, 0.f, FMath::Clamp(HitLocation.Z - Hitbox.Location.Z, -CylinderHalfHeight, CylinderHalfHeight));
+	const FVector HitNormal = (HitLocation - ClosestOnAxis).GetSafeNormal();
+
+	OutHit = FHitResult(HitCharacter, HitCharacter->GetCapsuleComponent(), HitLocation, HitNormal);
+	OutHit.bBlockingHit = true;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.Time = HitTime;
+	OutHit.Distance = Delta.Size() * HitTime;
+
+	if (CVar_BaseFPS_LagCompensation_DrawDebug > 0)
+	{
+		DrawDebugCapsule(GetWorld(), Hitbox.Location, Hitbox.HalfHeight, Hitbox.Radius, FQuat::Identity, FColor::Red, false, 2.f);
+	}
+	return true;
+}
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ABaseFPSCharacter;
+class APawn;
+
+/**
+ * Fixed-size ring buffer of a single character's hitbox (capsule) poses, stored as a structure of arrays.
+ * A rewind only scans the timestamps until it brackets the requested time, then reads exactly two poses.
+ */
+struct FLagCompensationHistory
+{
+	/** number of poses kept per character, ~0.5 seconds of history at a 60Hz server tick */
+	static constexpr int32 Capacity = 32;
+
+	/** server world time each pose was recorded at */
+	float Timestamps[Capacity];
+
+	/** capsule center */
+	FVector3f Locations[Capacity];
+
+	/** capsule half height, including the hemispheres (changes when crouching) */
+	float HalfHeights[Capacity];
+
+	/** capsule radius */
+	float Radii[Capacity];
+
+	/** index of the most recently recorded pose */
+	int32 Head = INDEX_NONE;
+
+	/** number of valid poses in the buffer */
+	int32 Num = 0;
+
+	/** overwrites the oldest pose with a new one */
+	void Record(float Timestamp, const FVector& Location, float HalfHeight, float Radius);
+
+	/**
+	 * Finds the pose at the given time, interpolating between the two recorded poses that bracket it
+	 * (times outside of the recorded history are clamped to the oldest/newest pose)
+	 * @return false if no poses have been recorded yet */
+	bool GetPoseAtTime(float Time, FVector& OutLocation, float& OutHalfHeight, float& OutRadius) const;
+
+	void Reset()
+	{
+		Head = INDEX_NONE;
+		Num = 0;
+	}
+};
+
+/** A character's hitbox (capsule) as it was at a rewind time, gathered on the game thread so worker threads can test against it */
+struct FLagCompensationHitbox
+{
+	TWeakObjectPtr<ABaseFPSCharacter> Character;
+
+	FVector Location = FVector::ZeroVector;
+	float HalfHeight = 0.f;
+	float Radius = 0.f;
+};
+
+/**
+ * Server-side lag compensation. Records the capsule pose of every {@code ABaseFPSCharacter} at the end of each
+ * server tick, allowing weapons to test their shots against where targets were when the shooter fired.
+ *
+ * Rewound hit tests are done analytically against the recorded capsules, actors are never moved in the physics scene.
+ */
+UCLASS()
+class BASEFPS_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/************************************************************************/
+	/* Pose History                                                         */
+	/************************************************************************/
+public:
+	/** [server] starts recording the character's pose history */
+	void RegisterCharacter(ABaseFPSCharacter* Character);
+
+	/** [server] stops recording the character's pose history */
+	void UnregisterCharacter(ABaseFPSCharacter* Character);
+
+private:
+	/** the tracked characters, indices match {@code Histories} */
+	TArray<TWeakObjectPtr<ABaseFPSCharacter>> Characters;
+
+	/** the pose history for each tracked character */
+	TArray<FLagCompensationHistory> Histories;
+
+	/** records the current pose of every tracked character */
+	void RecordPoses();
+
+	/************************************************************************/
+	/* Rewind                                                               */
+	/************************************************************************/
+public:
+	/** is lag compensation currently enabled (see BaseFPS.LagCompensation.Enabled) */
+	static bool IsEnabled();
+
+	/**
+	 * [server] converts a client's shot timestamp into the server time the shooter actually saw its targets at: the
+	 * replicated poses were already one-way latency old when they arrived, and are rendered a further interpolation
+	 * delay behind (see BaseFPS.LagCompensation.InterpDelay)
+	 * @param Shooter the pawn firing the shot, its player state's ping gives the latency
+	 * @param ClientShotTime the server world time (as estimated by the client) at which the client fired the shot
+	 * @param ShotTime the server world time the shot is being fired at on the server
+	 * @return the server world time to test character hitboxes at, no more than BaseFPS.LagCompensation.MaxRewindTime before ShotTime */
+	float GetRewindTime(const APawn* Shooter, float ClientShotTime, float ShotTime) const;
+
+	/**
+	 * [server] tests a segment against the hitboxes of all tracked characters as they were at RewindTime.
+	 * @param Shooter the character firing the shot (ignored by the test)
+	 * @param RewindTime the server world time to test the character poses at
+	 * @param OutHit filled with the closest character hit, left untouched on a miss
+	 * @return true if a character was hit
+	 * NOTE: game thread only, batched shots gather their hitboxes up front and test them with {@code TraceHitboxes} */
+	bool RewindTrace(const AActor* Shooter, float RewindTime, const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	/**
+	 * [server] appends the hitboxes of all living tracked characters as they were at RewindTime
+	 * @param Shooter the character firing the shot (left out)
+	 * NOTE: game thread only */
+	void GatherHitboxes(const AActor* Shooter, float RewindTime, TArray<FLagCompensationHitbox>& OutHitboxes) const;
+
+	/**
+	 * tests a segment against already gathered hitboxes, pure math so it is safe to call from worker threads
+	 * @param OutHitTime the closest entry time along the segment [0, 1]
+	 * @return the index of the closest hitbox hit, INDEX_NONE on a miss */
+	static int32 TraceHitboxes(TConstArrayView<FLagCompensationHitbox> Hitboxes, const FVector& Start, const FVector& End, float& OutHitTime);
+
+	/**
+	 * [server] fills a hit result for a hitbox found by {@code TraceHitboxes}
+	 * @return false if the hitbox's character is gone
+	 * NOTE: game thread only */
+	bool MakeHitboxHit(const FLagCompensationHitbox& Hitbox, const FVector& Start, const FVector& End, float HitTime, FHitResult& OutHit) const;
+};
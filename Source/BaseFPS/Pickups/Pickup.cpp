@@ -5,6 +5,7 @@
 
 #include "BaseFPS.h"
 #include "PickupInstance.h"
+#include "System/ActorPoolSubsystem.h"
 
 // Sets default values
 APickup::APickup(const FObjectInitializer& ObjectInitializer)
@@ -52,7 +53,7 @@ void APickup::Activate()
 		}
 		else
 		{
-			GetWorldTimerManager().SetTimer(RespawnTimerHandle, this, &APickup::SpawnPickup, RespawnTime, false);
+			ScheduleRespawn();
 		}
 	}
 	else
@@ -65,22 +66,35 @@ void APickup::Activate()
 void APickup::Deactivate()
 {
 	bIsActive = false;
-	GetWorldTimerManager().ClearTimer(RespawnTimerHandle);
+	if (UPickupSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UPickupSchedulerSubsystem>())
+	{
+		Scheduler->Cancel(RespawnHandle);
+	}
+}
+
+void APickup::ScheduleRespawn()
+{
+	if (UPickupSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UPickupSchedulerSubsystem>())
+	{
+		Scheduler->Cancel(RespawnHandle);
+		RespawnHandle = Scheduler->Schedule(RespawnTime, FSimpleDelegate::CreateUObject(this, &APickup::SpawnPickup), this);
+	}
 }
 
 void APickup::SpawnPickup()
 {
+	RespawnHandle.Invalidate();
 	if (HasAuthority() && bIsActive && PickupType)
 	{
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Owner = this;
 		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		if (APickupInstance* Pickup = GetWorld()->SpawnActor<APickupInstance>(PickupType, GetActorLocation(), GetActorRotation(), SpawnParams))
+		if (APickupInstance* Pickup = UActorPoolSubsystem::AcquireActor<APickupInstance>(GetWorld(), PickupType, FTransform(GetActorRotation(), GetActorLocation()), SpawnParams))
 		{
 			Pickup->SetOwner(this);
 			if (bIsRespawning)
 			{
-				Pickup->OnDestroyed.AddDynamic(this, &APickup::APickup::OnPickupDestroyed);
+				Pickup->OnDespawned.AddUObject(this, &APickup::OnPickupDespawned);
 			}
 			else
 			{
@@ -90,11 +104,11 @@ void APickup::SpawnPickup()
 	}
 }
 
-void APickup::OnPickupDestroyed(AActor* DestroyedPickup)
+void APickup::OnPickupDespawned(APickupInstance* DespawnedPickup)
 {
 	if (bIsActive)
 	{
-		GetWorldTimerManager().SetTimer(RespawnTimerHandle, this, &APickup::SpawnPickup, RespawnTime, false);
+		ScheduleRespawn();
 	}
 }
 
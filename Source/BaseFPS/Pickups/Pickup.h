@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Pickups/PickupSchedulerSubsystem.h"
 #include "Pickup.generated.h"
 
 class USphereComponent;
@@ -51,8 +52,8 @@ protected:
 	UPROPERTY(Transient)
 	float RespawnTime;
 
-	/** handle used to track respawn timer */
-	FTimerHandle RespawnTimerHandle;
+	/** handle used to track the respawn deadline, see {@code UPickupSchedulerSubsystem} */
+	FPickupScheduleHandle RespawnHandle;
 	
 	/** use this actor's default respawn time (true), or use the pickup instance's respawn time (false)? */
 	UPROPERTY(EditInstanceOnly, Category="Pickup")
@@ -66,12 +67,16 @@ public:
 	void Activate();
 	void Deactivate();
 
+protected:
+	/** schedules the next {@code SpawnPickup} in RespawnTime seconds, replacing any pending respawn */
+	void ScheduleRespawn();
+
+public:
 	UFUNCTION()
 	void SpawnPickup();
 
 	/** handles clean up and sets time to respawn another item if active */
-	UFUNCTION()
-	void OnPickupDestroyed(AActor* DestroyedPickup);
+	void OnPickupDespawned(APickupInstance* DespawnedPickup);
 
 	/************************************************************************/
 	/* Visuals                                                              */
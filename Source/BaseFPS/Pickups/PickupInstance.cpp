@@ -7,6 +7,11 @@
 #include "Character/BaseFPSCharacter.h"
 #include "Components/InteractableComponent.h"
 #include "Components/SphereComponent.h"
+#include "Pickups/PickupRenderSubsystem.h"
+#include "System/ActorPoolSubsystem.h"
+
+int32 CVar_BaseFPS_Pickups_NetDormancy = 1;
+static FAutoConsoleVariableRef CVarBaseFPSPickupsNetDormancy(TEXT("BaseFPS.Pickups.NetDormancy"), CVar_BaseFPS_Pickups_NetDormancy, TEXT("Pickups go net dormant after their initial replication and only wake up when interacted with. Applies to newly spawned pickups"), ECVF_Default );
 
 // Sets default values
 APickupInstance::APickupInstance(const FObjectInitializer& ObjectInitializer)
@@ -15,6 +20,7 @@ APickupInstance::APickupInstance(const FObjectInitializer& ObjectInitializer)
 	PrimaryActorTick.bStartWithTickEnabled = false;
 	PrimaryActorTick.bCanEverTick = false;
 	bReplicates = true;
+	NetDormancy = DORM_DormantAll;
 	
 	InteractCollision = ObjectInitializer.CreateDefaultSubobject<USphereComponent>(this, TEXT("Collision"));
 	InteractCollision->SetComponentTickEnabled(false);
@@ -33,6 +39,10 @@ APickupInstance::APickupInstance(const FObjectInitializer& ObjectInitializer)
 	InteractableComponent->SetInteractableHoldTime(0.4f);
 	InteractableComponent->SetInteractableDistance(1600.0f);
 	InteractableComponent->SetInteractableVerbText(FText::FromString("Pickup"));
+
+	bIdleAnimationInMaterial = false;
+	IdleSpinRate = 90.f;
+	IdleBobHeight = 8.f;
 }
 
 void APickupInstance::PostInitializeComponents()
@@ -45,9 +55,53 @@ void APickupInstance::PostInitializeComponents()
 void APickupInstance::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if (HasAuthority() && CVar_BaseFPS_Pickups_NetDormancy == 0)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+	
+	OnPickupSpawned();
+}
+
+void APickupInstance::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UPickupRenderSubsystem* PickupRender = GetWorld()->GetSubsystem<UPickupRenderSubsystem>())
+	{
+		PickupRender->UnregisterPickup(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void APickupInstance::OnPickupSpawned()
+{
+	if (UPickupRenderSubsystem* PickupRender = GetWorld()->GetSubsystem<UPickupRenderSubsystem>())
+	{
+		PickupRender->RegisterPickup(this);
+	}
 	PlayEffectsOnSpawn();
 }
 
+void APickupInstance::OnAcquiredFromPool()
+{
+	OnPickupSpawned();
+}
+
+void APickupInstance::OnReleasedToPool()
+{
+	if (UPickupRenderSubsystem* PickupRender = GetWorld()->GetSubsystem<UPickupRenderSubsystem>())
+	{
+		PickupRender->UnregisterPickup(this);
+	}
+	OnDespawned.Clear();
+}
+
+void APickupInstance::Despawn()
+{
+	OnDespawned.Broadcast(this);
+	UActorPoolSubsystem::ReleaseActor(this);
+}
+
 /************************************************************************/
 /* Properties                                                           */
 /************************************************************************/
@@ -87,7 +141,7 @@ void APickupInstance::OnInteract(ABaseFPSCharacter* Character)
 	{
 		GiveTo(Character);
 		PlayEffectsOnGiveTo();
-		Destroy();
+		Despawn();
 	}
 }
 
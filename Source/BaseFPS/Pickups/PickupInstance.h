@@ -4,19 +4,29 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "System/PoolableActor.h"
 #include "PickupInstance.generated.h"
 
 class ABaseFPSCharacter;
+class APickupInstance;
 class UInteractableComponent;
 class USphereComponent;
 
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPickupDespawned, APickupInstance* /* Pickup */);
+
 /**
  * This is the pickup object that is spawned in the game world by the {@see Pickup} class. These
  * are what players will see and interact with in-game. We're using spawned instances (instead of
  * a persistent class) because it provides the flexibility of movable pickups, e.g. physics-based pickups
+ *
+ * Nothing replicated changes on a pickup once it's spawned, so pickups are net dormant after their initial
+ * replication and are only flushed when they're taken, respawned or expire.
+ *
+ * Pickups leave the world through Despawn() rather than Destroy(), which pools them in standalone games and destroys
+ * them otherwise (see {@code UActorPoolSubsystem}).
  */
 UCLASS(Abstract, NotBlueprintable, NotPlaceable)
-class BASEFPS_API APickupInstance : public AActor
+class BASEFPS_API APickupInstance : public AActor, public IPoolableActor
 {
 	GENERATED_BODY()
 	
@@ -31,6 +41,24 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the actor leaves the world (clients' pickups go with their channel, they aren't pooled)
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** called when the pickup enters the world, either freshly spawned or handed out again by the pool */
+	virtual void OnPickupSpawned();
+
+public:
+	//~ Begin IPoolableActor interface
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+	//~ End IPoolableActor interface
+
+	/** [server] broadcast when the pickup is taken or expires, just before it goes back into the pool */
+	FOnPickupDespawned OnDespawned;
+
+	/** [server] takes the pickup out of the world */
+	void Despawn();
+
 	/************************************************************************/
 	/* Properties                                                           */
 	/************************************************************************/
@@ -51,6 +79,26 @@ public:
 	/** plays effects on spawn */
 	virtual void PlayEffectsOnSpawn();
 
+protected:
+	/**
+	 * the mesh's materials play the idle animation from the instance's custom data (see {@code UPickupRenderSubsystem}),
+	 * so the pickup may be drawn as an instance even though it animates itself (e.g. with a rotating movement or timeline) */
+	UPROPERTY(EditDefaultsOnly, Category="Pickup")
+	bool bIdleAnimationInMaterial;
+
+	/** idle spin, in degrees per second, passed to the material while the pickup is drawn as an instance */
+	UPROPERTY(EditDefaultsOnly, Category="Pickup", meta=(EditCondition="bIdleAnimationInMaterial"))
+	float IdleSpinRate;
+
+	/** idle bob height, in cm, passed to the material while the pickup is drawn as an instance */
+	UPROPERTY(EditDefaultsOnly, Category="Pickup", meta=(EditCondition="bIdleAnimationInMaterial"))
+	float IdleBobHeight;
+
+public:
+	bool HasIdleAnimationInMaterial() const { return bIdleAnimationInMaterial; }
+	float GetIdleSpinRate() const { return IdleSpinRate; }
+	float GetIdleBobHeight() const { return IdleBobHeight; }
+
 public:
 	/** the template used to create the editor mesh for {@code Pickup} actor */
 	UFUNCTION(BlueprintPure, Category="Pickup")
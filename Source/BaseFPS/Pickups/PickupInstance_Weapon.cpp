@@ -5,6 +5,7 @@
 
 #include "Components/InteractableComponent.h"
 #include "Components/SphereComponent.h"
+#include "System/ActorPoolSubsystem.h"
 #include "Weapons/Weapon.h"
 
 APickupInstance_Weapon::APickupInstance_Weapon(const FObjectInitializer& ObjectInitializer)
@@ -29,9 +30,9 @@ APickupInstance_Weapon::APickupInstance_Weapon(const FObjectInitializer& ObjectI
 	DroppedPickupLifetime = 30.f;
 }
 
-void APickupInstance_Weapon::BeginPlay()
+void APickupInstance_Weapon::OnPickupSpawned()
 {
-	Super::BeginPlay();
+	Super::OnPickupSpawned();
 	
 	// check for potentially overlapping pawns on spawn
 	if (HasAuthority())
@@ -43,9 +44,11 @@ void APickupInstance_Weapon::BeginPlay()
 			OnOverlap(CastChecked<ABaseFPSCharacter>(OverlappingPawn));
 		}
 
-		if (bIsDropped)
+		UPickupSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UPickupSchedulerSubsystem>();
+		if (bIsDropped && Scheduler)
 		{
-			GetWorldTimerManager().SetTimer(DroppedTimerHandle, this, &APickupInstance_Weapon::OnDroppedPickupLifetimeExpired, DroppedPickupLifetime, false);
+			Scheduler->Cancel(DroppedExpiryHandle);
+			DroppedExpiryHandle = Scheduler->Schedule(DroppedPickupLifetime, FSimpleDelegate::CreateUObject(this, &APickupInstance_Weapon::OnDroppedPickupLifetimeExpired), this);
 		}
 	}
 }
@@ -53,9 +56,26 @@ void APickupInstance_Weapon::BeginPlay()
 void APickupInstance_Weapon::Destroyed()
 {
 	GetWorldTimerManager().ClearAllTimersForObject(this);
+	if (UPickupSchedulerSubsystem* Scheduler = GetWorld() ? GetWorld()->GetSubsystem<UPickupSchedulerSubsystem>() : nullptr)
+	{
+		Scheduler->Cancel(DroppedExpiryHandle);
+	}
 	Super::Destroyed();
 }
 
+void APickupInstance_Weapon::OnReleasedToPool()
+{
+	Super::OnReleasedToPool();
+	// picked up before it expired, don't let the expiry fire on this actor's next use
+	if (UPickupSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UPickupSchedulerSubsystem>())
+	{
+		Scheduler->Cancel(DroppedExpiryHandle);
+	}
+	bIsDropped = false;
+	DroppedWeapon = nullptr;
+	DroppedAmmoAmount = 0;
+}
+
 /************************************************************************/
 /* Editor Only                                                          */
 /************************************************************************/
@@ -99,25 +119,33 @@ void APickupInstance_Weapon::GiveTo(ABaseFPSCharacter* Character)
 	
 	if (Character)
 	{
-		if (AInventory* Inv = Character->GetInventoryOfType(WeaponType))
+		if (Character->AddReserveAmmo(WeaponType, 30))
 		{
-			Cast<AWeapon>(Inv)->AddAmmoToReserve(30);
 			return;
 		}
 		
-		AWeapon* InvToAdd = ( DroppedWeapon != nullptr ) ? DroppedWeapon :
-			GetWorld()->SpawnActor<AWeapon>(WeaponType, FVector::ZeroVector, FRotator::ZeroRotator);
-		
 		if (!Character->IsInventoryFull())
 		{
-			if (!Character->AddInventory(InvToAdd, true)) // if not successful
+			// a new weapon goes in stowed, a dropped one keeps its actor (and ammo) until it's stowed
+			if (DroppedWeapon == nullptr)
 			{
-				UE_LOG(LogTemp, Warning, TEXT("Failed to give pickup item (%s) to character (%s)"), *InvToAdd->GetName(), *Character->GetName());
-				InvToAdd->Destroy();
+				if (Character->CreateInventory(WeaponType) == INDEX_NONE)
+				{
+					UE_LOG(LogTemp, Warning, TEXT("Failed to give pickup item (%s) to character (%s)"), *GetNameSafe(WeaponType), *Character->GetName());
+				}
+			}
+			else if (!Character->AddInventory(DroppedWeapon, true)) // if not successful
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Failed to give pickup item (%s) to character (%s)"), *DroppedWeapon->GetName(), *Character->GetName());
+				UActorPoolSubsystem::ReleaseActor(DroppedWeapon);
 			}
 			return;
 		}
 
+		// replacing the equipped weapon, so the new one needs its actor right away
+		AWeapon* InvToAdd = ( DroppedWeapon != nullptr ) ? DroppedWeapon :
+			UActorPoolSubsystem::AcquireActor<AWeapon>(GetWorld(), WeaponType, FTransform::Identity);
+
 		// if we're here, then the character's inventory is full. Force character to swap equipped with pickup
 		if (AWeapon* Equipped = Character->GetEquippedWeapon())
 		{
@@ -128,7 +156,7 @@ void APickupInstance_Weapon::GiveTo(ABaseFPSCharacter* Character)
 			else
 			{
 				UE_LOG(LogTemp, Warning, TEXT("Failed to give pickup item (%s) to character (%s)"), *InvToAdd->GetName(), *Character->GetName());
-				InvToAdd->Destroy();
+				UActorPoolSubsystem::ReleaseActor(InvToAdd);
 			}
 		}
 	}
@@ -150,14 +178,15 @@ void APickupInstance_Weapon::SetDroppedWeapon(AWeapon* WeaponToDrop)
 
 void APickupInstance_Weapon::OnDroppedPickupLifetimeExpired()
 {
+	DroppedExpiryHandle.Invalidate();
 	if (HasAuthority())
 	{
 		if (DroppedWeapon)
 		{
 			UE_LOG(LogTemp, Error, TEXT("OnDropppedPickupLifetimeExpired!!!!!! (Weapon=%s)"), *DroppedWeapon->GetName());
-			DroppedWeapon->Destroy();
+			UActorPoolSubsystem::ReleaseActor(DroppedWeapon);
 		}
-		Destroy();
+		Despawn();
 	}
 }
 
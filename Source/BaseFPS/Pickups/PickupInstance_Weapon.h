@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Pickups/PickupInstance.h"
+#include "Pickups/PickupSchedulerSubsystem.h"
 #include "PickupInstance_Weapon.generated.h"
 
 class AWeapon;
@@ -23,9 +24,19 @@ public:
 
 protected:
 	//~Begin AActor interface
-	virtual void BeginPlay() override;
 	virtual void Destroyed() override;
 	//~End AActor interface
+
+	//~ Begin APickupInstance interface
+	virtual void OnPickupSpawned() override;
+	//~ End APickupInstance interface
+
+public:
+	//~ Begin IPoolableActor interface
+	virtual void OnReleasedToPool() override;
+	//~ End IPoolableActor interface
+
+protected:
 	
 	/************************************************************************/
 	/* Editor Only                                                          */
@@ -66,8 +77,8 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category="DroppedPickup")
 	float DroppedPickupLifetime;
 	
-	/** handle for tracking dropped weapon timer */
-	FTimerHandle DroppedTimerHandle;
+	/** handle for tracking the dropped pickup's expiry, see {@code UPickupSchedulerSubsystem} */
+	FPickupScheduleHandle DroppedExpiryHandle;
 	
 public:
 	/** sets flag that this dropped weapon pickup and sets necessary pointers/data */
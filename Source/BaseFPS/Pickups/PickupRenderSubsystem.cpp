@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pickups/PickupRenderSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/TimelineComponent.h"
+#include "GameFramework/MovementComponent.h"
+#include "Pickups/PickupInstance.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Render: Instanced Pickups"), STAT_BaseFPS_PickupRenderInstanced, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Render: Batches"), STAT_BaseFPS_PickupRenderBatches, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_Pickups_InstancedRendering = 1;
+static FAutoConsoleVariableRef CVarBaseFPSPickupsInstancedRendering(TEXT("BaseFPS.Pickups.InstancedRendering"), CVar_BaseFPS_Pickups_InstancedRendering, TEXT("Idle static mesh pickups are drawn as instances of one instanced mesh per pickup type. Applies to pickups spawned afterwards"), ECVF_Default );
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool UPickupRenderSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer) && !IsRunningDedicatedServer();
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UPickupRenderSubsystem::Deinitialize()
+{
+	Batches.Empty();
+	Pickups.Empty();
+	FocusedPickups.Empty();
+	BatchOwner = nullptr;
+	NumInstancedPickups = 0;
+
+	Super::Deinitialize();
+}
+
+bool UPickupRenderSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UPickupRenderSubsystem::RegisterPickup(APickupInstance* Pickup)
+{
+	if (CVar_BaseFPS_Pickups_InstancedRendering == 0 || GetWorld()->GetNetMode() == NM_DedicatedServer || Pickups.Contains(Pickup))
+	{
+		return;
+	}
+
+	if (UStaticMeshComponent* Mesh = GetInstanceableMesh(Pickup))
+	{
+		FRegisteredPickup& Registered = Pickups.Add(Pickup);
+		Registered.Mesh = Mesh;
+		if (!IsFocused(Pickup))
+		{
+			ShowAsInstance(Pickup, Registered);
+		}
+	}
+}
+
+void UPickupRenderSubsystem::UnregisterPickup(APickupInstance* Pickup)
+{
+	if (FRegisteredPickup* Registered = Pickups.Find(Pickup))
+	{
+		ShowAsActor(Pickup, *Registered);
+		Pickups.Remove(Pickup);
+	}
+}
+
+void UPickupRenderSubsystem::SetFocusedPickup(const AActor* Viewer, APickupInstance* Pickup)
+{
+	PruneFocusedPickups();
+
+	APickupInstance* PrevPickup = FocusedPickups.FindRef(Viewer).Get();
+	if (PrevPickup == Pickup)
+	{
+		return;
+	}
+
+	if (Pickup)
+	{
+		FocusedPickups.Add(Viewer, Pickup);
+		if (FRegisteredPickup* Registered = Pickups.Find(Pickup))
+		{
+			ShowAsActor(Pickup, *Registered);
+		}
+	}
+	else
+	{
+		FocusedPickups.Remove(Viewer);
+	}
+
+	if (PrevPickup && !IsFocused(PrevPickup))
+	{
+		if (FRegisteredPickup* Registered = Pickups.Find(PrevPickup))
+		{
+			ShowAsInstance(PrevPickup, *Registered);
+		}
+	}
+}
+
+UStaticMeshComponent* UPickupRenderSubsystem::GetInstanceableMesh(const APickupInstance* Pickup)
+{
+	// on a live pickup the "template" is the pickup's own mesh
+	UStaticMeshComponent* Mesh = Pickup ? Cast<UStaticMeshComponent>(Pickup->GetEditorMeshTemplate()) : nullptr;
+	if (Mesh == nullptr || Mesh->GetStaticMesh() == nullptr || !Mesh->IsVisible())
+	{
+		return nullptr;
+	}
+
+	// the instance would freeze the animation, unless the material plays it from the custom data
+	if (!Pickup->HasIdleAnimationInMaterial() && AnimatesItself(Pickup))
+	{
+		return nullptr;
+	}
+
+	// anything else drawn along with the mesh would disappear with it
+	TArray<USceneComponent*> Children;
+	Mesh->GetChildrenComponents(true, Children);
+	for (const USceneComponent* Child : Children)
+	{
+		const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Child);
+		if (Primitive && Primitive->IsVisible() && !Primitive->bHiddenInGame)
+		{
+			return nullptr;
+		}
+	}
+	return Mesh;
+}
+
+bool UPickupRenderSubsystem::AnimatesItself(const APickupInstance* Pickup)
+{
+	if (Pickup->PrimaryActorTick.bCanEverTick)
+	{
+		return true;
+	}
+
+	TInlineComponentArray<UActorComponent*> Components(Pickup);
+	for (const UActorComponent* Component : Components)
+	{
+		if (Component->IsA<UMovementComponent>() || Component->IsA<UTimelineComponent>())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+FPickupInstanceBatch& UPickupRenderSubsystem::GetOrCreateBatch(UClass* PickupClass, const UStaticMeshComponent* Template)
+{
+	if (FPickupInstanceBatch* Batch = Batches.Find(PickupClass))
+	{
+		return *Batch;
+	}
+
+	if (BatchOwner == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		BatchOwner = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	}
+
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(BatchOwner);
+	Component->SetStaticMesh(Template->GetStaticMesh());
+	for (int32 i = 0; i < Template->GetNumMaterials(); i++)
+	{
+		Component->SetMaterial(i, Template->GetMaterial(i));
+	}
+	Component->NumCustomDataFloats = NumCustomDataFloats;
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetGenerateOverlapEvents(false);
+	Component->SetCanEverAffectNavigation(false);
+	Component->CastShadow = Template->CastShadow;
+	Component->bReceivesDecals = Template->bReceivesDecals;
+	if (USceneComponent* Root = BatchOwner->GetRootComponent())
+	{
+		Component->SetupAttachment(Root);
+	}
+	else
+	{
+		BatchOwner->SetRootComponent(Component);
+	}
+	Component->RegisterComponent();
+	BatchOwner->AddInstanceComponent(Component);
+
+	FPickupInstanceBatch& Batch = Batches.Add(PickupClass);
+	Batch.Component = Component;
+	SET_DWORD_STAT(STAT_BaseFPS_PickupRenderBatches, Batches.Num());
+	return Batch;
+}
+
+bool UPickupRenderSubsystem::IsFocused(const APickupInstance* Pickup) const
+{
+	for (const TPair<TWeakObjectPtr<const AActor>, TWeakObjectPtr<APickupInstance>>& Pair : FocusedPickups)
+	{
+		if (Pair.Key.IsValid() && Pair.Value.Get() == Pickup)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UPickupRenderSubsystem::PruneFocusedPickups()
+{
+	TArray<APickupInstance*, TInlineAllocator<2>> Unfocused;
+	for (auto It = FocusedPickups.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || !It.Value().IsValid())
+		{
+			if (APickupInstance* Pickup = It.Value().Get())
+			{
+				Unfocused.Add(Pickup);
+			}
+			It.RemoveCurrent();
+		}
+	}
+
+	// a viewer that left while focusing a pickup never looked away from it
+	for (APickupInstance* Pickup : Unfocused)
+	{
+		FRegisteredPickup* Registered = Pickups.Find(Pickup);
+		if (Registered && !IsFocused(Pickup))
+		{
+			ShowAsInstance(Pickup, *Registered);
+		}
+	}
+}
+
+void UPickupRenderSubsystem::ShowAsInstance(APickupInstance* Pickup, FRegisteredPickup& Registered)
+{
+	if (Registered.InstanceIndex != INDEX_NONE || Registered.Mesh == nullptr)
+	{
+		return;
+	}
+
+	FPickupInstanceBatch& Batch = GetOrCreateBatch(Pickup->GetClass(), Registered.Mesh);
+	const FTransform Transform = Registered.Mesh->GetComponentTransform();
+	if (Batch.FreeInstances.Num() > 0)
+	{
+		Registered.InstanceIndex = Batch.FreeInstances.Pop(false);
+		Batch.Component->UpdateInstanceTransform(Registered.InstanceIndex, Transform, true, true, true);
+	}
+	else
+	{
+		Registered.InstanceIndex = Batch.Component->AddInstance(Transform, true);
+	}
+
+	const TArray<float> CustomData = { FMath::FRand(), Pickup->GetIdleSpinRate(), Pickup->GetIdleBobHeight() };
+	Batch.Component->SetCustomData(Registered.InstanceIndex, CustomData, true);
+
+	Registered.Mesh->SetVisibility(false);
+	SET_DWORD_STAT(STAT_BaseFPS_PickupRenderInstanced, ++NumInstancedPickups);
+}
+
+void UPickupRenderSubsystem::ShowAsActor(APickupInstance* Pickup, FRegisteredPickup& Registered)
+{
+	if (Registered.InstanceIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (FPickupInstanceBatch* Batch = Batches.Find(Pickup->GetClass()))
+	{
+		// collapsed rather than removed, removing would shift the other pickups' indices
+		const FTransform Collapsed(FQuat::Identity, Batch->Component->GetComponentLocation(), FVector::ZeroVector);
+		Batch->Component->UpdateInstanceTransform(Registered.InstanceIndex, Collapsed, true, true, true);
+		Batch->FreeInstances.Add(Registered.InstanceIndex);
+	}
+	Registered.InstanceIndex = INDEX_NONE;
+
+	if (Registered.Mesh)
+	{
+		Registered.Mesh->SetVisibility(true);
+	}
+	SET_DWORD_STAT(STAT_BaseFPS_PickupRenderInstanced, --NumInstancedPickups);
+}
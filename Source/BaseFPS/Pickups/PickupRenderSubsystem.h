@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupRenderSubsystem.generated.h"
+
+class APickupInstance;
+class UInstancedStaticMeshComponent;
+class UStaticMeshComponent;
+
+/** The shared instanced mesh for one pickup type */
+USTRUCT()
+struct FPickupInstanceBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TObjectPtr<UInstancedStaticMeshComponent> Component;
+
+	/** instances that were given back, collapsed to zero scale until they're reused (keeps every index stable) */
+	TArray<int32> FreeInstances;
+};
+
+/** A pickup known to the render manager */
+USTRUCT()
+struct FRegisteredPickup
+{
+	GENERATED_BODY()
+
+	/** the pickup's own mesh, hidden while the pickup is drawn as an instance */
+	UPROPERTY(Transient)
+	TObjectPtr<UStaticMeshComponent> Mesh;
+
+	/** the pickup's instance in its type's batch, INDEX_NONE while it's drawn by its own mesh */
+	int32 InstanceIndex = INDEX_NONE;
+};
+
+/**
+ * Per-world render manager for idle pickups. Pickups whose visual is a single static mesh are drawn as instances of
+ * one instanced static mesh per pickup type, with their own mesh hidden, so a map full of pickups costs a draw call
+ * per type instead of one per pickup. Each instance carries {@code [phase, spin rate (deg/s), bob height (cm)]} as
+ * per-instance custom data (see IdleSpinRate/IdleBobHeight on {@code APickupInstance}) for a material to animate an
+ * idle spin and bob from. A pickup a local player focuses is switched back to its own mesh until they look away.
+ *
+ * An instance's transform is fixed, so pickups that animate themselves (they tick, or have a movement or timeline
+ * component) keep drawing themselves unless their material plays the animation (bIdleAnimationInMaterial). So do
+ * pickups with a skeletal mesh or further visible components attached to their mesh.
+ * Not created on dedicated servers. See BaseFPS.Pickups.InstancedRendering
+ */
+UCLASS()
+class BASEFPS_API UPickupRenderSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	/** number of custom data floats per instance, see the class comment for the layout */
+	static constexpr int32 NumCustomDataFloats = 3;
+
+	/** called by pickups as they enter the world, draws the pickup as an instance if it can be */
+	void RegisterPickup(APickupInstance* Pickup);
+
+	/** called by pickups as they leave the world, gives back their instance and restores their own mesh */
+	void UnregisterPickup(APickupInstance* Pickup);
+
+	/** [local] the pickup the viewer focuses (null for none) is drawn by its own mesh while they focus it */
+	void SetFocusedPickup(const AActor* Viewer, APickupInstance* Pickup);
+
+	int32 GetNumInstancedPickups() const { return NumInstancedPickups; }
+
+private:
+	/** the instanced meshes by pickup type */
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FPickupInstanceBatch> Batches;
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<APickupInstance>, FRegisteredPickup> Pickups;
+
+	/** the pickup each local viewer focuses */
+	TMap<TWeakObjectPtr<const AActor>, TWeakObjectPtr<APickupInstance>> FocusedPickups;
+
+	/** owns the instanced mesh components */
+	UPROPERTY(Transient)
+	TObjectPtr<AActor> BatchOwner;
+
+	int32 NumInstancedPickups = 0;
+
+	/** the pickup's static mesh if the pickup can be drawn as an instance of it */
+	static UStaticMeshComponent* GetInstanceableMesh(const APickupInstance* Pickup);
+
+	/** true if the pickup moves its mesh on its own (actor tick, movement or timeline component), which an instance wouldn't follow */
+	static bool AnimatesItself(const APickupInstance* Pickup);
+
+	FPickupInstanceBatch& GetOrCreateBatch(UClass* PickupClass, const UStaticMeshComponent* Template);
+
+	bool IsFocused(const APickupInstance* Pickup) const;
+
+	/** forgets the focus of viewers, or on pickups, that are gone, and draws what they focused as an instance again */
+	void PruneFocusedPickups();
+
+	void ShowAsInstance(APickupInstance* Pickup, FRegisteredPickup& Registered);
+	void ShowAsActor(APickupInstance* Pickup, FRegisteredPickup& Registered);
+};
@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pickups/PickupSchedulerSubsystem.h"
+
+#include "BaseFPS.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Scheduler: Scheduled"), STAT_BaseFPS_PickupSchedulerScheduled, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Scheduler: Dispatched"), STAT_BaseFPS_PickupSchedulerDispatched, STATGROUP_BaseFPS);
+DECLARE_CYCLE_STAT(TEXT("Pickup Scheduler: Advance"), STAT_BaseFPS_PickupSchedulerAdvance, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+float CVar_BaseFPS_PickupScheduler_Resolution = 0.1f;
+static FAutoConsoleVariableRef CVarBaseFPSPickupSchedulerResolution(TEXT("BaseFPS.PickupScheduler.Resolution"), CVar_BaseFPS_PickupScheduler_Resolution, TEXT("Seconds per tick of the pickup scheduler's timing wheel, deadlines are rounded up to it. Applies to worlds started afterwards"), ECVF_Default );
+
+/* -------------- FAutoConsoleCommandWithWorldAndArgs -------------- */
+
+FAutoConsoleCommandWithWorldAndArgs PickupSchedulerDumpCmd(TEXT("BaseFPS.PickupScheduler.Dump"), TEXT("Logs the upcoming pickup respawns and dropped pickup expiries, soonest first. Usage: BaseFPS.PickupScheduler.Dump [Count=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const FString Cmd = FString::Join(Args, TEXT(" "));
+		int32 Count = 20;
+		FParse::Value(*Cmd, TEXT("Count="), Count);
+
+		if (const UPickupSchedulerSubsystem* Scheduler = World ? World->GetSubsystem<UPickupSchedulerSubsystem>() : nullptr)
+		{
+			Scheduler->DumpUpcoming(Count);
+		}
+	}));
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool UPickupSchedulerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UPickupSchedulerSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Resolution = FMath::Max(CVar_BaseFPS_PickupScheduler_Resolution, 0.01f);
+	CurrentTick = GetNowTick();
+}
+
+void UPickupSchedulerSubsystem::Deinitialize()
+{
+	Entries.Empty();
+	for (TArray<uint32>& Slot : Wheel)
+	{
+		Slot.Empty();
+	}
+	DueIds.Empty();
+	NumIdsInWheel = 0;
+
+	Super::Deinitialize();
+}
+
+bool UPickupSchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UPickupSchedulerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Entries.IsEmpty())
+	{
+		// nothing to fire, skip ahead instead of stepping through the idle ticks
+		if (NumIdsInWheel > 0)
+		{
+			for (TArray<uint32>& Slot : Wheel)
+			{
+				Slot.Reset();
+			}
+			NumIdsInWheel = 0;
+		}
+		DueIds.Reset();
+		CurrentTick = FMath::Max(CurrentTick, GetNowTick());
+	}
+	else
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BaseFPS_PickupSchedulerAdvance);
+		AdvanceTo(GetNowTick());
+		DispatchDue();
+	}
+	SET_DWORD_STAT(STAT_BaseFPS_PickupSchedulerScheduled, Entries.Num());
+}
+
+TStatId UPickupSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPickupSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+FPickupScheduleHandle UPickupSchedulerSubsystem::Schedule(float Delay, FSimpleDelegate Callback, const UObject* DebugContext)
+{
+	LastId = LastId == MAX_uint32 ? 1 : LastId + 1;
+
+	FScheduledEntry& Entry = Entries.Add(LastId);
+	Entry.DeadlineTime = GetWorld()->GetTimeSeconds() + FMath::Max(Delay, 0.f);
+	Entry.DeadlineTick = FMath::CeilToInt64(Entry.DeadlineTime / Resolution);
+	Entry.Callback = MoveTemp(Callback);
+	Entry.DebugContext = DebugContext;
+	InsertIntoWheel(LastId, Entry.DeadlineTick);
+
+	FPickupScheduleHandle Handle;
+	Handle.Id = LastId;
+	return Handle;
+}
+
+void UPickupSchedulerSubsystem::Cancel(FPickupScheduleHandle& Handle)
+{
+	if (Handle.IsValid())
+	{
+		// the id stays in its slot and is skipped once the slot is reached
+		Entries.Remove(Handle.Id);
+		Handle.Invalidate();
+	}
+}
+
+bool UPickupSchedulerSubsystem::IsScheduled(const FPickupScheduleHandle& Handle) const
+{
+	return Handle.IsValid() && Entries.Contains(Handle.Id);
+}
+
+float UPickupSchedulerSubsystem::GetTimeRemaining(const FPickupScheduleHandle& Handle) const
+{
+	const FScheduledEntry* Entry = Handle.IsValid() ? Entries.Find(Handle.Id) : nullptr;
+	return Entry ? static_cast<float>(FMath::Max(Entry->DeadlineTick * Resolution - GetWorld()->GetTimeSeconds(), 0.0)) : -1.f;
+}
+
+void UPickupSchedulerSubsystem::DumpUpcoming(int32 Count) const
+{
+	TArray<const FScheduledEntry*> Upcoming;
+	Upcoming.Reserve(Entries.Num());
+	for (const TPair<uint32, FScheduledEntry>& Pair : Entries)
+	{
+		Upcoming.Add(&Pair.Value);
+	}
+	Upcoming.Sort([](const FScheduledEntry& A, const FScheduledEntry& B) { return A.DeadlineTick < B.DeadlineTick; });
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	UE_LOG(LogBaseFPS, Log, TEXT("Pickup scheduler: %d scheduled, resolution %.2fs, world time %.2fs"), Entries.Num(), Resolution, Now);
+	for (int32 i = 0; i < FMath::Min(Count, Upcoming.Num()); i++)
+	{
+		const FScheduledEntry& Entry = *Upcoming[i];
+		const UObject* Context = Entry.DebugContext.Get();
+		UE_LOG(LogBaseFPS, Log, TEXT("  in %7.2fs  %s (%s)"), Entry.DeadlineTick * Resolution - Now, *GetNameSafe(Context), Context ? *Context->GetClass()->GetName() : TEXT("None"));
+	}
+}
+
+int64 UPickupSchedulerSubsystem::GetNowTick() const
+{
+	return FMath::FloorToInt64(GetWorld()->GetTimeSeconds() / Resolution);
+}
+
+void UPickupSchedulerSubsystem::InsertIntoWheel(uint32 Id, int64 DeadlineTick)
+{
+	const int64 Delta = DeadlineTick - CurrentTick;
+	if (Delta <= 0)
+	{
+		DueIds.Add(Id);
+		return;
+	}
+
+	// level L holds deadlines 64^L to 64^(L+1) ticks out, slotted by their tick's bits for that level
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= (int64(1) << (SlotBits * (Level + 1))))
+	{
+		Level++;
+	}
+
+	int64 SlotTick = DeadlineTick;
+	if (Delta >= (int64(1) << (SlotBits * NumLevels)))
+	{
+		// past the end of the wheel, parked in the furthest top level slot and re-inserted when it cascades
+		SlotTick = CurrentTick + (int64(SlotMask) << (SlotBits * Level));
+	}
+
+	Wheel[Level * SlotsPerLevel + ((SlotTick >> (SlotBits * Level)) & SlotMask)].Add(Id);
+	NumIdsInWheel++;
+}
+
+void UPickupSchedulerSubsystem::AdvanceTo(int64 TargetTick)
+{
+	TArray<uint32> Cascading;
+	while (CurrentTick < TargetTick)
+	{
+		CurrentTick++;
+
+		// top level down, so a deadline can drop several levels on the same tick
+		for (int32 Level = NumLevels - 1; Level > 0; Level--)
+		{
+			if ((CurrentTick & ((int64(1) << (SlotBits * Level)) - 1)) == 0)
+			{
+				Swap(Cascading, Wheel[Level * SlotsPerLevel + ((CurrentTick >> (SlotBits * Level)) & SlotMask)]);
+				NumIdsInWheel -= Cascading.Num();
+				for (const uint32 Id : Cascading)
+				{
+					if (const FScheduledEntry* Entry = Entries.Find(Id))
+					{
+						InsertIntoWheel(Id, Entry->DeadlineTick);
+					}
+				}
+				Cascading.Reset();
+			}
+		}
+
+		TArray<uint32>& Slot = Wheel[CurrentTick & SlotMask];
+		NumIdsInWheel -= Slot.Num();
+		for (const uint32 Id : Slot)
+		{
+			if (Entries.Contains(Id))
+			{
+				DueIds.Add(Id);
+			}
+		}
+		Slot.Reset();
+	}
+}
+
+void UPickupSchedulerSubsystem::DispatchDue()
+{
+	if (DueIds.IsEmpty())
+	{
+		return;
+	}
+
+	// removed before any callback runs, so callbacks can schedule (or cancel) freely
+	TArray<TPair<uint32, FScheduledEntry>> Dispatching;
+	Dispatching.Reserve(DueIds.Num());
+	for (const uint32 Id : DueIds)
+	{
+		FScheduledEntry Entry;
+		if (Entries.RemoveAndCopyValue(Id, Entry))
+		{
+			Dispatching.Emplace(Id, MoveTemp(Entry));
+		}
+	}
+	DueIds.Reset();
+
+	Dispatching.Sort([](const TPair<uint32, FScheduledEntry>& A, const TPair<uint32, FScheduledEntry>& B)
+	{
+		return A.Value.DeadlineTime < B.Value.DeadlineTime || (A.Value.DeadlineTime == B.Value.DeadlineTime && A.Key < B.Key);
+	});
+
+	for (const TPair<uint32, FScheduledEntry>& Pair : Dispatching)
+	{
+		Pair.Value.Callback.ExecuteIfBound();
+	}
+	INC_DWORD_STAT_BY(STAT_BaseFPS_PickupSchedulerDispatched, Dispatching.Num());
+}
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupSchedulerSubsystem.generated.h"
+
+/** Identifies a deadline scheduled with {@code UPickupSchedulerSubsystem}, invalid once it fired or was cancelled */
+struct FPickupScheduleHandle
+{
+	uint32 Id = 0;
+
+	bool IsValid() const { return Id != 0; }
+	void Invalidate() { Id = 0; }
+};
+
+/**
+ * Per-world owner of every pickup respawn and dropped pickup expiry deadline, a hierarchical timing wheel
+ * (BaseFPS.PickupScheduler.Resolution seconds per tick, 4 levels of 64 slots) instead of a timer per pickup in the
+ * world's timer manager. Scheduling and cancelling are O(1), and each frame only the wheel slots that came due are
+ * visited, so the cost stays flat however many spawners a map has. Deadlines are in world time, so they hold
+ * through pauses and time dilation, and callbacks that came due in the same frame are dispatched together in
+ * deadline order. See BaseFPS.PickupScheduler.Dump
+ */
+UCLASS()
+class BASEFPS_API UPickupSchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	/**
+	 * Calls Callback once Delay seconds of world time have passed (rounded up to the wheel's resolution)
+	 * @param DebugContext shown by BaseFPS.PickupScheduler.Dump, usually the object the callback is bound to
+	 */
+	FPickupScheduleHandle Schedule(float Delay, FSimpleDelegate Callback, const UObject* DebugContext = nullptr);
+
+	/** cancels the deadline if it hasn't fired yet and invalidates the handle */
+	void Cancel(FPickupScheduleHandle& Handle);
+
+	bool IsScheduled(const FPickupScheduleHandle& Handle) const;
+
+	/** world time left until the deadline fires, negative if it isn't scheduled */
+	float GetTimeRemaining(const FPickupScheduleHandle& Handle) const;
+
+	int32 GetNumScheduled() const { return Entries.Num(); }
+
+	/** logs the next Count deadlines, soonest first */
+	void DumpUpcoming(int32 Count) const;
+
+private:
+	static constexpr int32 NumLevels = 4;
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotsPerLevel = 1 << SlotBits;
+	static constexpr int32 SlotMask = SlotsPerLevel - 1;
+
+	struct FScheduledEntry
+	{
+		/** wheel tick the deadline fires on */
+		int64 DeadlineTick = 0;
+
+		/** the world time the deadline was asked for, before rounding to the wheel's resolution */
+		double DeadlineTime = 0.0;
+
+		FSimpleDelegate Callback;
+		TWeakObjectPtr<const UObject> DebugContext;
+	};
+
+	/** scheduled deadlines by id, cancelling removes the entry and leaves its id in the wheel to be skipped */
+	TMap<uint32, FScheduledEntry> Entries;
+
+	/** ids per slot, level-major (level 0 is one tick per slot, each level above covers 64x the one below) */
+	TArray<uint32> Wheel[NumLevels * SlotsPerLevel];
+
+	/** ids that came due and are waiting for this frame's dispatch */
+	TArray<uint32> DueIds;
+
+	/** ids in the wheel, including cancelled ones that haven't been skipped yet */
+	int32 NumIdsInWheel = 0;
+
+	/** the last wheel tick that was processed */
+	int64 CurrentTick = 0;
+
+	/** seconds per wheel tick at the time the world started, see BaseFPS.PickupScheduler.Resolution */
+	double Resolution = 0.1;
+
+	uint32 LastId = 0;
+
+	int64 GetNowTick() const;
+
+	/** puts the id in the slot its deadline falls in, relative to CurrentTick */
+	void InsertIntoWheel(uint32 Id, int64 DeadlineTick);
+
+	/** processes every wheel tick up to (and including) TargetTick */
+	void AdvanceTo(int64 TargetTick);
+
+	void DispatchDue();
+};
@@ -6,7 +6,10 @@
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "InputMappingContext.h"
+#include "Kismet/GameplayStatics.h"
 #include "Character/BaseFPSCharacter.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Weapons/BaseFPSProjectile.h"
 #include "Settings/BaseFPSSettings.h"
 #include "Settings/BaseFPSSettingsLocal.h"
 #include "PlayerMappableInputConfig.h"
@@ -315,3 +318,62 @@ void ABaseFPSPlayerController::OnPrevWeapon()
 		MyCharacter->PrevWeapon();
 	}
 }
+
+/************************************************************************/
+/* Cosmetic Fire                                                        */
+/************************************************************************/
+
+void ABaseFPSPlayerController::ClientFireEventBatch_Implementation(const FFireEventBatch& Batch)
+{
+	for (const FBatchedFireEvent& Event : Batch.Events)
+	{
+		// shooter may not be relevant to us (yet)
+		ABaseFPSCharacter* Shooter = Batch.Shooters.IsValidIndex(Event.ShooterIndex) ? Batch.Shooters[Event.ShooterIndex].Get() : nullptr;
+		if (Shooter)
+		{
+			Shooter->PlayRelayedFiringInfo(Event.FireMode, Event.EndPoint, Event.Impact, Event.ShotCount);
+		}
+	}
+}
+
+void ABaseFPSPlayerController::ClientDistantGunfire_Implementation(const TArray<FDistantGunfire>& Gunfire)
+{
+	PlayDistantGunfire(Gunfire);
+	OnDistantGunfire.Broadcast(Gunfire);
+}
+
+void ABaseFPSPlayerController::PlayDistantGunfire(const TArray<FDistantGunfire>& Gunfire)
+{
+	if (DistantGunfireSound == nullptr)
+	{
+		return;
+	}
+
+	for (const FDistantGunfire& Shots : Gunfire)
+	{
+		// a single shot plays at half volume, a burst of 5+ at full
+		const float VolumeMultiplier = FMath::GetMappedRangeValueClamped(FVector2f(1.f, 5.f), FVector2f(0.5f, 1.f), (float)Shots.NumShots);
+		UGameplayStatics::PlaySoundAtLocation(this, DistantGunfireSound, Shots.Location, VolumeMultiplier);
+	}
+}
+
+void ABaseFPSPlayerController::ClientProjectileEvents_Implementation(const FProjectileEventBatch& Batch)
+{
+	if (UProjectileManagerSubsystem* ProjectileManager = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>())
+	{
+		ProjectileManager->HandleEventBatch(Batch);
+	}
+}
+
+void ABaseFPSPlayerController::ServerLaunchProjectile_Implementation(TSubclassOf<ABaseFPSProjectile> ProjectileClass, FVector_NetQuantize Location, FVector_NetQuantize Velocity, uint32 PredictedId)
+{
+	UProjectileManagerSubsystem* ProjectileManager = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>();
+	if (!ProjectileManager || !UProjectileManagerSubsystem::ShouldManage(ProjectileClass) || !UProjectileManagerSubsystem::IsPlausibleClientLaunch(GetPawn(), Location))
+	{
+		return;
+	}
+
+	// only the direction is the client's, the speed is the class'
+	const float Speed = ProjectileClass->GetDefaultObject<ABaseFPSProjectile>()->GetProjectileMovement()->InitialSpeed;
+	ProjectileManager->LaunchProjectile(ProjectileClass, Location, Velocity.GetSafeNormal() * Speed, GetPawn(), this, PredictedId);
+}
@@ -5,11 +5,18 @@
 #include "CoreMinimal.h"
 #include "InputActionValue.h"
 #include "CommonPlayerController.h"
+#include "Online/CosmeticFireRelevancySubsystem.h"
+#include "Weapons/ProjectileManagerSubsystem.h"
 #include "BaseFPSPlayerController.generated.h"
 
 class ABaseFPSCharacter;
+class ABaseFPSProjectile;
 class UInputMappingContext;
 class UInputAction;
+class USoundBase;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnDistantGunfire, const TArray<FDistantGunfire>& /* Gunfire */);
+
 /**
  * 
  */
@@ -114,5 +121,38 @@ protected:
 
 	void OnNextWeapon();
 	void OnPrevWeapon();
+
+	/************************************************************************/
+	/* Cosmetic Fire                                                        */
+	/************************************************************************/
+public:
+	/** [client] this frame's shots of remote characters, relayed by UCosmeticFireRelevancySubsystem */
+	UFUNCTION(Client, Unreliable)
+	void ClientFireEventBatch(const FFireEventBatch& Batch);
+
+	/** [client] gunfire too far away to be seen, relayed by UCosmeticFireRelevancySubsystem */
+	UFUNCTION(Client, Unreliable)
+	void ClientDistantGunfire(const TArray<FDistantGunfire>& Gunfire);
+
+	/** [local] broadcast on distant gunfire summaries, after their cue was played (e.g. for HUD indicators) */
+	FOnDistantGunfire OnDistantGunfire;
+
+	/** [client] this frame's projectile launches and impacts, sent by UProjectileManagerSubsystem */
+	UFUNCTION(Client, Unreliable)
+	void ClientProjectileEvents(const FProjectileEventBatch& Batch);
+
+	/**
+	 * [server] launches the managed projectile the client already predicted as PredictedId, e.g. from
+	 * UTP_WeaponComponent. Launches too far from the pawn are dropped */
+	UFUNCTION(Server, Reliable)
+	void ServerLaunchProjectile(TSubclassOf<ABaseFPSProjectile> ProjectileClass, FVector_NetQuantize Location, FVector_NetQuantize Velocity, uint32 PredictedId);
+
+protected:
+	/** far-off gunshot cue played at each distant gunfire summary's location, its attenuation should reach AudibleDist */
+	UPROPERTY(EditDefaultsOnly, Category="Cosmetic Fire")
+	TObjectPtr<USoundBase> DistantGunfireSound;
+
+	/** [local] plays DistantGunfireSound once per summary, louder the more shots it sums up */
+	void PlayDistantGunfire(const TArray<FDistantGunfire>& Gunfire);
 	
 };
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/DeveloperSettings.h"
+#include "ActorPoolData.generated.h"
+
+USTRUCT()
+struct BASEFPS_API FActorPoolPrewarmEntry
+{
+	GENERATED_BODY()
+
+	/** must implement {@code IPoolableActor} */
+	UPROPERTY(EditAnywhere, Category="Pool", meta=(MustImplement="/Script/BaseFPS.PoolableActor"))
+	TSoftClassPtr<AActor> ActorClass;
+
+	/** number of actors spawned into the pool when the world begins play */
+	UPROPERTY(EditAnywhere, Category="Pool", meta=(ClampMin=0))
+	int32 Count = 8;
+};
+
+/** Actors {@code UActorPoolSubsystem} spawns ahead of time, so the first respawn wave doesn't have to */
+UCLASS(BlueprintType, Const, Meta = (DisplayName = "Actor Pool Data", ShortTooltip = "Data asset used to pre-warm actor pools."))
+class BASEFPS_API UActorPoolData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category="Pool")
+	TArray<FActorPoolPrewarmEntry> Prewarm;
+};
+
+/** Project wide {@code UActorPoolSubsystem} settings */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "BaseFPS Actor Pool Settings"))
+class BASEFPS_API UActorPoolSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	/** pools to fill when a game world begins play */
+	UPROPERTY(config, EditAnywhere, Category="Pool", meta = (AllowedClasses = "/Script/BaseFPS.ActorPoolData"))
+	FSoftObjectPath PrewarmData;
+};
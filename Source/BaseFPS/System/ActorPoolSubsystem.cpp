@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "System/ActorPoolSubsystem.h"
+
+#include "BaseFPS.h"
+#include "System/ActorPoolData.h"
+#include "System/PoolableActor.h"
+#include "TimerManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Actor Pool: Spawned"), STAT_BaseFPS_ActorPoolSpawned, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Actor Pool: Reused"), STAT_BaseFPS_ActorPoolReused, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Actor Pool: Released"), STAT_BaseFPS_ActorPoolReleased, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_ActorPool_Enable = 1;
+static FAutoConsoleVariableRef CVarBaseFPSActorPoolEnable(TEXT("BaseFPS.ActorPool.Enable"), CVar_BaseFPS_ActorPool_Enable, TEXT("Reuse weapon attachments instead of destroying and spawning them again, and weapons and pickups too in standalone games"), ECVF_Default );
+
+int32 CVar_BaseFPS_ActorPool_MaxPerClass = 64;
+static FAutoConsoleVariableRef CVarBaseFPSActorPoolMaxPerClass(TEXT("BaseFPS.ActorPool.MaxPerClass"), CVar_BaseFPS_ActorPool_MaxPerClass, TEXT("Free actors kept per class, further releases are destroyed"), ECVF_Default );
+
+static FAutoConsoleCommandWithWorldAndArgs BaseFPSActorPoolStatsCmd(TEXT("BaseFPS.ActorPool.Stats"), TEXT("Logs per class actor pool counters"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UActorPoolSubsystem* Pool = World ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr)
+		{
+			Pool->LogStats();
+		}
+	}));
+
+/************************************************************************/
+/* UActorPoolSubsystem                                                  */
+/************************************************************************/
+
+bool UActorPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UActorPoolSubsystem::Deinitialize()
+{
+	// pooled actors belong to the world, they go with it
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+void UActorPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// next tick, so prewarmed actors don't begin play along with the rest of the level
+	InWorld.GetTimerManager().SetTimerForNextTick(this, &UActorPoolSubsystem::PrewarmFromSettings);
+}
+
+bool UActorPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+bool UActorPoolSubsystem::IsEnabled()
+{
+	return CVar_BaseFPS_ActorPool_Enable > 0;
+}
+
+/* -------------- Acquire/Release -------------- */
+
+AActor* UActorPoolSubsystem::AcquireActor(UWorld* World, UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor)
+{
+	if (World == nullptr || Class == nullptr)
+	{
+		return nullptr;
+	}
+
+	UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>();
+	if (Pool && Pool->CanPool(Class))
+	{
+		return Pool->AcquireFromPool(Class, Transform, SpawnParams, InitActor);
+	}
+	return SpawnActor(World, Class, Transform, SpawnParams, InitActor);
+}
+
+void UActorPoolSubsystem::ReleaseActor(AActor* Actor)
+{
+	if (!IsValid(Actor))
+	{
+		return;
+	}
+
+	UActorPoolSubsystem* Pool = Actor->GetWorld() ? Actor->GetWorld()->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+	if (Pool && Pool->CanPool(Actor))
+	{
+		Pool->ReleaseToPool(Actor);
+		return;
+	}
+
+	if (Pool)
+	{
+		Pool->Pools.FindOrAdd(Actor->GetClass()).NumDestroyed++;
+	}
+	Actor->Destroy();
+}
+
+bool UActorPoolSubsystem::CanPool(const UClass* Class) const
+{
+	if (!IsEnabled() || Class == nullptr || !Class->ImplementsInterface(UPoolableActor::StaticClass()))
+	{
+		return false;
+	}
+
+	// a reused replicated actor would keep the NetGUID of the one clients (and replays) saw destroyed
+	const AActor* DefaultActor = Class->GetDefaultObject<AActor>();
+	return !DefaultActor->GetIsReplicated() || (GetWorld()->GetNetDriver() == nullptr && GetWorld()->GetDemoNetDriver() == nullptr);
+}
+
+bool UActorPoolSubsystem::CanPool(const AActor* Actor) const
+{
+	if (!CanPool(Actor->GetClass()) || GetWorld()->bIsTearingDown || Actor->IsNetStartupActor())
+	{
+		return false;
+	}
+
+	const FActorPool* Pool = Pools.Find(Actor->GetClass());
+	return Pool == nullptr || Pool->FreeActors.Num() < CVar_BaseFPS_ActorPool_MaxPerClass;
+}
+
+AActor* UActorPoolSubsystem::AcquireFromPool(UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor)
+{
+	FActorPool& Pool = Pools.FindOrAdd(Class);
+	const AActor* DefaultActor = Class->GetDefaultObject<AActor>();
+	while (Pool.FreeActors.Num() > 0)
+	{
+		AActor* Actor = Pool.FreeActors[0].Actor;
+		Pool.FreeActors.RemoveAt(0, 1, false);
+		if (!IsValid(Actor))
+		{
+			continue; // destroyed while pooled, e.g. by a level unloading
+		}
+
+		Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Actor->SetOwner(SpawnParams.Owner);
+		Actor->SetInstigator(SpawnParams.Instigator);
+		Actor->SetActorHiddenInGame(DefaultActor->IsHidden());
+		Actor->SetActorEnableCollision(DefaultActor->GetActorEnableCollision());
+		Actor->SetActorTickEnabled(DefaultActor->PrimaryActorTick.bStartWithTickEnabled);
+
+		InitActor(Actor);
+		CastChecked<IPoolableActor>(Actor)->OnAcquiredFromPool();
+
+		Pool.NumReused++;
+		INC_DWORD_STAT(STAT_BaseFPS_ActorPoolReused);
+		return Actor;
+	}
+
+	AActor* Actor = SpawnActor(GetWorld(), Class, Transform, SpawnParams, InitActor);
+	if (Actor)
+	{
+		Pool.NumSpawned++;
+		INC_DWORD_STAT(STAT_BaseFPS_ActorPoolSpawned);
+	}
+	return Actor;
+}
+
+void UActorPoolSubsystem::ReleaseToPool(AActor* Actor)
+{
+	FActorPool& Pool = Pools.FindOrAdd(Actor->GetClass());
+	if (!ensureMsgf(!Pool.FreeActors.ContainsByPredicate([Actor](const FPooledActor& Pooled) { return Pooled.Actor == Actor; }), TEXT("UActorPoolSubsystem: %s released twice"), *Actor->GetName()))
+	{
+		return;
+	}
+
+	CastChecked<IPoolableActor>(Actor)->OnReleasedToPool();
+
+	GetWorld()->GetTimerManager().ClearAllTimersForObject(Actor);
+	Actor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+	Actor->SetOwner(nullptr);
+	Actor->SetInstigator(nullptr);
+
+	FPooledActor& Pooled = Pool.FreeActors.AddDefaulted_GetRef();
+	Pooled.Actor = Actor;
+	Pool.NumReleased++;
+	INC_DWORD_STAT(STAT_BaseFPS_ActorPoolReleased);
+}
+
+AActor* UActorPoolSubsystem::SpawnActor(UWorld* World, UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor)
+{
+	FActorSpawnParameters DeferredSpawnParams = SpawnParams;
+	DeferredSpawnParams.bDeferConstruction = true;
+
+	AActor* Actor = World->SpawnActor(Class, &Transform, DeferredSpawnParams);
+	if (Actor)
+	{
+		InitActor(Actor);
+		Actor->FinishSpawning(Transform);
+	}
+	return Actor;
+}
+
+/* -------------- Prewarm -------------- */
+
+void UActorPoolSubsystem::Prewarm(UClass* Class, int32 Count)
+{
+	if (!CanPool(Class))
+	{
+		return;
+	}
+
+	// weapon attachments and the like are only ever seen, dedicated servers never spawn them
+	const AActor* DefaultActor = Class->GetDefaultObject<AActor>();
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer && !DefaultActor->GetIsReplicated())
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const int32 NumToSpawn = FMath::Min(Count, CVar_BaseFPS_ActorPool_MaxPerClass) - Pools.FindOrAdd(Class).FreeActors.Num();
+	for (int32 i = 0; i < NumToSpawn; ++i)
+	{
+		if (AActor* Actor = SpawnActor(GetWorld(), Class, FTransform::Identity, SpawnParams, [](AActor*) {}))
+		{
+			Pools.FindChecked(Class).NumSpawned++;
+			ReleaseToPool(Actor);
+		}
+	}
+}
+
+void UActorPoolSubsystem::Prewarm(const UActorPoolData* Data)
+{
+	if (Data == nullptr)
+	{
+		return;
+	}
+
+	for (const FActorPoolPrewarmEntry& Entry : Data->Prewarm)
+	{
+		Prewarm(Entry.ActorClass.LoadSynchronous(), Entry.Count);
+	}
+}
+
+void UActorPoolSubsystem::PrewarmFromSettings()
+{
+	const UActorPoolSettings* Settings = GetDefault<UActorPoolSettings>();
+	if (Settings->PrewarmData.IsValid())
+	{
+		Prewarm(Cast<UActorPoolData>(Settings->PrewarmData.TryLoad()));
+	}
+}
+
+/* -------------- Debug -------------- */
+
+void UActorPoolSubsystem::LogStats() const
+{
+	UE_LOG(LogBaseFPS, Display, TEXT("Actor pools (World=%s, Enabled=%d):"), *GetNameSafe(GetWorld()), IsEnabled());
+	for (const TPair<TObjectPtr<UClass>, FActorPool>& Pair : Pools)
+	{
+		const FActorPool& Pool = Pair.Value;
+		const int32 NumAcquired = Pool.NumSpawned + Pool.NumReused;
+		UE_LOG(LogBaseFPS, Display, TEXT("  %-40s Free=%-4d Spawned=%-6d Reused=%-6d (%.0f%%) Released=%-6d Destroyed=%d"),
+			*GetNameSafe(Pair.Key), Pool.FreeActors.Num(), Pool.NumSpawned, Pool.NumReused,
+			NumAcquired > 0 ? 100.f * Pool.NumReused / NumAcquired : 0.f, Pool.NumReleased, Pool.NumDestroyed);
+	}
+}
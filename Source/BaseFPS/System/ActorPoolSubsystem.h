@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ActorPoolSubsystem.generated.h"
+
+class UActorPoolData;
+
+/** A free actor waiting in its pool */
+USTRUCT()
+struct FPooledActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TObjectPtr<AActor> Actor;
+};
+
+/** Free actors of a single class, oldest release first, plus counters for BaseFPS.ActorPool.Stats */
+USTRUCT()
+struct FActorPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<FPooledActor> FreeActors;
+
+	int32 NumSpawned = 0;
+	int32 NumReused = 0;
+	int32 NumReleased = 0;
+
+	/** released while the pool was full, or not poolable at the time */
+	int32 NumDestroyed = 0;
+};
+
+/**
+ * Per-world pools of actors that are spawned and destroyed all the time (weapons, weapon attachments and pickups),
+ * keyed by class. Released actors are hidden, stop colliding, ticking and replicating, and wait to be handed out
+ * again by AcquireActor(), which only spawns a new actor when the class' pool is empty.
+ *
+ * Replicated actors are only pooled while the world has no net driver and isn't recording a replay (standalone games).
+ * A pooled actor keeps its NetGUID, so clients would take a reused actor for the one they destroyed and resolve stale
+ * references and destruction infos against it. In networked worlds they are spawned and destroyed as usual, so only
+ * cosmetic actors (e.g. weapon attachments) are pooled there.
+ *
+ * Classes must implement {@code IPoolableActor}, anything else is spawned and destroyed as usual. See BaseFPS.ActorPool.*
+ */
+UCLASS()
+class BASEFPS_API UActorPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	//~ End UWorldSubsystem interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	static bool IsEnabled();
+
+	/**
+	 * Hands out a pooled actor of Class, or spawns one if there's none. Either way InitActor is called before the actor
+	 * begins play (new actors) or is notified with OnAcquiredFromPool() (reused actors), same as a deferred spawn.
+	 * Works without a pool as well, e.g. in worlds the subsystem isn't created for.
+	 */
+	static AActor* AcquireActor(UWorld* World, UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor);
+
+	template<class T>
+	static T* AcquireActor(UWorld* World, TSubclassOf<T> Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams = FActorSpawnParameters())
+	{
+		return Cast<T>(AcquireActor(World, *Class, Transform, SpawnParams, [](AActor*) {}));
+	}
+
+	/** puts Actor back into its pool, or destroys it if it can't be pooled */
+	static void ReleaseActor(AActor* Actor);
+
+	/** spawns actors into the pool until it holds Count free actors of Class */
+	void Prewarm(UClass* Class, int32 Count);
+	void Prewarm(const UActorPoolData* Data);
+
+	void LogStats() const;
+
+private:
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UClass>, FActorPool> Pools;
+
+	bool CanPool(const UClass* Class) const;
+	bool CanPool(const AActor* Actor) const;
+
+	AActor* AcquireFromPool(UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor);
+	void ReleaseToPool(AActor* Actor);
+
+	static AActor* SpawnActor(UWorld* World, UClass* Class, const FTransform& Transform, const FActorSpawnParameters& SpawnParams, TFunctionRef<void(AActor*)> InitActor);
+
+	void PrewarmFromSettings();
+};
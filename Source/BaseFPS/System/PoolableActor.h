@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PoolableActor.generated.h"
+
+UINTERFACE(MinimalAPI, meta=(CannotImplementInterfaceInBlueprint))
+class UPoolableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors that can be reused by {@code UActorPoolSubsystem} instead of being destroyed and spawned again.
+ * A pooled actor only gets BeginPlay once, so anything done there that has to happen every time the actor
+ * is handed out belongs in OnAcquiredFromPool() too.
+ */
+class BASEFPS_API IPoolableActor
+{
+	GENERATED_BODY()
+
+public:
+	/** actor is handed out again, its transform and owner are already set */
+	virtual void OnAcquiredFromPool() {}
+
+	/** actor is going back into the pool, reset gameplay and replicated state to its defaults */
+	virtual void OnReleasedToPool() {}
+};
@@ -15,6 +15,8 @@
 #include "UI/BaseFPSHUDLayout.h"
 #include "Weapons/Weapon.h"
 
+DECLARE_CYCLE_STAT(TEXT("HUD: Update Pawn HUD"), STAT_BaseFPS_HUDUpdatePawnHUD, STATGROUP_BaseFPS);
+
 ABaseFPSHUD::ABaseFPSHUD()
 {
 	// Structure to hold one-time initialization
@@ -34,6 +36,10 @@ ABaseFPSHUD::ABaseFPSHUD()
 	PawnHUDLayoutClass = ConstructorStatics.HUDLayoutClass.Class;
 	EscapeMenuClass = ConstructorStatics.EscapeMenuClass.Class;
 	ScoreboardClass = ConstructorStatics.ScoreboardClass.Class;
+
+	bPendingInventoryRefresh = false;
+	bPendingEquipRefresh = false;
+	bPawnHUDUpdateScheduled = false;
 }
 
 void ABaseFPSHUD::PostInitializeComponents()
@@ -87,8 +93,9 @@ void ABaseFPSHUD::OnPawnChanged(APawn* OldPawn, APawn* NewPawn)
 	}
 	
 	// refresh Pawn HUD widgets
-	OnInventoryUpdated();
-	OnEquipNewWeapon();
+	bPendingInventoryRefresh = true;
+	bPendingEquipRefresh = true;
+	UpdatePawnHUD();
 	OnFocusChanged(PossessedCharacter ? PossessedCharacter->GetInteractableInFocus() : nullptr);
 
 	if (PawnHUDLayout)
@@ -103,7 +110,7 @@ void ABaseFPSHUD::BindToCharacter(TObjectPtr<ABaseFPSCharacter> InChar)
 	if (ensureMsgf(InChar != nullptr, TEXT("Attempted to bind to invalid character")))
 	{
 		PossessedCharacter = InChar;
-		OnInventoryUpdatedHandle = InChar->OnInventoryUpdated.AddUObject(this, &ThisClass::OnInventoryUpdated);
+		OnInventorySlotUpdatedHandle = InChar->OnInventorySlotUpdated.AddUObject(this, &ThisClass::OnInventorySlotUpdated);
 		OnEquippedNewWeaponHandle = InChar->OnEquippedNewWeapon.AddUObject(this, &ThisClass::OnEquipNewWeapon);
 		OnFocusChangedHandle = InChar->OnFocusChanged.AddUObject(this, &ThisClass::OnFocusChanged);
 		OnAmmoUpdatedHandle = InChar->OnAmmoUpdated.AddUObject(this, &ThisClass::OnAmmoUpdated);
@@ -114,7 +121,7 @@ void ABaseFPSHUD::UnbindFromCharacter(TObjectPtr<ABaseFPSCharacter> InChar)
 {
 	if (ensureMsgf(InChar == PossessedCharacter, TEXT("Attempted to unbind from unpossessed character!")))
 	{
-		PossessedCharacter->OnInventoryUpdated.Remove(OnInventoryUpdatedHandle);
+		PossessedCharacter->OnInventorySlotUpdated.Remove(OnInventorySlotUpdatedHandle);
 		PossessedCharacter->OnEquippedNewWeapon.Remove(OnEquippedNewWeaponHandle);
 		PossessedCharacter->OnFocusChanged.Remove(OnFocusChangedHandle);
 		PossessedCharacter->OnAmmoUpdated.Remove(OnAmmoUpdatedHandle);
@@ -122,59 +129,16 @@ void ABaseFPSHUD::UnbindFromCharacter(TObjectPtr<ABaseFPSCharacter> InChar)
 	}
 }
 
-void ABaseFPSHUD::OnInventoryUpdated() const
+void ABaseFPSHUD::OnInventorySlotUpdated(int32 Slot)
 {
-	if (PawnHUDLayout)
-	{
-		TObjectPtr<UInventoryBar> InventoryBar = PawnHUDLayout->GetInventoryBar();
-		if (PossessedCharacter)
-		{
-			InventoryBar->SetDisplayedInventory(PossessedCharacter->GetInventory());
-			if (InventoryBar->ContainsItems())
-			{
-				InventoryBar->SetVisibility(ESlateVisibility::HitTestInvisible);
-				InventoryBar->SetActiveItem(PossessedCharacter->GetEquippedWeapon());
-			}
-			else
-			{
-				InventoryBar->SetVisibility(ESlateVisibility::Collapsed);
-			}
-		}
-		else
-		{
-			InventoryBar->SetVisibility(ESlateVisibility::Collapsed);
-		}
-	}
+	PendingInventorySlots.AddUnique(Slot);
+	RequestPawnHUDUpdate();
 }
 
-void ABaseFPSHUD::OnEquipNewWeapon() const
+void ABaseFPSHUD::OnEquipNewWeapon()
 {
-	if (PawnHUDLayout)
-	{
-		TObjectPtr<UAmmoCounter> AmmoCounter = PawnHUDLayout->GetAmmoCounter();
-		TObjectPtr<UInventoryBar> InventoryBar = PawnHUDLayout->GetInventoryBar();
-		if (PossessedCharacter)
-		{
-			if (TObjectPtr<AWeapon> EquippedWeapon = PossessedCharacter->GetEquippedWeapon())
-			{
-				AmmoCounter->SetVisibility(ESlateVisibility::HitTestInvisible);
-				AmmoCounter->SetDisplayedWeapon(EquippedWeapon);
-				if (InventoryBar->ContainsItem(EquippedWeapon))
-				{
-					// If this is a new/pending pickup item, then OnInventoryUpdated() will refresh active card
-					InventoryBar->SetActiveItem(EquippedWeapon);
-				}
-			}
-			else
-			{
-				AmmoCounter->SetVisibility(ESlateVisibility::Collapsed);
-			}
-		}
-		else
-		{
-			AmmoCounter->SetVisibility(ESlateVisibility::Collapsed);
-		}
-	}
+	bPendingEquipRefresh = true;
+	RequestPawnHUDUpdate();
 }
 
 void ABaseFPSHUD::OnFocusChanged(UInteractableComponent* Interactable) const
@@ -202,26 +166,110 @@ void ABaseFPSHUD::OnFocusChanged(UInteractableComponent* Interactable) const
 	}
 }
 
-void ABaseFPSHUD::OnAmmoUpdated(AWeapon* Weapon) const
+void ABaseFPSHUD::OnAmmoUpdated(AWeapon* Weapon)
+{
+	PendingAmmoWeapons.AddUnique(Weapon);
+	RequestPawnHUDUpdate();
+}
+
+void ABaseFPSHUD::RequestPawnHUDUpdate()
+{
+	if (!bPawnHUDUpdateScheduled)
+	{
+		bPawnHUDUpdateScheduled = true;
+		GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::UpdatePawnHUD);
+	}
+}
+
+void ABaseFPSHUD::UpdatePawnHUD()
 {
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_HUDUpdatePawnHUD);
+
+	bPawnHUDUpdateScheduled = false;
 	if (PawnHUDLayout)
 	{
-		TObjectPtr<UAmmoCounter> AmmoCounter = PawnHUDLayout->GetAmmoCounter();
-		TObjectPtr<UInventoryBar> InventoryBar = PawnHUDLayout->GetInventoryBar();
-		if (TObjectPtr<UInventoryBarSlot> Slot = InventoryBar->GetInventoryBarSlot(Weapon))
+		if (bPendingInventoryRefresh || bPendingEquipRefresh || !PendingInventorySlots.IsEmpty())
 		{
-			int32 TotalAmmo = Weapon->GetCurrentAmmoInClip() + Weapon->GetCurrentReserveAmmo();
-			Slot->SetAmmoCount(TotalAmmo);
+			UpdateInventoryBar();
 		}
-		if (PossessedCharacter)
+		if (bPendingEquipRefresh)
 		{
-			if (PossessedCharacter->IsEquipped(Weapon))
+			UpdateAmmoCounter();
+		}
+		for (const TWeakObjectPtr<AWeapon>& Weapon : PendingAmmoWeapons)
+		{
+			if (Weapon.IsValid())
 			{
-				AmmoCounter->SetCurrentAmmoInClipText(Weapon->GetCurrentAmmoInClip());
-				AmmoCounter->SetCurrentAmmoReserveText(Weapon->GetCurrentReserveAmmo());
+				UpdateWeaponAmmo(Weapon.Get());
 			}
 		}
 	}
+
+	PendingInventorySlots.Reset();
+	PendingAmmoWeapons.Reset();
+	bPendingInventoryRefresh = false;
+	bPendingEquipRefresh = false;
+}
+
+void ABaseFPSHUD::UpdateInventoryBar() const
+{
+	TObjectPtr<UInventoryBar> InventoryBar = PawnHUDLayout->GetInventoryBar();
+	if (PossessedCharacter)
+	{
+		const FInventoryList& Inventory = PossessedCharacter->GetInventory();
+		bool bRefreshAll = bPendingInventoryRefresh;
+		for (const int32 Slot : PendingInventorySlots)
+		{
+			// the bar is rebuilt if it doesn't have a card for the slot yet
+			bRefreshAll |= !Inventory.IsValidSlot(Slot) || !InventoryBar->SetDisplayedItem(Slot, Inventory.GetEntry(Slot));
+		}
+		if (bRefreshAll)
+		{
+			InventoryBar->SetDisplayedInventory(Inventory);
+		}
+	}
+
+	if (PossessedCharacter && InventoryBar->ContainsItems())
+	{
+		InventoryBar->SetVisibility(ESlateVisibility::HitTestInvisible);
+		InventoryBar->SetActiveSlot(PossessedCharacter->GetInventory().FindSlot(PossessedCharacter->GetEquippedWeapon()));
+	}
+	else
+	{
+		InventoryBar->SetVisibility(ESlateVisibility::Collapsed);
+	}
+}
+
+void ABaseFPSHUD::UpdateAmmoCounter() const
+{
+	TObjectPtr<UAmmoCounter> AmmoCounter = PawnHUDLayout->GetAmmoCounter();
+	TObjectPtr<AWeapon> EquippedWeapon = PossessedCharacter ? PossessedCharacter->GetEquippedWeapon() : nullptr;
+	if (EquippedWeapon)
+	{
+		AmmoCounter->SetVisibility(ESlateVisibility::HitTestInvisible);
+		AmmoCounter->SetDisplayedWeapon(EquippedWeapon);
+	}
+	else
+	{
+		AmmoCounter->SetVisibility(ESlateVisibility::Collapsed);
+	}
+}
+
+void ABaseFPSHUD::UpdateWeaponAmmo(AWeapon* Weapon) const
+{
+	TObjectPtr<UInventoryBar> InventoryBar = PawnHUDLayout->GetInventoryBar();
+	const int32 InventorySlot = PossessedCharacter ? PossessedCharacter->GetInventory().FindSlot(Weapon) : INDEX_NONE;
+	if (TObjectPtr<UInventoryBarSlot> Slot = InventoryBar->GetInventoryBarSlot(InventorySlot))
+	{
+		int32 TotalAmmo = Weapon->GetCurrentAmmoInClip() + Weapon->GetCurrentReserveAmmo();
+		Slot->SetAmmoCount(TotalAmmo);
+	}
+	if (PossessedCharacter && PossessedCharacter->IsEquipped(Weapon))
+	{
+		TObjectPtr<UAmmoCounter> AmmoCounter = PawnHUDLayout->GetAmmoCounter();
+		AmmoCounter->SetCurrentAmmoInClipText(Weapon->GetCurrentAmmoInClip());
+		AmmoCounter->SetCurrentAmmoReserveText(Weapon->GetCurrentReserveAmmo());
+	}
 }
 
 void ABaseFPSHUD::ToggleInGameMenu()
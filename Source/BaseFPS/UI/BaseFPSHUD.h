@@ -7,6 +7,7 @@
 #include "BaseFPSHUD.generated.h"
 
 class ABaseFPSCharacter;
+class AWeapon;
 class UCommonActivatableWidget;
 class UBaseFPSHUDLayout;
 /**
@@ -42,10 +43,39 @@ class BASEFPS_API ABaseFPSHUD : public AHUD
 	void BindToCharacter(TObjectPtr<ABaseFPSCharacter> InChar);
 	void UnbindFromCharacter(TObjectPtr<ABaseFPSCharacter> InChar);
 
-	void OnInventoryUpdated() const;
-	void OnEquipNewWeapon() const;
+	void OnInventorySlotUpdated(int32 Slot);
+	void OnEquipNewWeapon();
 	void OnFocusChanged(class UInteractableComponent* Interactable) const;
-	void OnAmmoUpdated(class AWeapon* Weapon) const;
+	void OnAmmoUpdated(AWeapon* Weapon);
+
+	/************************************************************************/
+	/* Pawn HUD Updates                                                     */
+	/************************************************************************/
+
+	/**
+	 * Inventory, equip and ammo notifications only record what changed, the widgets are updated once on the next
+	 * frame however many notifications arrived (e.g. a pickup swapping a weapon, or a shotgun's ammo per pellet)
+	 */
+	void RequestPawnHUDUpdate();
+	void UpdatePawnHUD();
+
+	void UpdateInventoryBar() const;
+	void UpdateAmmoCounter() const;
+	void UpdateWeaponAmmo(AWeapon* Weapon) const;
+
+	/** inventory slots changed since the last update */
+	TArray<int32> PendingInventorySlots;
+
+	/** weapons whose ammo changed since the last update */
+	TArray<TWeakObjectPtr<AWeapon>> PendingAmmoWeapons;
+
+	/** the whole inventory bar needs rebuilding (the possessed character changed) */
+	uint8 bPendingInventoryRefresh:1;
+
+	/** the equipped weapon changed */
+	uint8 bPendingEquipRefresh:1;
+
+	uint8 bPawnHUDUpdateScheduled:1;
 	
 	/************************************************************************/
 	/* HUD Layout                                                           */
@@ -95,7 +125,7 @@ public:
 	/************************************************************************/
 protected:
 	FDelegateHandle OnEquippedNewWeaponHandle;
-	FDelegateHandle OnInventoryUpdatedHandle;
+	FDelegateHandle OnInventorySlotUpdatedHandle;
 	FDelegateHandle OnFocusChangedHandle;
 	FDelegateHandle OnAmmoUpdatedHandle;
 	
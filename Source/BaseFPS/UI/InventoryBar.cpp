@@ -4,70 +4,75 @@
 #include "UI/InventoryBar.h"
 
 #include "Components/HorizontalBox.h"
+#include "Inventory/InventoryList.h"
 #include "UI/InventoryBarSlot.h"
 #include "Weapons/Weapon.h"
 
-void UInventoryBar::SetDisplayedInventory(TArray<AInventory*>& Inv)
+void UInventoryBar::SetDisplayedInventory(const FInventoryList& Inv)
 {
-	RemoveInventoryCards();
+	for (int32 i = SlotCards.Num(); i < Inv.Num(); i++)
+	{
+		if (AddInventoryCard() == nullptr)
+		{
+			break;
+		}
+	}
+	while (SlotCards.Num() > Inv.Num())
+	{
+		UInventoryBarSlot* SlotCard = SlotCards.Pop();
+		if (ActiveCard == SlotCard)
+		{
+			ActiveCard = nullptr;
+		}
+		SlotCard->SetDisplayedItem(nullptr);
+		WeaponBarHB->RemoveChild(SlotCard);
+		SlotWidgetCache.Push(SlotCard);
+	}
+
 	for (int32 i = 0; i < Inv.Num(); i++)
 	{
-		UInventoryBarSlot* SlotCard = !SlotWidgetCache.IsEmpty()
-					? SlotWidgetCache.Pop()
-					: CreateWidget<UInventoryBarSlot>(this, SlotWidgetClass);
-		SlotCard->SetDisplayedItem(Inv[i]);
-		WeaponBarHB->AddChild(SlotCard);
+		SetDisplayedItem(i, Inv.GetEntry(i));
 	}
 }
 
-void UInventoryBar::SetActiveItem(AInventory* NewActiveItem) const
+bool UInventoryBar::SetDisplayedItem(int32 Slot, const FInventoryEntry* Entry)
 {
-	for (UWidget* Widget : WeaponBarHB->GetAllChildren())
+	if (!SlotCards.IsValidIndex(Slot))
 	{
-		if (UInventoryBarSlot* SlotCard = Cast<UInventoryBarSlot>(Widget))
-		{
-			SlotCard->SetActive(SlotCard->IsDisplaying(NewActiveItem));
-		}
+		return false;
+	}
+
+	UInventoryBarSlot* SlotCard = SlotCards[Slot];
+	if (ActiveCard == SlotCard && SlotCard->GetDisplayedClass() != (Entry ? Entry->ItemClass : nullptr))
+	{
+		ActiveCard = nullptr; // a new item is displayed as inactive
 	}
+	SlotCard->SetDisplayedItem(Entry);
+	return true;
 }
 
-bool UInventoryBar::ContainsItem(AInventory* Item) const
+void UInventoryBar::SetActiveSlot(int32 Slot)
 {
-	for (UWidget* Widget : WeaponBarHB->GetAllChildren())
+	UInventoryBarSlot* NewActiveCard = GetInventoryBarSlot(Slot);
+	if (ActiveCard && ActiveCard != NewActiveCard)
 	{
-		UInventoryBarSlot* SlotCard = Cast<UInventoryBarSlot>(Widget);
-		if (SlotCard && Item && SlotCard->IsDisplaying(Item))
-		{
-			return true;
-		}
+		ActiveCard->SetActive(false);
 	}
-	return false;
+	if (NewActiveCard)
+	{
+		NewActiveCard->SetActive(true);
+	}
+	ActiveCard = NewActiveCard;
 }
 
 bool UInventoryBar::ContainsItems() const
 {
-	for (UWidget* Widget : WeaponBarHB->GetAllChildren())
-	{
-		TObjectPtr<UInventoryBarSlot> SlotCard = Cast<UInventoryBarSlot>(Widget);
-		if (SlotCard && SlotCard->GetDisplayedItem())
-		{
-			return true;
-		}
-	}
-	return false;	
+	return SlotCards.ContainsByPredicate([](const UInventoryBarSlot* SlotCard) { return SlotCard->GetDisplayedClass() != nullptr; });
 }
 
-UInventoryBarSlot* UInventoryBar::GetInventoryBarSlot(AInventory* Item) const
+UInventoryBarSlot* UInventoryBar::GetInventoryBarSlot(int32 Slot) const
 {
-	for (UWidget* Widget : WeaponBarHB->GetAllChildren())
-	{
-		UInventoryBarSlot* SlotCard = Cast<UInventoryBarSlot>(Widget);
-		if (SlotCard && Item && SlotCard->IsDisplaying(Item))
-		{
-			return SlotCard;
-		}
-	}
-	return nullptr;
+	return SlotCards.IsValidIndex(Slot) ? SlotCards[Slot] : nullptr;
 }
 
 void UInventoryBar::CreateInventoryCards(int32 Count)
@@ -76,11 +81,7 @@ void UInventoryBar::CreateInventoryCards(int32 Count)
 	{
 		for (int32 i = 0; i < Count; i++)
 		{
-			UInventoryBarSlot* SlotCard = !SlotWidgetCache.IsEmpty()
-				? SlotWidgetCache.Pop()
-				: CreateWidget<UInventoryBarSlot>(this, SlotWidgetClass);
-			SlotCard->DisplayEmptyText();
-			WeaponBarHB->AddChild(SlotCard);
+			AddInventoryCard();
 		}
 		SetVisibility(ESlateVisibility::Visible);
 	}
@@ -88,13 +89,27 @@ void UInventoryBar::CreateInventoryCards(int32 Count)
 
 void UInventoryBar::RemoveInventoryCards()
 {
-	for (UWidget* Widget : WeaponBarHB->GetAllChildren())
+	for (UInventoryBarSlot* SlotCard : SlotCards)
 	{
-		if (UInventoryBarSlot* SlotCard = Cast<UInventoryBarSlot>(Widget))
-		{
-			SlotCard->SetDisplayedItem(nullptr);
-			SlotWidgetCache.Push(SlotCard);
-		}
+		SlotCard->SetDisplayedItem(nullptr);
+		SlotWidgetCache.Push(SlotCard);
 	}
+	SlotCards.Reset();
+	ActiveCard = nullptr;
 	WeaponBarHB->ClearChildren();
 }
+
+UInventoryBarSlot* UInventoryBar::AddInventoryCard()
+{
+	UInventoryBarSlot* SlotCard = !SlotWidgetCache.IsEmpty()
+		? SlotWidgetCache.Pop()
+		: CreateWidget<UInventoryBarSlot>(this, SlotWidgetClass);
+	if (SlotCard == nullptr)
+	{
+		return nullptr;
+	}
+	SlotCard->DisplayEmptyText();
+	WeaponBarHB->AddChild(SlotCard);
+	SlotCards.Add(SlotCard);
+	return SlotCard;
+}
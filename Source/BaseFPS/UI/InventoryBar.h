@@ -8,7 +8,8 @@
 
 class UInventoryBarSlot;
 class UHorizontalBox;
-class AInventory;
+struct FInventoryEntry;
+struct FInventoryList;
 
 /**
  * 
@@ -30,18 +31,31 @@ private:
 	/** cached widgets to prevent needing to recreate */
 	UPROPERTY(Transient)
 	TArray<UInventoryBarSlot*> SlotWidgetCache;
+
+	/** the cards in WeaponBarHB, by inventory slot */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UInventoryBarSlot>> SlotCards;
+
+	/** the card currently shown as active */
+	UPROPERTY(Transient)
+	TObjectPtr<UInventoryBarSlot> ActiveCard;
 	
 public:
-	/** refreshes all inventory item cards in inventory bar */
-	void SetDisplayedInventory(TArray<AInventory*>& Inv);
+	/**
+	 * Brings the bar in line with the inventory: cards are added or removed at the end to match the slot count, and
+	 * every slot's card is refreshed from its entry (stowed items are displayed without their actors).
+	 */
+	void SetDisplayedInventory(const FInventoryList& Inv);
 
-	/** sets the specified item card as active in inventory bar */
-	void SetActiveItem(AInventory* NewActiveItem) const;
+	/** refreshes the single item card for the inventory slot, false if the bar has no card for it */
+	bool SetDisplayedItem(int32 Slot, const FInventoryEntry* Entry);
+
+	/** sets the card of the specified inventory slot as active in inventory bar, none if the slot is INDEX_NONE */
+	void SetActiveSlot(int32 Slot);
 	
-	bool ContainsItem(AInventory* Item) const;
 	bool ContainsItems() const;
 
-	UInventoryBarSlot* GetInventoryBarSlot(AInventory* Item) const;
+	UInventoryBarSlot* GetInventoryBarSlot(int32 Slot) const;
 
 protected:
 	UFUNCTION(BlueprintCallable, Category="InventoryBar")
@@ -50,4 +64,7 @@ protected:
 	UFUNCTION(BlueprintCallable, Category="InventoryBar")
 	void RemoveInventoryCards();
 
+private:
+	UInventoryBarSlot* AddInventoryCard();
+
 };
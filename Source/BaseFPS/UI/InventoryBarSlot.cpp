@@ -6,20 +6,26 @@
 #include "CommonNumericTextBlock.h"
 #include "Components/Border.h"
 #include "Components/Image.h"
+#include "Inventory/InventoryList.h"
 #include "Weapons/Weapon.h"
 
 static FName TextureParam = "TextureMask";
 
-void UInventoryBarSlot::SetDisplayedItem(AInventory* InInventory)
+void UInventoryBarSlot::SetDisplayedItem(const FInventoryEntry* Entry)
 {
-	DisplayedItem = InInventory;
-	if (DisplayedItem)
+	const TSubclassOf<AInventory> NewClass = Entry ? Entry->ItemClass : nullptr;
+	if (NewClass == nullptr)
 	{
-		if (AWeapon* Weapon = Cast<AWeapon>(DisplayedItem))
-		{
-			int32 TotalAmmo = Weapon->GetCurrentAmmoInClip() + Weapon->GetCurrentReserveAmmo();
-			SetAmmoCount(TotalAmmo);
+		DisplayedClass = nullptr;
+		DisplayEmptyText();
+		return;
+	}
 
+	if (NewClass != DisplayedClass)
+	{
+		DisplayedClass = NewClass;
+		if (const AWeapon* Weapon = Cast<AWeapon>(DisplayedClass.GetDefaultObject()))
+		{
 			if (UTexture2D* Icon = Weapon->GetPrimaryIcon())
 			{
 				WeaponCard->GetDynamicMaterial()->SetTextureParameterValue(TextureParam, Icon);
@@ -31,25 +37,22 @@ void UInventoryBarSlot::SetDisplayedItem(AInventory* InInventory)
 		}
 		ShowAsInactive(); // default to inactive
 	}
-	else
-	{
-		DisplayEmptyText();
-	}
+	SetAmmoCount(Entry->GetTotalAmmo());
 }
 
-AInventory* UInventoryBarSlot::GetDisplayedItem() const
+TSubclassOf<AInventory> UInventoryBarSlot::GetDisplayedClass() const
 {
-	return DisplayedItem;
+	return DisplayedClass;
 }
 
 bool UInventoryBarSlot::IsDisplaying(AInventory* TestInv) const
 {
-	return TestInv == DisplayedItem;
+	return DisplayedClass.Get() == (TestInv ? TestInv->GetClass() : nullptr);
 }
 
 void UInventoryBarSlot::SetActive(bool bIsActive) const
 {
-	if (DisplayedItem)
+	if (DisplayedClass)
 	{
 		if (bIsActive)
 		{
@@ -7,6 +7,7 @@
 #include "InventoryBarSlot.generated.h"
 
 class AInventory;
+struct FInventoryEntry;
 class UBorder;
 class UCommonTextBlock;
 class UCommonNumericTextBlock;
@@ -23,14 +24,16 @@ class BASEFPS_API UInventoryBarSlot : public UCommonUserWidget
 	GENERATED_BODY()
 
 protected:
-	/** the inventory actor that this card displays */
+	/** the class of the inventory item that this card displays, items are shown from their entry so stowed ones need no actor */
 	UPROPERTY(Transient)
-	TObjectPtr<AInventory> DisplayedItem;
+	TSubclassOf<AInventory> DisplayedClass;
 	
 public:
-	void SetDisplayedItem(AInventory* InInventory);
-	AInventory* GetDisplayedItem() const;
+	/** displays the inventory entry (its icons only change with its class), or the empty slot if Entry is null */
+	void SetDisplayedItem(const FInventoryEntry* Entry);
+	TSubclassOf<AInventory> GetDisplayedClass() const;
 
+	/** true if the card displays an item of TestInv's class (an empty card displays null) */
 	UFUNCTION(BlueprintPure, Category="InventoryCard")
 	bool IsDisplaying(AInventory* TestInv) const;
 	
@@ -40,4 +40,15 @@ void ABaseFPSProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor,
 
 		Destroy();
 	}
+}
+
+FManagedProjectileParams ABaseFPSProjectile::GetManagedParams() const
+{
+	FManagedProjectileParams Params;
+	Params.Radius = CollisionComp->GetUnscaledSphereRadius();
+	Params.GravityScale = ProjectileMovement->ProjectileGravityScale;
+	Params.Lifetime = InitialLifeSpan > 0.f ? InitialLifeSpan : Params.Lifetime;
+	Params.Bounciness = ProjectileMovement->Bounciness;
+	Params.MaxBounces = ProjectileMovement->bShouldBounce ? MAX_uint8 : 0; // bounces until its lifetime runs out
+	return Params;
 }
\ No newline at end of file
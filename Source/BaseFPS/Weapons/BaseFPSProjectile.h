@@ -4,10 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Weapons/ProjectileManagerSubsystem.h"
 #include "BaseFPSProjectile.generated.h"
 
 class USphereComponent;
 class UProjectileMovementComponent;
+class UStaticMesh;
 
 UCLASS(config=Game)
 class ABaseFPSProjectile : public AActor
@@ -29,6 +31,23 @@ public:
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/**
+	 * Fire this class through UProjectileManagerSubsystem instead of spawning it (see BaseFPS.Projectiles.Enable), the
+	 * defaults only describe how it flies and looks.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category="Projectile")
+	bool bSimulateWithManager = false;
+
+	/** drawn for managed projectiles, one instance per projectile facing along its velocity. None aren't drawn */
+	UPROPERTY(EditDefaultsOnly, Category="Projectile", meta=(EditCondition="bSimulateWithManager"))
+	UStaticMesh* ManagedMesh = nullptr;
+
+	UPROPERTY(EditDefaultsOnly, Category="Projectile", meta=(EditCondition="bSimulateWithManager"))
+	FVector ManagedMeshScale = FVector::OneVector;
+
+	/** how the manager simulates this projectile, built from the collision and movement defaults */
+	FManagedProjectileParams GetManagedParams() const;
+
 	/** Returns CollisionComp subobject **/
 	USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
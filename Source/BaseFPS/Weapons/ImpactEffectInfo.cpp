@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapons/ImpactEffectInfo.h"
+
+#include "Character/BaseFPSCharacter.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+FImpactEffectInfo FImpactEffectInfo::FromHit(const FHitResult& Hit)
+{
+	FImpactEffectInfo Info;
+	Info.bKnown = true;
+	Info.bBlockingHit = Hit.bBlockingHit;
+	if (Hit.bBlockingHit)
+	{
+		Info.bHitCharacter = Cast<ABaseFPSCharacter>(Hit.GetActor()) != nullptr;
+		Info.Normal = Hit.ImpactNormal;
+		Info.SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+	}
+	return Info;
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+/**
+ * What impact effects need to know about a shot's hit besides where it is. Taken from the hit result of whoever
+ * resolved the shot and sent along with it, so clients can spawn impact effects without tracing for the hit again.
+ */
+struct BASEFPS_API FImpactEffectInfo
+{
+	/** false if nothing is known about the hit, impact effects then trace for it themselves */
+	bool bKnown = false;
+
+	bool bBlockingHit = false;
+
+	bool bHitCharacter = false;
+
+	FVector Normal = FVector::ZeroVector;
+
+	TEnumAsByte<EPhysicalSurface> SurfaceType = SurfaceType_Default;
+
+	static FImpactEffectInfo FromHit(const FHitResult& Hit);
+};
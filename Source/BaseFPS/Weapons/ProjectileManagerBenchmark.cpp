@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapons/ProjectileManagerBenchmark.h"
+
+#include "BaseFPS.h"
+#include "Engine/World.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Weapons/BaseFPSProjectile.h"
+#include "Weapons/ProjectileManagerSubsystem.h"
+
+/* -------------- FAutoConsoleCommandWithWorldAndArgs -------------- */
+
+FAutoConsoleCommandWithWorldAndArgs ProjectileBenchmarkCmd(TEXT("BaseFPS.Projectiles.Benchmark"),
+	TEXT("Compares the frame time of managed projectiles against projectile actors. Usage: BaseFPS.Projectiles.Benchmark Class=/Game/... [Count=1000] [Actors=50] [Frames=300] [Radius=5000] [Quit=0]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UProjectileManagerBenchmark::FSettings Settings;
+		Settings.ParseArgs(Args);
+		UProjectileManagerBenchmark::Start(World, Settings);
+	})
+);
+
+// ----------------------------------------------------------------------------------------------------------
+
+namespace ProjectileBenchmark
+{
+	/** returns the given percentile (0-1) of the values */
+	double Percentile(TArray<double> Values, double Pct)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+		Values.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Pct * Values.Num()) - 1, 0, Values.Num() - 1);
+		return Values[Index];
+	}
+
+	double Average(const TArray<double>& Values)
+	{
+		double Sum = 0.0;
+		for (double Value : Values)
+		{
+			Sum += Value;
+		}
+		return Values.Num() > 0 ? Sum / Values.Num() : 0.0;
+	}
+}
+
+void UProjectileManagerBenchmark::FSettings::ParseArgs(const TArray<FString>& Args)
+{
+	const FString Cmd = FString::Join(Args, TEXT(" "));
+	FParse::Value(*Cmd, TEXT("Count="), NumProjectiles);
+	FParse::Value(*Cmd, TEXT("Actors="), NumActors);
+	FParse::Value(*Cmd, TEXT("Frames="), NumFrames);
+	FParse::Value(*Cmd, TEXT("Radius="), Radius);
+	FParse::Value(*Cmd, TEXT("Class="), ProjectileClassPath);
+	FParse::Bool(*Cmd, TEXT("Quit="), bQuitWhenDone);
+
+	NumProjectiles = FMath::Max(NumProjectiles, 0);
+	NumActors = FMath::Max(NumActors, 0);
+	NumFrames = FMath::Max(NumFrames, 1);
+}
+
+UProjectileManagerBenchmark* UProjectileManagerBenchmark::Start(UWorld* World, const FSettings& InSettings)
+{
+	UProjectileManagerSubsystem* Manager = World ? World->GetSubsystem<UProjectileManagerSubsystem>() : nullptr;
+	if (!Manager || World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogBaseFPS, Error, TEXT("Projectile benchmark: needs a server or standalone game world"));
+		return nullptr;
+	}
+
+	UClass* ProjectileClass = InSettings.ProjectileClassPath.IsEmpty() ? nullptr : LoadClass<ABaseFPSProjectile>(nullptr, *InSettings.ProjectileClassPath);
+	if (!UProjectileManagerSubsystem::ShouldManage(ProjectileClass))
+	{
+		UE_LOG(LogBaseFPS, Error, TEXT("Projectile benchmark: Class= has to be a projectile class that sets bSimulateWithManager (and BaseFPS.Projectiles.Enable 1)"));
+		return nullptr;
+	}
+
+	if (Manager->ActiveBenchmark)
+	{
+		UE_LOG(LogBaseFPS, Warning, TEXT("Projectile benchmark: a benchmark is already running"));
+		return nullptr;
+	}
+
+	UProjectileManagerBenchmark* Benchmark = NewObject<UProjectileManagerBenchmark>(Manager);
+	Benchmark->Settings = InSettings;
+	Benchmark->World = World;
+	Benchmark->ProjectileManager = Manager;
+	Benchmark->ProjectileClass = ProjectileClass;
+	Benchmark->Stream.Initialize(0x5A17);
+
+	for (TArray<double>& PhaseFrames : Benchmark->FrameMs)
+	{
+		PhaseFrames.Reserve(InSettings.NumFrames);
+	}
+	Benchmark->TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(Benchmark, &UProjectileManagerBenchmark::OnWorldTickStart);
+	Benchmark->TickEndHandle = FWorldDelegates::OnWorldTickEnd.AddUObject(Benchmark, &UProjectileManagerBenchmark::OnWorldTickEnd);
+	Benchmark->bRunning = true;
+	Manager->ActiveBenchmark = Benchmark;
+
+	UE_LOG(LogBaseFPS, Display, TEXT("Projectile benchmark: started with %d managed projectiles against %d actors of %s for %d frames each"),
+		InSettings.NumProjectiles, InSettings.NumActors, *GetNameSafe(ProjectileClass), InSettings.NumFrames);
+	return Benchmark;
+}
+
+void UProjectileManagerBenchmark::GetLaunch(FVector& OutLocation, FVector& OutVelocity)
+{
+	const float Speed = ProjectileClass->GetDefaultObject<ABaseFPSProjectile>()->GetProjectileMovement()->InitialSpeed;
+	OutLocation = FVector(Stream.FRandRange(-Settings.Radius, Settings.Radius), Stream.FRandRange(-Settings.Radius, Settings.Radius), 200.f);
+	OutVelocity = FRotator(Stream.FRandRange(20.f, 70.f), Stream.FRandRange(0.f, 360.f), 0.f).Vector() * Speed;
+}
+
+void UProjectileManagerBenchmark::TopUpManaged()
+{
+	UProjectileManagerSubsystem* Manager = ProjectileManager.Get();
+	for (int32 NumInFlight = Manager->GetNumProjectiles(); NumInFlight < Settings.NumProjectiles; NumInFlight++)
+	{
+		FVector Location, Velocity;
+		GetLaunch(Location, Velocity);
+		Manager->LaunchProjectile(ProjectileClass, Location, Velocity, nullptr);
+	}
+}
+
+void UProjectileManagerBenchmark::TopUpActors()
+{
+	SpawnedActors.RemoveAllSwap([](const AActor* Actor) { return !IsValid(Actor); }, false);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	while (SpawnedActors.Num() < Settings.NumActors)
+	{
+		FVector Location, Velocity;
+		GetLaunch(Location, Velocity);
+		AActor* Projectile = World->SpawnActor<ABaseFPSProjectile>(ProjectileClass, Location, Velocity.Rotation(), SpawnParams);
+		if (!Projectile)
+		{
+			break;
+		}
+		SpawnedActors.Add(Projectile);
+	}
+}
+
+void UProjectileManagerBenchmark::Tick(float DeltaTime)
+{
+	if (!ProjectileManager.IsValid())
+	{
+		Finish();
+		return;
+	}
+
+	if (Phase == EPhase::Managed)
+	{
+		TopUpManaged();
+	}
+	else if (Phase == EPhase::Actors)
+	{
+		TopUpActors();
+	}
+}
+
+TStatId UProjectileManagerBenchmark::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileManagerBenchmark, STATGROUP_Tickables);
+}
+
+void UProjectileManagerBenchmark::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld == World.Get())
+	{
+		TickStartTime = FPlatformTime::Seconds();
+	}
+}
+
+void UProjectileManagerBenchmark::OnWorldTickEnd(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (!bRunning || InWorld != World.Get() || TickStartTime == 0.0)
+	{
+		return;
+	}
+
+	// the actor phase waits for the last managed projectiles to run out, so it only pays for its own
+	const UProjectileManagerSubsystem* Manager = ProjectileManager.Get();
+	if (WarmupFrames > 0 || (Phase == EPhase::Actors && Manager && Manager->GetNumProjectiles() > 0))
+	{
+		WarmupFrames = FMath::Max(WarmupFrames - 1, 0);
+		return;
+	}
+
+	TArray<double>& PhaseFrames = FrameMs[(uint8)Phase];
+	PhaseFrames.Add((FPlatformTime::Seconds() - TickStartTime) * 1000.0);
+	if (PhaseFrames.Num() < Settings.NumFrames)
+	{
+		return;
+	}
+
+	if (Phase == EPhase::Actors)
+	{
+		Finish();
+		return;
+	}
+	Phase = (EPhase)((uint8)Phase + 1);
+	WarmupFrames = 30;
+}
+
+void UProjectileManagerBenchmark::Finish()
+{
+	bRunning = false;
+	LogResults();
+	Cleanup();
+
+	if (Settings.bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UProjectileManagerBenchmark::LogResults() const
+{
+	using namespace ProjectileBenchmark;
+
+	const TArray<double>& BaselineMs = FrameMs[(uint8)EPhase::Baseline];
+	const TArray<double>& ManagedMs = FrameMs[(uint8)EPhase::Managed];
+	const TArray<double>& ActorsMs = FrameMs[(uint8)EPhase::Actors];
+	if (ActorsMs.Num() < Settings.NumFrames)
+	{
+		UE_LOG(LogBaseFPS, Warning, TEXT("Projectile benchmark: stopped before every phase was recorded"));
+		return;
+	}
+
+	UE_LOG(LogBaseFPS, Display, TEXT("Projectile benchmark: baseline avg %.3f ms / p95 %.3f ms"), Average(BaselineMs), Percentile(BaselineMs, 0.95));
+	UE_LOG(LogBaseFPS, Display, TEXT("Projectile benchmark: %d managed avg %.3f ms / p95 %.3f ms"), Settings.NumProjectiles, Average(ManagedMs), Percentile(ManagedMs, 0.95));
+	UE_LOG(LogBaseFPS, Display, TEXT("Projectile benchmark: %d actors avg %.3f ms / p95 %.3f ms"), Settings.NumActors, Average(ActorsMs), Percentile(ActorsMs, 0.95));
+
+	const double ManagedCost = Average(ManagedMs) - Average(BaselineMs);
+	const double ActorsCost = Average(ActorsMs) - Average(BaselineMs);
+	UE_LOG(LogBaseFPS, Display, TEXT("Projectile benchmark: %d managed projectiles cost %.3f ms over the baseline, %d actors %.3f ms (%s)"),
+		Settings.NumProjectiles, ManagedCost, Settings.NumActors, ActorsCost, ManagedCost < ActorsCost ? TEXT("managed is cheaper") : TEXT("actors are cheaper"));
+}
+
+void UProjectileManagerBenchmark::Cleanup()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldTickEnd.Remove(TickEndHandle);
+
+	if (UProjectileManagerSubsystem* Manager = ProjectileManager.Get())
+	{
+		Manager->ActiveBenchmark = nullptr;
+	}
+
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (IsValid(Actor))
+		{
+			Actor->Destroy();
+		}
+	}
+	SpawnedActors.Empty();
+}
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "UObject/Object.h"
+#include "ProjectileManagerBenchmark.generated.h"
+
+class ABaseFPSProjectile;
+class UProjectileManagerSubsystem;
+
+/**
+ * Frame time benchmark for {@code UProjectileManagerSubsystem} against projectile actors. Times the whole world tick in
+ * three phases of a fixed number of frames each: nothing launched (the baseline), a constant number of managed
+ * projectiles in flight, then a (smaller) constant number of the same projectile spawned as actors. Each phase's
+ * cost over the baseline is logged, the goal being 1,000 managed projectiles costing less than 50 actors, e.g.
+ *		UnrealEditor-Cmd BaseFPS.uproject <Map> -game -nullrhi -nosound -ExecCmds="BaseFPS.Projectiles.Benchmark Class=/Game/...BP_Grenade_C Quit=1"
+ * The projectile class has to set bSimulateWithManager. Runs on any server or standalone world.
+ */
+UCLASS(Transient)
+class BASEFPS_API UProjectileManagerBenchmark : public UObject, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	struct FSettings
+	{
+		/** managed projectiles kept in flight during the managed phase */
+		int32 NumProjectiles = 1000;
+
+		/** projectile actors kept in flight during the actor phase */
+		int32 NumActors = 50;
+
+		/** number of frames to record per phase */
+		int32 NumFrames = 300;
+
+		/** radius of the area projectiles are launched from */
+		float Radius = 5000.f;
+
+		/** the projectile class fired in both phases */
+		FString ProjectileClassPath;
+
+		/** request engine exit once the results are logged */
+		bool bQuitWhenDone = false;
+
+		/** parses "Key=Value" console arguments */
+		void ParseArgs(const TArray<FString>& Args);
+	};
+
+	/** starts a benchmark on the world's projectile manager, returns null if the world can't run one */
+	static UProjectileManagerBenchmark* Start(UWorld* World, const FSettings& InSettings);
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual bool IsTickable() const override { return bRunning; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return World.Get(); }
+	//~ End FTickableGameObject interface
+
+private:
+	enum class EPhase : uint8
+	{
+		Baseline,
+		Managed,
+		Actors,
+		Num
+	};
+
+	FSettings Settings;
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<UProjectileManagerSubsystem> ProjectileManager;
+	TSubclassOf<ABaseFPSProjectile> ProjectileClass;
+
+	/** the actor phase's projectiles, topped up as they expire */
+	UPROPERTY()
+	TArray<TObjectPtr<AActor>> SpawnedActors;
+
+	/** world tick times in milliseconds, by phase */
+	TArray<double> FrameMs[(uint8)EPhase::Num];
+
+	EPhase Phase = EPhase::Baseline;
+
+	/** frames left to skip before recording the phase, lets the number in flight settle */
+	int32 WarmupFrames = 30;
+
+	FRandomStream Stream;
+	double TickStartTime = 0.0;
+	bool bRunning = false;
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle TickEndHandle;
+
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnWorldTickEnd(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	/** a random launch over the benchmark area, aimed upwards so projectiles fly out their lifetime */
+	void GetLaunch(FVector& OutLocation, FVector& OutVelocity);
+
+	void TopUpManaged();
+	void TopUpActors();
+
+	/** logs the results and tears down everything the benchmark created */
+	void Finish();
+	void LogResults() const;
+	void Cleanup();
+};
@@ -0,0 +1,563 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapons/ProjectileManagerSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Player/BaseFPSPlayerController.h"
+#include "Weapons/BaseFPSProjectile.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles: Active"), STAT_BaseFPS_ProjectilesActive, STATGROUP_BaseFPS);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles: Impacts"), STAT_BaseFPS_ProjectilesImpacts, STATGROUP_BaseFPS);
+DECLARE_CYCLE_STAT(TEXT("Projectiles: Simulate"), STAT_BaseFPS_ProjectilesSimulate, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_Projectiles_Enable = 1;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesEnable(TEXT("BaseFPS.Projectiles.Enable"), CVar_BaseFPS_Projectiles_Enable, TEXT("Projectile classes that opt in are simulated by the projectile manager instead of being spawned as actors"), ECVF_Default );
+
+float CVar_BaseFPS_Projectiles_FixedStep = 1.f / 60.f;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesFixedStep(TEXT("BaseFPS.Projectiles.FixedStep"), CVar_BaseFPS_Projectiles_FixedStep, TEXT("Seconds per simulation step, must match on server and clients"), ECVF_Default );
+
+int32 CVar_BaseFPS_Projectiles_MaxStepsPerFrame = 8;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesMaxStepsPerFrame(TEXT("BaseFPS.Projectiles.MaxStepsPerFrame"), CVar_BaseFPS_Projectiles_MaxStepsPerFrame, TEXT("Steps a single projectile may take in one frame, projectiles that fall behind catch up over the next frames"), ECVF_Default );
+
+int32 CVar_BaseFPS_Projectiles_MinParallelBatchSize = 32;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesMinParallelBatchSize(TEXT("BaseFPS.Projectiles.MinParallelBatchSize"), CVar_BaseFPS_Projectiles_MinParallelBatchSize, TEXT("Fewer projectiles than this are simulated on the game thread"), ECVF_Default );
+
+float CVar_BaseFPS_Projectiles_NetCullDistance = 15000.f;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesNetCullDistance(TEXT("BaseFPS.Projectiles.NetCullDistance"), CVar_BaseFPS_Projectiles_NetCullDistance, TEXT("Distance in cm from a connection's viewpoint a projectile has to come within before its spawn is sent there, the client that launched it is always sent it"), ECVF_Default );
+
+float CVar_BaseFPS_Projectiles_MaxClientLaunchOffset = 500.f;
+static FAutoConsoleVariableRef CVarBaseFPSProjectilesMaxClientLaunchOffset(TEXT("BaseFPS.Projectiles.MaxClientLaunchOffset"), CVar_BaseFPS_Projectiles_MaxClientLaunchOffset, TEXT("Distance in cm from its pawn a client may launch a projectile from, launches from further away are rejected by the server"), ECVF_Default );
+
+// ----------------------------------------------------------------------------------------------------------
+
+namespace ProjectileManager
+{
+	/** ids from here on are local-only projectiles, anything below is launched (and sent) by the server */
+	static constexpr uint32 LocalIdBase = 0x80000000;
+
+	static const FName CollisionProfile(TEXT("Projectile"));
+
+	/** rounds like FVector_NetQuantize so the server simulates from the values clients receive */
+	static FVector Quantize(const FVector& V)
+	{
+		return FVector(FMath::RoundToDouble(V.X), FMath::RoundToDouble(V.Y), FMath::RoundToDouble(V.Z));
+	}
+}
+
+void FProjectileEventBatch::Reset()
+{
+	Spawns.Reset();
+	Impacts.Reset();
+}
+
+bool UProjectileManagerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UProjectileManagerSubsystem::Deinitialize()
+{
+	Ids.Empty();
+	Positions.Empty();
+	Velocities.Empty();
+	SpawnTimes.Empty();
+	StepsTaken.Empty();
+	Owners.Empty();
+	ProjectileParams.Empty();
+	BouncesLeft.Empty();
+	VisualGroupIndices.Empty();
+	LaunchInfos.Empty();
+	StepResults.Empty();
+
+	if (AActor* Actor = VisualsActor.Get())
+	{
+		Actor->Destroy();
+	}
+	VisualsActor.Reset();
+	VisualGroups.Empty();
+	ClassToVisualGroup.Empty();
+
+	PendingImpacts.Empty();
+	PendingExpired.Empty();
+	ConnectionStates.Empty();
+	Batch.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UProjectileManagerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UProjectileManagerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Ids.Num() > 0)
+	{
+		SimulateProjectiles();
+	}
+	SET_DWORD_STAT(STAT_BaseFPS_ProjectilesActive, Ids.Num());
+
+	if (VisualGroups.Num() > 0)
+	{
+		UpdateVisuals();
+	}
+
+	if (GetWorld()->GetNetMode() != NM_Client)
+	{
+		SendPendingEvents();
+	}
+}
+
+TStatId UProjectileManagerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileManagerSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectileManagerSubsystem::IsEnabled()
+{
+	return CVar_BaseFPS_Projectiles_Enable > 0;
+}
+
+bool UProjectileManagerSubsystem::ShouldManage(TSubclassOf<ABaseFPSProjectile> ProjectileClass)
+{
+	const ABaseFPSProjectile* ProjectileCDO = ProjectileClass ? ProjectileClass->GetDefaultObject<ABaseFPSProjectile>() : nullptr;
+	return ProjectileCDO && ProjectileCDO->bSimulateWithManager && IsEnabled();
+}
+
+bool UProjectileManagerSubsystem::IsPlausibleClientLaunch(const AActor* Shooter, const FVector& Location)
+{
+	return Shooter && FVector::DistSquared(Shooter->GetActorLocation(), Location) <= FMath::Square(CVar_BaseFPS_Projectiles_MaxClientLaunchOffset);
+}
+
+uint32 UProjectileManagerSubsystem::LaunchProjectile(TSubclassOf<ABaseFPSProjectile> ProjectileClass, const FVector& Location, const FVector& Velocity, AActor* Owner, APlayerController* PredictingController, uint32 PredictedId)
+{
+	if (!ShouldManage(ProjectileClass))
+	{
+		return 0;
+	}
+
+	const FVector QuantizedLocation = ProjectileManager::Quantize(Location);
+	const FVector QuantizedVelocity = ProjectileManager::Quantize(Velocity);
+	const float SpawnTime = GetSimTime();
+
+	// a client's projectile is only a prediction, it's replaced by the server's once that one arrives (see HandleEventBatch)
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		LastLocalId = (LastLocalId + 1) % ProjectileManager::LocalIdBase;
+		const uint32 Id = ProjectileManager::LocalIdBase | LastLocalId;
+		AddProjectile(Id, QuantizedLocation, QuantizedVelocity, SpawnTime, ProjectileClass, Owner);
+		return Id;
+	}
+
+	// ids wrap around the lower half, skipping 0 so it can mean no projectile
+	LastReplicatedId = FMath::Max((LastReplicatedId + 1) % ProjectileManager::LocalIdBase, 1u);
+	const uint32 Id = LastReplicatedId;
+	const int32 Index = AddProjectile(Id, QuantizedLocation, QuantizedVelocity, SpawnTime, ProjectileClass, Owner);
+
+	// sent to connections as the projectile comes into their view (see SendPendingEvents)
+	FLaunchInfo& LaunchInfo = LaunchInfos[Index];
+	LaunchInfo.PredictingController = PredictingController;
+	LaunchInfo.PredictedId = PredictingController ? PredictedId : 0;
+	return Id;
+}
+
+void UProjectileManagerSubsystem::HandleEventBatch(const FProjectileEventBatch& InBatch)
+{
+	for (const FProjectileSpawnEvent& Event : InBatch.Spawns)
+	{
+		if (Event.PredictedId != 0)
+		{
+			// our own launch, the predicted projectile carries on as the server's. If it has already stopped here there's
+			// nothing left to reconcile, the server's impact for it is ignored below
+			const int32 PredictedIndex = Ids.IndexOfByKey(Event.PredictedId);
+			if (PredictedIndex != INDEX_NONE)
+			{
+				Ids[PredictedIndex] = Event.Id;
+			}
+		}
+		else if (!Ids.Contains(Event.Id))
+		{
+			// flight since the launch is caught up on over the next frames (see MaxStepsPerFrame)
+			AddProjectile(Event.Id, Event.Location, Event.Velocity, Event.SpawnTime, Event.ProjectileClass, Event.Owner);
+		}
+	}
+
+	for (const FProjectileImpactEvent& Event : InBatch.Impacts)
+	{
+		// may have already hit something here
+		const int32 Index = Ids.IndexOfByKey(Event.Id);
+		if (Index != INDEX_NONE)
+		{
+			FManagedProjectileImpact Impact;
+			Impact.Id = Event.Id;
+			Impact.Location = Event.Location;
+			Impact.Normal = Event.Normal;
+			Impact.Owner = Owners[Index];
+			OnProjectileImpact.Broadcast(Impact);
+
+			RemoveProjectile(Index);
+		}
+	}
+}
+
+int32 UProjectileManagerSubsystem::AddProjectile(uint32 Id, const FVector& Location, const FVector& Velocity, float SpawnTime, TSubclassOf<ABaseFPSProjectile> ProjectileClass, AActor* Owner)
+{
+	const ABaseFPSProjectile* ProjectileCDO = ProjectileClass ? ProjectileClass->GetDefaultObject<ABaseFPSProjectile>() : GetDefault<ABaseFPSProjectile>();
+	const FManagedProjectileParams Params = ProjectileCDO->GetManagedParams();
+
+	Ids.Add(Id);
+	Positions.Add(Location);
+	Velocities.Add(Velocity);
+	SpawnTimes.Add(SpawnTime);
+	StepsTaken.Add(0);
+	Owners.Add(Owner);
+	ProjectileParams.Add(Params);
+	BouncesLeft.Add(Params.MaxBounces);
+	VisualGroupIndices.Add(GetVisualGroup(ProjectileCDO->GetClass()));
+
+	FLaunchInfo& LaunchInfo = LaunchInfos.AddDefaulted_GetRef();
+	LaunchInfo.Location = Location;
+	LaunchInfo.Velocity = Velocity;
+	LaunchInfo.ProjectileClass = ProjectileCDO->GetClass();
+	return LaunchInfos.Num() - 1;
+}
+
+void UProjectileManagerSubsystem::RemoveProjectile(int32 Index)
+{
+	Ids.RemoveAtSwap(Index, 1, false);
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	SpawnTimes.RemoveAtSwap(Index, 1, false);
+	StepsTaken.RemoveAtSwap(Index, 1, false);
+	Owners.RemoveAtSwap(Index, 1, false);
+	ProjectileParams.RemoveAtSwap(Index, 1, false);
+	BouncesLeft.RemoveAtSwap(Index, 1, false);
+	VisualGroupIndices.RemoveAtSwap(Index, 1, false);
+	LaunchInfos.RemoveAtSwap(Index, 1, false);
+}
+
+void UProjectileManagerSubsystem::StepProjectile(const UWorld* World, int32 Index, float SimTime, float GravityZ, FStepResult& OutResult)
+{
+	const FManagedProjectileParams& Params = ProjectileParams[Index];
+	const float Step = FMath::Max(CVar_BaseFPS_Projectiles_FixedStep, KINDA_SMALL_NUMBER);
+	const float Age = SimTime - SpawnTimes[Index];
+
+	// steps are counted from the launch, so every machine takes the same ones no matter its frame rate
+	const int32 TargetSteps = FMath::FloorToInt(FMath::Min(Age, Params.Lifetime) / Step);
+	const int32 NumSteps = FMath::Min(TargetSteps - StepsTaken[Index], CVar_BaseFPS_Projectiles_MaxStepsPerFrame);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ManagedProjectile), false, Owners[Index].Get());
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(Params.Radius);
+	const FVector StepGravity(0.f, 0.f, GravityZ * Params.GravityScale * Step);
+
+	FVector Location = Positions[Index];
+	FVector Velocity = Velocities[Index];
+	int32 Taken = 0;
+	while (Taken < NumSteps)
+	{
+		const FVector NewVelocity = Velocity + StepGravity;
+		const FVector End = Location + (Velocity + NewVelocity) * (0.5f * Step);
+		++Taken;
+
+		if (World->SweepSingleByProfile(OutResult.Hit, Location, End, FQuat::Identity, ProjectileManager::CollisionProfile, Shape, QueryParams))
+		{
+			OutResult.bHit = true;
+			Location = OutResult.Hit.Location;
+			Velocity = NewVelocity;
+			break;
+		}
+		Location = End;
+		Velocity = NewVelocity;
+	}
+
+	Positions[Index] = Location;
+	Velocities[Index] = Velocity;
+	StepsTaken[Index] += Taken;
+	OutResult.bExpired = !OutResult.bHit && Age >= Params.Lifetime && StepsTaken[Index] >= TargetSteps;
+}
+
+void UProjectileManagerSubsystem::SimulateProjectiles()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_ProjectilesSimulate);
+
+	const UWorld* World = GetWorld();
+	const float SimTime = GetSimTime();
+	const float GravityZ = World->GetGravityZ();
+
+	StepResults.Reset();
+	StepResults.SetNum(Ids.Num());
+
+	// scene queries only read from the physics scene, nothing is allowed to move it until the batch is done
+	const EParallelForFlags Flags = Ids.Num() < CVar_BaseFPS_Projectiles_MinParallelBatchSize ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+	ParallelFor(Ids.Num(), [this, World, SimTime, GravityZ](int32 Index)
+	{
+		StepProjectile(World, Index, SimTime, GravityZ, StepResults[Index]);
+	}, Flags);
+
+	// back to front, removing swaps in a projectile that has already been handled
+	const bool bAuthority = World->GetNetMode() != NM_Client;
+	for (int32 Index = Ids.Num() - 1; Index >= 0; --Index)
+	{
+		const FStepResult& Result = StepResults[Index];
+		if (Result.bHit && HandleHit(Index, Result.Hit))
+		{
+			RemoveProjectile(Index);
+		}
+		else if (Result.bExpired)
+		{
+			if (bAuthority)
+			{
+				PendingExpired.Add(Ids[Index]);
+			}
+			RemoveProjectile(Index);
+		}
+	}
+}
+
+bool UProjectileManagerSubsystem::HandleHit(int32 Index, const FHitResult& Hit)
+{
+	UPrimitiveComponent* HitComp = Hit.GetComponent();
+	const bool bHitPhysics = HitComp && HitComp->IsSimulatingPhysics();
+
+	// bounces off anything that isn't simulating physics, same as ABaseFPSProjectile
+	if (!bHitPhysics && BouncesLeft[Index] > 0)
+	{
+		const FVector Normal = Hit.Normal;
+		FVector& Velocity = Velocities[Index];
+		Velocity -= (1.f + ProjectileParams[Index].Bounciness) * (Velocity | Normal) * Normal;
+		BouncesLeft[Index]--;
+		return false;
+	}
+
+	const bool bAuthority = GetWorld()->GetNetMode() != NM_Client;
+	if (bHitPhysics && bAuthority)
+	{
+		HitComp->AddImpulseAtLocation(Velocities[Index] * 100.f, Hit.ImpactPoint);
+	}
+
+	INC_DWORD_STAT(STAT_BaseFPS_ProjectilesImpacts);
+
+	FManagedProjectileImpact Impact;
+	Impact.Id = Ids[Index];
+	Impact.Location = Hit.ImpactPoint;
+	Impact.Normal = Hit.ImpactNormal;
+	Impact.HitActor = bAuthority ? Hit.GetActor() : nullptr;
+	Impact.Owner = Owners[Index];
+	OnProjectileImpact.Broadcast(Impact);
+
+	if (bAuthority && Impact.Id < ProjectileManager::LocalIdBase)
+	{
+		FProjectileImpactEvent& Event = PendingImpacts.AddDefaulted_GetRef();
+		Event.Id = Impact.Id;
+		Event.Location = Impact.Location;
+		Event.Normal = Impact.Normal;
+	}
+	return true;
+}
+
+float UProjectileManagerSubsystem::GetSimTime() const
+{
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+int32 UProjectileManagerSubsystem::GetVisualGroup(TSubclassOf<ABaseFPSProjectile> ProjectileClass)
+{
+	UWorld* World = GetWorld();
+	if (World->GetNetMode() == NM_DedicatedServer)
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* GroupIndex = ClassToVisualGroup.Find(ProjectileClass.Get()))
+	{
+		return *GroupIndex;
+	}
+
+	const ABaseFPSProjectile* ProjectileCDO = ProjectileClass->GetDefaultObject<ABaseFPSProjectile>();
+	if (!ProjectileCDO->ManagedMesh)
+	{
+		ClassToVisualGroup.Add(ProjectileClass.Get(), INDEX_NONE);
+		return INDEX_NONE;
+	}
+
+	AActor* Actor = VisualsActor.Get();
+	if (!Actor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		Actor = World->SpawnActor<AActor>(SpawnParams);
+		if (!Actor)
+		{
+			return INDEX_NONE;
+		}
+
+		USceneComponent* Root = NewObject<USceneComponent>(Actor, TEXT("Root"));
+		Actor->SetRootComponent(Root);
+		Root->RegisterComponent();
+		VisualsActor = Actor;
+	}
+
+	// instances are placed in world space, the component stays at the origin
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(Actor);
+	Instances->SetStaticMesh(ProjectileCDO->ManagedMesh);
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCanEverAffectNavigation(false);
+	Instances->SetupAttachment(Actor->GetRootComponent());
+	Instances->RegisterComponent();
+
+	const int32 GroupIndex = VisualGroups.AddDefaulted();
+	VisualGroups[GroupIndex].Scale = ProjectileCDO->ManagedMeshScale;
+	VisualGroups[GroupIndex].Instances = Instances;
+	ClassToVisualGroup.Add(ProjectileClass.Get(), GroupIndex);
+	return GroupIndex;
+}
+
+void UProjectileManagerSubsystem::UpdateVisuals()
+{
+	for (FVisualGroup& Group : VisualGroups)
+	{
+		Group.Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Ids.Num(); ++Index)
+	{
+		const int32 GroupIndex = VisualGroupIndices[Index];
+		if (GroupIndex != INDEX_NONE)
+		{
+			FVisualGroup& Group = VisualGroups[GroupIndex];
+			Group.Transforms.Emplace(Velocities[Index].Rotation(), Positions[Index], Group.Scale);
+		}
+	}
+
+	// instances are reused in any order, only the count changes when projectiles come and go
+	for (FVisualGroup& Group : VisualGroups)
+	{
+		UInstancedStaticMeshComponent* Instances = Group.Instances.Get();
+		if (!Instances)
+		{
+			continue;
+		}
+
+		const int32 NumInstances = Instances->GetInstanceCount();
+		const int32 NumTransforms = Group.Transforms.Num();
+		if (NumTransforms == 0)
+		{
+			if (NumInstances > 0)
+			{
+				Instances->ClearInstances();
+			}
+			continue;
+		}
+
+		if (NumInstances > NumTransforms)
+		{
+			TArray<int32> Removed;
+			for (int32 InstanceIndex = NumTransforms; InstanceIndex < NumInstances; ++InstanceIndex)
+			{
+				Removed.Add(InstanceIndex);
+			}
+			Instances->RemoveInstances(Removed);
+		}
+		else if (NumInstances < NumTransforms)
+		{
+			const TArray<FTransform> Added(Group.Transforms.GetData() + NumInstances, NumTransforms - NumInstances);
+			Instances->AddInstances(Added, false, true);
+		}
+		Instances->BatchUpdateInstancesTransforms(0, Group.Transforms, true, true, true);
+	}
+}
+
+void UProjectileManagerSubsystem::SendPendingEvents()
+{
+	UWorld* World = GetWorld();
+	const float NetCullDistSq = FMath::Square(CVar_BaseFPS_Projectiles_NetCullDistance);
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		ABaseFPSPlayerController* PC = Cast<ABaseFPSPlayerController>(It->Get());
+		if (!PC || PC->IsLocalController() || !PC->GetNetConnection())
+		{
+			continue;
+		}
+
+		FConnectionState& State = ConnectionStates.FindOrAdd(PC);
+		Batch.Reset();
+
+		// spawns for projectiles that came into view, the client simulates the flight it missed
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		for (int32 Index = 0; Index < Ids.Num(); ++Index)
+		{
+			const FLaunchInfo& LaunchInfo = LaunchInfos[Index];
+			const bool bPredicted = LaunchInfo.PredictingController == PC;
+			if ((!bPredicted && FVector::DistSquared(Positions[Index], ViewLocation) > NetCullDistSq) || State.KnownProjectiles.Contains(Ids[Index]))
+			{
+				continue;
+			}
+
+			FProjectileSpawnEvent& Event = Batch.Spawns.AddDefaulted_GetRef();
+			Event.Id = Ids[Index];
+			Event.PredictedId = bPredicted ? LaunchInfo.PredictedId : 0;
+			Event.Location = LaunchInfo.Location;
+			Event.Velocity = LaunchInfo.Velocity;
+			Event.SpawnTime = SpawnTimes[Index];
+			Event.Owner = Owners[Index].Get();
+			Event.ProjectileClass = LaunchInfo.ProjectileClass;
+			State.KnownProjectiles.Add(Ids[Index]);
+		}
+
+		for (const FProjectileImpactEvent& Impact : PendingImpacts)
+		{
+			if (State.KnownProjectiles.Remove(Impact.Id) > 0)
+			{
+				Batch.Impacts.Add(Impact);
+			}
+		}
+
+		// clients stop these on their own, same lifetime and the same steps
+		for (uint32 Id : PendingExpired)
+		{
+			State.KnownProjectiles.Remove(Id);
+		}
+
+		if (!Batch.IsEmpty())
+		{
+			PC->ClientProjectileEvents(Batch);
+		}
+	}
+
+	PendingImpacts.Reset();
+	PendingExpired.Reset();
+
+	for (auto It = ConnectionStates.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ProjectileManagerSubsystem.generated.h"
+
+class ABaseFPSProjectile;
+class APlayerController;
+class UInstancedStaticMeshComponent;
+class UProjectileManagerBenchmark;
+
+/** How a managed projectile flies, the same for every projectile of a kind (see ABaseFPSProjectile::GetManagedParams()) */
+USTRUCT()
+struct BASEFPS_API FManagedProjectileParams
+{
+	GENERATED_BODY()
+
+	/** collision sphere radius */
+	UPROPERTY()
+	float Radius = 5.f;
+
+	/** scales the world's gravity, zero flies straight */
+	UPROPERTY()
+	float GravityScale = 1.f;
+
+	/** seconds until the projectile is removed without an impact */
+	UPROPERTY()
+	float Lifetime = 3.f;
+
+	/** velocity kept along the normal when bouncing */
+	UPROPERTY()
+	float Bounciness = 0.6f;
+
+	/** bounces before the projectile stops at a blocking hit */
+	UPROPERTY()
+	uint8 MaxBounces = 0;
+};
+
+/** [server] a projectile was launched, clients simulate its flight from this on their own */
+USTRUCT()
+struct BASEFPS_API FProjectileSpawnEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Id = 0;
+
+	/** the id the receiving client predicted this projectile with, 0 if it didn't launch it */
+	UPROPERTY()
+	uint32 PredictedId = 0;
+
+	/** launch location and velocity, already quantized so both sides simulate from the same values */
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FVector_NetQuantize Velocity;
+
+	/** server world time of the launch, used by clients to catch up on the flight they missed */
+	UPROPERTY()
+	float SpawnTime = 0.f;
+
+	UPROPERTY()
+	TObjectPtr<AActor> Owner = nullptr;
+
+	/** flight params and visuals come from the class defaults, on the server and clients alike */
+	UPROPERTY()
+	TSubclassOf<ABaseFPSProjectile> ProjectileClass;
+};
+
+/** [server] a projectile stopped at a blocking hit */
+USTRUCT()
+struct BASEFPS_API FProjectileImpactEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Id = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Normal;
+};
+
+/** Every projectile event a connection gets to see in a frame */
+USTRUCT()
+struct BASEFPS_API FProjectileEventBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FProjectileSpawnEvent> Spawns;
+
+	UPROPERTY()
+	TArray<FProjectileImpactEvent> Impacts;
+
+	bool IsEmpty() const { return Spawns.Num() == 0 && Impacts.Num() == 0; }
+	void Reset();
+};
+
+/** A projectile's final impact, broadcast on both the server and clients (e.g. for impact effects) */
+struct FManagedProjectileImpact
+{
+	uint32 Id = 0;
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::UpVector;
+
+	/** [server] what was hit, null on clients */
+	TWeakObjectPtr<AActor> HitActor;
+	TWeakObjectPtr<AActor> Owner;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnManagedProjectileImpact, const FManagedProjectileImpact& /* Impact */);
+
+/**
+ * Per-world simulation for projectiles that don't need to be actors. Projectiles are kept as flat arrays (position,
+ * velocity, spawn time, owner, ...) and advanced once per frame in a ParallelFor, each projectile sweeping its
+ * own path through read-only scene queries, same as the hitscan batch in UWeaponFireQueueSubsystem. Hits are then
+ * applied on the game thread.
+ *
+ * Flight is integrated in fixed steps counted from the projectile's spawn time, so the server and clients take the
+ * same steps from the same (quantized) launch values. Only spawn and impact events are sent, batched per connection
+ * and frame; clients simulate the flight themselves, and the server's impact stops a projectile that is still flying
+ * on the client. A connection is sent a projectile's spawn once the projectile comes within NetCullDistance of its
+ * viewer, and only gets the impacts of projectiles it was sent.
+ *
+ * Only the server launches projectiles that count. A client's launch is a prediction under a local id: the caller
+ * sends it to the server (see {@code AWeapon::ServerFireProjectile}), which launches the real projectile and sends
+ * the spawn back with the predicted id, so the client's projectile carries on under the server's id.
+ *
+ * Projectiles are drawn with their class' ManagedMesh, one instanced mesh per class. See BaseFPS.Projectiles.*
+ */
+UCLASS()
+class BASEFPS_API UProjectileManagerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	static bool IsEnabled();
+
+	/**
+	 * Launches a projectile of ProjectileClass, flying as its GetManagedParams() say. On the server it's simulated
+	 * with authority and sent to clients, on a client it's a prediction the caller has to send to the server.
+	 * @param PredictingController [server] the client that already launched the projectile as PredictedId
+	 * @return the projectile's id, 0 if ProjectileClass isn't managed
+	 */
+	uint32 LaunchProjectile(TSubclassOf<ABaseFPSProjectile> ProjectileClass, const FVector& Location, const FVector& Velocity, AActor* Owner, APlayerController* PredictingController = nullptr, uint32 PredictedId = 0);
+
+	/** true if ProjectileClass is launched through the manager rather than spawned as an actor */
+	static bool ShouldManage(TSubclassOf<ABaseFPSProjectile> ProjectileClass);
+
+	/** [server] true if a client's launch from Location is close enough to its pawn to be believed (see MaxClientLaunchOffset) */
+	static bool IsPlausibleClientLaunch(const AActor* Shooter, const FVector& Location);
+
+	/** [client] starts simulating projectiles launched on the server and stops the ones that hit something */
+	void HandleEventBatch(const FProjectileEventBatch& Batch);
+
+	int32 GetNumProjectiles() const { return Ids.Num(); }
+	const TArray<FVector>& GetProjectilePositions() const { return Positions; }
+	const TArray<FVector>& GetProjectileVelocities() const { return Velocities; }
+
+	/** broadcast when a projectile stops at a blocking hit */
+	FOnManagedProjectileImpact OnProjectileImpact;
+
+	/** the load benchmark running in this world, if any (see BaseFPS.Projectiles.Benchmark) */
+	UPROPERTY(Transient)
+	TObjectPtr<UProjectileManagerBenchmark> ActiveBenchmark;
+
+private:
+	/* -------------- Projectiles (one entry per projectile in every array) -------------- */
+
+	TArray<uint32> Ids;
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> SpawnTimes;
+	TArray<int32> StepsTaken;
+	TArray<TWeakObjectPtr<AActor>> Owners;
+	TArray<FManagedProjectileParams> ProjectileParams;
+	TArray<uint8> BouncesLeft;
+
+	/** index into VisualGroups, INDEX_NONE for projectiles that aren't drawn */
+	TArray<int32> VisualGroupIndices;
+
+	/** [server] what a projectile was launched with, only read when its spawn is sent */
+	struct FLaunchInfo
+	{
+		FVector Location = FVector::ZeroVector;
+		FVector Velocity = FVector::ZeroVector;
+		TSubclassOf<ABaseFPSProjectile> ProjectileClass;
+		TWeakObjectPtr<APlayerController> PredictingController;
+		uint32 PredictedId = 0;
+	};
+	TArray<FLaunchInfo> LaunchInfos;
+
+	/** this frame's sweep results, reused between frames */
+	struct FStepResult
+	{
+		FHitResult Hit;
+		bool bHit = false;
+		bool bExpired = false;
+	};
+	TArray<FStepResult> StepResults;
+
+	int32 AddProjectile(uint32 Id, const FVector& Location, const FVector& Velocity, float SpawnTime, TSubclassOf<ABaseFPSProjectile> ProjectileClass, AActor* Owner);
+	void RemoveProjectile(int32 Index);
+
+	/** advances a projectile up to the given time, safe to call from worker threads while the batch is running */
+	void StepProjectile(const UWorld* World, int32 Index, float SimTime, float GravityZ, FStepResult& OutResult);
+
+	/** advances every projectile and applies their hits */
+	void SimulateProjectiles();
+
+	/** bounces or stops a projectile at a blocking hit, returns true if it stopped */
+	bool HandleHit(int32 Index, const FHitResult& Hit);
+
+	/** server world time, the clock every projectile's steps are counted on */
+	float GetSimTime() const;
+
+	/* -------------- Visuals -------------- */
+
+	/** [local] the instances drawing every projectile of a class */
+	struct FVisualGroup
+	{
+		FVector Scale = FVector::OneVector;
+		TWeakObjectPtr<UInstancedStaticMeshComponent> Instances;
+
+		/** this frame's instance transforms, reused between frames */
+		TArray<FTransform> Transforms;
+	};
+	TArray<FVisualGroup> VisualGroups;
+	TMap<TObjectKey<UClass>, int32> ClassToVisualGroup;
+
+	/** [local] owns the instanced mesh components */
+	TWeakObjectPtr<AActor> VisualsActor;
+
+	/** the class' visual group, created on first use. INDEX_NONE without a ManagedMesh or on dedicated servers */
+	int32 GetVisualGroup(TSubclassOf<ABaseFPSProjectile> ProjectileClass);
+
+	/** moves every group's instances to their projectile */
+	void UpdateVisuals();
+
+	/* -------------- Replication -------------- */
+
+	/** [server] last launched projectile id, clients don't launch replicated projectiles */
+	uint32 LastReplicatedId = 0;
+
+	/** [local] last launched local-only projectile id, uses the upper half of the id range */
+	uint32 LastLocalId = 0;
+
+	/** [server] this frame's impacts, and projectiles that ran out of lifetime without one */
+	TArray<FProjectileImpactEvent> PendingImpacts;
+	TArray<uint32> PendingExpired;
+
+	struct FConnectionState
+	{
+		/** projectiles the connection was sent the spawn of, the only ones it's sent the impact of */
+		TSet<uint32> KnownProjectiles;
+	};
+	TMap<TWeakObjectPtr<APlayerController>, FConnectionState> ConnectionStates;
+
+	/** [server] reused between frames to avoid reallocating */
+	FProjectileEventBatch Batch;
+
+	void SendPendingEvents();
+};
@@ -3,31 +3,166 @@
 
 #include "Weapons/States/WeaponStateFiring.h"
 
+#include "Character/BaseFPSCharacter.h"
+
 void UWeaponStateFiring::BeginState(UWeaponState* PrevState)
 {
-	GetWorldTimerManager().SetTimer(RefireCheckHandle, this, &ThisClass::RefireCheck, OuterWeapon->GetRefireTime(OuterWeapon->CurrentFireMode), true);
-	FireShot();
+	const double Now = GetWorld()->GetTimeSeconds();
+	const float RefireTime = FMath::Max(OuterWeapon->GetRefireTime(OuterWeapon->GetCurrentFireMode()), UE_KINDA_SMALL_NUMBER);
+	const float TimeSinceLastShot = FiringEndTime >= 0.0 ? OverflowTime + static_cast<float>(Now - FiringEndTime) : RefireTime;
+
+	FiringStartFrame = GFrameCounter;
+	OuterWeapon->ShotsFiredThisSequence = 0;
+	OuterWeapon->ClientProjectilesThisSequence = 0;
+	UnconfirmedShots.Reset();
+	if (TimeSinceLastShot >= RefireTime)
+	{
+		RefireTimeAccumulator = 0.f;
+		FiringStartTime = Now;
+		FireShot();
+	}
+	else
+	{
+		// the last sequence's refire time hasn't passed yet, the first shot fires from Tick once it has
+		RefireTimeAccumulator = TimeSinceLastShot;
+		FiringStartTime = Now + (RefireTime - TimeSinceLastShot);
+	}
+}
+
+void UWeaponStateFiring::EndState()
+{
+	OverflowTime = RefireTimeAccumulator;
+	FiringEndTime = GetWorld()->GetTimeSeconds();
+
+	// the sequence ended without the client's shot count (e.g. out of ammo), nothing left to drop
+	ConfirmShots(TNumericLimits<double>::Max());
+
+	// lets the clients that saw this sequence's shots stop their firing effects
+	ABaseFPSCharacter* CharacterOwner = GetCharacterOwner();
+	if (CharacterOwner && OuterWeapon->HasAuthority())
+	{
+		CharacterOwner->ClearFiringInfo();
+	}
 }
 
 void UWeaponStateFiring::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (NeedsShotConfirmation())
+	{
+		ConfirmShots(GetWorld()->GetTimeSeconds() - SyncShotTimeTolerance);
+	}
+
+	if (GFrameCounter == FiringStartFrame)
+	{
+		return; // the sequence started this frame, its time is already accounted for
+	}
+
+	const float RefireTime = FMath::Max(OuterWeapon->GetRefireTime(OuterWeapon->GetCurrentFireMode()), UE_KINDA_SMALL_NUMBER);
+	RefireTimeAccumulator += DeltaTime;
+
+	int32 ShotsThisTick = 0;
+	while (RefireTimeAccumulator >= RefireTime)
+	{
+		if (ShotsThisTick >= MaxShotsPerTick)
+		{
+			// drop the remaining owed shots, but keep the phase of the next shot
+			RefireTimeAccumulator = FMath::Fmod(RefireTimeAccumulator, RefireTime);
+			break;
+		}
+
+		// what remains in the accumulator is how long ago this shot was due, it's only spent if the shot fires
+		// so a sequence that stops here leaves a full refire time as its overflow
+		const float ShotAge = RefireTimeAccumulator - RefireTime;
+		if (!RefireCheck(ShotAge))
+		{
+			break; // no longer firing
+		}
+		RefireTimeAccumulator = ShotAge;
+		++ShotsThisTick;
+	}
 }
 
-void UWeaponStateFiring::EndState()
+void UWeaponStateFiring::FireShot(float ShotAge)
 {
-	GetWorldTimerManager().ClearAllTimersForObject(this);
+	OuterWeapon->FireShot(ShotAge);
 }
 
-void UWeaponStateFiring::FireShot()
+bool UWeaponStateFiring::RefireCheck(float ShotAge)
 {
-	OuterWeapon->FireShot();
+	if (OuterWeapon->HandleContinuedFiring())
+	{
+		FireShot(ShotAge);
+		return true;
+	}
+	return false;
 }
 
-void UWeaponStateFiring::RefireCheck()
+void UWeaponStateFiring::SyncShotCount(int32 ClientShotCount)
 {
-	if (OuterWeapon->HandleContinuedFiring())
+	const int32 ServerShotCount = OuterWeapon->ShotsFiredThisSequence;
+	if (ClientShotCount < ServerShotCount)
 	{
-		FireShot();
+		// the client stopped before we did, drop the shots it never fired before they're applied
+		UnconfirmedShots.RemoveAll([ClientShotCount](const FHitscanShotResult& Shot)
+		{
+			return Shot.Request.ShotIndex >= ClientShotCount;
+		});
+		OuterWeapon->RefundAmmoInClip(OuterWeapon->GetCurrentFireMode(), ServerShotCount - ClientShotCount);
+		ConfirmShots(TNumericLimits<double>::Max());
+		return;
+	}
+	ConfirmShots(TNumericLimits<double>::Max());
+
+	// the first shot fires as the sequence starts, every further one a refire time later
+	const float RefireTime = FMath::Max(OuterWeapon->GetRefireTime(OuterWeapon->GetCurrentFireMode()), UE_KINDA_SMALL_NUMBER);
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double Elapsed = Now - FiringStartTime + SyncShotTimeTolerance;
+	const int32 MaxShotCount = 1 + FMath::FloorToInt32(Elapsed / RefireTime);
+	if (ClientShotCount > MaxShotCount)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Client fired more shots than its firing sequence allows (Weapon=%s, ClientShots=%d, MaxShots=%d)"), *OuterWeapon->GetName(), ClientShotCount, MaxShotCount);
+	}
+
+	// owed shots keep the times they were due at, so they're traced (and rewound) where the client fired them
+	const int32 OwedShots = FMath::Min(FMath::Min(ClientShotCount, MaxShotCount) - ServerShotCount, MaxShotsPerTick);
+	for (int32 i = 0; i < OwedShots; ++i)
+	{
+		const double DueTime = FiringStartTime + (ServerShotCount + i) * RefireTime;
+		if (!RefireCheck(FMath::Max(static_cast<float>(Now - DueTime), 0.f)))
+		{
+			break;
+		}
+	}
+}
+
+void UWeaponStateFiring::OnShotResolved(const FHitscanShotResult& Result)
+{
+	// shots resolved after the sequence ended (e.g. the owed shots above) have already been confirmed
+	if (OuterWeapon->CurrentState == this && NeedsShotConfirmation())
+	{
+		UnconfirmedShots.Add(Result);
+	}
+	else
+	{
+		OuterWeapon->ShotResolved(Result);
+	}
+}
+
+bool UWeaponStateFiring::NeedsShotConfirmation() const
+{
+	const ABaseFPSCharacter* CharacterOwner = GetCharacterOwner();
+	return OuterWeapon->HasAuthority() && CharacterOwner && !CharacterOwner->IsLocallyControlled();
+}
+
+void UWeaponStateFiring::ConfirmShots(double ShotTime)
+{
+	int32 NumConfirmed = 0;
+	while (NumConfirmed < UnconfirmedShots.Num() && UnconfirmedShots[NumConfirmed].Request.ShotTime <= ShotTime)
+	{
+		OuterWeapon->ShotResolved(UnconfirmedShots[NumConfirmed]);
+		++NumConfirmed;
 	}
+	UnconfirmedShots.RemoveAt(0, NumConfirmed, false);
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Weapons/States/WeaponState.h"
+#include "Weapons/WeaponFireQueueSubsystem.h"
 #include "WeaponStateFiring.generated.h"
 
 /**
@@ -18,22 +19,86 @@ public:
 	// Constructor
 	UWeaponStateFiring(const FObjectInitializer& ObjectInitializer)
 		: Super(ObjectInitializer)
+		, MaxShotsPerTick(10)
+		, SyncShotTimeTolerance(0.1f)
+		, RefireTimeAccumulator(0.f)
+		, FiringStartFrame(0)
+		, FiringStartTime(0.0)
+		, OverflowTime(0.f)
+		, FiringEndTime(-1.0)
 	{}
 
 protected:
-	FTimerHandle RefireCheckHandle;
+	/** the max number of owed shots fired in a single tick, keeps a long hitch from turning into a huge burst */
+	UPROPERTY(EditDefaultsOnly, Category="Firing", meta=(ClampMin=1))
+	int32 MaxShotsPerTick;
+
+	/**
+	 * [server] extra seconds of firing granted to a client's shot count when its sequence ends, covers the jitter
+	 * between its start and stop fire requests. Shots beyond what the sequence's duration allows aren't fired.
+	 * Also how long a remote client's resolved shots are held before they're applied, so shots the client never
+	 * fired can be dropped before they deal damage or play effects */
+	UPROPERTY(EditDefaultsOnly, Category="Firing", meta=(ClampMin=0))
+	float SyncShotTimeTolerance;
+
+	/**
+	 * time elapsed since the last shot was fired (or was due), refires are spent from this accumulator so shots
+	 * fire at their exact interval regardless of frame rate, several per tick if the interval is shorter than a frame */
+	float RefireTimeAccumulator;
+
+	/** the frame the firing sequence started on, the first shot already accounts for that frame's time */
+	uint64 FiringStartFrame;
+
+	/** the world time the firing sequence's first shot was due at */
+	double FiringStartTime;
+
+	/**
+	 * how far the last firing sequence ran past its last shot when it ended (what was left in the accumulator),
+	 * the next sequence's first shot waits out whatever is left of the refire time so re-pressing can't beat it */
+	float OverflowTime;
+
+	/** the world time the last firing sequence ended at, negative if none has */
+	double FiringEndTime;
+
+	/**
+	 * [server] a remote client's resolved shots that haven't been applied yet, in the order they were fired. They're
+	 * confirmed by the client's shot count when the sequence ends, or once SyncShotTimeTolerance passes without it ending */
+	TArray<FHitscanShotResult> UnconfirmedShots;
 
 public:
 	//~Begin UWeaponState interface
 	virtual void BeginState(UWeaponState* PrevState) override;
-	virtual void Tick(float DeltaTime) override;
 	virtual void EndState() override;
+	virtual void Tick(float DeltaTime) override;
 	//~End UWeaponState interface
 
-	/** calls fire shot on weapon */
-	virtual void FireShot();
+	/** the world time the current sequence's first shot was (or will be) fired at */
+	double GetFiringStartTime() const { return FiringStartTime; }
+
+	/**
+	 * calls fire shot on weapon
+	 * @param ShotAge how long ago (in seconds) the shot was due, i.e. its sub-tick offset from the current time */
+	virtual void FireShot(float ShotAge=0.0f);
 	
-	/** called after refire delay -- usually either fire or go back to active state */
-	virtual void RefireCheck();
+	/**
+	 * called once the refire delay has elapsed -- usually either fire or go back to active state
+	 * @return true if the shot was fired and the weapon is still firing */
+	virtual bool RefireCheck(float ShotAge);
+
+	/**
+	 * [server] reconciles the sequence's shots with the client's before it ends: fires the shots the client fired that
+	 * we haven't yet (e.g. due to jitter) at the ages they were due, as many as the sequence's duration and refire time
+	 * allow, and drops the shots we fired that the client didn't before they're applied, giving back their ammo */
+	void SyncShotCount(int32 ClientShotCount);
+
+	/** called by the fire queue once a shot fired from this state has been resolved */
+	virtual void OnShotResolved(const FHitscanShotResult& Result);
+
+protected:
+	/** [server] is this state firing for a remote client, i.e. do its shots need confirming before they're applied */
+	bool NeedsShotConfirmation() const;
+
+	/** [server] applies the unconfirmed shots fired at or before ShotTime */
+	void ConfirmShots(double ShotTime);
 	
 };
@@ -4,6 +4,8 @@
 #include "TP_WeaponComponent.h"
 #include "Character/BaseFPSCharacter.h"
 #include "BaseFPSProjectile.h"
+#include "Player/BaseFPSPlayerController.h"
+#include "GameFramework/ProjectileMovementComponent.h"
 #include "GameFramework/PlayerController.h"
 #include "Camera/PlayerCameraManager.h"
 #include "Kismet/GameplayStatics.h"
@@ -40,8 +42,25 @@ void UTP_WeaponComponent::Fire()
 			FActorSpawnParameters ActorSpawnParams;
 			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
 	
-			// Spawn the projectile at the muzzle
-			World->SpawnActor<ABaseFPSProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+			UProjectileManagerSubsystem* ProjectileManager = World->GetSubsystem<UProjectileManagerSubsystem>();
+			if (ProjectileManager && UProjectileManagerSubsystem::ShouldManage(ProjectileClass))
+			{
+				// no actor, the manager simulates it from the class defaults
+				const FVector Velocity = SpawnRotation.Vector() * ProjectileClass->GetDefaultObject<ABaseFPSProjectile>()->GetProjectileMovement()->InitialSpeed;
+				const uint32 PredictedId = ProjectileManager->LaunchProjectile(ProjectileClass, SpawnLocation, Velocity, Character);
+
+				// a client only predicts the launch, the server's projectile is the one that hits
+				ABaseFPSPlayerController* BasePC = Cast<ABaseFPSPlayerController>(PlayerController);
+				if (BasePC && World->GetNetMode() == NM_Client)
+				{
+					BasePC->ServerLaunchProjectile(ProjectileClass, SpawnLocation, Velocity, PredictedId);
+				}
+			}
+			else
+			{
+				// Spawn the projectile at the muzzle
+				World->SpawnActor<ABaseFPSProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+			}
 		}
 	}
 	
@@ -5,8 +5,17 @@
 
 #include "BaseFPS.h"
 #include "WeaponAttachment.h"
+#include "WeaponFireQueueSubsystem.h"
+#include "BaseFPSProjectile.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Inventory/InventoryList.h"
 #include "Net/UnrealNetwork.h"
+#include "Online/LagCompensationSubsystem.h"
 #include "Pickups/PickupInstance_Weapon.h"
+#include "ProjectileManagerSubsystem.h"
+#include "Sound/SoundAttenuation.h"
+#include "System/ActorPoolSubsystem.h"
 
 #include "States/WeaponState.h"
 #include "States/WeaponStateActive.h"
@@ -61,6 +70,10 @@ AWeapon::AWeapon(const FObjectInitializer& ObjectInitializer)
 
 	bPendingReload = false;
 	ReloadTime = 2.2f;
+
+	ClientFireStartTime = -1.f;
+	ShotsFiredThisSequence = 0;
+	ClientProjectilesThisSequence = 0;
 	
 	// States
 	InactiveState = ObjectInitializer.CreateDefaultSubobject<UWeaponStateInactive>(this, TEXT("StateInactive"));
@@ -98,11 +111,7 @@ void AWeapon::PostInitializeComponents()
 	ReloadingState->SetOuterWeapon(this);
 	GotoState(InactiveState);
 
-	CurrentAmmoInClip = MaxAmmoPerClip;
-	if (InitialReserveAmmo > 0)
-	{
-		AddAmmoToReserve(InitialReserveAmmo);
-	}
+	ResetAmmo();
 }
 
 // Called when the game starts or when spawned
@@ -116,6 +125,29 @@ void AWeapon::Destroyed()
 	Super::Destroyed();
 }
 
+void AWeapon::OnReleasedToPool()
+{
+	if (CurrentState != InactiveState)
+	{
+		GotoState(InactiveState);
+	}
+	if (Mesh->GetAttachParent())
+	{
+		// only a weapon still in hand, detaching also stops the hands' montages (a stowed weapon's owner may be firing another)
+		DetachMeshFromPawn();
+	}
+	ClearPendingFire();
+	CurrentFireMode = 0;
+	ClientFireStartTime = -1.f;
+	ShotsFiredThisSequence = 0;
+	ClientProjectilesThisSequence = 0;
+	bPendingReload = false;
+
+	// back to what a freshly spawned weapon carries
+	Super::OnReleasedToPool();
+	ResetAmmo();
+}
+
 void AWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -161,6 +193,25 @@ void AWeapon::OnRemovedFromInventory()
 	Super::OnRemovedFromInventory();
 }
 
+void AWeapon::InitStowedState(FInventoryEntry& Entry) const
+{
+	// same as ResetAmmo()
+	Entry.AmmoInClip = MaxAmmoPerClip;
+	Entry.ReserveAmmo = FMath::Clamp(InitialReserveAmmo, 0, MaxReserveAmmo);
+}
+
+void AWeapon::StowState(FInventoryEntry& Entry) const
+{
+	Entry.AmmoInClip = CurrentAmmoInClip;
+	Entry.ReserveAmmo = CurrentReserveAmmo;
+}
+
+void AWeapon::RestoreStowedState(const FInventoryEntry& Entry)
+{
+	CurrentAmmoInClip = FMath::Clamp(Entry.AmmoInClip, 0, MaxAmmoPerClip);
+	CurrentReserveAmmo = FMath::Clamp(Entry.ReserveAmmo, 0, MaxReserveAmmo);
+}
+
 void AWeapon::BringUp(float OverflowTime /*=0.0f*/)
 {
 	UE_LOG(LogTemp, Log, TEXT("BringUp (Weapon=%s, bServer=%d)!!!"), *GetName(), HasAuthority());
@@ -232,18 +283,20 @@ void AWeapon::DropFrom(const FVector& StartLocation)
 
 			const FVector PickupLocation = Hit.ImpactPoint + FVector(0.f, 0.f, 2.f); // need to raise off the ground a little to avoid clipping
 			const FTransform Transform = FTransform(PickupRotation, PickupLocation);
-			if (APickupInstance_Weapon* Pickup = GetWorld()->SpawnActorDeferred<APickupInstance_Weapon>(PickupClass,
-				Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn))
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+			if (UActorPoolSubsystem::AcquireActor(GetWorld(), PickupClass, Transform, SpawnParams, [this](AActor* Pickup)
+				{
+					CastChecked<APickupInstance_Weapon>(Pickup)->SetDroppedWeapon(this);
+				}))
 			{
 				UE_LOG(LogTemp, Warning, TEXT("Spawned Pickup!"));
-				Pickup->SetDroppedWeapon(this);
-				Pickup->FinishSpawning(Transform);
 			}
 			return;
 		}
 	}
 	// destroy is checks fail...
-	Destroy();
+	UActorPoolSubsystem::ReleaseActor(this);
 }
 
 /************************************************************************/
@@ -329,7 +382,11 @@ void AWeapon::StartFire(uint8 InFireMode)
 	bool bClientFired = BeginFiringSequence(InFireMode, false);
 	if (!HasAuthority())
 	{
-		ServerStartFire(InFireMode, bClientFired);
+		// the first shot may still be waiting out the last sequence's refire time
+		const UWeaponStateFiring* FiringState = Cast<UWeaponStateFiring>(CurrentState);
+		const float FirstShotDelay = FiringState ? FMath::Max(static_cast<float>(FiringState->GetFiringStartTime() - GetWorld()->GetTimeSeconds()), 0.f) : 0.f;
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+		ServerStartFire(InFireMode, bClientFired, (GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds()) + FirstShotDelay);
 	}
 }
 
@@ -339,22 +396,32 @@ void AWeapon::StopFire(uint8 InFireMode)
 	EndFiringSequence(InFireMode);
 	if (!HasAuthority())
 	{
-		ServerStopFire(InFireMode);
+		ServerStopFire(InFireMode, ShotsFiredThisSequence);
 	}
 }
 
-void AWeapon::ServerStartFire_Implementation(uint8 InFireMode, bool bClientFired)
+void AWeapon::ServerStartFire_Implementation(uint8 InFireMode, bool bClientFired, float ClientFireTime)
 {
 	if (!CharacterOwner->IsEquipped(this) && !CharacterOwner->IsLocallyControlled())
 	{
 		CharacterOwner->ClientVerifyWeapon();
 		return;
 	}
+
+	ClientFireStartTime = ClientFireTime;
 	BeginFiringSequence(InFireMode, bClientFired);
 }
 
-void AWeapon::ServerStopFire_Implementation(uint8 InFireMode)
+void AWeapon::ServerStopFire_Implementation(uint8 InFireMode, int32 ClientShotCount)
 {
+	// make sure we fired every shot the client did before we stop
+	if (FireModes.IsValidIndex(InFireMode) && CurrentState == FireModes[InFireMode].FiringState)
+	{
+		if (UWeaponStateFiring* FiringState = Cast<UWeaponStateFiring>(CurrentState))
+		{
+			FiringState->SyncShotCount(ClientShotCount);
+		}
+	}
 	EndFiringSequence(InFireMode);
 }
 
@@ -388,9 +455,17 @@ bool AWeapon::HandleContinuedFiring()
 	return true;
 }
 
-void AWeapon::FireShot()
+void AWeapon::FireShot(float ShotAge)
 {
 	ConsumeAmmoInClip(CurrentFireMode);
+	++ShotsFiredThisSequence;
+
+	if (UProjectileManagerSubsystem::ShouldManage(FireModes[CurrentFireMode].ProjectileClass))
+	{
+		FireProjectile();
+		PlayFiringEffects();
+		return;
+	}
 	
 	const FVector StartLoc = GetFireStartLocation(CurrentFireMode);
 	const FRotator BaseRot = GetBaseFireRotation();
@@ -398,21 +473,113 @@ void AWeapon::FireShot()
 	const FVector FireDir = BaseRot.Vector();
 	const FVector EndTrace = StartLoc + FireDir * 1000.f;
 
-	const ECollisionChannel TraceChannel = COLLISION_TRACE_WEAPON;
-	
-	FHitResult OutHit;
-	FCollisionQueryParams TraceParams(GetClass()->GetFName(), false, CharacterOwner);
-	GetWorld()->LineTraceSingleByChannel(OutHit, StartLoc, EndTrace, TraceChannel, TraceParams);
+	FHitscanShotRequest Request;
+	Request.FiringState = Cast<UWeaponStateFiring>(FireModes[CurrentFireMode].FiringState);
+	Request.Shooter = CharacterOwner;
+	Request.Start = StartLoc;
+	Request.End = EndTrace;
+	Request.FireMode = CurrentFireMode;
+	Request.ShotIndex = ShotsFiredThisSequence - 1;
+	Request.ShotTime = GetWorld()->GetTimeSeconds() - ShotAge;
 
-	if (OutHit.bBlockingHit)
+	const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if (LagCompensation && ClientFireStartTime >= 0.f && HasAuthority() && !CharacterOwner->IsLocallyControlled() && ULagCompensationSubsystem::IsEnabled())
 	{
-		UE_LOG(LogTemp, Log, TEXT("Hit!!! (Target=%s)"), *GetNameSafe(OutHit.GetActor()));
+		// the client fires its sequence at the same fixed interval, so each shot carries its own client timestamp
+		const float ClientShotTime = ClientFireStartTime + (ShotsFiredThisSequence - 1) * GetRefireTime(CurrentFireMode);
+		Request.RewindTime = LagCompensation->GetRewindTime(CharacterOwner, ClientShotTime, Request.ShotTime);
 	}
 
-	CharacterOwner->SetFlashLocation(OutHit.bBlockingHit ? OutHit.ImpactPoint : EndTrace, CurrentFireMode);
+	UWeaponFireQueueSubsystem* FireQueue = GetWorld()->GetSubsystem<UWeaponFireQueueSubsystem>();
+	if (FireQueue && Request.FiringState.IsValid())
+	{
+		FireQueue->EnqueueShot(Request);
+	}
+	else
+	{
+		FHitscanShotResult Result;
+		Result.Request = Request;
+		UWeaponFireQueueSubsystem::ResolveShot(GetWorld(), Result.Request, Result.Hit);
+		if (UWeaponStateFiring* FiringState = Result.Request.FiringState.Get())
+		{
+			FiringState->OnShotResolved(Result);
+		}
+		else
+		{
+			ShotResolved(Result);
+		}
+	}
 	PlayFiringEffects();
 }
 
+void AWeapon::FireProjectile()
+{
+	UProjectileManagerSubsystem* ProjectileManager = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>();
+	if (!ProjectileManager || !CharacterOwner)
+	{
+		return;
+	}
+
+	const TSubclassOf<ABaseFPSProjectile> ProjectileClass = FireModes[CurrentFireMode].ProjectileClass;
+	const float Speed = ProjectileClass->GetDefaultObject<ABaseFPSProjectile>()->GetProjectileMovement()->InitialSpeed;
+	const FVector StartLoc = GetFireStartLocation(CurrentFireMode);
+	const FVector Velocity = GetBaseFireRotation().Vector() * Speed;
+
+	if (!HasAuthority())
+	{
+		// only a prediction, the server launches the projectile that counts from where we aimed
+		const uint32 PredictedId = ProjectileManager->LaunchProjectile(ProjectileClass, StartLoc, Velocity, CharacterOwner);
+		ServerFireProjectile(CurrentFireMode, StartLoc, Velocity, PredictedId);
+		return;
+	}
+
+	// a remote client's projectiles are launched by its ServerFireProjectile
+	if (CharacterOwner->IsLocallyControlled())
+	{
+		ProjectileManager->LaunchProjectile(ProjectileClass, StartLoc, Velocity, CharacterOwner);
+	}
+	CharacterOwner->IncrementFlashCounter(CurrentFireMode);
+}
+
+void AWeapon::ServerFireProjectile_Implementation(uint8 InFireMode, FVector_NetQuantize Location, FVector_NetQuantize Velocity, uint32 PredictedId)
+{
+	// the server fires the sequence alongside the client, a couple of shots of slack covers the client firing first
+	if (!FireModes.IsValidIndex(InFireMode) || CurrentState != FireModes[InFireMode].FiringState || ClientProjectilesThisSequence >= ShotsFiredThisSequence + 2)
+	{
+		return;
+	}
+
+	UProjectileManagerSubsystem* ProjectileManager = GetWorld()->GetSubsystem<UProjectileManagerSubsystem>();
+	const TSubclassOf<ABaseFPSProjectile> ProjectileClass = FireModes[InFireMode].ProjectileClass;
+	if (!ProjectileManager || !UProjectileManagerSubsystem::ShouldManage(ProjectileClass) || !UProjectileManagerSubsystem::IsPlausibleClientLaunch(CharacterOwner, Location))
+	{
+		return;
+	}
+	++ClientProjectilesThisSequence;
+
+	// only the direction is the client's, the speed is the class'
+	const float Speed = ProjectileClass->GetDefaultObject<ABaseFPSProjectile>()->GetProjectileMovement()->InitialSpeed;
+	ProjectileManager->LaunchProjectile(ProjectileClass, Location, Velocity.GetSafeNormal() * Speed, CharacterOwner, Cast<APlayerController>(CharacterOwner->GetController()), PredictedId);
+}
+
+void AWeapon::ShotResolved(const FHitscanShotResult& Result)
+{
+	if (Result.Hit.bBlockingHit)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Hit!!! (Target=%s)"), *GetNameSafe(Result.Hit.GetActor()));
+
+		if (ABaseFPSCharacter* HitCharacter = Cast<ABaseFPSCharacter>(Result.Hit.GetActor()))
+		{
+			HitCharacter->NotifyCombatEvent();
+		}
+	}
+
+	if (CharacterOwner)
+	{
+		CharacterOwner->SetFlashLocation(Result.GetEndPoint(), Result.Request.FireMode, FImpactEffectInfo::FromHit(Result.Hit));
+	}
+}
+
 bool AWeapon::CanFireAgain() const
 {
 	return (CharacterOwner && !CharacterOwner->GetPendingWeapon()) && HasAmmoInClip(CurrentFireMode);
@@ -427,6 +594,21 @@ float AWeapon::GetRefireTime(uint8 InFireMode) const
 	return 0.1f;
 }
 
+float AWeapon::GetAudibleRange(uint8 InFireMode) const
+{
+	if (!FireModes.IsValidIndex(InFireMode))
+	{
+		return 0.f;
+	}
+
+	const FFireMode& FireMode = FireModes[InFireMode];
+	if (FireMode.FireSoundAttenuation && FireMode.FireSoundAttenuation->Attenuation.bAttenuate)
+	{
+		return FireMode.FireSoundAttenuation->Attenuation.GetMaxDimension();
+	}
+	return FireMode.AudibleRange;
+}
+
 FVector AWeapon::GetFireStartLocation(uint8 FireMode) const
 {
 	if (!CharacterOwner)
@@ -467,12 +649,13 @@ void AWeapon::SpawnTrailEffect(uint8 FireMode, const FVector& EndPoint)
 	DrawDebugLine(GetWorld(), StartPoint, EndPoint, FColor::Green, false, 1.0f, 0, 0.3f);
 }
 
-void AWeapon::SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint)
+void AWeapon::SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact)
 {
-	FHitResult Hit = AWeapon::GetImpactEffectHit(CharacterOwner, GetMuzzleLocation(), EndPoint);
-	if (AActor* HitActor = Hit.GetActor())
+	const FImpactEffectInfo ImpactInfo = Impact.bKnown ? Impact :
+		FImpactEffectInfo::FromHit(AWeapon::GetImpactEffectHit(CharacterOwner, GetMuzzleLocation(), EndPoint));
+	if (ImpactInfo.bBlockingHit)
 	{
-		const bool bHitCharacter = HitActor->IsA(ABaseFPSCharacter::StaticClass());
+		const bool bHitCharacter = ImpactInfo.bHitCharacter;
 		DrawDebugPoint(GetWorld(), EndPoint, bHitCharacter ? 10.f : 6.f,  bHitCharacter ? FColor::Red : FColor::Green, false, 0.8f);		
 	}
 }
@@ -546,6 +729,28 @@ void AWeapon::ConsumeAmmoInClip(int32 InFireMode)
 	}
 }
 
+void AWeapon::RefundAmmoInClip(int32 InFireMode, int32 NumShots)
+{
+	if (HasAuthority() && !HasInfiniteClip() && FireModes.IsValidIndex(InFireMode) && NumShots > 0)
+	{
+		CurrentAmmoInClip = FMath::Min(CurrentAmmoInClip + FireModes[InFireMode].AmmoCost * NumShots, MaxAmmoPerClip);
+		if (CharacterOwner)
+		{
+			CharacterOwner->NotifyAmmoUpdated(this);
+		}
+	}
+}
+
+void AWeapon::ResetAmmo()
+{
+	CurrentAmmoInClip = MaxAmmoPerClip;
+	CurrentReserveAmmo = 0;
+	if (InitialReserveAmmo > 0)
+	{
+		AddAmmoToReserve(InitialReserveAmmo);
+	}
+}
+
 void AWeapon::AddAmmoToReserve(int32 AddAmount)
 {
 	if (HasAuthority())
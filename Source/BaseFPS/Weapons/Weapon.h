@@ -7,11 +7,13 @@
 #include "Inventory/Inventory.h"
 #include "Weapon.generated.h"
 
+class ABaseFPSProjectile;
 class UWeaponStateReloading;
 class UWeaponStateFiring;
 class AWeaponAttachment;
 class APickupInstance_Weapon;
 class UAnimMontage;
+class USoundAttenuation;
 class UWeaponState;
 class UWeaponStateActive;
 class UWeaponStateInactive;
@@ -30,20 +32,39 @@ struct FFireMode
 	UPROPERTY(EditDefaultsOnly, Category="Animation")
 	UAnimMontage* FireAnim;
 	
-	/** the time between shots (or refire checks) */
-	UPROPERTY(EditDefaultsOnly, Category="Weapon", meta = (ClampMin = 0.1f))
+	/**
+	 * the time between shots (or refire checks), can be shorter than a frame (several shots are fired per tick).
+	 * The 0.01s minimum (6000 rounds per minute) is what the firing state's MaxShotsPerTick of 10 covers at a 10Hz worst-case tick */
+	UPROPERTY(EditDefaultsOnly, Category="Weapon", meta = (ClampMin = 0.01f))
 	float FiringInterval;
 	
 	/** the ammo cost to fire a single shot */
 	UPROPERTY(EditAnywhere, Category = "Weapon", meta = (ClampMin = 0))
 	int32 AmmoCost;
 
+	/**
+	 * attenuation of the shot's sound, its falloff distance is how far away other players hear the shot (see
+	 * UCosmeticFireRelevancySubsystem). Takes precedence over AudibleRange */
+	UPROPERTY(EditDefaultsOnly, Category="Sound")
+	USoundAttenuation* FireSoundAttenuation;
+
+	/** how far away (cm) other players hear the shot when there's no FireSoundAttenuation, 0 uses BaseFPS.CosmeticFire.AudibleDist */
+	UPROPERTY(EditDefaultsOnly, Category="Sound", meta = (ClampMin = 0))
+	float AudibleRange;
+
+	/** fired through UProjectileManagerSubsystem when the class opts in (see bSimulateWithManager), shots are hitscan otherwise */
+	UPROPERTY(EditDefaultsOnly, Category="Weapon")
+	TSubclassOf<ABaseFPSProjectile> ProjectileClass;
+
 	// Constructor
 	FFireMode()
 		: FiringState()
 		, FireAnim()
 		, FiringInterval(0.2f)
 		, AmmoCost(1)
+		, FireSoundAttenuation()
+		, AudibleRange(0.f)
+		, ProjectileClass()
 	{}
 };
 
@@ -81,6 +102,11 @@ protected:
 	//~ Begin AInventory interface
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	//~ End AInventory interface
+
+public:
+	//~ Begin IPoolableActor interface
+	virtual void OnReleasedToPool() override;
+	//~ End IPoolableActor interface
 	
 public:	
 	// Called every frame
@@ -102,6 +128,9 @@ public:
 	//~ Begin AInventory interface
 	virtual void OnAddedToInventory(ABaseFPSCharacter* NewOwner) override;
 	virtual void OnRemovedFromInventory() override;
+	virtual void InitStowedState(FInventoryEntry& Entry) const override;
+	virtual void StowState(FInventoryEntry& Entry) const override;
+	virtual void RestoreStowedState(const FInventoryEntry& Entry) override;
 	//~ End AInventory interface
 	
 	/**
@@ -232,22 +261,53 @@ public:
 	void StartFire(uint8 InFireMode);
 	void StopFire(uint8 InFireMode);
 	
+	/**
+	 * @param ClientFireTime the server world time as seen by the client when it fired the sequence's first shot,
+	 *                       every further shot's client time is a refire time after the previous one */
+	UFUNCTION(Server, Reliable)
+	void ServerStartFire(uint8 InFireMode, bool bClientFired, float ClientFireTime);
+
+	/** @param ClientShotCount the number of shots the client fired during this firing sequence */
 	UFUNCTION(Server, Reliable)
-	void ServerStartFire(uint8 InFireMode, bool bClientFired);
+	void ServerStopFire(uint8 InFireMode, int32 ClientShotCount);
 
+	/**
+	 * launches the managed projectile of a shot the client fired, and predicted as PredictedId. Only accepted while the
+	 * fire mode's firing state is active and the client isn't too many shots ahead */
 	UFUNCTION(Server, Reliable)
-	void ServerStopFire(uint8 InFireMode);
+	void ServerFireProjectile(uint8 InFireMode, FVector_NetQuantize Location, FVector_NetQuantize Velocity, uint32 PredictedId);
 	
 	/** sends this weapon to it's firing state, returns true if a shot is fired this frame */
 	bool BeginFiringSequence(uint8 InFireMode, bool bClientFired);
 	void EndFiringSequence(uint8 InFireMode);
 
 protected:
+	/** [server] the client's timestamp for the first shot of this firing sequence, used to rewind targets (negative for local shooters) */
+	UPROPERTY(Transient)
+	float ClientFireStartTime;
+
+	/** the number of shots fired since the current firing sequence began */
+	UPROPERTY(Transient)
+	int32 ShotsFiredThisSequence;
+
+	/** [server] the number of projectiles the client launched since the current firing sequence began */
+	UPROPERTY(Transient)
+	int32 ClientProjectilesThisSequence;
+
 	/** Checks to see if weapon should continue firing, or sends it back to active state */
 	bool HandleContinuedFiring();
 	
+	/**
+	 * fires a single shot, hitscan shots are queued and resolved with the rest of the frame's shots
+	 * @param ShotAge how long ago (in seconds) the shot was due, used to timestamp shots fired within the same tick */
 	UFUNCTION(BlueprintCallable, Category="Weapon")
-	virtual void FireShot();
+	virtual void FireShot(float ShotAge=0.0f);
+
+	/** launches the fire mode's managed projectile, a client predicts it and has the server launch it (see ServerFireProjectile) */
+	virtual void FireProjectile();
+
+	/** called once a queued hitscan shot has been resolved (see {@code UWeaponFireQueueSubsystem}) */
+	virtual void ShotResolved(const struct FHitscanShotResult& Result);
 
 public:
 	/** can this weapon fire again (after already starting firing)? */
@@ -255,6 +315,9 @@ public:
 
 	/** the weapon's next fire time based on its fire interval */
 	float GetRefireTime(uint8 InFireMode) const;
+
+	/** how far away (cm) a shot of the fire mode can be heard, 0 if the fire mode doesn't say (see FFireMode::AudibleRange) */
+	float GetAudibleRange(uint8 InFireMode) const;
 	
 	FVector GetFireStartLocation(uint8 FireMode) const;
 	FRotator GetBaseFireRotation() const;
@@ -263,7 +326,8 @@ public:
 	virtual void PlayFiringEffects();
 	
 	void SpawnTrailEffect(uint8 FireMode, const FVector& EndPoint);
-	void SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint);
+	/** spawns impact effects at EndPoint, only traces for the hit if Impact doesn't already describe it */
+	void SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact);
 	
 	/** get the muzzle location of the weapon */
 	FVector GetMuzzleLocation() const;
@@ -271,7 +335,7 @@ public:
 	/** get direction of weapon's muzzle */
 	FVector GetMuzzleDirection() const;
 
-	/** Used by both AWeapon & AWeaponAttachment to find a hit result for impact effects */
+	/** Used by both AWeapon & AWeaponAttachment to find a hit result for impact effects, when none came with the shot */
 	static FHitResult GetImpactEffectHit(APawn* Shooter, const FVector& StartLoc, const FVector& TargetLoc);
 	
 	/************************************************************************/
@@ -316,12 +380,19 @@ protected:
 
 	UFUNCTION()
 	void OnRep_Ammo();
+
+	/** full clip and initial reserve ammo, as spawned */
+	void ResetAmmo();
 	
 public:
 	/** is there enough ammo in clip to fire? */
 	bool HasAmmoInClip(uint8 InFireMode) const;
 
 	void ConsumeAmmoInClip(int32 InFireMode);
+
+	/** [server] gives back the clip ammo of shots the server fired but the client didn't */
+	void RefundAmmoInClip(int32 InFireMode, int32 NumShots);
+
 	void AddAmmoToReserve(int32 AddAmount);
 	
 	/** get max ammo amount (reserve) */
@@ -57,6 +57,17 @@ void AWeaponAttachment::Destroyed()
 	Super::Destroyed();
 }
 
+void AWeaponAttachment::OnAcquiredFromPool()
+{
+	CharacterOwner = Cast<ABaseFPSCharacter>(Owner);
+}
+
+void AWeaponAttachment::OnReleasedToPool()
+{
+	DetachFromOwner();
+	CharacterOwner = nullptr;
+}
+
 void AWeaponAttachment::AttachToOwnerEquipped()
 {
 	if (!CharacterOwner)
@@ -102,14 +113,15 @@ void AWeaponAttachment::SpawnTrailEffect(uint8 FireMode, const FVector& EndPoint
 	}
 }
 
-void AWeaponAttachment::SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint)
+void AWeaponAttachment::SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact)
 {
 	if (!CharacterOwner->IsLocallyControlled())
 	{
-		FHitResult Hit = AWeapon::GetImpactEffectHit(CharacterOwner, GetMuzzleLocation(), EndPoint);
-		if (AActor* HitActor = Hit.GetActor())
+		const FImpactEffectInfo ImpactInfo = Impact.bKnown ? Impact :
+			FImpactEffectInfo::FromHit(AWeapon::GetImpactEffectHit(CharacterOwner, GetMuzzleLocation(), EndPoint));
+		if (ImpactInfo.bBlockingHit)
 		{
-			const bool bHitCharacter = HitActor->IsA(ABaseFPSCharacter::StaticClass());
+			const bool bHitCharacter = ImpactInfo.bHitCharacter;
 			DrawDebugPoint(GetWorld(), EndPoint, bHitCharacter ? 10.f : 6.f,  bHitCharacter ? FColor::Red : FColor::Green, false, 0.8f);		
 		}
 	}
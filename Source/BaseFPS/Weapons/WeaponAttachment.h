@@ -4,16 +4,18 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "System/PoolableActor.h"
 #include "WeaponAttachment.generated.h"
 
 class ABaseFPSCharacter;
 class AWeapon;
+struct FImpactEffectInfo;
 /**
  * This is the world/3rd person representation of a weapon
  * Note: does not spawn/exist on dedicated servers (since it's visual only)
  */
 UCLASS()
-class BASEFPS_API AWeaponAttachment : public AActor
+class BASEFPS_API AWeaponAttachment : public AActor, public IPoolableActor
 {
 	GENERATED_BODY()
 	
@@ -28,6 +30,12 @@ protected:
 	//~ Begin AActor interface
 	virtual void Destroyed() override;
 	//~ End AActor interface
+
+public:
+	//~ Begin IPoolableActor interface
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+	//~ End IPoolableActor interface
 	
 protected:
 	UPROPERTY(Transient)
@@ -66,9 +74,13 @@ public:
 
 	/** plays effects like particles and sound on weapon fire */
 	virtual void PlayFiringEffects(uint8 FireMode);
+
+	/** stops looping firing effects once the owner stops firing, the base attachment only plays one-shot effects */
+	virtual void StopFiringEffects(uint8 FireMode) {}
 	
 	void SpawnTrailEffect(uint8 FireMode, const FVector& EndPoint);
-	void SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint);
+	/** spawns impact effects at EndPoint, only traces for the hit if Impact doesn't already describe it */
+	void SpawnImpactEffects(uint8 FireMode, const FVector& EndPoint, const FImpactEffectInfo& Impact);
 
 	/** get the muzzle location of the weapon */
 	FVector GetMuzzleLocation() const;
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapons/WeaponFireQueueSubsystem.h"
+
+#include "BaseFPS.h"
+#include "Async/ParallelFor.h"
+#include "Online/LagCompensationSubsystem.h"
+#include "Weapons/States/WeaponStateFiring.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fire Queue: Batched Traces"), STAT_BaseFPS_FireQueueBatchedTraces, STATGROUP_BaseFPS);
+DECLARE_CYCLE_STAT(TEXT("Fire Queue: Resolve Batch"), STAT_BaseFPS_FireQueueResolveBatch, STATGROUP_BaseFPS);
+
+/* -------------- CVars -------------- */
+
+int32 CVar_BaseFPS_FireQueue_MinParallelBatchSize = 8;
+static FAutoConsoleVariableRef CVarBaseFPSFireQueueMinParallelBatchSize(TEXT("BaseFPS.FireQueue.MinParallelBatchSize"), CVar_BaseFPS_FireQueue_MinParallelBatchSize, TEXT("Batches smaller than this are resolved on the game thread"), ECVF_Default );
+
+// ----------------------------------------------------------------------------------------------------------
+
+bool UWeaponFireQueueSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	bool bShouldCreateSubsystem = Super::ShouldCreateSubsystem(Outer);
+
+	if (Outer)
+	{
+		if (UWorld* World = Outer->GetWorld())
+		{
+			bShouldCreateSubsystem = DoesSupportWorldType(World->WorldType) && bShouldCreateSubsystem;
+		}
+	}
+
+	return bShouldCreateSubsystem;
+}
+
+void UWeaponFireQueueSubsystem::Deinitialize()
+{
+	PendingShots.Empty();
+	BatchResults.Empty();
+	BatchShots.Empty();
+	BatchHitboxes.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWeaponFireQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UWeaponFireQueueSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingShots.Num() > 0)
+	{
+		ResolvePendingShots();
+	}
+}
+
+TStatId UWeaponFireQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponFireQueueSubsystem, STATGROUP_Tickables);
+}
+
+void UWeaponFireQueueSubsystem::EnqueueShot(const FHitscanShotRequest& Request)
+{
+	PendingShots.Add(Request);
+}
+
+bool UWeaponFireQueueSubsystem::ResolveShot(const UWorld* World, const FHitscanShotRequest& Request, FHitResult& OutHit)
+{
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponFire), false, Request.Shooter.Get());
+	TraceParams.bReturnPhysicalMaterial = true; // surface type is sent along with the shot for impact effects
+
+	const ULagCompensationSubsystem* LagCompensation = (Request.RewindTime >= 0.f) ? World->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+	if (LagCompensation)
+	{
+		// world geometry is tested as it is now, characters as they were when the shooter fired
+		World->LineTraceSingleByChannel(OutHit, Request.Start, Request.End, COLLISION_TRACE_WEAPON, TraceParams, WorldResponseParams);
+		const FVector WorldHitLoc = OutHit.bBlockingHit ? FVector(OutHit.ImpactPoint) : Request.End;
+		LagCompensation->RewindTrace(Request.Shooter.Get(), Request.RewindTime, Request.Start, WorldHitLoc, OutHit);
+	}
+	else
+	{
+		World->LineTraceSingleByChannel(OutHit, Request.Start, Request.End, COLLISION_TRACE_WEAPON, TraceParams);
+	}
+	return OutHit.bBlockingHit;
+}
+
+void UWeaponFireQueueSubsystem::ResolvePendingShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BaseFPS_FireQueueResolveBatch);
+	INC_DWORD_STAT_BY(STAT_BaseFPS_FireQueueBatchedTraces, PendingShots.Num());
+
+	// swap out the pending list, anything fired while dispatching goes into next frame's batch
+	BatchResults.Reset(PendingShots.Num());
+	for (FHitscanShotRequest& Request : PendingShots)
+	{
+		BatchResults.AddDefaulted_GetRef().Request = MoveTemp(Request);
+	}
+	PendingShots.Reset();
+
+	// game thread: resolve the weak pointers and snapshot the rewound hitboxes, workers never touch a UObject
+	const UWorld* World = GetWorld();
+	const ULagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULagCompensationSubsystem>();
+	BatchShots.Reset(BatchResults.Num());
+	BatchHitboxes.Reset();
+	for (const FHitscanShotResult& Result : BatchResults)
+	{
+		FBatchedShot& Shot = BatchShots.AddDefaulted_GetRef();
+		Shot.Shooter = Result.Request.Shooter.Get();
+		if (LagCompensation && Result.Request.RewindTime >= 0.f)
+		{
+			Shot.FirstHitbox = BatchHitboxes.Num();
+			LagCompensation->GatherHitboxes(Shot.Shooter, Result.Request.RewindTime, BatchHitboxes);
+			Shot.NumHitboxes = BatchHitboxes.Num() - Shot.FirstHitbox;
+		}
+	}
+
+	// workers: scene queries only read from the physics scene, nothing is allowed to move it until the batch is done
+	const EParallelForFlags Flags = BatchResults.Num() < CVar_BaseFPS_FireQueue_MinParallelBatchSize ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+	ParallelFor(BatchResults.Num(), [this, World, LagCompensation](int32 Index)
+	{
+		FHitscanShotResult& Result = BatchResults[Index];
+		FBatchedShot& Shot = BatchShots[Index];
+
+		FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponFire), false, Shot.Shooter);
+		TraceParams.bReturnPhysicalMaterial = true; // surface type is sent along with the shot for impact effects
+
+		if (LagCompensation && Result.Request.RewindTime >= 0.f)
+		{
+			// world geometry is tested as it is now, characters as they were when the shooter fired
+			World->LineTraceSingleByChannel(Result.Hit, Result.Request.Start, Result.Request.End, COLLISION_TRACE_WEAPON, TraceParams, WorldResponseParams);
+			const FVector WorldHitLoc = Result.Hit.bBlockingHit ? FVector(Result.Hit.ImpactPoint) : Result.Request.End;
+			const TConstArrayView<FLagCompensationHitbox> Hitboxes(BatchHitboxes.GetData() + Shot.FirstHitbox, Shot.NumHitboxes);
+			const int32 HitIdx = ULagCompensationSubsystem::TraceHitboxes(Hitboxes, Result.Request.Start, WorldHitLoc, Shot.HitboxHitTime);
+			Shot.HitHitbox = HitIdx != INDEX_NONE ? Shot.FirstHitbox + HitIdx : INDEX_NONE;
+		}
+		else
+		{
+			World->LineTraceSingleByChannel(Result.Hit, Result.Request.Start, Result.Request.End, COLLISION_TRACE_WEAPON, TraceParams);
+		}
+	}, Flags);
+
+	// game thread: turn rewound hitbox hits into hit results and dispatch
+	for (int32 i = 0; i < BatchResults.Num(); ++i)
+	{
+		FHitscanShotResult& Result = BatchResults[i];
+		const FBatchedShot& Shot = BatchShots[i];
+		if (Shot.HitHitbox != INDEX_NONE)
+		{
+			const FVector WorldHitLoc = Result.Hit.bBlockingHit ? FVector(Result.Hit.ImpactPoint) : Result.Request.End;
+			LagCompensation->MakeHitboxHit(BatchHitboxes[Shot.HitHitbox], Result.Request.Start, WorldHitLoc, Shot.HitboxHitTime, Result.Hit);
+		}
+
+		if (UWeaponStateFiring* FiringState = Result.Request.FiringState.Get())
+		{
+			FiringState->OnShotResolved(Result);
+		}
+	}
+}
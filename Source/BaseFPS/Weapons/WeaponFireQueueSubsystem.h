@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Online/LagCompensationSubsystem.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WeaponFireQueueSubsystem.generated.h"
+
+class UWeaponStateFiring;
+
+/** A single hitscan shot waiting to be resolved */
+struct FHitscanShotRequest
+{
+	/** the firing state the result is dispatched back to */
+	TWeakObjectPtr<UWeaponStateFiring> FiringState;
+
+	/** the actor firing the shot, ignored by the trace */
+	TWeakObjectPtr<const AActor> Shooter;
+
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+
+	uint8 FireMode = 0;
+
+	/** the shot's index within its firing sequence */
+	int32 ShotIndex = 0;
+
+	/** world time the shot was fired at (sub-tick accurate) */
+	float ShotTime = 0.f;
+
+	/** [server] world time to test character hitboxes at, negative if the shot is not lag compensated */
+	float RewindTime = -1.f;
+};
+
+/** The resolved hit for a {@code FHitscanShotRequest} */
+struct FHitscanShotResult
+{
+	FHitscanShotRequest Request;
+	FHitResult Hit;
+
+	/** the shot's end point, i.e. the impact point if something was hit, else the end of the trace */
+	FVector GetEndPoint() const
+	{
+		return Hit.bBlockingHit ? FVector(Hit.ImpactPoint) : Request.End;
+	}
+};
+
+/**
+ * Per-world queue for hitscan weapon fire. Weapons enqueue their shots as they fire, and the queue resolves
+ * every shot fired this frame as a single batch once all actors have ticked. Anything touching UObjects (the
+ * shooters, the rewound hitboxes) is gathered on the game thread first, worker threads only run the scene queries
+ * and the hitbox math (ParallelFor), and the results are applied back on the game thread before the net driver
+ * replicates the frame.
+ */
+UCLASS()
+class BASEFPS_API UWeaponFireQueueSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ Begin USubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	//~ End USubsystem interface
+
+	//~ Begin FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableGameObject interface
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+	/** adds a shot to be resolved with this frame's batch */
+	void EnqueueShot(const FHitscanShotRequest& Request);
+
+	/**
+	 * Resolves a single shot immediately, for shots that can't wait for the batch (game thread only)
+	 * @return true if anything was hit */
+	static bool ResolveShot(const UWorld* World, const FHitscanShotRequest& Request, FHitResult& OutHit);
+
+private:
+	/** what the worker threads need to resolve a batched shot, gathered on the game thread */
+	struct FBatchedShot
+	{
+		/** the shooter, ignored by the scene query */
+		const AActor* Shooter = nullptr;
+
+		/** the shot's rewound hitboxes in {@code BatchHitboxes} (none if the shot is not lag compensated) */
+		int32 FirstHitbox = 0;
+		int32 NumHitboxes = 0;
+
+		/** the rewound hitbox hit by the shot (filled by the worker), INDEX_NONE if none */
+		int32 HitHitbox = INDEX_NONE;
+		float HitboxHitTime = 1.f;
+	};
+
+	/** per-shot worker inputs/outputs, indices match {@code BatchResults} */
+	TArray<FBatchedShot> BatchShots;
+
+	/** the rewound hitboxes of every lag compensated shot in the batch */
+	TArray<FLagCompensationHitbox> BatchHitboxes;
+
+	/** shots fired this frame, waiting to be resolved */
+	TArray<FHitscanShotRequest> PendingShots;
+
+	/** reused between frames to avoid reallocating */
+	TArray<FHitscanShotResult> BatchResults;
+
+	/** resolves every pending shot and dispatches the results */
+	void ResolvePendingShots();
+};